@@ -0,0 +1,97 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+
+#include <cstdlib>
+#include <climits>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "cipher.hpp"
+#include "lsb_matching.hpp"
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+cv::Mat generate_image(int rows, int cols, int type)
+{
+	cv::Mat image(rows, cols, type);
+	for(int i = 0; i < image.rows; i++){
+		uchar* ptr = image.ptr<uchar>(i);
+		for(int j = 0; j < image.cols*image.channels(); j++)
+			ptr[j] = rand()%(UCHAR_MAX+1);
+	}
+
+	return image;
+}
+
+/*
+ * the mean time of `n_rounds` calls of `f`, after one more to warm
+ * the caches
+ */
+template<typename F>
+double mean_us(int n_rounds, F f)
+{
+	f();
+
+	auto begin = std::chrono::steady_clock::now();
+	for(int i = 0; i < n_rounds; i++)
+		f();
+	auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		end - begin).count()/1000.0/n_rounds;
+}
+
+/*
+ * the lsb matching embedding of a payload filling the cover, in the
+ * clear, encrypted by a separate pass over a copy of the payload and
+ * encrypted in the embedding loop
+ */
+int main(int argc, char** argv)
+{
+	int rows = argc > 1 ? atoi(argv[1]) : 1080;
+	int cols = argc > 2 ? atoi(argv[2]) : 1920;
+	int n_rounds = argc > 3 ? atoi(argv[3]) : 10;
+
+	cv::Mat cover = generate_image(rows, cols, CV_8UC3);
+	cv::Mat stego;
+
+	std::vector<char> data = generate_data(
+		(size_t) rows*cols*cover.channels()/CHAR_BIT);
+	std::vector<char> key = generate_data(16);
+
+	stegim::lsb_matching_permutation permutation(cover, key);
+	stegim::lsb_matching_options lsbm_opt;
+
+	std::cout << "Image: " << rows << "x" << cols << ", "
+		<< data.size() << " bytes" << std::endl;
+
+	std::cout << "clear: " << mean_us(n_rounds, [&]{
+		stegim::lsb_matching_embed(cover, stego, data, permutation, lsbm_opt);
+	}) << " us" << std::endl;
+
+	std::cout << "separate pass: " << mean_us(n_rounds, [&]{
+		const uint8_t nonce[stegim::chacha20_nonce_size] = {};
+		std::vector<char> ciphertext(data);
+		stegim::chacha20_xor(permutation.get_cipher_key(), nonce, 0,
+			ciphertext.data(), ciphertext.size());
+		stegim::lsb_matching_embed(cover, stego, ciphertext, permutation,
+			lsbm_opt);
+	}) << " us" << std::endl;
+
+	lsbm_opt.set_encryption(true);
+	std::cout << "fused: " << mean_us(n_rounds, [&]{
+		stegim::lsb_matching_embed(cover, stego, data, permutation, lsbm_opt);
+	}) << " us" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,204 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+
+#include <cstdlib>
+#include <climits>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "capacity.hpp"
+#include "frame.hpp"
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+/*
+ * JSON records with random fields, the text payloads
+ */
+std::vector<char> generate_text(size_t n)
+{
+	const char* names[] = { "alpha", "beta", "gamma", "delta" };
+
+	std::string text;
+	while(text.size() < n)
+		text += "{\"id\": " + std::to_string(rand()%1000) +
+			", \"name\": \"" + names[rand()%4] +
+			"\", \"active\": " + (rand()%2 ? "true" : "false") + "}\n";
+
+	return std::vector<char>(text.begin(), text.begin() + n);
+}
+
+cv::Mat generate_image(int rows, int cols, int type)
+{
+	cv::Mat image(rows, cols, type);
+	for(int i = 0; i < image.rows; i++){
+		uchar* ptr = image.ptr<uchar>(i);
+		for(int j = 0; j < image.cols*image.channels(); j++)
+			ptr[j] = rand()%(UCHAR_MAX+1);
+	}
+
+	return image;
+}
+
+/*
+ * the mean time of `n_rounds` calls of `f`, after one more to warm
+ * the caches
+ */
+template<typename F>
+double mean_us(int n_rounds, F f)
+{
+	f();
+
+	auto begin = std::chrono::steady_clock::now();
+	for(int i = 0; i < n_rounds; i++)
+		f();
+	auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		end - begin).count()/1000.0/n_rounds;
+}
+
+void print(const std::string& name, double us, double base_us)
+{
+	std::cout << name << ": " << us << " us";
+	if(base_us)
+		std::cout << " (" << std::showpos << 100*(us - base_us)/base_us
+			<< std::noshowpos << "%)";
+	std::cout << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	int rows = argc > 1 ? atoi(argv[1]) : 1080;
+	int cols = argc > 2 ? atoi(argv[2]) : 1920;
+	int n_rounds = argc > 3 ? atoi(argv[3]) : 20;
+
+	cv::Mat cover = generate_image(rows, cols, CV_8UC1);
+	std::string key("frame");
+
+	/*
+	 * the data of a frame with parity filling the cover
+	 */
+	stegim::frame_options crc_opt;
+	crc_opt.set_parity(false);
+
+	size_t size = stegim::capacity(cover)*223/255 - 64;
+	std::vector<char> data = generate_data(size), extracted;
+
+	std::cout << "Image: " << rows << "x" << cols << ", " << size
+		<< " bytes of data, frame of " << stegim::frame_size(size)
+		<< " bytes" << std::endl;
+
+	size_t n = stegim::frame_size(size);
+	cv::Mat stego;
+	stegim::lsb_embed_framed(cover, stego, data);
+
+	double lsb_us = mean_us(n_rounds, [&]{
+		stegim::lsb_extract(stego, extracted, n);
+	});
+	print("lsb extract", lsb_us, 0);
+
+	print("lsb extract, crc", mean_us(n_rounds, [&]{
+		std::vector<char> frame;
+		stegim::lsb_extract(stego, frame, n);
+		stegim::frame_decode(frame, extracted, size, crc_opt);
+	}), lsb_us);
+
+	print("lsb extract, crc and parity", mean_us(n_rounds, [&]{
+		stegim::lsb_extract_framed(stego, extracted, size);
+	}), lsb_us);
+
+	stegim::lsb_matching_embed_framed(cover, stego, data, key);
+
+	double lsbm_us = mean_us(n_rounds, [&]{
+		stegim::lsb_matching_extract(stego, extracted, n, key);
+	});
+	print("lsb matching extract", lsbm_us, 0);
+
+	print("lsb matching extract, crc and parity", mean_us(n_rounds, [&]{
+		stegim::lsb_matching_extract_framed(stego, extracted, size, key);
+	}), lsbm_us);
+
+	/*
+	 * the costs of the framing alone
+	 */
+	std::vector<char> frame;
+	stegim::frame_encode(data, frame);
+
+	print("crc32c", mean_us(n_rounds, [&]{
+		volatile uint32_t crc = stegim::crc32c(data.data(), data.size());
+		(void) crc;
+	}), 0);
+
+	print("encode", mean_us(n_rounds, [&]{
+		stegim::frame_encode(data, frame);
+	}), 0);
+
+	/*
+	 * one wrong byte in every codeword, the parity is evaluated
+	 */
+	std::vector<char> corrupted(frame);
+	for(size_t i = 0; i < (size + 230)/223; i++)
+		corrupted[i] ^= 1;
+
+	print("decode, corrected", mean_us(n_rounds, [&]{
+		stegim::frame_decode(corrupted, extracted, size);
+	}), 0);
+
+	/*
+	 * the compressed frames of text and random data: their bytes,
+	 * so the samples embedded, and the cost of the round trip
+	 */
+	std::vector<char> text = generate_text(size);
+	double lsb_text_us = mean_us(n_rounds, [&]{
+		stegim::lsb_embed_framed(cover, stego, text);
+		stegim::lsb_extract_framed(stego, extracted, size);
+	});
+
+	for(stegim::frame_compression compression : {
+		stegim::COMPRESSION_LZ4, stegim::COMPRESSION_ZSTD }){
+
+		if(!stegim::compression_supported(compression))
+			continue;
+
+		std::string name = compression == stegim::COMPRESSION_LZ4 ?
+			"lz4" : "zstd";
+
+		stegim::frame_options compress_opt;
+		compress_opt.set_compression(compression);
+
+		for(bool is_text : { true, false }){
+			const std::vector<char>& payload = is_text ? text : data;
+
+			stegim::frame_encode(payload, frame, compress_opt);
+			std::cout << name << (is_text ? ", text" : ", random")
+				<< ": frame of " << frame.size() << " bytes" << std::endl;
+		}
+
+		print(name + " encode, text", mean_us(n_rounds, [&]{
+			stegim::frame_encode(text, frame, compress_opt);
+		}), 0);
+
+		print(name + " decode, text", mean_us(n_rounds, [&]{
+			stegim::frame_decode(frame, extracted, size, compress_opt);
+		}), 0);
+
+		print(name + " lsb embed and extract, text", mean_us(n_rounds, [&]{
+			stegim::lsb_embed_framed(cover, stego, text,
+				stegim::lsb_options(), compress_opt);
+			stegim::lsb_extract_framed(stego, extracted, size,
+				stegim::lsb_options(), compress_opt);
+		}), lsb_text_us);
+	}
+
+	return 0;
+}
@@ -0,0 +1,156 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+
+#include <jpeglib.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "jsteg.hpp"
+#include "lsb.hpp"
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+/*
+ * a smooth image with some noise, so its JPEG has about the usable
+ * coefficients of a photo
+ */
+cv::Mat generate_image(int rows, int cols)
+{
+	cv::Mat image(rows, cols, CV_8UC3);
+	for(int i = 0; i < image.rows; i++){
+		uchar* ptr = image.ptr<uchar>(i);
+		for(int j = 0; j < image.cols*3; j++)
+			ptr[j] = (i + j/3)%UCHAR_MAX/2 + rand()%8;
+	}
+
+	return image;
+}
+
+std::vector<char> encode_jpeg(const cv::Mat& image, int quality)
+{
+	jpeg_compress_struct cinfo;
+	jpeg_error_mgr jerr;
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_compress(&cinfo);
+
+	unsigned char* out = nullptr;
+	unsigned long out_size = 0;
+	jpeg_mem_dest(&cinfo, &out, &out_size);
+
+	cinfo.image_width = image.cols;
+	cinfo.image_height = image.rows;
+	cinfo.input_components = image.channels();
+	cinfo.in_color_space = JCS_RGB;
+
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, quality, TRUE);
+	jpeg_start_compress(&cinfo, TRUE);
+
+	while(cinfo.next_scanline < cinfo.image_height){
+		JSAMPROW row = (JSAMPROW) image.ptr<uchar>(cinfo.next_scanline);
+		jpeg_write_scanlines(&cinfo, &row, 1);
+	}
+
+	jpeg_finish_compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+
+	std::vector<char> jpeg(out, out + out_size);
+	free(out);
+
+	return jpeg;
+}
+
+cv::Mat decode_jpeg(const std::vector<char>& jpeg)
+{
+	jpeg_decompress_struct cinfo;
+	jpeg_error_mgr jerr;
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_decompress(&cinfo);
+
+	jpeg_mem_src(&cinfo, (unsigned char*) jpeg.data(), jpeg.size());
+	jpeg_read_header(&cinfo, TRUE);
+	cinfo.out_color_space = JCS_RGB;
+	jpeg_start_decompress(&cinfo);
+
+	cv::Mat image(cinfo.output_height, cinfo.output_width, CV_8UC3);
+	while(cinfo.output_scanline < cinfo.output_height){
+		JSAMPROW row = (JSAMPROW) image.ptr<uchar>(cinfo.output_scanline);
+		jpeg_read_scanlines(&cinfo, &row, 1);
+	}
+
+	jpeg_finish_decompress(&cinfo);
+	jpeg_destroy_decompress(&cinfo);
+
+	return image;
+}
+
+int main(int argc, char** argv)
+{
+	int rows = argc > 1 ? atoi(argv[1]) : 1080;
+	int cols = argc > 2 ? atoi(argv[2]) : 1920;
+	int n_rounds = argc > 3 ? atoi(argv[3]) : 5;
+
+	std::vector<char> cover = encode_jpeg(generate_image(rows, cols), 85);
+	size_t capacity = stegim::jsteg_capacity(cover);
+
+	std::vector<char> data = generate_data(capacity/2);
+	std::vector<char> key = generate_data(16);
+
+	std::cout << "Image: " << rows << "x" << cols << "x3, "
+		<< cover.size() << " bytes, " << data.size() << " bytes of data"
+		<< std::endl;
+
+	/*
+	 * the pixel route, which decodes, embeds with lsb_embed and
+	 * encodes again
+	 */
+	uint64_t pixels_ns = 0;
+	for(int i = 0; i < n_rounds; i++){
+		auto begin = std::chrono::steady_clock::now();
+
+		cv::Mat stego;
+		stegim::lsb_embed(decode_jpeg(cover), stego, data);
+		std::vector<char> stego_jpeg = encode_jpeg(stego, 85);
+
+		auto end = std::chrono::steady_clock::now();
+		pixels_ns += std::chrono::duration_cast<
+			std::chrono::nanoseconds>(end - begin).count();
+	}
+
+	uint64_t jsteg_ns = 0;
+	stegim::stats stats;
+	for(int i = 0; i < n_rounds; i++){
+		auto begin = std::chrono::steady_clock::now();
+
+		std::vector<char> stego_jpeg;
+		stegim::jsteg_embed(cover, stego_jpeg, data, key,
+			stegim::jsteg_options().set_stats(&stats));
+
+		auto end = std::chrono::steady_clock::now();
+		jsteg_ns += std::chrono::duration_cast<
+			std::chrono::nanoseconds>(end - begin).count();
+	}
+
+	std::cout << "pixels: " << pixels_ns/n_rounds/1000 << " us/image"
+		<< std::endl;
+	std::cout << "jsteg: " << jsteg_ns/n_rounds/1000 << " us/image ("
+		<< stats.permutation_ns/n_rounds/1000 << " us decoding and "
+		<< "shuffling, " << stats.embedding_ns/n_rounds/1000
+		<< " us embedding)" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,90 @@
+#include <iostream>
+#include <string>
+
+#include <cstdlib>
+#include <climits>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "key_trial.hpp"
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+cv::Mat generate_image(int rows, int cols, int type)
+{
+	cv::Mat image(rows, cols, type);
+	for(int i = 0; i < image.rows; i++){
+		uchar* ptr = image.ptr<uchar>(i);
+		for(int j = 0; j < image.cols*image.channels(); j++)
+			ptr[j] = rand()%(UCHAR_MAX+1);
+	}
+
+	return image;
+}
+
+/*
+ * keys per second of the candidates of a framed embedding, the last
+ * one is the key
+ */
+void bench(
+	const std::string& name,
+	const cv::Mat& cover,
+	const stegim::lsb_matching_options& lsbm_opt,
+	size_t n_keys,
+	int n_threads)
+{
+	std::vector<char> key = generate_data(16);
+	std::vector<char> data = generate_data(4096);
+
+	cv::Mat stego;
+	stegim::lsb_matching_embed_framed(cover, stego, data, key, lsbm_opt);
+
+	std::vector<std::vector<char>> keys;
+	for(size_t i = 0; i + 1 < n_keys; i++)
+		keys.push_back(generate_data(16));
+	keys.push_back(key);
+
+	stegim::key_trial_options trial_opt;
+	trial_opt.set_lsb_matching_options(lsbm_opt).set_threads(n_threads);
+
+	stegim::key_trial_result result =
+		stegim::lsb_matching_try_keys(stego, keys, trial_opt);
+
+	std::cout << name << ": " << result.keys_per_second << " keys/s, "
+		<< result.keys_rejected_by_header << " of " << result.keys_tried
+		<< " rejected by the header"
+		<< (result.found && result.key_index == n_keys - 1 ? "" : ", NOT FOUND")
+		<< std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	int rows = argc > 1 ? atoi(argv[1]) : 1080;
+	int cols = argc > 2 ? atoi(argv[2]) : 1920;
+	int n_threads = argc > 3 ? atoi(argv[3]) : 0;
+
+	cv::Mat cover = generate_image(rows, cols, CV_8UC3);
+	std::cout << "Image: " << rows << "x" << cols << std::endl;
+
+	stegim::lsb_matching_options lsbm_opt;
+	bench("shuffle", cover, lsbm_opt, 8, n_threads);
+	bench("tiles", cover, stegim::lsb_matching_options(lsbm_opt).set_tile_size(64),
+		8, n_threads);
+
+	lsbm_opt.set_feistel(true);
+	bench("feistel", cover, lsbm_opt, 100000, n_threads);
+	bench("feistel, encrypted", cover,
+		stegim::lsb_matching_options(lsbm_opt).set_encryption(true),
+		100000, n_threads);
+
+	return 0;
+}
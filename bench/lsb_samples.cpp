@@ -0,0 +1,100 @@
+#include <iostream>
+#include <string>
+
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "lsb.hpp"
+#include "lsb_matching.hpp"
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+cv::Mat generate_image(int rows, int cols, int type)
+{
+	cv::Mat image(rows, cols, type);
+	for(int i = 0; i < image.rows; i++){
+		uchar* ptr = image.ptr<uchar>(i);
+		for(size_t j = 0; j < image.cols*image.elemSize(); j++)
+			ptr[j] = rand()%(UCHAR_MAX+1);
+	}
+
+	return image;
+}
+
+/*
+ * embeds and extracts with lsb and embeds with lsb matching in a
+ * cover of `type`, the data fills the cover. The samples of 8 and
+ * 16 bits of the same geometry have the same capacity.
+ */
+void bench(const std::string& name, int rows, int cols, int type, int n_rounds)
+{
+	cv::Mat cover = generate_image(rows, cols, type);
+	cv::Mat stego;
+
+	size_t n_samples = (size_t) rows*cols*cover.channels();
+	std::vector<char> data = generate_data(n_samples/CHAR_BIT);
+	std::vector<char> key = generate_data(16);
+
+	stegim::stats embed_stats, extract_stats, lsbm_stats;
+	stegim::lsb_options lsb_opt;
+	stegim::lsb_matching_options lsbm_opt;
+	lsbm_opt.set_stats(&lsbm_stats);
+
+	stegim::lsb_matching_permutation permutation(cover, key);
+
+	/*
+	 * the first round warms the caches and is not counted
+	 */
+	for(int i = 0; i <= n_rounds; i++){
+		if(i == 1){
+			embed_stats.reset();
+			extract_stats.reset();
+			lsbm_stats.reset();
+		}
+
+		stegim::lsb_embed(cover, stego, data,
+			stegim::lsb_options(lsb_opt).set_stats(&embed_stats));
+
+		std::vector<char> extracted;
+		stegim::lsb_extract(stego, extracted, data.size(),
+			stegim::lsb_options(lsb_opt).set_stats(&extract_stats));
+
+		stegim::lsb_matching_embed(cover, stego, data, permutation, lsbm_opt);
+	}
+
+	std::cout << name << " (" << lsbm_stats.isa << "): lsb embed "
+		<< (double) embed_stats.embedding_ns/n_rounds/n_samples
+		<< " ns/sample, lsb extract "
+		<< (double) extract_stats.embedding_ns/n_rounds/n_samples
+		<< " ns/sample, lsb matching "
+		<< (double) lsbm_stats.embedding_ns/n_rounds/(n_samples/2)
+		<< " ns/pair" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	int rows = argc > 1 ? atoi(argv[1]) : 1080;
+	int cols = argc > 2 ? atoi(argv[2]) : 1920;
+	int n_rounds = argc > 3 ? atoi(argv[3]) : 5;
+
+	std::cout << "Image: " << rows << "x" << cols << std::endl;
+
+	bench("8 bits, 1 channel", rows, cols, CV_8UC1, n_rounds);
+	bench("16 bits, 1 channel", rows, cols, CV_16UC1, n_rounds);
+	bench("8 bits, 3 channels", rows, cols, CV_8UC3, n_rounds);
+	bench("16 bits, 3 channels", rows, cols, CV_16UC3, n_rounds);
+
+	return 0;
+}
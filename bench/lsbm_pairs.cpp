@@ -0,0 +1,128 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <random>
+
+#include <cstdlib>
+#include <climits>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "lsb_matching.hpp"
+#include "pixel_kernel.hpp"
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+cv::Mat generate_image(int rows, int cols, int type)
+{
+	cv::Mat image(rows, cols, type);
+	for(int i = 0; i < image.rows; i++){
+		uchar* ptr = image.ptr<uchar>(i);
+		for(int j = 0; j < image.cols*image.channels(); j++)
+			ptr[j] = rand()%(UCHAR_MAX+1);
+	}
+
+	return image;
+}
+
+/*
+ * the pair by pair embedding with the branches of the paper, as
+ * the library did before the vectorized pairs. `stego` must hold
+ * a copy of the cover.
+ */
+void embed_branches(
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const stegim::lsb_matching_permutation& permutation)
+{
+	static std::random_device random;
+
+	const auto& pair = permutation.get_pairs();
+	for(size_t i = 0; i < data.size()*CHAR_BIT/2; i++){
+		uchar* p0 = stego.ptr<uchar>(pair[i].first.x) + pair[i].first.y;
+		uchar* p1 = stego.ptr<uchar>(pair[i].second.x) + pair[i].second.y;
+
+		int m0 = (data[2*i/CHAR_BIT] >> (2*i%CHAR_BIT)) & 1;
+		int m1 = (data[2*i/CHAR_BIT] >> (2*i%CHAR_BIT + 1)) & 1;
+		uchar c0 = *p0, c1 = *p1;
+
+		if(m0 == (c0 & 1)){
+			if((unsigned) m1 != stegim::lsbmr_correlation(c0, c1))
+				*p1 = c1 == 0 ? 1 : c1 == UCHAR_MAX ? c1 - 1 :
+					c1 + ((random()%2) ? 1 : -1);
+		}else if(c0 == 0){
+			*p0 = (unsigned) m1 == stegim::lsbmr_correlation(1, c1) ? 1 : 3;
+		}else if(c0 == UCHAR_MAX){
+			*p0 = (unsigned) m1 == stegim::lsbmr_correlation(254, c1) ?
+				254 : 252;
+		}else if((unsigned) m1 == stegim::lsbmr_correlation(c0 - 1, c1)){
+			*p0 = c0 - 1;
+		}else{
+			*p0 = c0 + 1;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int rows = argc > 1 ? atoi(argv[1]) : 1080;
+	int cols = argc > 2 ? atoi(argv[2]) : 1920;
+	int n_rounds = argc > 3 ? atoi(argv[3]) : 5;
+
+	cv::Mat cover = generate_image(rows, cols, CV_8UC3);
+	cv::Mat stego;
+	std::vector<char> data = generate_data((rows*cols*3)/CHAR_BIT);
+	std::vector<char> key = generate_data(16);
+
+	size_t n_pairs = data.size()*CHAR_BIT/2;
+	stegim::lsb_matching_permutation permutation(cover, key);
+
+	std::cout << "Image: " << rows << "x" << cols << "x3, "
+		<< n_pairs << " pairs" << std::endl;
+
+	/*
+	 * the embedding time, the copy of the cover is left out
+	 */
+	stegim::stats stats;
+	stegim::lsb_matching_options lsbm_opt;
+	lsbm_opt.set_stats(&stats);
+
+	for(int i = 0; i <= n_rounds; i++){
+		if(i == 1)
+			stats.reset();
+
+		stegim::lsb_matching_embed(cover, stego, data, permutation, lsbm_opt);
+	}
+
+	std::cout << "pairs (" << stats.isa << "): "
+		<< (double) stats.embedding_ns/n_rounds/n_pairs << " ns/pair"
+		<< std::endl;
+
+	uint64_t branches_ns = 0;
+	for(int i = 0; i <= n_rounds; i++){
+		cover.copyTo(stego);
+
+		auto begin = std::chrono::steady_clock::now();
+		embed_branches(stego, data, permutation);
+		auto end = std::chrono::steady_clock::now();
+
+		if(i > 0)
+			branches_ns += std::chrono::duration_cast<
+				std::chrono::nanoseconds>(end - begin).count();
+	}
+
+	std::cout << "branches: "
+		<< (double) branches_ns/n_rounds/n_pairs << " ns/pair"
+		<< std::endl;
+
+	return 0;
+}
@@ -0,0 +1,191 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "lsb_matching.hpp"
+
+/*
+ * a hardware counter of the calling thread, as `perf stat` reads
+ * them. It is unavailable if the kernel does not allow it.
+ */
+class perf_counter {
+public:
+	perf_counter(uint32_t type, uint64_t config)
+	{
+		struct perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	}
+
+	~perf_counter()
+	{
+		if(fd >= 0)
+			close(fd);
+	}
+
+	bool available() const
+	{
+		return fd >= 0;
+	}
+
+	void start()
+	{
+		if(fd < 0)
+			return;
+
+		ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+
+	uint64_t stop()
+	{
+		uint64_t count = 0;
+		if(fd < 0)
+			return count;
+
+		ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+		if(read(fd, &count, sizeof(count)) != sizeof(count))
+			count = 0;
+
+		return count;
+	}
+
+private:
+	int fd;
+};
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+cv::Mat generate_image(int rows, int cols, int type)
+{
+	cv::Mat image(rows, cols, type);
+	for(int i = 0; i < image.rows; i++){
+		uchar* ptr = image.ptr<uchar>(i);
+		for(int j = 0; j < image.cols*image.channels(); j++)
+			ptr[j] = rand()%(UCHAR_MAX+1);
+	}
+
+	return image;
+}
+
+void print_count(const char* name, const perf_counter& counter, uint64_t count, size_t n_pairs)
+{
+	std::cout << ", " << name << ": ";
+	if(counter.available())
+		std::cout << (double) count/n_pairs << "/pair";
+	else
+		std::cout << "n/a";
+}
+
+/*
+ * embeds with the permutation of `lsbm_opt`, the data fills the cover
+ */
+void bench(
+	const std::string& name,
+	const cv::Mat& cover,
+	const std::vector<char>& data,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt,
+	int n_rounds)
+{
+	cv::Mat stego;
+	size_t n_pairs = data.size()*CHAR_BIT/2;
+
+	auto begin = std::chrono::steady_clock::now();
+	stegim::lsb_matching_permutation permutation(cover, key, lsbm_opt);
+	auto end = std::chrono::steady_clock::now();
+
+	uint64_t permutation_ms = std::chrono::duration_cast<
+		std::chrono::milliseconds>(end - begin).count();
+
+	stegim::lsb_matching_embed(cover, stego, data, permutation, lsbm_opt);
+
+	perf_counter cache_misses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+	perf_counter tlb_misses(PERF_TYPE_HW_CACHE,
+		PERF_COUNT_HW_CACHE_DTLB |
+		(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		(PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+
+	uint64_t n_cache_misses = 0, n_tlb_misses = 0, embedding_ns = 0;
+	for(int i = 0; i < n_rounds; i++){
+		cover.copyTo(stego);
+
+		/*
+		 * the copy of the cover is left out. The counters are of
+		 * the calling thread only, the workers of a parallel
+		 * embedding are not counted.
+		 */
+		cache_misses.start();
+		tlb_misses.start();
+		begin = std::chrono::steady_clock::now();
+		stegim::lsb_matching_embed(stego, stego, data, permutation, lsbm_opt);
+		end = std::chrono::steady_clock::now();
+		n_cache_misses += cache_misses.stop();
+		n_tlb_misses += tlb_misses.stop();
+
+		embedding_ns += std::chrono::duration_cast<
+			std::chrono::nanoseconds>(end - begin).count();
+	}
+
+	std::cout << name << ": permutation " << permutation_ms << " ms, "
+		<< (double) embedding_ns/n_rounds/n_pairs << " ns/pair";
+
+	print_count("cache misses", cache_misses, n_cache_misses/n_rounds, n_pairs);
+	print_count("dTLB misses", tlb_misses, n_tlb_misses/n_rounds, n_pairs);
+	std::cout << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	int rows = argc > 1 ? atoi(argv[1]) : 4000;
+	int cols = argc > 2 ? atoi(argv[2]) : 6000;
+	int n_rounds = argc > 3 ? atoi(argv[3]) : 3;
+
+	cv::Mat cover = generate_image(rows, cols, CV_8UC3);
+	std::vector<char> data = generate_data((rows*cols*3)/CHAR_BIT);
+	std::vector<char> key = generate_data(16);
+
+	std::cout << "Image: " << rows << "x" << cols << "x3, "
+		<< data.size()*CHAR_BIT/2 << " pairs" << std::endl;
+
+	stegim::lsb_matching_options lsbm_opt;
+	bench("global", cover, data, key, lsbm_opt, n_rounds);
+
+	lsbm_opt.set_tile_size(64);
+	bench("tiles 64", cover, data, key, lsbm_opt, n_rounds);
+
+	lsbm_opt.set_tile_size(256);
+	bench("tiles 256", cover, data, key, lsbm_opt, n_rounds);
+
+	lsbm_opt.set_tile_size(64).set_threads(0);
+	bench("tiles 64, all cores", cover, data, key, lsbm_opt, n_rounds);
+
+	return 0;
+}
@@ -0,0 +1,336 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <new>
+#include <cmath>
+
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "bit_plane.hpp"
+#include "lsb.hpp"
+#include "lsb_matching.hpp"
+
+/*
+ * every heap allocation of the process is counted
+ */
+std::atomic<size_t> n_allocations(0);
+std::atomic<size_t> allocated_bytes(0);
+
+void* operator new(size_t size)
+{
+	n_allocations++;
+	allocated_bytes += size;
+
+	void* p = std::malloc(size ? size : 1);
+	if(!p)
+		throw std::bad_alloc();
+
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+std::vector<char> generate_data(size_t n)
+{
+	std::vector<char> v;
+	for(size_t i = 0; i < n; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+/*
+ * fills `image` with a xorshift generator, rand() is too slow for
+ * hundreds of megapixels
+ */
+void fill_image(cv::Mat& image)
+{
+	uint64_t x = 0x9e3779b97f4a7c15ULL ^ rand();
+	for(int i = 0; i < image.rows; i++){
+		uchar* ptr = image.ptr<uchar>(i);
+		for(int j = 0; j < image.cols*image.channels(); j++){
+			x ^= x << 13;
+			x ^= x >> 7;
+			x ^= x << 17;
+			ptr[j] = x;
+		}
+	}
+}
+
+/*
+ * a field in kB of a /proc file such as /proc/self/status, 0 if it is
+ * missing
+ */
+size_t read_proc_kb(const std::string& path, const std::string& field)
+{
+	std::ifstream file(path);
+	std::string line;
+	while(std::getline(file, line)){
+		if(line.compare(0, field.size() + 1, field + ":") != 0)
+			continue;
+
+		std::istringstream value(line.substr(field.size() + 1));
+		size_t kb = 0;
+		value >> kb;
+		return kb;
+	}
+
+	return 0;
+}
+
+/*
+ * an api measured, run once on an image allocated by the caller
+ */
+struct api_case {
+	std::string name;
+
+	/*
+	 * allowed peak of the resident memory of the call, in images
+	 */
+	double budget;
+
+	std::function<void(cv::Mat& image, const std::vector<char>& data)> run;
+};
+
+/*
+ * resident memory a call may take on top of its budget, whatever the
+ * image: page tables, stacks and the pages of the allocator
+ */
+#define BUDGET_SLACK (1 << 20)
+
+struct measure {
+	size_t peak_bytes;
+	size_t n_allocations;
+	size_t allocated_bytes;
+	double ms;
+};
+
+/*
+ * runs `api` in a child process on a `rows`x`cols` color image, so the
+ * high-water mark of its resident memory is not the one of the cases
+ * before. The peak counts the image and everything allocated by the
+ * call, not the payload. Returns false if the child dies, as killed by
+ * the OOM killer.
+ */
+bool run_case(const api_case& api, int rows, int cols, measure& m)
+{
+	int fds[2];
+	if(pipe(fds) != 0)
+		return false;
+
+	pid_t pid = fork();
+	if(pid < 0)
+		return false;
+
+	if(pid == 0){
+		close(fds[0]);
+
+		std::vector<char> data = generate_data((size_t) rows*cols*3/16);
+
+		/*
+		 * the code, the kernel dispatch and the thread resources
+		 * are set up by a first call on a small image
+		 */
+		cv::Mat small(64, 64, CV_8UC3);
+		fill_image(small);
+		api.run(small, std::vector<char>(64*64*3/16));
+
+		/*
+		 * resets the high-water mark to the current resident
+		 * memory, not allowed by every kernel
+		 */
+		std::ofstream("/proc/self/clear_refs") << "5";
+		size_t baseline_kb = read_proc_kb("/proc/self/status", "VmRSS");
+
+		cv::Mat image(rows, cols, CV_8UC3);
+		fill_image(image);
+
+		size_t allocations = n_allocations, bytes = allocated_bytes;
+		auto begin = std::chrono::steady_clock::now();
+
+		api.run(image, data);
+
+		auto end = std::chrono::steady_clock::now();
+
+		measure child;
+		child.n_allocations = n_allocations - allocations;
+		child.allocated_bytes = allocated_bytes - bytes;
+		child.ms = std::chrono::duration<double, std::milli>(end - begin).count();
+		child.peak_bytes = (read_proc_kb("/proc/self/status", "VmHWM")
+			- baseline_kb)*1024;
+
+		bool written = write(fds[1], &child, sizeof(child)) == sizeof(child);
+		_exit(written ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	close(fds[1]);
+	bool read_all = read(fds[0], &m, sizeof(m)) == sizeof(m);
+	close(fds[0]);
+
+	int status = 0;
+	waitpid(pid, &status, 0);
+
+	return read_all && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+std::vector<api_case> api_cases()
+{
+	std::vector<char> key = generate_data(16);
+
+	return {
+		{ "lsb_embed", 2.1,
+			[](cv::Mat& image, const std::vector<char>& data){
+				cv::Mat stego;
+				stegim::lsb_embed(image, stego, data);
+			} },
+		{ "lsb_embed_in_place", 1.1,
+			[](cv::Mat& image, const std::vector<char>& data){
+				stegim::lsb_embed(image, image, data);
+			} },
+		{ "lsb_extract", 1.1,
+			[](cv::Mat& image, const std::vector<char>& data){
+				std::vector<char> extracted;
+				stegim::lsb_extract(image, extracted, data.size());
+			} },
+		/*
+		 * the global permutation holds the shuffled samples and
+		 * their pairs, 16 bytes per sample
+		 */
+		{ "lsb_matching_embed", 19,
+			[key](cv::Mat& image, const std::vector<char>& data){
+				cv::Mat stego;
+				stegim::lsb_matching_embed(image, stego, data, key);
+			} },
+		{ "lsb_matching_embed_tiles", 11,
+			[key](cv::Mat& image, const std::vector<char>& data){
+				cv::Mat stego;
+				stegim::lsb_matching_embed(image, stego, data, key,
+					stegim::lsb_matching_options().set_tile_size(64));
+			} },
+		{ "lsb_matching_extract", 18,
+			[key](cv::Mat& image, const std::vector<char>& data){
+				std::vector<char> extracted;
+				stegim::lsb_matching_extract(image, extracted,
+					data.size(), key);
+			} },
+		{ "bit_plane_pack", 1.2,
+			[](cv::Mat& image, const std::vector<char>&){
+				std::vector<char> plane;
+				stegim::bit_plane_pack(image, plane);
+			} }
+	};
+}
+
+/*
+ * usage: memory_bench [max megapixels] [csv of the scaling curve]
+ * [api=budget ...]
+ *
+ * Every api is measured on color images from 1 MP up to the maximum,
+ * skipping the ones whose budget does not fit in the available memory.
+ * Fails if a peak is over the budget of its api, in images, plus
+ * BUDGET_SLACK.
+ */
+int main(int argc, char** argv)
+{
+	double max_megapixels = argc > 1 ? atof(argv[1]) : 64;
+	std::ofstream csv;
+	if(argc > 2)
+		csv.open(argv[2]);
+
+	std::vector<api_case> apis = api_cases();
+	for(int i = 3; i < argc; i++){
+		std::string arg(argv[i]);
+		size_t eq = arg.find('=');
+
+		bool known = false;
+		for(api_case& api : apis)
+			if(eq != std::string::npos && arg.substr(0, eq) == api.name){
+				api.budget = atof(arg.c_str() + eq + 1);
+				known = true;
+			}
+
+		if(!known){
+			std::cerr << "Unknown budget: " << arg << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if(csv.is_open())
+		csv << "api,megapixels,rows,cols,image_mb,peak_mb,images,budget,"
+			"allocations,allocated_mb,ms" << std::endl;
+
+	const double megapixels[] = { 1, 2, 4, 8, 16, 32, 64, 128, 256, 500 };
+	bool failed = false;
+
+	for(const api_case& api : apis){
+		std::cout << api.name << " (budget " << api.budget << " images)"
+			<< std::endl;
+
+		for(double mp : megapixels){
+			if(mp > max_megapixels)
+				break;
+
+			int cols = (int) std::lround(std::sqrt(mp*1e6*4/3)/16)*16;
+			int rows = (int) std::lround(mp*1e6/cols);
+			size_t image_bytes = (size_t) rows*cols*3;
+
+			std::cout << "  " << mp << " MP, " << rows << "x" << cols << ": ";
+
+			size_t available = read_proc_kb("/proc/meminfo", "MemAvailable")*1024;
+			if(api.budget*image_bytes > available){
+				std::cout << "skipped, " << available/(1 << 20)
+					<< " MB available" << std::endl;
+				continue;
+			}
+
+			measure m;
+			if(!run_case(api, rows, cols, m)){
+				std::cout << "died" << std::endl;
+				failed = true;
+				continue;
+			}
+
+			double images = (double) m.peak_bytes/image_bytes;
+			bool over = m.peak_bytes > api.budget*image_bytes + BUDGET_SLACK;
+			failed |= over;
+
+			std::cout << m.peak_bytes/(1 << 20) << " MB peak, "
+				<< images << " images, "
+				<< m.n_allocations << " allocations of "
+				<< m.allocated_bytes/(1 << 20) << " MB, "
+				<< m.ms << " ms" << (over ? ", OVER BUDGET" : "")
+				<< std::endl;
+
+			if(csv.is_open())
+				csv << api.name << "," << mp << "," << rows << ","
+					<< cols << "," << image_bytes/(1 << 20) << ","
+					<< m.peak_bytes/(1 << 20) << "," << images << ","
+					<< api.budget << "," << m.n_allocations << ","
+					<< m.allocated_bytes/(1 << 20) << "," << m.ms
+					<< std::endl;
+		}
+	}
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+#include <cstdlib>
+#include <climits>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "bit_plane.hpp"
+#include "lsb.hpp"
+#include "lsb_matching.hpp"
+#include "scratch.hpp"
+
+/*
+ * every heap allocation of the process is counted
+ */
+std::atomic<size_t> n_allocations(0);
+
+void* operator new(size_t size)
+{
+	n_allocations++;
+
+	void* p = std::malloc(size ? size : 1);
+	if(!p)
+		throw std::bad_alloc();
+
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+cv::Mat generate_image(int rows, int cols, int type)
+{
+	cv::Mat image(rows, cols, type);
+	for(int i = 0; i < image.rows; i++){
+		uchar* ptr = image.ptr<uchar>(i);
+		for(int j = 0; j < image.cols*image.channels(); j++)
+			ptr[j] = rand()%(UCHAR_MAX+1);
+	}
+
+	return image;
+}
+
+/*
+ * runs a round of embeddings and extractions with the buffers of the
+ * caller, as a batch job does for each image
+ */
+void run_round(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	std::vector<char>& extracted,
+	std::vector<char>& plane,
+	const std::vector<char>& key)
+{
+	stegim::lsb_embed(cover, stego, data);
+	stegim::lsb_extract(stego, extracted, data.size());
+
+	stegim::lsb_matching_embed(cover, stego, data, key);
+	stegim::lsb_matching_extract(stego, extracted, data.size(), key);
+
+	stegim::lsb_matching_options lsbm_opt;
+	lsbm_opt.set_edge_adaptive(true);
+	stegim::lsb_matching_embed(cover, stego, data, key, lsbm_opt);
+	stegim::lsb_matching_extract(stego, extracted, data.size(), key, lsbm_opt);
+
+	stegim::bit_plane_pack(stego, plane);
+}
+
+/*
+ * runs `n_rounds` rounds after a warm up one, returns the
+ * allocations of the steady state
+ */
+size_t bench(const std::string& name, int n_rounds, int rows, int cols)
+{
+	cv::Mat cover = generate_image(rows, cols, CV_8UC3);
+	cv::Mat stego;
+	std::vector<char> data = generate_data(
+		stegim::edge_region(cover).capacity(0)/2);
+	std::vector<char> extracted, plane;
+	std::vector<char> key = generate_data(16);
+
+	run_round(cover, stego, data, extracted, plane, key);
+
+	size_t before = n_allocations;
+	auto begin = std::chrono::steady_clock::now();
+
+	for(int i = 0; i < n_rounds; i++)
+		run_round(cover, stego, data, extracted, plane, key);
+
+	auto end = std::chrono::steady_clock::now();
+	size_t allocations = n_allocations - before;
+
+	std::cout << name << ": "
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(
+			end - begin).count()/n_rounds << " ms/round, "
+		<< (double) allocations/n_rounds << " allocations/round"
+		<< std::endl;
+
+	return allocations;
+}
+
+int main(int argc, char** argv)
+{
+	int rows = argc > 1 ? atoi(argv[1]) : 1080;
+	int cols = argc > 2 ? atoi(argv[2]) : 1920;
+	int n_rounds = argc > 3 ? atoi(argv[3]) : 5;
+
+	std::cout << "Image: " << rows << "x" << cols << "x3" << std::endl;
+
+	stegim::set_scratch_resource(stegim::new_delete_scratch_resource());
+	bench("new/delete", n_rounds, rows, cols);
+
+	stegim::arena_resource small_pages(1 << 20, false);
+	stegim::set_scratch_resource(&small_pages);
+	size_t n = bench("arena", n_rounds, rows, cols);
+
+	stegim::arena_resource huge_pages;
+	stegim::set_scratch_resource(&huge_pages);
+	n += bench("arena, huge pages", n_rounds, rows, cols);
+
+	std::cout << "Arena reserved: " << huge_pages.reserved()/(1 << 20)
+		<< " MB in " << huge_pages.blocks_mapped() << " maps" << std::endl;
+
+	stegim::set_scratch_resource(nullptr);
+
+	return n == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
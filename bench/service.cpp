@@ -0,0 +1,143 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+#include <csignal>
+#include <cstdlib>
+#include <climits>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "capacity.hpp"
+#include "lsb_matching.hpp"
+#include "service.hpp"
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+cv::Mat generate_image(int rows, int cols, int type)
+{
+	cv::Mat image(rows, cols, type);
+	for(int i = 0; i < image.rows; i++){
+		uchar* ptr = image.ptr<uchar>(i);
+		for(int j = 0; j < image.cols*image.channels(); j++)
+			ptr[j] = rand()%(UCHAR_MAX+1);
+	}
+
+	return image;
+}
+
+/*
+ * times `n_jobs` runs of `job`, and prints their median and 99th
+ * percentile
+ */
+template<typename JOB>
+void bench(const std::string& name, int n_jobs, JOB job)
+{
+	std::vector<double> us;
+	for(int i = 0; i < n_jobs; i++){
+		auto begin = std::chrono::steady_clock::now();
+		job();
+		auto end = std::chrono::steady_clock::now();
+
+		us.push_back(std::chrono::duration<double, std::micro>(
+			end - begin).count());
+	}
+
+	std::sort(us.begin(), us.end());
+	std::cout << name << ": median " << us[us.size()/2] << " us, p99 "
+		<< us[std::min(us.size() - 1, us.size()*99/100)] << " us"
+		<< std::endl;
+}
+
+/*
+ * the latency of embedding a frame: in process from the key, as a
+ * short lived process does, in process with the permutation kept, and
+ * through the service, whose frame is shared. The cover is copied in
+ * the stego frame by every job.
+ */
+void bench_geometry(
+	const std::string& socket_path,
+	int rows,
+	int cols,
+	int n_jobs)
+{
+	std::cout << "Image: " << rows << "x" << cols << "x3" << std::endl;
+
+	cv::Mat cover = generate_image(rows, cols, CV_8UC3), stego;
+	std::vector<char> data = generate_data(
+		stegim::lsb_matching_capacity(cover)/2);
+	std::vector<char> key = generate_data(16);
+
+	bench("in process, key", n_jobs, [&](){
+		stegim::lsb_matching_embed(cover, stego, data, key);
+	});
+
+	stegim::lsb_matching_permutation permutation(cover, key);
+	bench("in process, permutation", n_jobs, [&](){
+		stegim::lsb_matching_embed(cover, stego, data, permutation);
+	});
+
+	stegim::service_client client;
+	if(!client.connect(socket_path)){
+		std::cerr << "Cannot connect to " << socket_path << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	stegim::shared_frame frame(rows, cols, CV_8UC3);
+	bench("service, first job", 1, [&](){
+		cover.copyTo(frame.mat());
+		client.embed(frame, data, key);
+	});
+
+	bench("service", n_jobs, [&](){
+		cover.copyTo(frame.mat());
+		if(!client.embed(frame, data, key)){
+			std::cerr << "Job failed" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+	});
+}
+
+int main(int argc, char** argv)
+{
+	int n_jobs = argc > 1 ? atoi(argv[1]) : 20;
+
+	std::string socket_path = "/tmp/stegim_bench_" +
+		std::to_string(getpid()) + ".sock";
+
+	/*
+	 * the service runs in its own process, as the daemon
+	 */
+	pid_t pid = fork();
+	if(pid == 0){
+		stegim::service service(socket_path);
+		service.run();
+		_exit(EXIT_SUCCESS);
+	}
+
+	stegim::service_client probe;
+	for(int i = 0; i < 100 && !probe.connect(socket_path); i++)
+		usleep(10000);
+
+	bench_geometry(socket_path, 480, 640, n_jobs);
+	bench_geometry(socket_path, 1080, 1920, n_jobs);
+
+	kill(pid, SIGKILL);
+	waitpid(pid, nullptr, 0);
+	unlink(socket_path.c_str());
+
+	return 0;
+}
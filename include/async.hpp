@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "lsb.hpp"
+#include "lsb_matching.hpp"
+
+/*
+ * the awaitable of a job is only declared to the callers built with
+ * coroutines, the library itself does not need them
+ */
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#define STEGIM_COROUTINES
+#endif
+
+namespace stegim {
+
+/** The `async_options` class provides the optional arguments of the
+  * async calls, in the same fashion of `lsb_options`.
+  */
+class async_options {
+public:
+	async_options();
+
+	virtual ~async_options();
+
+	/** Samples of the image visited by each chunk of work, 1M by
+	  * default. The cancellation takes effect between two chunks,
+	  * so smaller chunks stop sooner at the cost of more tasks.
+	  */
+	virtual async_options& set_chunk_size(size_t chunk_size);
+
+	/** Calls `progress(done, total)` after each chunk, with the
+	  * chunks done and the chunks of the whole job. It is called by
+	  * the threads of the pool, one call at a time, and not after
+	  * the job is cancelled.
+	  */
+	virtual async_options& set_progress(
+		std::function<void(size_t done, size_t total)> progress);
+
+	virtual size_t get_chunk_size() const;
+	virtual const std::function<void(size_t, size_t)>& get_progress() const;
+
+private:
+	size_t chunk_size;
+	std::function<void(size_t, size_t)> progress;
+};
+
+struct async_state;
+
+/** The `async_job` class is the handle of a call running in chunks on
+  * the thread pool of the library, one thread per core. The copies of
+  * a handle refer to the same job.
+  *
+  * The images and the output vector given to the call must outlive
+  * the job and not be touched until it is done. The input data is
+  * copied by the call.
+  */
+class async_job {
+public:
+	/** A job already done, as cancelled.
+	  */
+	async_job();
+
+	/** Used by the async calls.
+	  */
+	async_job(const std::shared_ptr<async_state>& state);
+
+	virtual ~async_job();
+
+	/** Asks the job to stop. The chunks not started are skipped and
+	  * the permutation of lsb matching polls it while computed, so
+	  * the job is done shortly after. The output is then partial: the
+	  * stego image of an embedding is the cover with the chunks done
+	  * before the cancellation embedded, and the data of an
+	  * extraction is zero past the chunks done.
+	  */
+	virtual void cancel();
+
+	/** Whether the job is done, completed or cancelled.
+	  */
+	virtual bool done() const;
+
+	/** Waits for the job. Must not be called from a progress or a
+	  * completion callback.
+	  *
+	  * @return		Whether the job completed, false if it was
+	  *			cancelled.
+	  */
+	virtual bool wait();
+
+	/** Calls `callback(completed)` once the job is done, from the
+	  * thread of the pool that finishes it, or at once if it is
+	  * already done. A job holds a single callback, a new one
+	  * replaces the one not yet called.
+	  */
+	virtual void on_complete(std::function<void(bool completed)> callback);
+
+private:
+	std::shared_ptr<async_state> state;
+};
+
+/** Same as `lsb_embed`, running in chunks of rows on the thread pool.
+  * `stego` is allocated before returning. The delta is not supported
+  * and the stats sink is not used.
+  *
+  * @see lsb_embed
+  */
+async_job lsb_embed_async(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const lsb_options& lsb_opt = lsb_options(),
+	const async_options& async_opt = async_options());
+
+/** Same as `lsb_extract`, running in chunks of rows on the thread
+  * pool. `data` is sized before returning.
+  *
+  * @see lsb_extract
+  */
+async_job lsb_extract_async(
+	const cv::Mat& stego,
+	std::vector<char>& data,
+	int size = -1,
+	const lsb_options& lsb_opt = lsb_options(),
+	const async_options& async_opt = async_options());
+
+/** Same as `lsb_matching_embed`. The permutation is computed by a
+  * first chunk, in a single thread, then the pairs are embedded in
+  * chunks on the thread pool. `stego` is allocated before returning.
+  * The edge adaptive mode and the delta are not supported, the stats
+  * sink and the threads are not used.
+  *
+  * @see lsb_matching_embed
+  */
+async_job lsb_matching_embed_async(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const std::vector<char>& key,
+	const lsb_matching_options& lsbm_opt = lsb_matching_options(),
+	const async_options& async_opt = async_options());
+
+/** Same as `lsb_matching_extract`, in chunks as
+  * `lsb_matching_embed_async`. `data` is sized before returning.
+  *
+  * @see lsb_matching_extract
+  */
+async_job lsb_matching_extract_async(
+	const cv::Mat& stego,
+	std::vector<char>& data,
+	size_t size,
+	const std::vector<char>& key,
+	const lsb_matching_options& lsbm_opt = lsb_matching_options(),
+	const async_options& async_opt = async_options());
+
+#ifdef STEGIM_COROUTINES
+
+/** Awaits a job in a coroutine, `bool completed = co_await job;`. The
+  * coroutine is resumed by the thread of the pool that finishes the
+  * job. An event loop resuming its coroutines in its own thread posts
+  * them from `async_job::on_complete` instead.
+  */
+class async_awaiter {
+public:
+	async_awaiter(const async_job& job)
+		: job(job)
+	{}
+
+	bool await_ready() const
+	{
+		return this->job.done();
+	}
+
+	/*
+	 * the coroutine may be resumed, and the awaiter destroyed, before
+	 * on_complete returns: nothing is touched after it
+	 */
+	void await_suspend(std::coroutine_handle<> handle)
+	{
+		this->job.on_complete([handle](bool){ handle.resume(); });
+	}
+
+	bool await_resume()
+	{
+		return this->job.wait();
+	}
+
+private:
+	async_job job;
+};
+
+inline async_awaiter operator co_await(const async_job& job)
+{
+	return async_awaiter(job);
+}
+
+#endif
+
+/*
+ * end of stegim namespace
+ */
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace stegim {
+
+/** Packs the `k`-th bit plane of `image` in a 1-bpp bitmap. The
+  * samples are visited in raster order with the channels interleaved
+  * and the i-th sample goes to the bit `i%CHAR_BIT` of the byte
+  * `i/CHAR_BIT` of `plane`, the same little endian order used by
+  * `lsb_extract`.
+  *
+  * @param image	The image to be decomposed. Must be CV_8UC{1,3,4} type.
+  * @param plane	Vector to return the bitmap on. It is resized to
+  *			hold all the samples of `image`.
+  * @param k		The bit plane, 0 is the least significant bit.
+  */
+void bit_plane_pack(
+	const cv::Mat& image,
+	std::vector<char>& plane,
+	int k = 0);
+
+/** Writes the bitmap `plane` in the `k`-th bit plane of `image`, the
+  * inverse operation of `bit_plane_pack`. Every other bit of `image` is
+  * left untouched.
+  *
+  * @param plane	The bitmap, in the layout returned by
+  *			`bit_plane_pack`. Must have at least one bit for
+  *			each sample of `image`.
+  * @param image	The image to be written. Must be CV_8UC{1,3,4} type
+  *			and already allocated.
+  * @param k		The bit plane, 0 is the least significant bit.
+  *
+  * @see bit_plane_pack
+  */
+void bit_plane_unpack(
+	const std::vector<char>& plane,
+	cv::Mat& image,
+	int k = 0);
+
+/** Packs the `k`-th bit plane of each channel of `image` in a separated
+  * 1-bpp bitmap, in a single pass through the image. The i-th pixel
+  * goes to the bit `i%CHAR_BIT` of the byte `i/CHAR_BIT` of the bitmap
+  * of its channel.
+  *
+  * @param image	The image to be decomposed. Must be CV_8UC{1,3,4} type.
+  * @param planes	Vector to return one bitmap per channel on.
+  * @param k		The bit plane, 0 is the least significant bit.
+  *
+  * @see bit_plane_pack
+  */
+void bit_plane_pack_channels(
+	const cv::Mat& image,
+	std::vector<std::vector<char>>& planes,
+	int k = 0);
+
+/*
+ * end of stegim namespace
+ */
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "lsb.hpp"
+
+namespace stegim {
+
+/** The `cover_geometry` class describes the shape of a cover image,
+  * which is all the capacity of the non adaptive algorithms depends
+  * on. It may be built without loading the image.
+  */
+class cover_geometry {
+public:
+	/** @param rows	Number of rows of the cover.
+	  * @param cols	Number of columns of the cover.
+	  * @param channels	Number of channels of the cover, 1, 3 or 4.
+	  */
+	cover_geometry(int rows, int cols, int channels = 1);
+
+	/** Takes the geometry of `cover`.
+	  */
+	cover_geometry(const cv::Mat& cover);
+
+	virtual ~cover_geometry();
+
+	virtual int get_rows() const;
+	virtual int get_cols() const;
+	virtual int get_channels() const;
+
+private:
+	int rows, cols, channels;
+};
+
+/** Returns the exact number of bytes `lsb_embed` embeds in a cover
+  * with `geometry`, taking into account the offset and the channels
+  * selected in `lsb_opt`. O(1).
+  *
+  * @param geometry	The geometry of the cover image.
+  * @param lsb_opt	The options that will be given to `lsb_embed`.
+  *
+  * @see lsb_embed
+  */
+size_t capacity(
+	const cover_geometry& geometry,
+	const lsb_options& lsb_opt = lsb_options());
+
+/** Returns the exact number of bytes `lsb_matching_embed` embeds in a
+  * cover with `geometry`. The sample left out of the pairs of an image
+  * with an odd number of samples is not counted. O(1).
+  *
+  * The edge adaptive mode depends on the content of the cover, its
+  * capacity is given by `edge_region`.
+  *
+  * @param geometry	The geometry of the cover image.
+  *
+  * @see lsb_matching_embed
+  * @see edge_region
+  */
+size_t lsb_matching_capacity(const cover_geometry& geometry);
+
+/** The slot of a payload assigned by `pack_payloads`.
+  */
+struct payload_slot {
+	/*
+	 * index of the cover holding the payload, -1 if
+	 * the payload does not fit in any cover
+	 */
+	int cover;
+
+	/*
+	 * byte offset of the payload in the message embedded
+	 * in the cover
+	 */
+	size_t offset;
+};
+
+/** Assigns a batch of payloads to a pool of covers using the first fit
+  * decreasing heuristic of bin packing. The payloads assigned to the
+  * same cover are meant to be concatenated, in the order of their
+  * offsets, in a single message embedded in the cover.
+  *
+  * @param payload_sizes	The size in bytes of each payload.
+  * @param cover_capacities	The capacity in bytes of each cover, as
+  *				returned by `capacity` or
+  *				`lsb_matching_capacity`.
+  *
+  * @return			The slot of each payload, in the order of
+  *				`payload_sizes`.
+  */
+std::vector<payload_slot> pack_payloads(
+	const std::vector<size_t>& payload_sizes,
+	const std::vector<size_t>& cover_capacities);
+
+/*
+ * end of stegim namespace
+ */
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace stegim {
+
+/** Size in bytes of a ChaCha20 key.
+  */
+const size_t chacha20_key_size = 32;
+
+/** Size in bytes of a ChaCha20 nonce.
+  */
+const size_t chacha20_nonce_size = 12;
+
+/** Writes in `okm` the `okm_size` (<= 8160) bytes derived from the
+  * `ikm_size` bytes of `ikm` by HKDF-SHA256 (RFC 5869), with `salt` and
+  * `info`. A null `salt` is the default one of zeros.
+  */
+void hkdf_sha256(
+	const char* ikm,
+	size_t ikm_size,
+	const char* salt,
+	size_t salt_size,
+	const char* info,
+	size_t info_size,
+	uint8_t* okm,
+	size_t okm_size);
+
+/** XORs in place the `size` bytes of `data` with the ChaCha20 keystream
+  * (RFC 8439) of `key` and `nonce`, beginning in the block `counter`.
+  * The same call encrypts and decrypts. The blocks are generated by the
+  * vectorized kernels.
+  *
+  * @param key		The chacha20_key_size bytes of the key.
+  * @param nonce	The chacha20_nonce_size bytes of the nonce.
+  */
+void chacha20_xor(
+	const uint8_t* key,
+	const uint8_t* nonce,
+	uint32_t counter,
+	char* data,
+	size_t size);
+
+/*
+ * end of stegim namespace
+ */
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace stegim {
+
+/** The `sample_delta` class holds the samples an embedding modified,
+  * so the stego image can be rebuilt from the cover. It is filled
+  * while embedding when attached to the options of an embed call.
+  *
+  * The samples are numbered in raster order with the channels
+  * interleaved. The encoded buffer is the varint of the number of
+  * rows and of samples per row followed, for each modified sample in
+  * increasing order, by the varint of the gap to the previous modified
+  * sample and the new value.
+  *
+  * @see lsb_options::set_delta
+  * @see lsb_matching_options::set_delta
+  * @see apply_delta
+  */
+class sample_delta {
+public:
+	sample_delta();
+
+	virtual ~sample_delta();
+
+	/** Starts a new delta for an image with `rows` rows of `width`
+	  * samples, discarding the current one. Called by the embed
+	  * functions.
+	  */
+	virtual void begin(size_t rows, size_t width);
+
+	/** Records that the sample `index` was modified to `value`, in
+	  * any order. Called by the embed functions.
+	  */
+	virtual void add(uint64_t index, uchar value);
+
+	/** Encodes the recorded samples in the buffer. Called by the
+	  * embed functions.
+	  */
+	virtual void finish();
+
+	/** Number of modified samples.
+	  */
+	virtual size_t size() const;
+
+	virtual size_t get_rows() const;
+	virtual size_t get_width() const;
+
+	/** The encoded delta, to be transmitted or stored.
+	  */
+	virtual const std::vector<uchar>& get_buffer() const;
+
+	/** Loads an encoded delta, as returned by `get_buffer`.
+	  *
+	  * @return	false if `buffer` is not a valid delta.
+	  */
+	virtual bool set_buffer(const std::vector<uchar>& buffer);
+
+private:
+	size_t rows, width, n_samples;
+	std::vector<std::pair<uint64_t, uchar>> pending;
+	std::vector<uchar> buffer;
+};
+
+/** Writes the samples of `delta` in `cover`, turning it in the stego
+  * image of the embedding that produced `delta`. Only the modified
+  * samples are visited.
+  *
+  * @param cover	The image to be patched, in place, of 8 bit
+  *			samples and of the geometry recorded in `delta`.
+  * @param delta	The delta to be applied.
+  *
+  * @return		false if `cover` does not match `delta`, which is
+  *			then left untouched.
+  */
+bool apply_delta(cv::Mat& cover, const sample_delta& delta);
+
+/*
+ * end of stegim namespace
+ */
+}
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "lsb.hpp"
+#include "lsb_matching.hpp"
+#include "stats.hpp"
+
+namespace stegim {
+
+/** Size in bytes of the header of a frame: the length of the data, the
+  * CRC32C of the length, and the CRC32C of the length and the data. The
+  * length is checked alone, so a header read with a wrong key is
+  * rejected before the data is read.
+  */
+const size_t frame_header_size = 12;
+
+/** The compression of the data of a frame. The data is compressed in
+  * blocks of 64 KiB, each stored raw if it does not shrink, so the
+  * frame of incompressible data only grows by 4 bytes per block.
+  *
+  * @see frame_options::set_compression
+  */
+enum frame_compression {
+	COMPRESSION_NONE,
+
+	/** The LZ4 block format, built in.
+	  */
+	COMPRESSION_LZ4,
+
+	/** zstd at its default level, only if the library was built with
+	  * libzstd.
+	  *
+	  * @see compression_supported
+	  */
+	COMPRESSION_ZSTD
+};
+
+/** Whether the library was built with `compression`.
+  */
+bool compression_supported(frame_compression compression);
+
+/** The `frame_options` class provides the optional arguments of the
+  * frame functions, in the same fashion of `lsb_options`.
+  *
+  * @see lsb_options
+  */
+class frame_options {
+public:
+	frame_options();
+
+	virtual ~frame_options();
+
+	/** Appends Reed-Solomon parity to the frame, RS(255,223) over
+	  * GF(2^8), which corrects up to 16 wrong bytes in each codeword
+	  * of 223 bytes of the frame. The codewords are interleaved, so
+	  * consecutive wrong bytes fall in different codewords. Enabled
+	  * by default, without it only the CRC32C detects the errors.
+	  */
+	virtual frame_options& set_parity(bool parity);
+
+	/** Attaches a sink to the calls using these options. Every call
+	  * accumulates its framing time and the bytes corrected by the
+	  * parity in `stats_sink`. A null sink (the default) disables the
+	  * instrumentation.
+	  */
+	virtual frame_options& set_stats(stats* stats_sink);
+
+	/** Compresses the data of the frame, so the text and the other
+	  * redundant data take fewer samples. The frame then begins with
+	  * a head holding the sizes of the compressed data and of the data,
+	  * protected by the parity as well. COMPRESSION_NONE by default,
+	  * and must be supported.
+	  *
+	  * @see frame_head_size
+	  */
+	virtual frame_options& set_compression(frame_compression compression);
+
+	virtual bool get_parity() const;
+	virtual stats* get_stats() const;
+	virtual frame_compression get_compression() const;
+
+private:
+	bool parity;
+	stats* stats_sink;
+	frame_compression compression;
+};
+
+/** Returns the CRC32C (Castagnoli) of the `size` bytes of `data`. The
+  * vectorized kernels use the crc32 instruction of SSE4.2.
+  */
+uint32_t crc32c(const char* data, size_t size);
+
+/** Returns the size in bytes of the frame of `size` bytes of data. If
+  * compressed, the size of the frame of incompressible data, an upper
+  * bound of the frame.
+  */
+size_t frame_size(size_t size, const frame_options& frame_opt = frame_options());
+
+/** Returns the largest size in bytes of data whose frame fits in
+  * `raw_capacity` bytes, the inverse of frame_size, or 0 if not even
+  * the frame of no data fits. If compressed, the size of the
+  * incompressible data that fits, more compressible data may fit.
+  *
+  * @param raw_capacity	The bytes the frame is embedded in, as given by
+  *			`capacity` or `lsb_matching_capacity`.
+  * @param frame_opt	The options that will be given to frame_encode.
+  *
+  * @see frame_size
+  */
+size_t frame_capacity(
+	size_t raw_capacity,
+	const frame_options& frame_opt = frame_options());
+
+/** Returns the size in bytes of the head of a compressed frame, 0 if
+  * the frame is not compressed. The size of the whole frame is known
+  * from its head, so an extraction reads the head first.
+  *
+  * @see frame_size_from_head
+  */
+size_t frame_head_size(const frame_options& frame_opt = frame_options());
+
+/** Returns the size in bytes of the frame of `size` bytes of data whose
+  * first frame_head_size bytes are `head`, or 0 if the head is corrupted
+  * beyond the parity. The same as frame_size if the frame is not
+  * compressed.
+  */
+size_t frame_size_from_head(
+	const std::vector<char>& head,
+	size_t size,
+	const frame_options& frame_opt = frame_options());
+
+/** Returns the size in bytes of the data of the frame whose first bytes
+  * are `head`, or SIZE_MAX if they are corrupted beyond the parity. The
+  * head is the frame_head_size bytes of a compressed frame, or the
+  * frame_header_size bytes of the header of a frame that is not, whose
+  * length is checked by its CRC32C but not corrected by the parity. So
+  * a frame of unknown size is read by its head, then
+  * frame_size_from_head bytes.
+  */
+size_t frame_data_size(
+	const std::vector<char>& head,
+	const frame_options& frame_opt = frame_options());
+
+/** Writes in `frame` the `data` after a header with its length and the
+  * CRC32C of both, followed by the parity of both if enabled in `frame_opt`.
+  * Compressed data is written block by block in the frame, after the
+  * head.
+  *
+  * @param data		The data to be framed.
+  * @param frame	Vector to return the frame on, of frame_size bytes,
+  *			or of fewer if compressed.
+  * @param frame_opt	Optional arguments of frame_encode.
+  *
+  * @see frame_size
+  */
+void frame_encode(
+	const std::vector<char>& data,
+	std::vector<char>& frame,
+	const frame_options& frame_opt = frame_options());
+
+/** Checks the `frame` of `size` bytes of data written by frame_encode
+  * and writes the data in `data`. The parity is only evaluated if the
+  * CRC32C does not match, so an intact frame costs a CRC32C. Compressed
+  * blocks are decompressed straight in `data`.
+  *
+  * @param frame	The frame, at least frame_size bytes, or
+  *			frame_size_from_head bytes if compressed.
+  * @param data		Vector to return the data on.
+  * @param size		The size of the framed data in bytes.
+  * @param frame_opt	The options used by frame_encode.
+  *
+  * @return		Whether the data was intact or corrected. `data`
+  *			is left empty otherwise.
+  */
+bool frame_decode(
+	const std::vector<char>& frame,
+	std::vector<char>& data,
+	size_t size,
+	const frame_options& frame_opt = frame_options());
+
+/** Embeds the frame of `data` with `lsb_embed`, if the frame fits in
+  * the capacity of `cover`.
+  *
+  * @return		Whether the frame fit, `stego` is left untouched
+  *			otherwise.
+  *
+  * @see lsb_embed
+  * @see frame_encode
+  * @see frame_capacity
+  */
+bool lsb_embed_framed(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const lsb_options& lsb_opt = lsb_options(),
+	const frame_options& frame_opt = frame_options());
+
+/** Extracts the frame of `size` bytes of data embedded by
+  * `lsb_embed_framed` and decodes it in `data`. A compressed frame is
+  * extracted in two steps, its head and then the frame.
+  *
+  * @return		Whether the data was intact or corrected.
+  *
+  * @see lsb_extract
+  * @see frame_decode
+  */
+bool lsb_extract_framed(
+	const cv::Mat& stego,
+	std::vector<char>& data,
+	size_t size,
+	const lsb_options& lsb_opt = lsb_options(),
+	const frame_options& frame_opt = frame_options());
+
+/** Embeds the frame of `data` with `lsb_matching_embed`, if the frame
+  * fits in the lsb matching capacity of `cover`, or in its edge region
+  * in the edge adaptive mode.
+  *
+  * @return		Whether the frame fit, `stego` is left untouched
+  *			otherwise.
+  *
+  * @see lsb_matching_embed
+  * @see frame_encode
+  * @see frame_capacity
+  */
+bool lsb_matching_embed_framed(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const std::vector<char>& key,
+	const lsb_matching_options& lsbm_opt = lsb_matching_options(),
+	const frame_options& frame_opt = frame_options());
+
+bool lsb_matching_embed_framed(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const std::string& key,
+	const lsb_matching_options& lsbm_opt = lsb_matching_options(),
+	const frame_options& frame_opt = frame_options());
+
+/** Extracts the frame of `size` bytes of data embedded by
+  * `lsb_matching_embed_framed` and decodes it in `data`.
+  *
+  * @return		Whether the data was intact or corrected.
+  *
+  * @see lsb_matching_extract
+  * @see frame_decode
+  */
+bool lsb_matching_extract_framed(
+	const cv::Mat& stego,
+	std::vector<char>& data,
+	size_t size,
+	const std::vector<char>& key,
+	const lsb_matching_options& lsbm_opt = lsb_matching_options(),
+	const frame_options& frame_opt = frame_options());
+
+bool lsb_matching_extract_framed(
+	const cv::Mat& stego,
+	std::vector<char>& data,
+	size_t size,
+	const std::string& key,
+	const lsb_matching_options& lsbm_opt = lsb_matching_options(),
+	const frame_options& frame_opt = frame_options());
+
+/*
+ * end of stegim namespace
+ */
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include "stats.hpp"
+
+namespace stegim {
+
+/** The `jsteg_options` class provides the optional arguments of the
+  * jsteg functions, in the same fashion of `lsb_options`.
+  *
+  * @see lsb_options
+  */
+class jsteg_options {
+public:
+	jsteg_options();
+
+	virtual ~jsteg_options();
+
+	/** Attaches a sink to the calls using these options. Every call
+	  * accumulates its instrumentation in `stats_sink`. The samples
+	  * of the stats are the coefficients. A null sink (the default)
+	  * disables the instrumentation.
+	  */
+	virtual jsteg_options& set_stats(stats* stats_sink);
+
+	/** Embeds by lsb matching, changing a coefficient by +1 or -1
+	  * instead of replacing its least significant bit. The default
+	  * is the replacement of JSteg. Extraction is the same in both
+	  * modes.
+	  */
+	virtual jsteg_options& set_matching(bool matching);
+
+	virtual stats* get_stats() const;
+	virtual bool get_matching() const;
+
+private:
+	stats* stats_sink;
+	bool matching;
+};
+
+/** Embeds the `data` in the quantized DCT coefficients of the JPEG
+  * image `cover_jpeg` and writes the resulting JPEG in `stego_jpeg`,
+  * in the fashion of JSteg. The image is never decoded to pixels: the
+  * coefficients are read by libjpeg, changed and written back with the
+  * same quantization tables, so nothing but the embedded coefficients
+  * changes. The APP and COM markers are kept, a progressive image is
+  * written progressive.
+  *
+  * The bits go, in the order of the lsb functions, to the AC
+  * coefficients whose value is neither 0 nor 1, visited in an order
+  * shuffled by `key`. The embedding never creates nor removes such a
+  * coefficient, so the extraction finds the same ones.
+  *
+  * Only available if the library was built with libjpeg, which
+  * defines STEGIM_JPEG.
+  *
+  * @param cover_jpeg	The cover JPEG file contents.
+  * @param stego_jpeg	Vector to return the stego JPEG file on.
+  * @param data		Data to be embedded, at most the
+  *			jsteg_capacity of `cover_jpeg`.
+  * @param key		The key of the order of the coefficients, the
+  *			same key must be used in the extraction.
+  * @param jsteg_opt	Optional arguments of jsteg_embed.
+  *
+  * @return		Whether `cover_jpeg` could be decoded and `data`
+  *			fits in it.
+  *
+  * @see jsteg_capacity
+  */
+bool jsteg_embed(
+	const std::vector<char>& cover_jpeg,
+	std::vector<char>& stego_jpeg,
+	const std::vector<char>& data,
+	const std::vector<char>& key,
+	const jsteg_options& jsteg_opt = jsteg_options());
+
+bool jsteg_embed(
+	const std::vector<char>& cover_jpeg,
+	std::vector<char>& stego_jpeg,
+	const std::vector<char>& data,
+	const std::string& key,
+	const jsteg_options& jsteg_opt = jsteg_options());
+
+/** Extracts `size` bytes embedded by `jsteg_embed` in `stego_jpeg`
+  * with `key` and writes them in `data`.
+  *
+  * @param stego_jpeg	The stego JPEG file contents.
+  * @param data		Vector to return the data on.
+  * @param size		The size of the embedded data in bytes.
+  * @param key		The key used by jsteg_embed.
+  * @param jsteg_opt	Optional arguments of jsteg_extract.
+  *
+  * @return		Whether `stego_jpeg` could be decoded and holds
+  *			`size` bytes.
+  *
+  * @see jsteg_embed
+  */
+bool jsteg_extract(
+	const std::vector<char>& stego_jpeg,
+	std::vector<char>& data,
+	size_t size,
+	const std::vector<char>& key,
+	const jsteg_options& jsteg_opt = jsteg_options());
+
+bool jsteg_extract(
+	const std::vector<char>& stego_jpeg,
+	std::vector<char>& data,
+	size_t size,
+	const std::string& key,
+	const jsteg_options& jsteg_opt = jsteg_options());
+
+/** Returns the number of bytes `jsteg_embed` can embed in
+  * `cover_jpeg`, 0 if it cannot be decoded. A stego image has the
+  * capacity of its cover.
+  */
+size_t jsteg_capacity(const std::vector<char>& cover_jpeg);
+
+/*
+ * end of stegim namespace
+ */
+}
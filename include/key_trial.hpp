@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "frame.hpp"
+#include "lsb_matching.hpp"
+
+namespace stegim {
+
+/** The `key_trial_options` class provides the optional arguments of
+  * `lsb_matching_try_keys`, in the same fashion of `lsb_options`.
+  *
+  * @see lsb_options
+  */
+class key_trial_options {
+public:
+	key_trial_options();
+
+	virtual ~key_trial_options();
+
+	/** Threads testing the keys, 0 for one per core (the default).
+	  */
+	virtual key_trial_options& set_threads(int n_threads);
+
+	/** The options the data was embedded with: the tile size, the
+	  * Feistel permutation and the encryption. The edge adaptive mode
+	  * is not supported. The stats sink, the delta and the threads
+	  * are not used.
+	  */
+	virtual key_trial_options& set_lsb_matching_options(
+		const lsb_matching_options& lsbm_opt);
+
+	/** The options the data was framed with. The stats sink is not
+	  * used.
+	  */
+	virtual key_trial_options& set_frame_options(const frame_options& frame_opt);
+
+	virtual int get_threads() const;
+	virtual const lsb_matching_options& get_lsb_matching_options() const;
+	virtual const frame_options& get_frame_options() const;
+
+private:
+	int n_threads;
+	lsb_matching_options lsbm_opt;
+	frame_options frame_opt;
+};
+
+/** The result of `lsb_matching_try_keys`.
+  */
+struct key_trial_result {
+	/** Whether a key decoded a frame.
+	  */
+	bool found;
+
+	/** Index of that key in the candidates.
+	  */
+	size_t key_index;
+
+	/** The data of its frame.
+	  */
+	std::vector<char> data;
+
+	/** Number of keys tested, and how many of them were rejected by
+	  * the header of the frame alone.
+	  */
+	size_t keys_tried;
+	size_t keys_rejected_by_header;
+
+	/** Keys tested per second.
+	  */
+	double keys_per_second;
+};
+
+/** Tests the candidate `keys` of the frame embedded in `stego` by
+  * `lsb_matching_embed_framed`, whose size is unknown. The keys are
+  * tested in parallel against the same `stego`, which is only read.
+  *
+  * For each key only the pairs of the header of the frame, or of its
+  * head if compressed, are read first, and the key is rejected if the
+  * length in the header does not fit in `stego`. The rest of the frame is only extracted for the keys
+  * left, which are accepted if the CRC32C of the frame, or its parity,
+  * checks. With the Feistel permutation the pairs are computed as they
+  * are read, so a rejected key costs a few microseconds. The other
+  * permutations are computed whole for every key, reusing the scratch
+  * memory of the thread.
+  *
+  * The trial stops at the first key accepted, in the order of `keys`:
+  * the keys after it are not tested.
+  *
+  * @param stego	The stego image. Must be CV_8UC{1,3,4} or
+  *			CV_16UC{1,3,4} type.
+  * @param keys		The candidate keys.
+  * @param trial_opt	Optional arguments of lsb_matching_try_keys.
+  *
+  * @see lsb_matching_options::set_feistel
+  * @see lsb_matching_embed_framed
+  */
+key_trial_result lsb_matching_try_keys(
+	const cv::Mat& stego,
+	const std::vector<std::vector<char>>& keys,
+	const key_trial_options& trial_opt = key_trial_options());
+
+/*
+ * end of stegim namespace
+ */
+}
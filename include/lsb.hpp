@@ -9,6 +9,9 @@
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#include "delta.hpp"
+#include "stats.hpp"
+
 namespace stegim {
 
 /** The `lsb_options` class functions is to provide a
@@ -35,6 +38,9 @@ public:
 	  *			will be ignored.
 	  * @param offset	The pixel offset to be the begin of the
 	  *			embedding process.
+	  *
+	  * The stats sink and the delta are not set by the constructor,
+	  * see `set_stats` and `set_delta`.
 	  */
 	lsb_options(
 		bool b = true,
@@ -51,22 +57,50 @@ public:
 	virtual lsb_options& set_a(bool r);
 	virtual lsb_options& set_offset(int offset);
 
+	/** Attaches a sink to the calls using these options. Every call
+	  * accumulates its instrumentation in `stats_sink`. A null sink
+	  * (the default) disables the instrumentation.
+	  */
+	virtual lsb_options& set_stats(stats* stats_sink);
+
+	/** Attaches a delta to the embed calls using these options. Every
+	  * call replaces `delta` with the samples it modified. A null delta
+	  * (the default) disables the recording.
+	  */
+	virtual lsb_options& set_delta(sample_delta* delta);
+
 	virtual bool get_b() const;
 	virtual bool get_g() const;
 	virtual bool get_r() const;
 	virtual bool get_a() const;
 	virtual int get_offset() const;
+	virtual stats* get_stats() const;
+	virtual sample_delta* get_delta() const;
 
 private:
 	bool b, g, r, a;
 	int offset;
+	stats* stats_sink;
+	sample_delta* delta;
 };
 
 /** Perform a naive lsb replacement algorithm.
   * TODO: A more detailed description of lsb.
   *
-  * @param cover	The cover image. Must be CV_8UC{1,3,4} type
-  * @param stego	The stego image buffer. Must be CV_8UC{1,3,4} type
+  * Both images may be ROIs of larger frames, their rows are walked
+  * by their own steps. If `stego` already has the size and type of
+  * `cover` it is written in place, so a ROI of a frame receives the
+  * embedding without being copied out and back. `stego` may also be
+  * `cover` itself, then only the samples carrying data are written.
+  *
+  * Samples of 16 bits are embedded in their least significant bit as
+  * well, with the same capacity. A delta is only supported for
+  * samples of 8 bits.
+  *
+  * @param cover	The cover image. Must be CV_8UC{1,3,4} or
+  *			CV_16UC{1,3,4} type
+  * @param stego	The stego image buffer. Must be of the type of
+  *			`cover`
   * @param data		Data to be embedded in `cover`
   * @param lsb_opt	Optional arguments of lsb_embed
   *
@@ -82,7 +116,8 @@ void lsb_embed (
   * vector using a naive lsb replacement algorithm.
   * TODO: A more detailed description of lsb_extract.
   *
-  * @param stego	Image containing the embed data.
+  * @param stego	Image containing the embed data. Must be
+  *			CV_8UC{1,3,4} or CV_16UC{1,3,4} type.
   * @param data		Vector to return the data on
   * @param size		The size of the message embedded in bytes
   * @param lsb_opt	Optional arguments of lsb_extract
@@ -95,6 +130,30 @@ void lsb_extract (
 	int size = -1,
 	const lsb_options& lsb_opt = lsb_options());
 
+/** Rewrites the data embedded by `lsb_embed` in `stego`, in place,
+  * from `old_data` to `new_data`. Only the samples of the bits that
+  * differ are visited, with the same bit to sample mapping of
+  * lsb_embed, so the cost depends on the size of the edit instead of
+  * the size of the image. The bytes of `new_data` past `old_data` are
+  * all written, the bytes of `old_data` past `new_data` are kept.
+  *
+  * @param stego	The stego image, updated in place. Must be
+  *			CV_8UC{1,3,4} type.
+  * @param old_data	The data currently embedded in `stego`.
+  * @param new_data	The data to be embedded. The bits past the
+  *			capacity of `stego` are dropped, as lsb_embed
+  *			does.
+  * @param lsb_opt	The options used by lsb_embed. A delta receives
+  *			the samples modified in `stego`.
+  *
+  * @see lsb_embed
+  */
+void lsb_update(
+	cv::Mat& stego,
+	const std::vector<char>& old_data,
+	const std::vector<char>& new_data,
+	const lsb_options& lsb_opt = lsb_options());
+
 /*
  * end of stegim namespace
  */
@@ -3,24 +3,268 @@
 #include <vector>
 #include <random>
 
+#include <climits>
+
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#include "capacity.hpp"
+#include "cipher.hpp"
+#include "delta.hpp"
+#include "scratch.hpp"
+#include "stats.hpp"
+
 namespace stegim {
 
+/** The `lsb_matching_options` class provides the optional arguments
+  * of the lsb matching functions, in the same fashion of `lsb_options`.
+  *
+  * @see lsb_options
+  */
+class lsb_matching_options {
+public:
+	lsb_matching_options();
+
+	virtual ~lsb_matching_options();
+
+	/** Attaches a sink to the calls using these options. Every call
+	  * accumulates its instrumentation in `stats_sink`. A null sink
+	  * (the default) disables the instrumentation.
+	  */
+	virtual lsb_matching_options& set_stats(stats* stats_sink);
+
+	/** Attaches a delta to the embed calls using these options, see
+	  * `lsb_options::set_delta`.
+	  */
+	virtual lsb_matching_options& set_delta(sample_delta* delta);
+
+	/** Enables the edge adaptive mode, from the paper "Edge Adaptive
+	  * Image Steganography Based on LSB Matching Revisited". Data is
+	  * only embedded in pairs of horizontally adjacent samples of the
+	  * same channel whose difference is at least a threshold, chosen
+	  * as the largest one that still fits the data. The threshold is
+	  * embedded in the last 8 samples of the stego image, which may
+	  * span rows, so an image of fewer samples has no capacity. Data
+	  * beyond the capacity of threshold 0 is truncated.
+	  *
+	  * @see edge_region
+	  */
+	virtual lsb_matching_options& set_edge_adaptive(bool edge_adaptive);
+
+	/** Enables the tiled permutation. The image is cut in tiles of
+	  * `tile_size` x `tile_size` pixels, the order of the tiles is
+	  * shuffled by the key and so are the samples inside each tile.
+	  * The data fills a tile before going to the next one, so the
+	  * pairs of a tile are embedded from the cache instead of two
+	  * random memory accesses per pair. The positions still depend
+	  * on the key, but an attacker knows that consecutive bits lie
+	  * in the same tile. A tile size of 0 (the default) uses the
+	  * global permutation. The same tile size must be used in the
+	  * extraction. Not used by the edge adaptive mode.
+	  */
+	virtual lsb_matching_options& set_tile_size(int tile_size);
+
+	/** Threads computing the tiled permutation and embedding its
+	  * tiles, 0 for one per core. The default is 1. The embedding
+	  * is sequential if a stats sink or a delta is attached.
+	  */
+	virtual lsb_matching_options& set_threads(int n_threads);
+
+	/** Encrypts the data with ChaCha20 while it is embedded, and
+	  * decrypts it while it is extracted, in the same pass through the
+	  * pairs and without a copy of the data. The cipher key is derived
+	  * from the key of the pairs by HKDF-SHA256, so the same key must
+	  * be given to the extraction with the encryption enabled. The
+	  * nonce is zero, so a key must not embed different data with the
+	  * same pairs where both stego images may be seen. Disabled by
+	  * default.
+	  *
+	  * @see lsb_matching_permutation::get_cipher_key
+	  */
+	virtual lsb_matching_options& set_encryption(bool encryption);
+
+	/** Uses a keyed Feistel network as the permutation of the
+	  * samples instead of the shuffle. The position of any pair is
+	  * computed from the key in O(1) without the others, so the
+	  * permutation is built in parallel by the threads, and the first
+	  * bytes of a candidate key are tested without building it at all.
+	  * The same option must be used in the extraction. Not used with
+	  * the tiled permutation or the edge adaptive mode.
+	  *
+	  * @see lsb_matching_try_keys
+	  */
+	virtual lsb_matching_options& set_feistel(bool feistel);
+
+	virtual stats* get_stats() const;
+	virtual sample_delta* get_delta() const;
+	virtual bool get_edge_adaptive() const;
+	virtual int get_tile_size() const;
+	virtual int get_threads() const;
+	virtual bool get_encryption() const;
+	virtual bool get_feistel() const;
+
+private:
+	stats* stats_sink;
+	sample_delta* delta;
+	bool edge_adaptive;
+	int tile_size;
+	int n_threads;
+	bool encryption;
+	bool feistel;
+};
+
+/** The `edge_region` class holds the histogram of the differences of
+  * the pixel pairs used by the edge adaptive mode of lsb matching. It
+  * is computed in a single pass through the image, after that the
+  * capacity queries are O(1).
+  *
+  * @see lsb_matching_options::set_edge_adaptive
+  */
+class edge_region {
+public:
+	/** The largest threshold the edge adaptive mode uses.
+	  */
+	static const int max_threshold = 31;
+
+	/** Computes the histogram of the pair differences of `cover`.
+	  *
+	  * @param cover	The cover image. Must be CV_8UC{1,3,4} type.
+	  */
+	edge_region(const cv::Mat& cover);
+
+	virtual ~edge_region();
+
+	/** Returns the number of pairs whose difference is at least
+	  * `threshold`.
+	  */
+	virtual size_t pairs(int threshold) const;
+
+	/** Returns the number of bytes that can be embedded using only
+	  * the pairs whose difference is at least `threshold`.
+	  */
+	virtual size_t capacity(int threshold) const;
+
+	/** Returns the largest threshold, up to `max_threshold`, whose
+	  * capacity holds `size` bytes or -1 if `size` does not fit
+	  * even with all pairs.
+	  */
+	virtual int threshold(size_t size) const;
+
+private:
+	/*
+	 * number of pairs with difference greater than or
+	 * equal to the index
+	 */
+	size_t cumulative[UCHAR_MAX + 2];
+};
+
+/** The `lsb_matching_permutation` class holds the keyed sequence of
+  * sample pairs used by lsb matching, so it can be computed once for
+  * a geometry and a key and reused by `lsb_matching_embed`,
+  * `lsb_matching_extract` and `lsb_matching_update`.
+  *
+  * @see lsb_matching_update
+  */
+class lsb_matching_permutation {
+public:
+	typedef std::vector<
+		std::pair<cv::Point2i, cv::Point2i>,
+		scratch_allocator<std::pair<cv::Point2i, cv::Point2i>>> pair_list;
+
+	/** Computes the pairs of an image with `geometry` for `key`, in
+	  * O(rows*cols*channels).
+	  *
+	  * @param resource	Where the pairs are allocated. A permutation
+	  *			kept across calls should not use the arena of
+	  *			the thread, which is only reclaimed once all
+	  *			its buffers are freed.
+	  */
+	lsb_matching_permutation(
+		const cover_geometry& geometry,
+		const std::vector<char>& key,
+		scratch_resource* resource = new_delete_scratch_resource());
+
+	/** Same as above, with the tile size, the Feistel permutation
+	  * and the threads of `lsbm_opt`.
+	  *
+	  * @see lsb_matching_options::set_tile_size
+	  * @see lsb_matching_options::set_feistel
+	  */
+	lsb_matching_permutation(
+		const cover_geometry& geometry,
+		const std::vector<char>& key,
+		const lsb_matching_options& lsbm_opt,
+		scratch_resource* resource = new_delete_scratch_resource());
+
+	virtual ~lsb_matching_permutation();
+
+	/** Number of pairs.
+	  */
+	virtual size_t size() const;
+
+	/** The pairs, as (row, sample column) positions of their first
+	  * and second samples. The i-th pair holds the bits 2*i and
+	  * 2*i + 1 of the data.
+	  */
+	virtual const pair_list& get_pairs() const;
+
+	virtual int get_rows() const;
+	virtual int get_width() const;
+
+	/** The tile size in pixels, 0 for the global permutation.
+	  */
+	virtual int get_tile_size() const;
+
+	/** For the tiled permutation, the index of the first pair of
+	  * each tile in the order they are used, followed by the end of
+	  * the last tile. The pairs after it join the samples left out
+	  * of the tiles with an odd number of samples. Empty for the
+	  * global permutation.
+	  */
+	virtual const std::vector<size_t>& get_tile_bounds() const;
+
+	/** The chacha20_key_size bytes of the ChaCha20 key derived from
+	  * the key of the pairs, used if the encryption is enabled.
+	  *
+	  * @see lsb_matching_options::set_encryption
+	  */
+	virtual const uint8_t* get_cipher_key() const;
+
+private:
+	void tile_pairs(uint64_t seed, int n_threads);
+	void feistel_pairs(const std::vector<char>& key, int n_threads);
+
+	int rows, width, channels;
+	int tile_size;
+	pair_list pairs;
+	std::vector<size_t> tile_bounds;
+	uint8_t cipher_key[chacha20_key_size];
+};
+
 /** Embeds the `data` in `cover` image using the `key` 
   * and writes the result in `stego`. This is a implementation
   * of lsb matching algorithm, inspired by the white papers
   * "An Implementation of Key-Based Digital Signal Steganography"
   * and "LSB Matching Revised".
   *
-  * @param cover	The cover image. Must be CV_8UC{1,3,4} type.
-  * @param stego	The stego image buffer. Must be CV_8UC{1,3,4} type.
+  * As in lsb_embed, both images may be ROIs of larger frames, and
+  * `stego` is written in place if it has the size and type of `cover`
+  * or is `cover` itself. The pairs are positions inside the ROI.
+  *
+  * Samples of 16 bits take the same pairs, saturated at 0 and 65535.
+  * The edge adaptive mode and the delta are only supported for
+  * samples of 8 bits.
+  *
+  * @param cover	The cover image. Must be CV_8UC{1,3,4} or
+  *			CV_16UC{1,3,4} type.
+  * @param stego	The stego image buffer. Must be of the type of
+  *			`cover`.
   * @param data		Data to be embedded in `cover`
   * @param key		The key to be used in the embedding process. To the
   * 			operation be reversible, the same key must to be used
   * 			in the extraction process.
+  * @param lsbm_opt	Optional arguments of lsb_matching_embed
   *
   * @return		The number of bytes successfully embedded.
   */
@@ -28,23 +272,43 @@ void lsb_matching_embed(
 	const cv::Mat& cover,
 	cv::Mat& stego,
 	const std::vector<char>& data,
-	const std::vector<char>& key);
+	const std::vector<char>& key,
+	const lsb_matching_options& lsbm_opt = lsb_matching_options());
 
 void lsb_matching_embed(
 	const cv::Mat& cover,
 	cv::Mat& stego,
 	const std::vector<char>& data,
-	const std::string key);
+	const std::string key,
+	const lsb_matching_options& lsbm_opt = lsb_matching_options());
+
+/** Same as above, using the pairs of a precomputed `permutation`, so
+  * the key is not derived again. Does not allocate if `stego` already
+  * has the geometry of `cover`. The edge adaptive mode is not
+  * supported. The tiles are the ones of `permutation`, the tile size
+  * of `lsbm_opt` is not used.
+  *
+  * @see lsb_matching_permutation
+  */
+void lsb_matching_embed(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const lsb_matching_permutation& permutation,
+	const lsb_matching_options& lsbm_opt = lsb_matching_options());
 
 /** Extracts the embedded data from `stego` usign `key`
   * and writes the result in `data` vector. Extraction is
   * realized taking into consideration the embedding process
   * was `lsb_matching_embed`.
   *
-  * @param stego	The stego image buffer. Must be CV_8UC{1,3,4} type.
+  * @param stego	The stego image buffer. Must be CV_8UC{1,3,4} or
+  *			CV_16UC{1,3,4} type, the edge adaptive mode only
+  *			supports CV_8UC{1,3,4}.
   * @param data		Vector buffer to be write with embedded data from `stego`
   * @param size		The size of the embedded data in `stego`
   * @param key		The key to be used in the embedding process.
+  * @param lsbm_opt	Optional arguments of lsb_matching_extract
   *
   * @see lsb_matching_embed
   *
@@ -53,13 +317,66 @@ void lsb_matching_extract(
 	const cv::Mat& stego,
 	std::vector<char>& data,
 	size_t size,
-	const std::vector<char>& key);
+	const std::vector<char>& key,
+	const lsb_matching_options& lsbm_opt = lsb_matching_options());
 
 void lsb_matching_extract(
 	const cv::Mat& stego,
 	std::vector<char>& data,
 	size_t size,
-	const std::string& key);
+	const std::string& key,
+	const lsb_matching_options& lsbm_opt = lsb_matching_options());
+
+/** Same as above, using the pairs of a precomputed `permutation`, so
+  * the key is not derived again. The edge adaptive mode is not
+  * supported.
+  *
+  * @see lsb_matching_permutation
+  */
+void lsb_matching_extract(
+	const cv::Mat& stego,
+	std::vector<char>& data,
+	size_t size,
+	const lsb_matching_permutation& permutation,
+	const lsb_matching_options& lsbm_opt = lsb_matching_options());
+
+/** Rewrites the data embedded by `lsb_matching_embed` in `stego`, in
+  * place, from `old_data` to `new_data`. Only the pairs of the bytes
+  * that differ are visited and lsb matching is applied to them using
+  * the current stego samples as cover, so the cost depends on the size
+  * of the edit instead of the size of the image. The bytes of
+  * `new_data` past `old_data` are all written, the bytes of `old_data`
+  * past `new_data` are kept. The edge adaptive mode is not supported.
+  *
+  * @param stego	The stego image, updated in place. Must be
+  *			CV_8UC{1,3,4} type.
+  * @param old_data	The data currently embedded in `stego`.
+  * @param new_data	The data to be embedded, truncated to the
+  *			capacity of `stego`.
+  * @param permutation	The pairs of the key used by lsb_matching_embed,
+  *			with the geometry of `stego`.
+  * @param lsbm_opt	Optional arguments of lsb_matching_update. A delta
+  *			receives the samples modified in `stego`.
+  *
+  * @see lsb_matching_embed
+  * @see lsb_matching_permutation
+  */
+void lsb_matching_update(
+	cv::Mat& stego,
+	const std::vector<char>& old_data,
+	const std::vector<char>& new_data,
+	const lsb_matching_permutation& permutation,
+	const lsb_matching_options& lsbm_opt = lsb_matching_options());
+
+/** Same as above, computing the permutation of `key`, which takes
+  * O(rows*cols*channels).
+  */
+void lsb_matching_update(
+	cv::Mat& stego,
+	const std::vector<char>& old_data,
+	const std::vector<char>& new_data,
+	const std::vector<char>& key,
+	const lsb_matching_options& lsbm_opt = lsb_matching_options());
 
 /*
  * end of stegim namespace
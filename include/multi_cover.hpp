@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "lsb.hpp"
+
+namespace stegim {
+
+/** Size in bytes of the header embedded before each chunk by
+  * `multi_cover_embed`.
+  */
+const size_t multi_cover_header_size = 32;
+
+/** Splits `data` in chunks and embeds each chunk in one of the `covers`
+  * using `lsb_embed`, writing the results in `stegos`. Each cover takes
+  * a chunk as big as its capacity, after a header with the sequence
+  * number of the chunk, its offset in `data`, its length and the total
+  * size of `data`. The covers too small for a header are copied
+  * unchanged. The covers are processed concurrently.
+  *
+  * @param covers	The cover images. Must be CV_8UC{1,3,4} type.
+  * @param stegos	Vector to return the stego images on, one for each
+  *			cover.
+  * @param data		Data to be embedded. Must fit in the sum of the
+  *			capacities of `covers` minus the headers.
+  * @param lsb_opt	Optional arguments of lsb_embed, used for every
+  *			cover. A stats sink receives the sum of all covers,
+  *			a delta is ignored.
+  * @param n_threads	Number of threads, 0 uses one per core.
+  *
+  * @see lsb_embed
+  * @see capacity
+  */
+void multi_cover_embed(
+	const std::vector<cv::Mat>& covers,
+	std::vector<cv::Mat>& stegos,
+	const std::vector<char>& data,
+	const lsb_options& lsb_opt = lsb_options(),
+	int n_threads = 0);
+
+/** Extracts the data embedded by `multi_cover_embed`. The stego images
+  * may be given in any order, each chunk is written directly in its
+  * place of `data`, which is allocated once. The images without a
+  * chunk header are ignored.
+  *
+  * @param stegos	The stego images. Must be CV_8UC{1,3,4} type.
+  * @param data		Vector to return the data on.
+  * @param lsb_opt	The options used by multi_cover_embed.
+  * @param n_threads	Number of threads, 0 uses one per core.
+  *
+  * @return		Whether all the chunks were found.
+  *
+  * @see multi_cover_embed
+  */
+bool multi_cover_extract(
+	const std::vector<cv::Mat>& stegos,
+	std::vector<char>& data,
+	const lsb_options& lsb_opt = lsb_options(),
+	int n_threads = 0);
+
+/*
+ * end of stegim namespace
+ */
+}
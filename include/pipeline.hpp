@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace stegim {
+
+/** The `pipeline_options` class provides the optional arguments of
+  * the pipeline functions, in the same fashion of `lsb_options`.
+  *
+  * @see pipeline_embed
+  * @see pipeline_extract
+  */
+class pipeline_options {
+public:
+	/** @param decode_threads	Threads reading the images.
+	  * @param embed_threads	Threads embedding or extracting.
+	  * @param encode_threads	Threads writing the stego images.
+	  * @param queue_size		Maximum number of images waiting
+	  *				between two stages. A full queue
+	  *				stalls the stage before it, which
+	  *				bounds the images in memory.
+	  * @param imread_flags		Flags of cv::imread.
+	  */
+	pipeline_options(
+		int decode_threads = 2,
+		int embed_threads = 1,
+		int encode_threads = 2,
+		int queue_size = 8,
+		int imread_flags = -1);
+
+	virtual ~pipeline_options();
+
+	virtual pipeline_options& set_decode_threads(int decode_threads);
+	virtual pipeline_options& set_embed_threads(int embed_threads);
+	virtual pipeline_options& set_encode_threads(int encode_threads);
+	virtual pipeline_options& set_queue_size(int queue_size);
+	virtual pipeline_options& set_imread_flags(int imread_flags);
+
+	virtual int get_decode_threads() const;
+	virtual int get_embed_threads() const;
+	virtual int get_encode_threads() const;
+	virtual int get_queue_size() const;
+	virtual int get_imread_flags() const;
+
+private:
+	int decode_threads, embed_threads, encode_threads;
+	int queue_size;
+	int imread_flags;
+};
+
+/** Throughput of a stage of a pipeline run.
+  */
+struct stage_report {
+	/** "decode", "embed", "extract" or "encode".
+	  */
+	std::string name;
+
+	int n_threads;
+
+	/** Number of images that went through the stage.
+	  */
+	size_t items;
+
+	/** Time the threads of the stage spent working, summed.
+	  */
+	uint64_t busy_ns;
+
+	/** Time the threads of the stage spent waiting for an image
+	  * from the stage before or for room in the queue to the stage
+	  * after, summed.
+	  */
+	uint64_t stall_ns;
+
+	stage_report();
+
+	/** Images per second the stage sustains with its threads,
+	  * not counting the stalls.
+	  */
+	double items_per_second() const;
+};
+
+/** Result of a pipeline run.
+  */
+struct pipeline_report {
+	std::vector<stage_report> stages;
+
+	/** Wall time of the whole run.
+	  */
+	uint64_t wall_ns;
+
+	/** Indexes of the jobs whose image could not be read or
+	  * written, in increasing order.
+	  */
+	std::vector<size_t> failed;
+
+	pipeline_report();
+};
+
+/** An image to be embedded by `pipeline_embed`.
+  */
+struct pipeline_job {
+	std::string input;
+	std::string output;
+	std::vector<char> data;
+};
+
+typedef std::function<void(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data)> embed_function;
+
+typedef std::function<void(
+	const cv::Mat& stego,
+	std::vector<char>& data)> extract_function;
+
+/** Reads the cover image of each job, embeds its data using `embed`
+  * and writes the stego image, in three stages running concurrently
+  * and linked by bounded lock free queues. The jobs may complete in
+  * any order.
+  *
+  * @param jobs		The images to be embedded.
+  * @param embed	The embedding, for example a call to lsb_embed.
+  *			Called concurrently if there are several embed
+  *			threads.
+  * @param pipe_opt	Optional arguments of pipeline_embed.
+  *
+  * @return		The report of each stage.
+  */
+pipeline_report pipeline_embed(
+	const std::vector<pipeline_job>& jobs,
+	const embed_function& embed,
+	const pipeline_options& pipe_opt = pipeline_options());
+
+/** Reads each image of `paths` and extracts its data using `extract`,
+  * in two stages running concurrently. The encode threads of
+  * `pipe_opt` are not used.
+  *
+  * @param paths	The stego images.
+  * @param data		Vector to return the data of each image on, in
+  *			the order of `paths`.
+  * @param extract	The extraction, for example a call to
+  *			lsb_extract.
+  * @param pipe_opt	Optional arguments of pipeline_extract.
+  *
+  * @return		The report of each stage.
+  */
+pipeline_report pipeline_extract(
+	const std::vector<std::string>& paths,
+	std::vector<std::vector<char>>& data,
+	const extract_function& extract,
+	const pipeline_options& pipe_opt = pipeline_options());
+
+/*
+ * end of stegim namespace
+ */
+}
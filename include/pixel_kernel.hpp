@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstdint>
+
+namespace stegim {
+
+/*
+ * Per sample kernels of the embedding methods. They are inline and
+ * free of checks, so they can be called from the loops of the user,
+ * for example to embed while converting the colors of a frame in a
+ * single pass over its memory:
+ *
+ *	uint8_t y = rgb_to_gray(r, g, b);
+ *	stegim::lsbmr_step step = stegim::lsbmr_embed_step(y0, y, m0, m1);
+ *
+ * They compute the same values as lsb_embed and lsb_matching_embed.
+ */
+
+/** Returns the sample `c` with its least significant bit set to `bit`,
+  * 0 or 1.
+  */
+constexpr uint8_t lsb_embed_sample(uint8_t c, unsigned bit)
+{
+	return (c & ~1u) | bit;
+}
+
+/** Returns the bit embedded in the sample `s`.
+  */
+constexpr unsigned lsb_extract_sample(uint8_t s)
+{
+	return s & 1u;
+}
+
+/** The binary function of "LSB Matching Revised", which carries the
+  * second bit of a pair of samples.
+  */
+constexpr unsigned lsbmr_correlation(uint8_t a, uint8_t b)
+{
+	return (a/2 + b) & 1u;
+}
+
+/** Returns the two bits embedded in the pair of samples `s0` and `s1`,
+  * the first one in the least significant bit.
+  */
+constexpr unsigned lsbmr_extract_pair(uint8_t s0, uint8_t s1)
+{
+	return lsb_extract_sample(s0) | lsbmr_correlation(s0, s1) << 1;
+}
+
+/** The change of a pair of samples (c0, c1) to embed two bits by
+  * LSB matching revised.
+  */
+struct lsbmr_step {
+	/** Value added to c0, 0, +/-1 or +/-3. It is +/-3 when c0 is
+	  * saturated (0 or 255) and can only move to one side.
+	  */
+	int8_t delta0 = 0;
+
+	/** Whether c1 must be changed by one. Both +1 and -1 embed the
+	  * bit, the side should be random, or +1 for 0 and -1 for 255.
+	  */
+	bool change1 = false;
+
+	/** Whether c0 was saturated and needed the adjustment.
+	  */
+	bool saturated = false;
+};
+
+/** Returns the index of the decision table for the bits `m0`, `m1` and
+  * the second sample `c1`. The correlation of the pair only depends on
+  * c1 through its parity, so the 256 values of c1 fold to two columns.
+  */
+constexpr unsigned lsbmr_code(uint8_t c1, unsigned m0, unsigned m1)
+{
+	return m0 << 1 | (m1 ^ (c1 & 1u));
+}
+
+/** Computes the step of the first sample `c0`, of samples saturated
+  * at 0 and `max`, for the `code` given by `lsbmr_code`.
+  */
+constexpr lsbmr_step lsbmr_make_step_max(unsigned c0, unsigned code, unsigned max)
+{
+	unsigned m0 = code >> 1;
+	unsigned t = code & 1u;
+
+	lsbmr_step step;
+
+	if(m0 == (c0 & 1u)){
+		step.change1 = ((c0/2) & 1u) != t;
+		return step;
+	}
+
+	/*
+	 * the correlation of (c0 + d, c1) matches m1 if the parity
+	 * of (c0 + d)/2 is t
+	 */
+	if(c0 == 0){
+		step.delta0 = ((1/2) & 1u) == t ? 1 : 3;
+		step.saturated = true;
+	}else if(c0 == max){
+		step.delta0 = (((max - 1)/2) & 1u) == t ? -1 : -3;
+		step.saturated = true;
+	}else{
+		step.delta0 = (((c0 - 1)/2) & 1u) == t ? -1 : 1;
+	}
+
+	return step;
+}
+
+/** Computes the step of the first sample `c0` for the `code` given by
+  * `lsbmr_code`.
+  */
+constexpr lsbmr_step lsbmr_make_step(uint8_t c0, unsigned code)
+{
+	return lsbmr_make_step_max(c0, code, UINT8_MAX);
+}
+
+/** The decision table of LSB matching revised, indexed by the first
+  * sample and `lsbmr_code`.
+  */
+struct lsbmr_table {
+	lsbmr_step step[UINT8_MAX + 1][4];
+};
+
+constexpr lsbmr_table make_lsbmr_table()
+{
+	lsbmr_table table;
+	for(unsigned c0 = 0; c0 <= UINT8_MAX; c0++)
+		for(unsigned code = 0; code < 4; code++)
+			table.step[c0][code] = lsbmr_make_step(c0, code);
+
+	return table;
+}
+
+constexpr lsbmr_table lsbmr_steps = make_lsbmr_table();
+
+/** Returns how the pair (`c0`, `c1`) changes to embed the bits `m0`
+  * and `m1`.
+  */
+inline lsbmr_step lsbmr_embed_step(
+	uint8_t c0,
+	uint8_t c1,
+	unsigned m0,
+	unsigned m1)
+{
+	return lsbmr_steps.step[c0][lsbmr_code(c1, m0, m1)];
+}
+
+/*
+ * The same kernels for samples of 16 bits, CV_16U, saturated at 0 and
+ * 65535. The decision of LSB matching revised only depends on the two
+ * least significant bits of the samples and on the saturation, so it
+ * is computed instead of being looked up in a table.
+ */
+
+constexpr uint16_t lsb_embed_sample16(uint16_t c, unsigned bit)
+{
+	return (c & ~1u) | bit;
+}
+
+constexpr unsigned lsb_extract_sample16(uint16_t s)
+{
+	return s & 1u;
+}
+
+constexpr unsigned lsbmr_extract_pair16(uint16_t s0, uint16_t s1)
+{
+	return (s0 & 1u) | ((s0/2 + s1) & 1u) << 1;
+}
+
+constexpr lsbmr_step lsbmr_embed_step16(
+	uint16_t c0,
+	uint16_t c1,
+	unsigned m0,
+	unsigned m1)
+{
+	return lsbmr_make_step_max(c0, m0 << 1 | (m1 ^ (c1 & 1u)), UINT16_MAX);
+}
+
+/*
+ * end of stegim namespace
+ */
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace stegim {
+
+/** The `scratch_resource` class is the source of the temporary buffers
+  * the library uses inside a call, as the pairs of the lsb matching
+  * permutation. It follows std::pmr::memory_resource, so a resource can
+  * be plugged per thread with `set_scratch_resource`.
+  *
+  * @see arena_resource
+  */
+class scratch_resource {
+public:
+	virtual ~scratch_resource();
+
+	/** Returns `bytes` bytes aligned to `alignment`, throws
+	  * std::bad_alloc on failure.
+	  */
+	virtual void* allocate(size_t bytes, size_t alignment) = 0;
+
+	/** Returns a buffer given by `allocate` with the same `bytes`
+	  * and `alignment`.
+	  */
+	virtual void deallocate(void* p, size_t bytes, size_t alignment) = 0;
+};
+
+/** A resource on operator new and operator delete.
+  */
+scratch_resource* new_delete_scratch_resource();
+
+/** The `arena_resource` class hands out buffers from a few big blocks
+  * of memory, by bumping a pointer. The buffers are not reused one by
+  * one, all of them are reclaimed at once when the last one is
+  * deallocated. At that point the blocks are merged in a single block
+  * big enough for the whole round, so a sequence of calls with the
+  * same sizes does not allocate after the first one.
+  *
+  * The blocks are mapped straight from the system, optionally backed by
+  * transparent huge pages, which saves page faults and TLB misses on
+  * the multi megabyte buffers of big images.
+  *
+  * It is not thread safe, each thread has its own, see
+  * `get_scratch_resource`.
+  */
+class arena_resource : public scratch_resource {
+public:
+	/** @param block_size	Minimum size in bytes of a block.
+	  * @param huge_pages	Whether the blocks are advised to use
+	  *			transparent huge pages. The blocks are then
+	  *			rounded to 2 MB.
+	  */
+	arena_resource(size_t block_size = 1 << 20, bool huge_pages = true);
+
+	arena_resource(const arena_resource&) = delete;
+	arena_resource& operator=(const arena_resource&) = delete;
+
+	virtual ~arena_resource();
+
+	virtual void* allocate(size_t bytes, size_t alignment);
+	virtual void deallocate(void* p, size_t bytes, size_t alignment);
+
+	/** Returns the blocks to the system. Must not be called while
+	  * there are buffers allocated.
+	  */
+	virtual void release();
+
+	/** Total size in bytes of the blocks held.
+	  */
+	virtual size_t reserved() const;
+
+	/** Number of blocks mapped since the construction.
+	  */
+	virtual size_t blocks_mapped() const;
+
+private:
+	struct block {
+		char* data;
+		size_t size;
+	};
+
+	block map_block(size_t size);
+	void unmap_block(const block& b);
+
+	size_t block_size;
+	bool huge_pages;
+	std::vector<block> blocks;
+	size_t used;
+	size_t live;
+	size_t n_mapped;
+};
+
+/** Returns the scratch resource of the calling thread. Unless changed
+  * by `set_scratch_resource`, it is an `arena_resource` owned by the
+  * thread.
+  */
+scratch_resource* get_scratch_resource();
+
+/** Sets the scratch resource of the calling thread, which must outlive
+  * the calls using it. A null resource restores the default one.
+  */
+void set_scratch_resource(scratch_resource* resource);
+
+/** Allocator of the containers holding scratch buffers, bound to the
+  * resource of the thread that created it.
+  */
+template<typename T>
+class scratch_allocator {
+public:
+	typedef T value_type;
+
+	scratch_allocator()
+		: resource(get_scratch_resource())
+	{}
+
+	scratch_allocator(scratch_resource* resource)
+		: resource(resource)
+	{}
+
+	template<typename U>
+	scratch_allocator(const scratch_allocator<U>& other)
+		: resource(other.get_resource())
+	{}
+
+	T* allocate(size_t n)
+	{
+		return static_cast<T*>(
+			this->resource->allocate(n*sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* p, size_t n)
+	{
+		this->resource->deallocate(p, n*sizeof(T), alignof(T));
+	}
+
+	scratch_resource* get_resource() const
+	{
+		return this->resource;
+	}
+
+private:
+	scratch_resource* resource;
+};
+
+template<typename T, typename U>
+bool operator==(const scratch_allocator<T>& a, const scratch_allocator<U>& b)
+{
+	return a.get_resource() == b.get_resource();
+}
+
+template<typename T, typename U>
+bool operator!=(const scratch_allocator<T>& a, const scratch_allocator<U>& b)
+{
+	return a.get_resource() != b.get_resource();
+}
+
+/** A vector of scratch memory.
+  */
+template<typename T>
+using scratch_vector = std::vector<T, scratch_allocator<T>>;
+
+/*
+ * end of stegim namespace
+ */
+}
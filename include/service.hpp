@@ -0,0 +1,266 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "lsb_matching.hpp"
+
+namespace stegim {
+
+/** The `service_options` class provides the optional arguments of
+  * `service`, in the same fashion of `lsb_options`.
+  *
+  * @see service
+  */
+class service_options {
+public:
+	service_options();
+
+	virtual ~service_options();
+
+	/** Number of permutations kept warm, the least recently used
+	  * one is dropped first. Default 16.
+	  */
+	virtual service_options& set_cache_size(int cache_size);
+
+	/** Threads of each job, as lsb_matching_options::set_threads.
+	  * The connections are served in parallel, one thread each.
+	  * Default 1.
+	  */
+	virtual service_options& set_threads(int n_threads);
+
+	virtual int get_cache_size() const;
+	virtual int get_threads() const;
+
+private:
+	int cache_size;
+	int n_threads;
+};
+
+/** The `service` class is a long running lsb matching service. Its
+  * clients connect to a Unix domain socket and submit embedding and
+  * extraction jobs, whose frames are `shared_frame` buffers: the
+  * service maps the memory of the client, and embeds in place, so the
+  * pixels are never copied through the socket. The permutations of
+  * the keys are cached, so the jobs on a geometry and a key already
+  * seen skip the permutation.
+  *
+  * The edge adaptive mode, the stats sink and the delta are not
+  * supported through the socket.
+  *
+  * @see service_client
+  */
+class service {
+public:
+	/** Listens on `socket_path`, replacing a stale socket file.
+	  *
+	  * @see listening
+	  */
+	service(
+		const std::string& socket_path,
+		const service_options& service_opt = service_options());
+
+	service(const service&) = delete;
+	service& operator=(const service&) = delete;
+
+	/** Stops the service and removes the socket file.
+	  */
+	virtual ~service();
+
+	/** Whether the socket is listening. If not, `run` returns at
+	  * once.
+	  */
+	virtual bool listening() const;
+
+	/** Serves the clients in the calling thread until `stop` is
+	  * called. The socket is then closed and removed, resetting the
+	  * clients not yet accepted, and the connections still open are
+	  * shut down.
+	  */
+	virtual void run();
+
+	/** Makes `run` return. May be called from any thread, and from a
+	  * signal handler.
+	  */
+	virtual void stop();
+
+	/** Number of jobs whose permutation was found in the cache, and
+	  * computed.
+	  */
+	virtual size_t cache_hits() const;
+	virtual size_t cache_misses() const;
+
+private:
+	typedef std::shared_ptr<const lsb_matching_permutation> permutation_ptr;
+
+	struct cache_entry {
+		std::string id;
+		permutation_ptr permutation;
+	};
+
+	struct connection {
+		int fd;
+		std::thread thread;
+		std::atomic<bool> done;
+	};
+
+	void serve(connection* c);
+	permutation_ptr get_permutation(
+		const cv::Mat& frame,
+		const std::vector<char>& key,
+		const lsb_matching_options& lsbm_opt);
+	void reap(bool all);
+
+	std::string socket_path;
+	service_options service_opt;
+	int listen_fd;
+	int stop_pipe[2];
+
+	std::mutex connections_mutex;
+	std::list<std::unique_ptr<connection>> connections;
+
+	/*
+	 * the most recently used permutation first
+	 */
+	std::mutex cache_mutex;
+	std::list<cache_entry> cache;
+	std::map<std::string, std::list<cache_entry>::iterator> cache_index;
+	std::atomic<size_t> n_hits, n_misses;
+};
+
+/** The `shared_frame` class is an image in an anonymous shared memory
+  * file, the frames given to a `service`. The image is written by the
+  * client, as any cv::Mat, and is embedded in place by the service.
+  * The file is sealed against shrinking and growing, and the service
+  * refuses the files that are not.
+  */
+class shared_frame {
+public:
+	/** Allocates a continuous `rows`x`cols` image of `type`, one of
+	  * CV_8UC{1,3,4} or CV_16UC{1,3,4}.
+	  *
+	  * @see valid
+	  */
+	shared_frame(int rows, int cols, int type);
+
+	shared_frame(const shared_frame&) = delete;
+	shared_frame& operator=(const shared_frame&) = delete;
+
+	virtual ~shared_frame();
+
+	/** Whether the memory could be allocated.
+	  */
+	virtual bool valid() const;
+
+	/** The image, a header on the shared memory.
+	  */
+	virtual cv::Mat& mat();
+	virtual const cv::Mat& mat() const;
+
+	/** The shared memory file and the identifier of the frame in the
+	  * process, unique while the frame lives.
+	  */
+	virtual int fd() const;
+	virtual uint64_t id() const;
+
+private:
+	int memfd;
+	uint64_t frame_id;
+	void* memory;
+	size_t size;
+	cv::Mat image;
+};
+
+/** The `service_client` class submits jobs to a `service`. A frame is
+  * sent to the service with its first job, and stays mapped by the
+  * service until it is released or the client disconnects.
+  *
+  * The functions of a client must be called from a single thread,
+  * each waits for its job to be done.
+  */
+class service_client {
+public:
+	service_client();
+
+	service_client(const service_client&) = delete;
+	service_client& operator=(const service_client&) = delete;
+
+	virtual ~service_client();
+
+	/** Connects to the service listening on `socket_path`, closing
+	  * the previous connection.
+	  *
+	  * @return		Whether the client is connected.
+	  */
+	virtual bool connect(const std::string& socket_path);
+
+	virtual bool connected() const;
+
+	/** Embeds `data` in `frame` in place, as `lsb_matching_embed`.
+	  *
+	  * @param frame	The frame, written by the service.
+	  * @param data		Data to be embedded. Must fit in `frame`.
+	  * @param key		The key of lsb_matching_embed.
+	  * @param lsbm_opt	The tile size, the Feistel permutation and
+	  *			the encryption are sent, the other options
+	  *			are not used. The edge adaptive mode is not
+	  *			supported.
+	  *
+	  * @return		Whether the job was done. It fails if the
+	  *			connection is lost or the data does not fit.
+	  */
+	virtual bool embed(
+		shared_frame& frame,
+		const std::vector<char>& data,
+		const std::vector<char>& key,
+		const lsb_matching_options& lsbm_opt = lsb_matching_options());
+
+	/** Extracts `size` bytes from `frame` in `data`, as
+	  * `lsb_matching_extract`.
+	  *
+	  * @see embed
+	  */
+	virtual bool extract(
+		const shared_frame& frame,
+		std::vector<char>& data,
+		size_t size,
+		const std::vector<char>& key,
+		const lsb_matching_options& lsbm_opt = lsb_matching_options());
+
+	/** Unmaps `frame` from the service. It is sent again with its next
+	  * job.
+	  */
+	virtual bool release(const shared_frame& frame);
+
+private:
+	bool submit(
+		uint32_t op,
+		const shared_frame& frame,
+		const std::vector<char>& data,
+		size_t size,
+		const std::vector<char>& key,
+		const lsb_matching_options& lsbm_opt,
+		std::vector<char>* reply);
+
+	void disconnect();
+
+	int fd;
+	std::set<uint64_t> frames_sent;
+};
+
+/*
+ * end of stegim namespace
+ */
+}
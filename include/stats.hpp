@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/** The largest change of a sample counted by its own bin of
+  * `stats::change_histogram`, and the number of bins.
+  */
+#define STATS_MAX_CHANGE 3
+#define STATS_CHANGE_BINS (2*STATS_MAX_CHANGE + 1)
+
+namespace stegim {
+
+/** The `stats` class is a sink for instrumentation of the embed and
+  * extract calls. It is attached to a call through its options and
+  * every call accumulates its numbers in the sink, so the same sink may
+  * aggregate several calls. When no sink is attached, nothing is
+  * measured.
+  *
+  * @see lsb_options
+  * @see lsb_matching_options
+  */
+struct stats {
+	/*
+	 * time spent, in nanoseconds, generating the key based
+	 * permutation of the samples
+	 */
+	uint64_t permutation_ns;
+
+	/*
+	 * time spent, in nanoseconds, embedding or extracting data
+	 */
+	uint64_t embedding_ns;
+
+	/*
+	 * time spent, in nanoseconds, copying the regions of the cover
+	 * not used by the embedding to the stego image
+	 */
+	uint64_t copy_ns;
+
+	/*
+	 * number of samples used to embed or extract data
+	 */
+	size_t samples_visited;
+
+	/*
+	 * number of samples with a different value in stego and cover
+	 */
+	size_t samples_modified;
+
+	/*
+	 * number of saturated samples (0 or 255) that needed a special
+	 * adjustment by lsb matching
+	 */
+	size_t saturated_adjustments;
+
+	/*
+	 * number of data bytes embedded or extracted
+	 */
+	size_t bytes_processed;
+
+	/*
+	 * time spent, in nanoseconds, framing the data with its checksum
+	 * and parity or checking and correcting a frame
+	 */
+	uint64_t framing_ns;
+
+	/*
+	 * number of bytes of frames corrected by their parity
+	 */
+	size_t bytes_corrected;
+
+	/*
+	 * sum of the squared differences of the stego and the cover
+	 * samples visited by the embed calls
+	 */
+	uint64_t squared_error;
+
+	/*
+	 * number of samples of the stego images of the embed calls, over
+	 * which the squared error is averaged by `mse`
+	 */
+	size_t samples_total;
+
+	/*
+	 * largest value of a sample of those images, 255, or 65535 if
+	 * one of them has samples of 16 bits, the peak of `psnr`
+	 */
+	unsigned sample_max;
+
+	/*
+	 * number of samples visited by the embed calls by their change,
+	 * stego minus cover, the change d at change_histogram[d + 3]. lsb
+	 * changes a sample by +/-1, lsb matching by +/-3 as well in its
+	 * saturated adjustments. The larger changes of the edge adaptive
+	 * readjustment are counted at the ends.
+	 */
+	size_t change_histogram[STATS_CHANGE_BINS];
+
+	/*
+	 * instruction set of the vectorized kernels used by the calls,
+	 * "scalar", "sse42", "avx2" or "avx512", or null if the calls
+	 * did not use them. It is selected once for the cpu and may be
+	 * forced with the environment variable STEGIM_ISA.
+	 */
+	const char* isa;
+
+	stats();
+
+	/** Sets all counters to zero and `isa` to null.
+	  */
+	void reset();
+
+	/** Accumulates the counters of `other`, so the stats of calls
+	  * made with separated sinks, such as concurrent calls, can be
+	  * merged.
+	  */
+	stats& operator+=(const stats& other);
+
+	/** The mean squared error of the stego images of the embed calls,
+	  * exact without reading the images again, as the samples not
+	  * visited keep their cover values. 0 if there was no call.
+	  */
+	double mse() const;
+
+	/** The peak signal to noise ratio, in dB, of `sample_max` and
+	  * `mse`. Infinity if no sample was changed.
+	  */
+	double psnr() const;
+};
+
+/*
+ * end of stegim namespace
+ */
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "capacity.hpp"
+#include "lsb_matching.hpp"
+
+class worker_team;
+
+namespace stegim {
+
+/** The `stream_context` class embeds data with lsb matching in a
+  * sequence of frames of a fixed geometry, as the frames of a video.
+  * The permutation of the key, the two stego buffers and the threads
+  * of the tiles are built once by the constructor, after that embedding
+  * a frame does not allocate.
+  *
+  * A frame can be embedded synchronously with `process`, or handed to
+  * a worker thread with `submit` and collected with `retrieve`, so the
+  * embedding of a frame overlaps with the decoding of the next one and
+  * the encoding of the previous one. Each frame is written in one of
+  * the two stego buffers, alternately.
+  *
+  * The functions of a context must be called from a single thread.
+  *
+  * @see lsb_matching_embed
+  */
+class stream_context {
+public:
+	/** @param geometry	The geometry of the frames.
+	  * @param key		The key of lsb_matching_embed.
+	  * @param lsbm_opt	Optional arguments of lsb_matching_embed, the
+	  *			edge adaptive mode is not supported. A stats
+	  *			sink or a delta are written by the worker
+	  *			thread when the frames are submitted. The
+	  *			tiles of a frame are embedded by threads
+	  *			owned by the context.
+	  */
+	stream_context(
+		const cover_geometry& geometry,
+		const std::vector<char>& key,
+		const lsb_matching_options& lsbm_opt = lsb_matching_options());
+
+	stream_context(const stream_context&) = delete;
+	stream_context& operator=(const stream_context&) = delete;
+
+	virtual ~stream_context();
+
+	/** Embeds `data` in `frame` in the calling thread. Must not be
+	  * called while frames submitted are not retrieved.
+	  *
+	  * @param frame	The cover frame. Must be CV_8UC{1,3,4} type
+	  *			with the geometry of the context.
+	  * @param data		Data to be embedded, up to `capacity` bytes.
+	  *
+	  * @return		The stego frame, valid until the next call
+	  *			to `process` or `submit`.
+	  */
+	virtual const cv::Mat& process(
+		const cv::Mat& frame,
+		const std::vector<char>& data);
+
+	/** Queues the embedding of `data` in `frame` and returns at once.
+	  * `data` is copied, `frame` must not be modified until its stego
+	  * is retrieved. At most two frames may be submitted and not
+	  * retrieved.
+	  *
+	  * @param frame	The cover frame. Must be CV_8UC{1,3,4} type
+	  *			with the geometry of the context.
+	  * @param data		Data to be embedded, up to `capacity` bytes.
+	  */
+	virtual void submit(
+		const cv::Mat& frame,
+		const std::vector<char>& data);
+
+	/** Waits for the oldest frame submitted and not retrieved.
+	  *
+	  * @return		Its stego frame, valid until the next call
+	  *			to `process` or `submit`.
+	  */
+	virtual const cv::Mat& retrieve();
+
+	/** Number of bytes each frame holds.
+	  */
+	virtual size_t capacity() const;
+
+private:
+	enum slot_state { FREE, PENDING, DONE, HELD };
+
+	/*
+	 * one of the two buffers of the double buffering
+	 */
+	struct slot {
+		cv::Mat frame;
+		cv::Mat stego;
+		std::vector<char> data;
+		slot_state state;
+	};
+
+	void check_frame(const cv::Mat& frame) const;
+	void work();
+
+	cover_geometry geometry;
+	lsb_matching_permutation permutation;
+	lsb_matching_options lsbm_opt;
+
+	slot slots[2];
+	int next_submit, next_work, next_retrieve;
+
+	bool stop;
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::thread worker;
+
+	/*
+	 * the threads of the tiles, null without them
+	 */
+	std::unique_ptr<worker_team> tile_workers;
+};
+
+/*
+ * end of stegim namespace
+ */
+}
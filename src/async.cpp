@@ -0,0 +1,541 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include <cassert>
+#include <climits>
+#include <cstring>
+
+#include "async.hpp"
+#include "lsb_matching_kernel.hpp"
+#include "thread_pool.hpp"
+
+thread_local const std::atomic<bool>* chunk_cancel_flag = nullptr;
+
+thread_pool& library_thread_pool()
+{
+	static thread_pool pool(0);
+	return pool;
+}
+
+/*
+ * the state shared by the handles of a job and its chunks
+ */
+struct stegim::async_state {
+	std::atomic<bool> cancel;
+
+	std::function<void(size_t, size_t)> progress;
+	std::mutex progress_mutex;
+	size_t n_chunks;
+	size_t n_done;
+
+	std::mutex mutex;
+	std::condition_variable finished_changed;
+	bool finished;
+	bool completed;
+	std::function<void(bool)> callback;
+
+	/*
+	 * the permutation of an lsb matching job, freed before the job is
+	 * done so the caller may exit once it waits
+	 */
+	std::unique_ptr<stegim::lsb_matching_permutation> permutation;
+};
+
+typedef std::shared_ptr<stegim::async_state> async_state_ptr;
+
+async_state_ptr async_new_state(const stegim::async_options& async_opt, size_t n_chunks)
+{
+	async_state_ptr state = std::make_shared<stegim::async_state>();
+	state->cancel = false;
+	state->progress = async_opt.get_progress();
+	state->n_chunks = n_chunks;
+	state->n_done = 0;
+	state->finished = false;
+	state->completed = false;
+
+	return state;
+}
+
+void async_finish(const async_state_ptr& state, bool completed)
+{
+	state->permutation.reset();
+
+	std::function<void(bool)> callback;
+	{
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->finished = true;
+		state->completed = completed;
+		callback.swap(state->callback);
+	}
+	state->finished_changed.notify_all();
+
+	if(callback)
+		callback(completed);
+}
+
+/*
+ * runs a stage of a job: the `n` chunks of `chunk` in parallel on the
+ * pool, then `next` once all of them are done, or the end of the job
+ * if `next` is empty. A cancelled job ends after the stage. The chunks
+ * of a cancelled job are skipped, unless `always`, when they are run
+ * to leave a valid output and check the cancellation themselves.
+ */
+void async_stage(
+	const async_state_ptr& state,
+	size_t n,
+	std::function<void(size_t)> chunk,
+	std::function<void()> next,
+	bool always = false)
+{
+	if(n == 0){
+		if(state->cancel)
+			async_finish(state, false);
+		else if(next)
+			next();
+		else
+			async_finish(state, true);
+		return;
+	}
+
+	auto remaining = std::make_shared<std::atomic<size_t>>(n);
+	auto shared_chunk = std::make_shared<std::function<void(size_t)>>(std::move(chunk));
+	auto shared_next = std::make_shared<std::function<void()>>(std::move(next));
+
+	for(size_t i = 0; i < n; i++)
+		library_thread_pool().submit([=](){
+			if(always || !state->cancel){
+				chunk_cancel_flag = &state->cancel;
+				(*shared_chunk)(i);
+				chunk_cancel_flag = nullptr;
+			}
+
+			if(state->progress && !state->cancel){
+				std::lock_guard<std::mutex> lock(state->progress_mutex);
+				state->progress(++state->n_done, state->n_chunks);
+			}
+
+			if(--*remaining)
+				return;
+
+			if(state->cancel)
+				async_finish(state, false);
+			else if(*shared_next)
+				(*shared_next)();
+			else
+				async_finish(state, true);
+		});
+}
+
+/*
+ * number of the channels of `image` selected by `lsb_opt`, the only
+ * channel of a grayscale image
+ */
+size_t async_lsb_channels(const cv::Mat& image, const stegim::lsb_options& lsb_opt)
+{
+	if(image.channels() == 1)
+		return 1;
+
+	bool channel[] = {
+		lsb_opt.get_b(),
+		lsb_opt.get_g(),
+		lsb_opt.get_r(),
+		lsb_opt.get_a()
+	};
+
+	size_t n = 0;
+	for(int c = 0; c < image.channels(); c++)
+		n += channel[c];
+
+	return n;
+}
+
+/*
+ * the rows splitting `image` in strips of about `chunk_size` samples.
+ * The bits of the data before each split are a whole number of bytes,
+ * so each strip takes its own bytes. If no row of the next 8 splits at
+ * a byte, the last strip goes to the end of the image.
+ */
+std::vector<int> async_lsb_strips(
+	const cv::Mat& image,
+	const stegim::lsb_options& lsb_opt,
+	size_t chunk_size)
+{
+	size_t n_channels = async_lsb_channels(image, lsb_opt);
+	size_t cols = image.cols;
+	size_t offset = lsb_opt.get_offset();
+
+	auto aligned = [&](size_t row){
+		return row*cols <= offset || (row*cols - offset)*n_channels%CHAR_BIT == 0;
+	};
+
+	int step = std::max((size_t) 1, chunk_size/(cols*image.channels()));
+
+	std::vector<int> strips(1, 0);
+	while(strips.back() < image.rows){
+		int row = strips.back() + step;
+		while(row < image.rows && row < strips.back() + step + CHAR_BIT && !aligned(row))
+			row++;
+
+		strips.push_back(row < image.rows && aligned(row) ? row : image.rows);
+	}
+
+	return strips;
+}
+
+/*
+ * the options and the bytes of the data of the strip [`row0`, `row1`)
+ * of `image`: its offset in the strip and the range [`begin`, `end`)
+ * of the bytes its bits hold, empty if it holds none
+ */
+stegim::lsb_options async_lsb_strip(
+	const cv::Mat& image,
+	const stegim::lsb_options& lsb_opt,
+	int row0,
+	int row1,
+	size_t& begin,
+	size_t& end)
+{
+	size_t n_channels = async_lsb_channels(image, lsb_opt);
+	size_t first = (size_t) row0*image.cols;
+	size_t last = (size_t) row1*image.cols;
+	size_t offset = lsb_opt.get_offset();
+
+	stegim::lsb_options strip_opt(lsb_opt);
+	strip_opt.set_stats(nullptr).set_offset(0);
+
+	if(offset >= last){
+		begin = end = 0;
+		return strip_opt;
+	}
+
+	size_t strip_offset = offset > first ? offset - first : 0;
+	strip_opt.set_offset(strip_offset);
+
+	begin = (first + strip_offset - offset)*n_channels/CHAR_BIT;
+	end = (last - offset)*n_channels/CHAR_BIT;
+
+	/*
+	 * the last strip may end in the middle of a byte
+	 */
+	if(row1 == image.rows)
+		end = (last - offset)*n_channels/CHAR_BIT + 1;
+
+	return strip_opt;
+}
+
+/*
+ * async_options
+ */
+stegim::async_options::async_options()
+	: chunk_size(1 << 20)
+{}
+
+stegim::async_options::~async_options()
+{}
+
+stegim::async_options& stegim::async_options::set_chunk_size(size_t chunk_size)
+{
+	assert(chunk_size > 0);
+	this->chunk_size = chunk_size;
+	return *this;
+}
+
+stegim::async_options& stegim::async_options::set_progress(
+	std::function<void(size_t, size_t)> progress)
+{
+	this->progress = progress;
+	return *this;
+}
+
+size_t stegim::async_options::get_chunk_size() const
+{
+	return this->chunk_size;
+}
+
+const std::function<void(size_t, size_t)>& stegim::async_options::get_progress() const
+{
+	return this->progress;
+}
+
+/*
+ * async_job
+ */
+stegim::async_job::async_job()
+{}
+
+stegim::async_job::async_job(const std::shared_ptr<stegim::async_state>& state)
+	: state(state)
+{}
+
+stegim::async_job::~async_job()
+{}
+
+void stegim::async_job::cancel()
+{
+	if(this->state)
+		this->state->cancel = true;
+}
+
+bool stegim::async_job::done() const
+{
+	if(!this->state)
+		return true;
+
+	std::lock_guard<std::mutex> lock(this->state->mutex);
+	return this->state->finished;
+}
+
+bool stegim::async_job::wait()
+{
+	if(!this->state)
+		return false;
+
+	std::unique_lock<std::mutex> lock(this->state->mutex);
+	this->state->finished_changed.wait(lock, [this](){
+		return this->state->finished;
+	});
+
+	return this->state->completed;
+}
+
+/*
+ * the callback may destroy this handle, only the local copy of the
+ * state is used around it
+ */
+void stegim::async_job::on_complete(std::function<void(bool)> callback)
+{
+	async_state_ptr state = this->state;
+	if(!state){
+		callback(false);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	if(!state->finished){
+		state->callback = std::move(callback);
+		return;
+	}
+
+	bool completed = state->completed;
+	lock.unlock();
+	callback(completed);
+}
+
+stegim::async_job stegim::lsb_embed_async(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const stegim::lsb_options& lsb_opt,
+	const stegim::async_options& async_opt)
+{
+	assert(	cover.type() == CV_8UC1 ||
+		cover.type() == CV_8UC3 ||
+		cover.type() == CV_8UC4 ||
+		cover.type() == CV_16UC1 ||
+		cover.type() == CV_16UC3 ||
+		cover.type() == CV_16UC4);
+	assert(cover.cols && cover.rows);
+	assert(async_lsb_channels(cover, lsb_opt));
+	assert(!lsb_opt.get_delta());
+	stego.create(cover.size(), cover.type());
+
+	std::vector<int> strips = async_lsb_strips(cover, lsb_opt,
+		async_opt.get_chunk_size());
+	async_state_ptr state = async_new_state(async_opt, strips.size() - 1);
+
+	/*
+	 * the headers share the pixels of the caller
+	 */
+	cv::Mat cover_header = cover, stego_header = stego;
+	auto shared_data = std::make_shared<std::vector<char>>(data);
+
+	async_stage(state, strips.size() - 1, [=](size_t s){
+		cv::Rect strip(0, strips[s], cover_header.cols, strips[s + 1] - strips[s]);
+		cv::Mat cover_strip = cover_header(strip);
+		cv::Mat stego_strip = stego_header(strip);
+
+		size_t begin, end;
+		stegim::lsb_options strip_opt = async_lsb_strip(cover_header, lsb_opt,
+			strips[s], strips[s + 1], begin, end);
+
+		begin = std::min(begin, shared_data->size());
+		end = std::min(end, shared_data->size());
+
+		/*
+		 * the strips of a cancelled job keep the cover
+		 */
+		if(begin == end || state->cancel){
+			if(stego_strip.data != cover_strip.data)
+				cover_strip.copyTo(stego_strip);
+			return;
+		}
+
+		std::vector<char> bytes(shared_data->begin() + begin,
+			shared_data->begin() + end);
+		stegim::lsb_embed(cover_strip, stego_strip, bytes, strip_opt);
+	}, nullptr, true);
+
+	return stegim::async_job(state);
+}
+
+stegim::async_job stegim::lsb_extract_async(
+	const cv::Mat& stego,
+	std::vector<char>& data,
+	int size,
+	const stegim::lsb_options& lsb_opt,
+	const stegim::async_options& async_opt)
+{
+	assert(	stego.type() == CV_8UC1 ||
+		stego.type() == CV_8UC3 ||
+		stego.type() == CV_8UC4 ||
+		stego.type() == CV_16UC1 ||
+		stego.type() == CV_16UC3 ||
+		stego.type() == CV_16UC4);
+	assert(stego.cols && stego.rows);
+	assert(async_lsb_channels(stego, lsb_opt));
+
+	/*
+	 * sized as lsb_extract, the bytes past the image are left zero
+	 */
+	data.assign(size < 0 ? (size_t) stego.rows*stego.cols/CHAR_BIT : size, 0);
+
+	std::vector<int> strips = async_lsb_strips(stego, lsb_opt,
+		async_opt.get_chunk_size());
+	async_state_ptr state = async_new_state(async_opt, strips.size() - 1);
+
+	cv::Mat stego_header = stego;
+	char* out = data.data();
+	size_t n_bytes = data.size();
+
+	async_stage(state, strips.size() - 1, [=](size_t s){
+		cv::Rect strip(0, strips[s], stego_header.cols, strips[s + 1] - strips[s]);
+
+		size_t begin, end;
+		stegim::lsb_options strip_opt = async_lsb_strip(stego_header, lsb_opt,
+			strips[s], strips[s + 1], begin, end);
+
+		begin = std::min(begin, n_bytes);
+		end = std::min(end, n_bytes);
+		if(begin == end)
+			return;
+
+		std::vector<char> bytes;
+		stegim::lsb_extract(stego_header(strip), bytes, end - begin, strip_opt);
+		std::memcpy(out + begin, bytes.data(), std::min(bytes.size(), end - begin));
+	}, nullptr);
+
+	return stegim::async_job(state);
+}
+
+/*
+ * the options of the permutation of an async job, computed in the
+ * thread of its chunk
+ */
+stegim::lsb_matching_options async_lsbm_options(
+	const stegim::lsb_matching_options& lsbm_opt)
+{
+	return stegim::lsb_matching_options(lsbm_opt)
+		.set_stats(nullptr)
+		.set_threads(1);
+}
+
+stegim::async_job stegim::lsb_matching_embed_async(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt,
+	const stegim::async_options& async_opt)
+{
+	assert(	cover.type() == CV_8UC1 ||
+		cover.type() == CV_8UC3 ||
+		cover.type() == CV_8UC4 ||
+		cover.type() == CV_16UC1 ||
+		cover.type() == CV_16UC3 ||
+		cover.type() == CV_16UC4);
+	assert(cover.cols && cover.rows);
+	assert(!lsbm_opt.get_edge_adaptive());
+	assert(!lsbm_opt.get_delta());
+	stego.create(cover.size(), cover.type());
+
+	/*
+	 * a byte takes 4 pairs, 8 samples
+	 */
+	size_t chunk_bytes = std::max((size_t) 1, async_opt.get_chunk_size()/CHAR_BIT);
+	size_t n_chunks = (data.size() + chunk_bytes - 1)/chunk_bytes;
+
+	/*
+	 * the permutation and the copy of the cover, then the bytes
+	 */
+	async_state_ptr state = async_new_state(async_opt, 2 + n_chunks);
+
+	cv::Mat cover_header = cover, stego_header = stego;
+	auto shared_data = std::make_shared<std::vector<char>>(data);
+	stegim::lsb_matching_options opt = async_lsbm_options(lsbm_opt);
+
+	auto embed = [=](size_t c) mutable {
+		lsbm_embed_range(stego_header, *shared_data, *state->permutation, opt,
+			c*chunk_bytes, (c + 1)*chunk_bytes);
+	};
+
+	/*
+	 * the cover is copied even if the job is cancelled, the pairs
+	 * already embedded then leave a valid partial image
+	 */
+	async_stage(state, 2, [=](size_t c) mutable {
+		if(c == 0 && !state->cancel)
+			state->permutation.reset(new stegim::lsb_matching_permutation(
+				cover_header, key, opt));
+		else if(c == 1 && stego_header.data != cover_header.data)
+			cover_header.copyTo(stego_header);
+	}, [=](){
+		async_stage(state, n_chunks, embed, nullptr);
+	}, true);
+
+	return stegim::async_job(state);
+}
+
+stegim::async_job stegim::lsb_matching_extract_async(
+	const cv::Mat& stego,
+	std::vector<char>& data,
+	size_t size,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt,
+	const stegim::async_options& async_opt)
+{
+	assert(	stego.type() == CV_8UC1 ||
+		stego.type() == CV_8UC3 ||
+		stego.type() == CV_8UC4 ||
+		stego.type() == CV_16UC1 ||
+		stego.type() == CV_16UC3 ||
+		stego.type() == CV_16UC4);
+	assert(stego.cols && stego.rows);
+	assert(!lsbm_opt.get_edge_adaptive());
+
+	data.assign(size, 0);
+
+	size_t chunk_bytes = std::max((size_t) 1, async_opt.get_chunk_size()/CHAR_BIT);
+	size_t n_chunks = (size + chunk_bytes - 1)/chunk_bytes;
+
+	async_state_ptr state = async_new_state(async_opt, 1 + n_chunks);
+
+	cv::Mat stego_header = stego;
+	std::vector<char>* out = &data;
+	stegim::lsb_matching_options opt = async_lsbm_options(lsbm_opt);
+
+	auto extract = [=](size_t c){
+		lsbm_extract_range(stego_header, *out, *state->permutation, opt,
+			c*chunk_bytes, std::min(size, (c + 1)*chunk_bytes));
+	};
+
+	async_stage(state, 1, [=](size_t){
+		state->permutation.reset(new stegim::lsb_matching_permutation(
+			stego_header, key, opt));
+	}, [=](){
+		async_stage(state, n_chunks, extract, nullptr);
+	});
+
+	return stegim::async_job(state);
+}
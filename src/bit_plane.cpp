@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "bit_plane.hpp"
+#include "kernels.hpp"
+
+/*
+ * number of samples in each row of `image`, or in the whole
+ * image if `image` is continuous
+ */
+inline void plane_geometry(const cv::Mat& image, size_t& rows, size_t& cols)
+{
+	rows = image.rows;
+	cols = image.cols*image.channels();
+
+	if(image.isContinuous()){
+		cols *= rows;
+		rows = 1;
+	}
+}
+
+void stegim::bit_plane_pack(
+	const cv::Mat& image,
+	std::vector<char>& plane,
+	int k)
+{
+	assert(	image.type() == CV_8UC1 ||
+		image.type() == CV_8UC3 ||
+		image.type() == CV_8UC4);
+	assert(k >= 0 && k < CHAR_BIT);
+
+	size_t rows, cols;
+	plane_geometry(image, rows, cols);
+
+	size_t n_samples = rows*cols;
+	plane.clear();
+	plane.resize((n_samples + CHAR_BIT - 1)/CHAR_BIT, 0);
+
+	const kernel_table& kt = kernels();
+	uchar* dst = reinterpret_cast<uchar*>(plane.data());
+
+	if(rows == 1){
+		kt.pack_plane(image.ptr<uchar>(0), cols, k, dst);
+		return;
+	}
+
+	/*
+	 * the rows are not byte aligned in the bitmap, so they are
+	 * packed in words and appended
+	 */
+	size_t pos = 0;
+	for(size_t i = 0; i < rows; i++){
+		const uchar* ptr = image.ptr<uchar>(i);
+
+		for(size_t j = 0; j < cols; j += PLANE_WORD_BIT){
+			size_t n = std::min((size_t) PLANE_WORD_BIT, cols - j);
+			uint64_t word = 0;
+
+			kt.pack_plane(ptr + j, n, k, (uchar*) &word);
+			append_bits(dst, pos, word, n);
+			pos += n;
+		}
+	}
+}
+
+void stegim::bit_plane_unpack(
+	const std::vector<char>& plane,
+	cv::Mat& image,
+	int k)
+{
+	assert(	image.type() == CV_8UC1 ||
+		image.type() == CV_8UC3 ||
+		image.type() == CV_8UC4);
+	assert(k >= 0 && k < CHAR_BIT);
+
+	size_t rows, cols;
+	plane_geometry(image, rows, cols);
+
+	assert(plane.size()*CHAR_BIT >= rows*cols);
+
+	const kernel_table& kt = kernels();
+	const uchar* bits = reinterpret_cast<const uchar*>(plane.data());
+
+	if(rows == 1){
+		uchar* ptr = image.ptr<uchar>(0);
+		kt.unpack_plane(bits, cols, k, ptr, ptr);
+		return;
+	}
+
+	size_t pos = 0;
+	for(size_t i = 0; i < rows; i++){
+		uchar* ptr = image.ptr<uchar>(i);
+
+		for(size_t j = 0; j < cols; j += PLANE_WORD_BIT){
+			size_t n = std::min((size_t) PLANE_WORD_BIT, cols - j);
+			uint64_t word = read_bits(bits, pos, n);
+
+			kt.unpack_plane((const uchar*) &word, n, k, ptr + j, ptr + j);
+			pos += n;
+		}
+	}
+}
+
+void stegim::bit_plane_pack_channels(
+	const cv::Mat& image,
+	std::vector<std::vector<char>>& planes,
+	int k)
+{
+	assert(	image.type() == CV_8UC1 ||
+		image.type() == CV_8UC3 ||
+		image.type() == CV_8UC4);
+	assert(k >= 0 && k < CHAR_BIT);
+
+	size_t channels = image.channels();
+	if(channels == 1){
+		planes.resize(1);
+		bit_plane_pack(image, planes[0], k);
+		return;
+	}
+
+	size_t rows = image.rows;
+	size_t cols = image.cols;
+
+	if(image.isContinuous()){
+		cols *= rows;
+		rows = 1;
+	}
+
+	planes.resize(channels);
+	for(std::vector<char>& p : planes){
+		p.clear();
+		p.resize((rows*cols + CHAR_BIT - 1)/CHAR_BIT, 0);
+	}
+
+	/*
+	 * for a block of 64 pixels, the interleaved plane takes
+	 * `channels` words and mask[c][w] selects the bits of the
+	 * channel c in the w-th word
+	 */
+	const kernel_table& kt = kernels();
+	uint64_t mask[4][4] = {};
+	for(size_t w = 0; w < channels; w++)
+		for(size_t b = 0; b < PLANE_WORD_BIT; b++)
+			mask[(w*PLANE_WORD_BIT + b)%channels][w] |= 1ULL << b;
+
+	size_t pos = 0;
+	for(size_t i = 0; i < rows; i++){
+		const uchar* ptr = image.ptr<uchar>(i);
+
+		for(size_t j = 0; j < cols; j += PLANE_WORD_BIT){
+			size_t n = std::min((size_t) PLANE_WORD_BIT, cols - j);
+			uint64_t word[4] = {};
+
+			kt.pack_plane(ptr + j*channels, n*channels, k, (uchar*) word);
+
+			for(size_t c = 0; c < channels; c++){
+				uint64_t bits = 0;
+				size_t n_bits = 0;
+				for(size_t w = 0; w < channels; w++){
+					bits |= kt.pext(word[w], mask[c][w]) << n_bits;
+					n_bits += __builtin_popcountll(mask[c][w]);
+				}
+
+				uchar* dst = reinterpret_cast<uchar*>(planes[c].data());
+				if(pos%CHAR_BIT == 0 && n == PLANE_WORD_BIT)
+					std::memcpy(dst + pos/CHAR_BIT, &bits, sizeof(bits));
+				else
+					append_bits(dst, pos, bits, n);
+			}
+
+			pos += n;
+		}
+	}
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+/*
+ * bounded lock free multi producer multi consumer queue, from
+ * Dmitry Vyukov's design. Each cell has a sequence number telling
+ * whether it is free for the producer of a position or filled for its
+ * consumer, so the producers and the consumers only contend on their
+ * own position counter. The capacity is rounded up to a power of two.
+ */
+template<typename T>
+class bounded_queue {
+public:
+	bounded_queue(size_t capacity)
+		: cell(round_capacity(capacity)),
+		mask(cell.size() - 1)
+	{
+		for(size_t i = 0; i < this->cell.size(); i++)
+			this->cell[i].sequence.store(i, std::memory_order_relaxed);
+
+		this->enqueue_pos.store(0, std::memory_order_relaxed);
+		this->dequeue_pos.store(0, std::memory_order_relaxed);
+	}
+
+	bounded_queue(const bounded_queue&) = delete;
+	bounded_queue& operator=(const bounded_queue&) = delete;
+
+	/*
+	 * returns false if the queue is full
+	 */
+	bool try_push(const T& value)
+	{
+		cell_t* c;
+		size_t pos = this->enqueue_pos.load(std::memory_order_relaxed);
+
+		for(;;){
+			c = &this->cell[pos & this->mask];
+			size_t seq = c->sequence.load(std::memory_order_acquire);
+			ptrdiff_t diff = (ptrdiff_t) seq - (ptrdiff_t) pos;
+
+			if(diff == 0){
+				if(this->enqueue_pos.compare_exchange_weak(
+					pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}else if(diff < 0){
+				return false;
+			}else{
+				pos = this->enqueue_pos.load(std::memory_order_relaxed);
+			}
+		}
+
+		c->value = value;
+		c->sequence.store(pos + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	/*
+	 * returns false if the queue is empty
+	 */
+	bool try_pop(T& value)
+	{
+		cell_t* c;
+		size_t pos = this->dequeue_pos.load(std::memory_order_relaxed);
+
+		for(;;){
+			c = &this->cell[pos & this->mask];
+			size_t seq = c->sequence.load(std::memory_order_acquire);
+			ptrdiff_t diff = (ptrdiff_t) seq - (ptrdiff_t) (pos + 1);
+
+			if(diff == 0){
+				if(this->dequeue_pos.compare_exchange_weak(
+					pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}else if(diff < 0){
+				return false;
+			}else{
+				pos = this->dequeue_pos.load(std::memory_order_relaxed);
+			}
+		}
+
+		value = c->value;
+		c->sequence.store(pos + this->mask + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	size_t capacity() const
+	{
+		return this->mask + 1;
+	}
+
+private:
+	struct cell_t {
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	static size_t round_capacity(size_t capacity)
+	{
+		size_t n = 2;
+		while(n < capacity)
+			n *= 2;
+
+		return n;
+	}
+
+	/*
+	 * the positions are kept in different cache lines, so the
+	 * producers and the consumers do not share one
+	 */
+	std::vector<cell_t> cell;
+	size_t mask;
+	alignas(64) std::atomic<size_t> enqueue_pos;
+	alignas(64) std::atomic<size_t> dequeue_pos;
+};
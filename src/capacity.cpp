@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <numeric>
+
+#include "capacity.hpp"
+
+/*
+ * number of channels `lsb_embed` uses in a cover with `channels`
+ */
+int lsb_embedding_channels(int channels, const stegim::lsb_options& lsb_opt)
+{
+	if(channels == 1)
+		return 1;
+
+	int n = lsb_opt.get_b() + lsb_opt.get_g() + lsb_opt.get_r();
+
+	if(channels == 4)
+		n += lsb_opt.get_a();
+
+	return n;
+}
+
+size_t stegim::capacity(
+	const stegim::cover_geometry& geometry,
+	const stegim::lsb_options& lsb_opt)
+{
+	size_t n_pixel = (size_t) geometry.get_rows()*geometry.get_cols();
+	size_t offset = std::max(lsb_opt.get_offset(), 0);
+
+	if(offset >= n_pixel)
+		return 0;
+
+	size_t n_bits = (n_pixel - offset)
+		*lsb_embedding_channels(geometry.get_channels(), lsb_opt);
+
+	return n_bits/CHAR_BIT;
+}
+
+size_t stegim::lsb_matching_capacity(const stegim::cover_geometry& geometry)
+{
+	size_t n_sample = (size_t) geometry.get_rows()
+		*geometry.get_cols()
+		*geometry.get_channels();
+
+	/*
+	 * two bits in each pair of samples
+	 */
+	return (n_sample/2)*2/CHAR_BIT;
+}
+
+std::vector<stegim::payload_slot> stegim::pack_payloads(
+	const std::vector<size_t>& payload_sizes,
+	const std::vector<size_t>& cover_capacities)
+{
+	std::vector<stegim::payload_slot> slot(payload_sizes.size());
+	std::vector<size_t> used(cover_capacities.size(), 0);
+
+	/*
+	 * the biggest payloads first
+	 */
+	std::vector<size_t> order(payload_sizes.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(),
+		[&payload_sizes](size_t a, size_t b){
+			return payload_sizes[a] > payload_sizes[b];
+		});
+
+	for(size_t p : order){
+		slot[p].cover = -1;
+		slot[p].offset = 0;
+
+		for(size_t c = 0; c < cover_capacities.size(); c++){
+			if(cover_capacities[c] - used[c] >= payload_sizes[p]){
+				slot[p].cover = c;
+				slot[p].offset = used[c];
+				used[c] += payload_sizes[p];
+				break;
+			}
+		}
+	}
+
+	return slot;
+}
+
+/*
+ * cover_geometry
+ */
+stegim::cover_geometry::cover_geometry(int rows, int cols, int channels)
+	: rows(rows),
+	cols(cols),
+	channels(channels)
+{}
+
+stegim::cover_geometry::cover_geometry(const cv::Mat& cover)
+	: rows(cover.rows),
+	cols(cover.cols),
+	channels(cover.channels())
+{}
+
+stegim::cover_geometry::~cover_geometry()
+{}
+
+int stegim::cover_geometry::get_rows() const
+{
+	return this->rows;
+}
+
+int stegim::cover_geometry::get_cols() const
+{
+	return this->cols;
+}
+
+int stegim::cover_geometry::get_channels() const
+{
+	return this->channels;
+}
@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <utility>
+
+#include <cassert>
+#include <cstring>
+
+#include "cipher.hpp"
+#include "kernels.hpp"
+#include "keystream.hpp"
+
+/*
+ * bytes of a SHA-256 digest and of the blocks it compresses
+ */
+#define SHA256_DIGEST 32
+#define SHA256_BLOCK 64
+
+#define ROTR32(X, K) ((uint32_t)((X) >> (K) | (X) << (32 - (K))))
+
+/*
+ * the words "expand 32-byte k" beginning every ChaCha20 state
+ */
+const uint32_t chacha20_sigma[4] = {
+	0x61707865, 0x3320646e, 0x79622d32, 0x6b206574
+};
+
+void write_be32(uint8_t* p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+uint32_t read_be32(const uint8_t* p)
+{
+	return (uint32_t) p[0] << 24 | (uint32_t) p[1] << 16 |
+		(uint32_t) p[2] << 8 | p[3];
+}
+
+/*
+ * a word of a ChaCha20 key or nonce, in little endian
+ */
+uint32_t chacha20_word(const uint8_t* p)
+{
+	return p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 |
+		(uint32_t) p[3] << 24;
+}
+
+/*
+ * SHA-256 (FIPS 180-4), only used to derive keys, so it is scalar
+ */
+class sha256 {
+public:
+	sha256()
+		: h{	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+			0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 },
+		size(0)
+	{}
+
+	void update(const uint8_t* p, size_t n)
+	{
+		for(size_t i = 0; i < n; i++){
+			this->block[this->size%SHA256_BLOCK] = p[i];
+			this->size++;
+
+			if(this->size%SHA256_BLOCK == 0)
+				compress();
+		}
+	}
+
+	void finish(uint8_t* digest)
+	{
+		uint64_t n_bits = this->size*8;
+
+		const uint8_t one = 0x80, zero = 0;
+		update(&one, 1);
+		while(this->size%SHA256_BLOCK != SHA256_BLOCK - 8)
+			update(&zero, 1);
+
+		uint8_t length[8];
+		for(int i = 0; i < 8; i++)
+			length[i] = n_bits >> (56 - 8*i);
+		update(length, 8);
+
+		for(int i = 0; i < 8; i++)
+			write_be32(digest + 4*i, this->h[i]);
+	}
+
+private:
+	void compress()
+	{
+		static const uint32_t k[64] = {
+			0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+			0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+			0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+			0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+			0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+			0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+			0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+			0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+			0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+			0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+			0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+			0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+			0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+			0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+			0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+			0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+		};
+
+		uint32_t w[64];
+		for(int i = 0; i < 16; i++)
+			w[i] = read_be32(this->block + 4*i);
+
+		for(int i = 16; i < 64; i++){
+			uint32_t s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^
+				(w[i - 15] >> 3);
+			uint32_t s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^
+				(w[i - 2] >> 10);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+
+		uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+		uint32_t e = h[4], f = h[5], g = h[6], hh = h[7];
+
+		for(int i = 0; i < 64; i++){
+			uint32_t s1 = ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25);
+			uint32_t ch = (e & f) ^ (~e & g);
+			uint32_t t1 = hh + s1 + ch + k[i] + w[i];
+			uint32_t s0 = ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22);
+			uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+			uint32_t t2 = s0 + maj;
+
+			hh = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+
+		h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+		h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+	}
+
+	uint32_t h[8];
+	uint8_t block[SHA256_BLOCK];
+	uint64_t size;
+};
+
+/*
+ * HMAC-SHA256 (RFC 2104) of the concatenation of the `n_parts` parts
+ * of `message`
+ */
+void hmac_sha256(
+	const uint8_t* key,
+	size_t key_size,
+	const std::pair<const uint8_t*, size_t>* message,
+	size_t n_parts,
+	uint8_t* mac)
+{
+	uint8_t k[SHA256_BLOCK] = {};
+	if(key_size > SHA256_BLOCK){
+		sha256 hash;
+		hash.update(key, key_size);
+		hash.finish(k);
+	}else if(key_size){
+		std::memcpy(k, key, key_size);
+	}
+
+	uint8_t pad[SHA256_BLOCK];
+
+	sha256 inner;
+	for(int i = 0; i < SHA256_BLOCK; i++)
+		pad[i] = k[i] ^ 0x36;
+	inner.update(pad, SHA256_BLOCK);
+	for(size_t i = 0; i < n_parts; i++)
+		inner.update(message[i].first, message[i].second);
+
+	uint8_t digest[SHA256_DIGEST];
+	inner.finish(digest);
+
+	sha256 outer;
+	for(int i = 0; i < SHA256_BLOCK; i++)
+		pad[i] = k[i] ^ 0x5c;
+	outer.update(pad, SHA256_BLOCK);
+	outer.update(digest, SHA256_DIGEST);
+	outer.finish(mac);
+}
+
+/*
+ * the initial state of the block `counter` of `key` and `nonce`
+ */
+void chacha20_state(
+	const uint8_t* key,
+	const uint8_t* nonce,
+	uint32_t counter,
+	uint32_t* state)
+{
+	for(int i = 0; i < 4; i++)
+		state[i] = chacha20_sigma[i];
+	for(int i = 0; i < 8; i++)
+		state[4 + i] = chacha20_word(key + 4*i);
+
+	state[12] = counter;
+	for(int i = 0; i < 3; i++)
+		state[13 + i] = chacha20_word(nonce + 4*i);
+}
+
+void stegim::hkdf_sha256(
+	const char* ikm,
+	size_t ikm_size,
+	const char* salt,
+	size_t salt_size,
+	const char* info,
+	size_t info_size,
+	uint8_t* okm,
+	size_t okm_size)
+{
+	assert(okm_size <= 255*SHA256_DIGEST);
+
+	/*
+	 * extract
+	 */
+	uint8_t prk[SHA256_DIGEST];
+	std::pair<const uint8_t*, size_t> input(
+		reinterpret_cast<const uint8_t*>(ikm), ikm_size);
+	hmac_sha256(reinterpret_cast<const uint8_t*>(salt), salt ? salt_size : 0,
+		&input, 1, prk);
+
+	/*
+	 * expand, T(i) = HMAC(prk, T(i - 1) | info | i)
+	 */
+	uint8_t t[SHA256_DIGEST] = {};
+	for(size_t done = 0, i = 1; done < okm_size; i++){
+		uint8_t index = i;
+		std::pair<const uint8_t*, size_t> message[3] = {
+			{ t, i > 1 ? (size_t) SHA256_DIGEST : 0 },
+			{ reinterpret_cast<const uint8_t*>(info), info_size },
+			{ &index, 1 }
+		};
+		hmac_sha256(prk, SHA256_DIGEST, message, 3, t);
+
+		size_t n = std::min(okm_size - done, (size_t) SHA256_DIGEST);
+		std::memcpy(okm + done, t, n);
+		done += n;
+	}
+}
+
+void stegim::chacha20_xor(
+	const uint8_t* key,
+	const uint8_t* nonce,
+	uint32_t counter,
+	char* data,
+	size_t size)
+{
+	const kernel_table& kt = kernels();
+
+	uint32_t state[16];
+	chacha20_state(key, nonce, counter, state);
+
+	/*
+	 * the keystream is generated KEYSTREAM_BLOCKS at a time
+	 */
+	alignas(64) uint8_t stream[KEYSTREAM_BLOCKS*CHACHA20_BLOCK];
+	for(size_t i = 0; i < size; i += sizeof(stream)){
+		size_t n = std::min(size - i, sizeof(stream));
+		kt.chacha20(state, (n + CHACHA20_BLOCK - 1)/CHACHA20_BLOCK, stream);
+		state[12] += KEYSTREAM_BLOCKS;
+
+		for(size_t j = 0; j < n; j++)
+			data[i + j] ^= stream[j];
+	}
+}
+
+/*
+ * keystream
+ */
+keystream::keystream(const uint8_t* key)
+	: begin(0),
+	end(0)
+{
+	const uint8_t nonce[stegim::chacha20_nonce_size] = {};
+	chacha20_state(key, nonce, 0, this->state);
+}
+
+void keystream::fill(size_t block)
+{
+	/*
+	 * the counter has 32 bits, 256 GiB of keystream
+	 */
+	assert(block + KEYSTREAM_BLOCKS <= ((uint64_t) 1 << 32));
+
+	this->state[12] = block;
+	kernels().chacha20(this->state, KEYSTREAM_BLOCKS, this->buffer);
+
+	this->begin = block*CHACHA20_BLOCK;
+	this->end = this->begin + sizeof(this->buffer);
+}
@@ -0,0 +1,277 @@
+#include <cassert>
+#include <cstring>
+
+#ifdef STEGIM_ZSTD
+#include <zstd.h>
+#endif
+
+#include "compress.hpp"
+
+/*
+ * the bytes of the minimum match, the bytes at the end of a block that
+ * are always literals and the bytes after the start of the last match
+ */
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MATCH_LIMIT 12
+
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_HASH_BITS 12
+
+/*
+ * the misses after which the search skips ahead faster, so the
+ * incompressible data is given up quickly
+ */
+#define LZ4_SKIP_TRIGGER 6
+
+uint32_t lz4_read32(const uint8_t* p)
+{
+	uint32_t v;
+	std::memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+uint32_t lz4_hash(uint32_t sequence)
+{
+	return (sequence*2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+/*
+ * writes the remainder of a length of the low or high nibble of a
+ * token, 255 per byte
+ */
+uint8_t* lz4_write_length(uint8_t* op, size_t length)
+{
+	for(; length >= 255; length -= 255)
+		*op++ = 255;
+	*op++ = length;
+
+	return op;
+}
+
+/*
+ * writes the sequence of the `n_literals` bytes of `literals` and of
+ * the match of `match_length` bytes `offset` bytes behind, or of the
+ * literals alone if `match_length` is 0, and returns the end of the
+ * sequence, or null if it does not fit before `end`
+ */
+uint8_t* lz4_write_sequence(
+	uint8_t* op,
+	uint8_t* end,
+	const uint8_t* literals,
+	size_t n_literals,
+	size_t offset,
+	size_t match_length)
+{
+	size_t worst = 1 + n_literals/255 + 1 + n_literals;
+	if(match_length)
+		worst += 2 + match_length/255 + 1;
+
+	if(worst > (size_t) (end - op))
+		return nullptr;
+
+	uint8_t* token = op++;
+	*token = (n_literals < 15 ? n_literals : 15) << 4;
+	if(n_literals >= 15)
+		op = lz4_write_length(op, n_literals - 15);
+
+	std::memcpy(op, literals, n_literals);
+	op += n_literals;
+
+	if(!match_length)
+		return op;
+
+	*op++ = offset;
+	*op++ = offset >> 8;
+
+	size_t length = match_length - LZ4_MIN_MATCH;
+	*token |= length < 15 ? length : 15;
+	if(length >= 15)
+		op = lz4_write_length(op, length - 15);
+
+	return op;
+}
+
+size_t lz4_compress(const uint8_t* src, size_t n, uint8_t* dst, size_t capacity)
+{
+	uint8_t* op = dst;
+	uint8_t* end = dst + capacity;
+	size_t anchor = 0;
+
+	if(n > LZ4_MATCH_LIMIT){
+		/*
+		 * the last position of each hash, plus one, 0 if none
+		 */
+		uint32_t table[1 << LZ4_HASH_BITS] = {};
+
+		size_t search_end = n - LZ4_MATCH_LIMIT;
+		size_t match_end = n - LZ4_LAST_LITERALS;
+		size_t misses = 0;
+
+		for(size_t ip = 0; ip < search_end;){
+			uint32_t sequence = lz4_read32(src + ip);
+			uint32_t h = lz4_hash(sequence);
+			size_t candidate = table[h];
+			table[h] = ip + 1;
+
+			if(	!candidate ||
+				ip - (candidate - 1) > LZ4_MAX_OFFSET ||
+				lz4_read32(src + candidate - 1) != sequence){
+				ip += 1 + (misses++ >> LZ4_SKIP_TRIGGER);
+				continue;
+			}
+
+			misses = 0;
+
+			size_t ref = candidate - 1;
+			while(ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]){
+				ip--;
+				ref--;
+			}
+
+			size_t length = LZ4_MIN_MATCH;
+			while(ip + length < match_end && src[ip + length] == src[ref + length])
+				length++;
+
+			op = lz4_write_sequence(op, end, src + anchor, ip - anchor,
+				ip - ref, length);
+			if(!op)
+				return 0;
+
+			ip += length;
+			anchor = ip;
+		}
+	}
+
+	op = lz4_write_sequence(op, end, src + anchor, n - anchor, 0, 0);
+	if(!op)
+		return 0;
+
+	return op - dst;
+}
+
+/*
+ * reads the remainder of a length of a token, false if the block ends
+ * before it
+ */
+bool lz4_read_length(const uint8_t* src, size_t n, size_t& ip, size_t& length)
+{
+	uint8_t b;
+	do{
+		if(ip >= n)
+			return false;
+
+		b = src[ip++];
+		length += b;
+	}while(b == 255);
+
+	return true;
+}
+
+bool lz4_decompress(const uint8_t* src, size_t n, uint8_t* dst, size_t size)
+{
+	size_t ip = 0, op = 0;
+
+	for(;;){
+		if(ip >= n)
+			return false;
+
+		uint8_t token = src[ip++];
+
+		size_t n_literals = token >> 4;
+		if(n_literals == 15 && !lz4_read_length(src, n, ip, n_literals))
+			return false;
+
+		if(n_literals > n - ip || n_literals > size - op)
+			return false;
+
+		std::memcpy(dst + op, src + ip, n_literals);
+		ip += n_literals;
+		op += n_literals;
+
+		/*
+		 * the last sequence has no match
+		 */
+		if(ip == n)
+			break;
+
+		if(n - ip < 2)
+			return false;
+
+		size_t offset = src[ip] | src[ip + 1] << 8;
+		ip += 2;
+
+		if(!offset || offset > op)
+			return false;
+
+		size_t length = token & 15;
+		if(length == 15 && !lz4_read_length(src, n, ip, length))
+			return false;
+		length += LZ4_MIN_MATCH;
+
+		if(length > size - op)
+			return false;
+
+		/*
+		 * an overlapping match repeats its first bytes
+		 */
+		if(offset >= length)
+			std::memcpy(dst + op, dst + op - offset, length);
+		else
+			for(size_t i = 0; i < length; i++)
+				dst[op + i] = dst[op + i - offset];
+
+		op += length;
+	}
+
+	return op == size;
+}
+
+size_t compress_block(
+	stegim::frame_compression compression,
+	const uint8_t* src,
+	size_t n,
+	uint8_t* dst,
+	size_t capacity)
+{
+	assert(n <= COMPRESS_BLOCK);
+
+	switch(compression){
+	case stegim::COMPRESSION_LZ4:
+		return lz4_compress(src, n, dst, capacity);
+
+#ifdef STEGIM_ZSTD
+	case stegim::COMPRESSION_ZSTD: {
+		size_t written = ZSTD_compress(dst, capacity, src, n, ZSTD_CLEVEL_DEFAULT);
+		return ZSTD_isError(written) ? 0 : written;
+	}
+#endif
+
+	default:
+		assert(false);
+		return 0;
+	}
+}
+
+bool decompress_block(
+	stegim::frame_compression compression,
+	const uint8_t* src,
+	size_t n,
+	uint8_t* dst,
+	size_t size)
+{
+	switch(compression){
+	case stegim::COMPRESSION_LZ4:
+		return lz4_decompress(src, n, dst, size);
+
+#ifdef STEGIM_ZSTD
+	case stegim::COMPRESSION_ZSTD: {
+		size_t written = ZSTD_decompress(dst, size, src, n);
+		return !ZSTD_isError(written) && written == size;
+	}
+#endif
+
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "frame.hpp"
+
+/*
+ * the raw bytes of a block of a compressed stream, the last block of
+ * a stream may be shorter
+ */
+#define COMPRESS_BLOCK (1 << 16)
+
+/*
+ * the word before each block of a stream: the bytes of the block,
+ * and this bit if the block is stored raw because it did not shrink
+ */
+#define COMPRESS_STORED 0x80000000u
+
+/*
+ * compresses the `n` bytes of `src`, at most COMPRESS_BLOCK, in the
+ * `capacity` bytes of `dst` with `compression`, and returns the size
+ * of the compressed block, or 0 if it does not fit
+ */
+size_t compress_block(
+	stegim::frame_compression compression,
+	const uint8_t* src,
+	size_t n,
+	uint8_t* dst,
+	size_t capacity);
+
+/*
+ * decompresses the block of `n` bytes of `src` in the `size` bytes of
+ * `dst`, and returns whether it was exactly `size` bytes
+ */
+bool decompress_block(
+	stegim::frame_compression compression,
+	const uint8_t* src,
+	size_t n,
+	uint8_t* dst,
+	size_t size);
+
+/*
+ * the LZ4 block format, without the frame format of the reference
+ * library. The matches are found by a single hash of 4 bytes.
+ */
+size_t lz4_compress(const uint8_t* src, size_t n, uint8_t* dst, size_t capacity);
+bool lz4_decompress(const uint8_t* src, size_t n, uint8_t* dst, size_t size);
@@ -0,0 +1,185 @@
+#include <algorithm>
+
+#include "delta.hpp"
+
+/*
+ * appends `v` to `buffer` as a varint, 7 bits per byte
+ * beginning with the least significant ones
+ */
+inline void write_varint(std::vector<uchar>& buffer, uint64_t v)
+{
+	while(v >= 0x80){
+		buffer.push_back((v & 0x7f) | 0x80);
+		v >>= 7;
+	}
+
+	buffer.push_back(v);
+}
+
+/*
+ * reads a varint from `buffer` beginning in `pos` and advances `pos`,
+ * returns false if the buffer ends before the varint
+ */
+inline bool read_varint(const std::vector<uchar>& buffer, size_t& pos, uint64_t& v)
+{
+	v = 0;
+	for(int shift = 0; pos < buffer.size() && shift < 64; shift += 7){
+		uchar b = buffer[pos++];
+		v |= (uint64_t)(b & 0x7f) << shift;
+
+		if(!(b & 0x80))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * calls `f(index, value)` for every sample of the encoded `buffer`,
+ * returns false if the buffer is malformed
+ */
+template<typename F>
+bool decode_delta(
+	const std::vector<uchar>& buffer,
+	size_t& rows,
+	size_t& width,
+	F f)
+{
+	size_t pos = 0;
+	uint64_t r, w;
+
+	if(!read_varint(buffer, pos, r) || !read_varint(buffer, pos, w))
+		return false;
+
+	rows = r;
+	width = w;
+
+	uint64_t index = 0;
+	for(bool first = true; pos < buffer.size(); first = false){
+		uint64_t gap;
+		if(!read_varint(buffer, pos, gap) || pos >= buffer.size())
+			return false;
+
+		index += first ? gap : gap + 1;
+		if(index >= rows*width)
+			return false;
+
+		f(index, buffer[pos++]);
+	}
+
+	return true;
+}
+
+bool stegim::apply_delta(cv::Mat& cover, const stegim::sample_delta& delta)
+{
+	if(	cover.depth() != CV_8U ||
+		(size_t) cover.rows != delta.get_rows() ||
+		(size_t) cover.cols*cover.channels() != delta.get_width())
+		return false;
+
+	size_t rows, width;
+	return decode_delta(delta.get_buffer(), rows, width,
+		[&cover, &width](uint64_t index, uchar value){
+			cover.ptr<uchar>(index/width)[index%width] = value;
+		});
+}
+
+/*
+ * sample_delta
+ */
+stegim::sample_delta::sample_delta()
+	: rows(0),
+	width(0),
+	n_samples(0)
+{
+	finish();
+}
+
+stegim::sample_delta::~sample_delta()
+{}
+
+void stegim::sample_delta::begin(size_t rows, size_t width)
+{
+	this->rows = rows;
+	this->width = width;
+	this->pending.clear();
+	this->buffer.clear();
+	this->n_samples = 0;
+}
+
+void stegim::sample_delta::add(uint64_t index, uchar value)
+{
+	this->pending.push_back(std::make_pair(index, value));
+}
+
+void stegim::sample_delta::finish()
+{
+	/*
+	 * a sample modified twice keeps the last value
+	 */
+	std::stable_sort(this->pending.begin(), this->pending.end(),
+		[](const std::pair<uint64_t, uchar>& a,
+			const std::pair<uint64_t, uchar>& b){
+			return a.first < b.first;
+		});
+
+	this->buffer.clear();
+	write_varint(this->buffer, this->rows);
+	write_varint(this->buffer, this->width);
+
+	this->n_samples = 0;
+	uint64_t last = 0;
+	for(size_t i = 0; i < this->pending.size(); i++){
+		if(	i + 1 < this->pending.size() &&
+			this->pending[i + 1].first == this->pending[i].first)
+			continue;
+
+		uint64_t index = this->pending[i].first;
+		uint64_t gap = this->n_samples ? index - last - 1 : index;
+
+		write_varint(this->buffer, gap);
+		this->buffer.push_back(this->pending[i].second);
+
+		last = index;
+		this->n_samples++;
+	}
+
+	this->pending.clear();
+}
+
+size_t stegim::sample_delta::size() const
+{
+	return this->n_samples;
+}
+
+size_t stegim::sample_delta::get_rows() const
+{
+	return this->rows;
+}
+
+size_t stegim::sample_delta::get_width() const
+{
+	return this->width;
+}
+
+const std::vector<uchar>& stegim::sample_delta::get_buffer() const
+{
+	return this->buffer;
+}
+
+bool stegim::sample_delta::set_buffer(const std::vector<uchar>& buffer)
+{
+	size_t rows, width, n_samples = 0;
+
+	if(!decode_delta(buffer, rows, width,
+		[&n_samples](uint64_t, uchar){ n_samples++; }))
+		return false;
+
+	this->rows = rows;
+	this->width = width;
+	this->n_samples = n_samples;
+	this->pending.clear();
+	this->buffer = buffer;
+
+	return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include <opencv2/core/core.hpp>
+
+#include "stats.hpp"
+
+/*
+ * accumulates the squared error and the change histogram of the
+ * samples visited by an embed call, added to the stats sink at the
+ * end of the call with the other counters
+ */
+class distortion {
+public:
+	distortion()
+		: squared_error(0),
+		histogram()
+	{}
+
+	/*
+	 * a sample visited, `cover` in the cover and `stego` in the stego
+	 */
+	void add(long cover, long stego)
+	{
+		long d = stego - cover;
+		squared_error += d*d;
+
+		d = std::min((long) STATS_MAX_CHANGE, std::max(-(long) STATS_MAX_CHANGE, d));
+		histogram[d + STATS_MAX_CHANGE]++;
+	}
+
+	/*
+	 * adds the distortion of the embedding in `stego` to `stats`, if
+	 * not null
+	 */
+	void flush(stegim::stats* stats, const cv::Mat& stego) const
+	{
+		if(!stats)
+			return;
+
+		stats->squared_error += squared_error;
+		for(int i = 0; i < STATS_CHANGE_BINS; i++)
+			stats->change_histogram[i] += histogram[i];
+
+		stats->samples_total += (size_t) stego.rows*stego.cols*stego.channels();
+		stats->sample_max = std::max(stats->sample_max,
+			stego.depth() == CV_16U ? (unsigned) UINT16_MAX : (unsigned) UINT8_MAX);
+	}
+
+private:
+	uint64_t squared_error;
+	size_t histogram[STATS_CHANGE_BINS];
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "cipher.hpp"
+
+/*
+ * rounds of the Feistel network of the lazy permutation
+ */
+#define FEISTEL_ROUNDS 4
+
+/*
+ * a keyed bijection of [0, `n`): a balanced Feistel network on the
+ * smallest domain of 4^h >= `n` values, walked through its cycles
+ * until the image falls back in [0, `n`). The domain has less than
+ * 4`n` values, so an image takes less than 4 walks on average, and
+ * any of them is computed without the others.
+ */
+class feistel_permutation {
+public:
+	feistel_permutation(uint64_t n, const std::vector<char>& key)
+		: n(n),
+		half_bits(1)
+	{
+		while(((uint64_t) 1 << 2*this->half_bits) < n)
+			this->half_bits++;
+		this->mask = ((uint64_t) 1 << this->half_bits) - 1;
+
+		/*
+		 * the round keys are independent of the seed of the
+		 * shuffle and of the cipher key
+		 */
+		const char info[] = "stegim lsb matching feistel";
+		uint8_t okm[8*FEISTEL_ROUNDS];
+		stegim::hkdf_sha256(key.data(), key.size(), nullptr, 0,
+			info, sizeof(info) - 1, okm, sizeof(okm));
+
+		for(int r = 0; r < FEISTEL_ROUNDS; r++){
+			this->round_keys[r] = 0;
+			for(int b = 0; b < 8; b++)
+				this->round_keys[r] |= (uint64_t) okm[8*r + b] << 8*b;
+		}
+	}
+
+	uint64_t size() const
+	{
+		return this->n;
+	}
+
+	/*
+	 * the image of `x` < `n`
+	 */
+	uint64_t operator()(uint64_t x) const
+	{
+		do
+			x = encrypt(x);
+		while(x >= this->n);
+
+		return x;
+	}
+
+private:
+	/*
+	 * the murmur3 finalizer of the right half and the round key
+	 */
+	static uint64_t mix(uint64_t x)
+	{
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdULL;
+		x ^= x >> 33;
+		x *= 0xc4ceb9fe1a85ec53ULL;
+		x ^= x >> 33;
+
+		return x;
+	}
+
+	uint64_t encrypt(uint64_t x) const
+	{
+		uint64_t l = x >> this->half_bits;
+		uint64_t r = x & this->mask;
+
+		for(int i = 0; i < FEISTEL_ROUNDS; i++){
+			uint64_t t = l ^ (mix(r ^ this->round_keys[i]) & this->mask);
+			l = r;
+			r = t;
+		}
+
+		return l << this->half_bits | r;
+	}
+
+	uint64_t n;
+	int half_bits;
+	uint64_t mask;
+	uint64_t round_keys[FEISTEL_ROUNDS];
+};
+
+/*
+ * the pair `i` of the samples permuted by `f` of an image of `width`
+ * samples per row, as (row, sample column) positions: the images of
+ * 2`i` and 2`i` + 1. The last sample of an odd image is paired with
+ * itself.
+ */
+inline std::pair<cv::Point2i, cv::Point2i> feistel_pair(
+	const feistel_permutation& f,
+	size_t i,
+	size_t width)
+{
+	uint64_t s0 = f(2*i);
+	uint64_t s1 = 2*i + 1 < f.size() ? f(2*i + 1) : s0;
+
+	return std::make_pair(
+		cv::Point2i(s0/width, s0%width),
+		cv::Point2i(s1/width, s1%width));
+}
@@ -0,0 +1,945 @@
+#include <algorithm>
+
+#include <cassert>
+#include <cstring>
+
+#include "capacity.hpp"
+#include "compress.hpp"
+#include "frame.hpp"
+#include "kernels.hpp"
+#include "scope_timer.hpp"
+#include "scratch.hpp"
+
+/*
+ * bytes of a Reed-Solomon codeword, of its parity and of its data
+ */
+#define RS_BLOCK 255
+#define RS_PARITY 32
+#define RS_DATA (RS_BLOCK - RS_PARITY)
+
+/*
+ * the primitive polynomial of GF(2^8), x^8 + x^4 + x^3 + x^2 + 1
+ */
+#define GF_POLY 0x11d
+
+/*
+ * the arithmetic of GF(2^8) by logarithms, and the nibble tables of
+ * the kernels: the coefficients of the generator of the code, whose
+ * roots are the powers 0 to RS_PARITY - 1 of the primitive element,
+ * and those powers
+ */
+struct gf_field {
+	uint8_t exp[2*RS_BLOCK];
+	uint8_t log[256];
+
+	uint8_t generator[32*RS_PARITY];
+	uint8_t power[32*RS_PARITY];
+
+	gf_field()
+	{
+		unsigned x = 1;
+		for(int i = 0; i < RS_BLOCK; i++){
+			exp[i] = exp[i + RS_BLOCK] = x;
+			log[x] = i;
+
+			x <<= 1;
+			if(x & 0x100)
+				x ^= GF_POLY;
+		}
+
+		log[0] = 0;
+
+		/*
+		 * the product of (x + a^i), lowest degree first
+		 */
+		uint8_t g[RS_PARITY + 1] = { 1 };
+		for(int i = 0; i < RS_PARITY; i++){
+			for(int j = i + 1; j > 0; j--)
+				g[j] = g[j - 1] ^ mul(g[j], exp[i]);
+			g[0] = mul(g[0], exp[i]);
+		}
+
+		for(int i = 0; i < RS_PARITY; i++){
+			nibble_table(g[i], generator + 32*i);
+			nibble_table(exp[i], power + 32*i);
+		}
+	}
+
+	uint8_t mul(uint8_t a, uint8_t b) const
+	{
+		if(a == 0 || b == 0)
+			return 0;
+
+		return exp[log[a] + log[b]];
+	}
+
+	uint8_t div(uint8_t a, uint8_t b) const
+	{
+		assert(b);
+
+		if(a == 0)
+			return 0;
+
+		return exp[log[a] + RS_BLOCK - log[b]];
+	}
+
+	/*
+	 * a^`e`, for 0 <= `e` < RS_BLOCK
+	 */
+	uint8_t pow(size_t e) const
+	{
+		return exp[e];
+	}
+
+	/*
+	 * the value of the polynomial of `n` coefficients `p`, lowest
+	 * degree first, in `x`
+	 */
+	uint8_t eval(const uint8_t* p, size_t n, uint8_t x) const
+	{
+		uint8_t v = 0;
+		for(size_t i = n; i > 0; i--)
+			v = mul(v, x) ^ p[i - 1];
+
+		return v;
+	}
+
+	void nibble_table(uint8_t c, uint8_t* t) const
+	{
+		for(int n = 0; n < 16; n++){
+			t[n] = mul(c, n);
+			t[16 + n] = mul(c, n << 4);
+		}
+	}
+};
+
+const gf_field& gf()
+{
+	static const gf_field field;
+	return field;
+}
+
+/*
+ * the layout of a frame: the header and the data, the message, split
+ * in `n_codewords` codewords of `k` bytes, whose byte t is the byte
+ * t*`n_codewords` + c of the message. The last row is padded with
+ * zeros and followed by the RS_PARITY rows of parity, so the byte t
+ * of the codeword c is the byte t*`n_codewords` + c of the frame.
+ */
+struct frame_layout {
+	size_t message;
+	size_t n_codewords;
+	size_t k;
+	size_t size;
+
+	frame_layout(size_t data_size, bool parity)
+		: message(stegim::frame_header_size + data_size),
+		n_codewords(0),
+		k(0),
+		size(message)
+	{
+		if(!parity)
+			return;
+
+		n_codewords = (message + RS_DATA - 1)/RS_DATA;
+		k = (message + n_codewords - 1)/n_codewords;
+		size = (k + RS_PARITY)*n_codewords;
+	}
+
+	/*
+	 * the lanes of the kernels, whole vectors of the narrowest
+	 * vectorized width
+	 */
+	size_t stride() const
+	{
+		return (n_codewords + 15)/16*16;
+	}
+};
+
+/*
+ * copies `n_rows` rows of `n` bytes from `src` to `dst`, whose rows
+ * are `src_stride` and `dst_stride` bytes apart
+ */
+void copy_rows(
+	uint8_t* dst,
+	size_t dst_stride,
+	const uint8_t* src,
+	size_t src_stride,
+	size_t n,
+	size_t n_rows)
+{
+	for(size_t t = 0; t < n_rows; t++)
+		std::memcpy(dst + t*dst_stride, src + t*src_stride, n);
+}
+
+void write_le32(uint8_t* p, uint32_t v)
+{
+	for(int i = 0; i < 4; i++)
+		p[i] = v >> (CHAR_BIT*i);
+}
+
+uint32_t read_le32(const uint8_t* p)
+{
+	uint32_t v = 0;
+	for(int i = 0; i < 4; i++)
+		v |= (uint32_t) p[i] << (CHAR_BIT*i);
+
+	return v;
+}
+
+/*
+ * the CRC32C of the length in the header of `message`
+ */
+uint32_t length_crc(const uint8_t* message)
+{
+	return ~kernels().crc32c(~0u, message, 4);
+}
+
+/*
+ * the CRC32C of the length in the header of `message` and of its
+ * `size` bytes of data
+ */
+uint32_t message_crc(const uint8_t* message, size_t size)
+{
+	const kernel_table& kt = kernels();
+
+	uint32_t crc = kt.crc32c(~0u, message, 4);
+	crc = kt.crc32c(crc, message + stegim::frame_header_size, size);
+
+	return ~crc;
+}
+
+/*
+ * true if the header of `message` has the length `size`, its CRC32C
+ * and the CRC32C of the data
+ */
+bool message_intact(const uint8_t* message, size_t size)
+{
+	return	read_le32(message) == size &&
+		read_le32(message + 4) == length_crc(message) &&
+		read_le32(message + 8) == message_crc(message, size);
+}
+
+/*
+ * corrects the codeword `cw` of `n` bytes, whose syndromes `s` are
+ * not all zero, and returns the number of corrected bytes, or -1 if
+ * there are more errors than the parity corrects
+ */
+int rs_correct(uint8_t* cw, size_t n, const uint8_t* s)
+{
+	const gf_field& f = gf();
+
+	/*
+	 * Berlekamp-Massey, the error locator `lambda`
+	 */
+	uint8_t lambda[RS_PARITY + 1] = { 1 };
+	uint8_t prev[RS_PARITY + 1] = { 1 };
+	int n_errors = 0;
+	int shift = 1;
+	uint8_t prev_d = 1;
+
+	for(int r = 0; r < RS_PARITY; r++){
+		uint8_t d = s[r];
+		for(int i = 1; i <= n_errors; i++)
+			d ^= f.mul(lambda[i], s[r - i]);
+
+		if(d == 0){
+			shift++;
+			continue;
+		}
+
+		uint8_t last[RS_PARITY + 1];
+		std::memcpy(last, lambda, sizeof(lambda));
+
+		uint8_t coef = f.div(d, prev_d);
+		for(int i = 0; i + shift <= RS_PARITY; i++)
+			lambda[i + shift] ^= f.mul(coef, prev[i]);
+
+		if(2*n_errors <= r){
+			n_errors = r + 1 - n_errors;
+			std::memcpy(prev, last, sizeof(last));
+			prev_d = d;
+			shift = 1;
+		}else{
+			shift++;
+		}
+	}
+
+	if(n_errors > RS_PARITY/2)
+		return -1;
+
+	/*
+	 * the error evaluator, S(x)*lambda(x) mod x^RS_PARITY
+	 */
+	uint8_t omega[RS_PARITY] = {};
+	for(int i = 0; i < RS_PARITY; i++)
+		for(int j = 0; j <= i && j <= n_errors; j++)
+			omega[i] ^= f.mul(s[i - j], lambda[j]);
+
+	/*
+	 * the formal derivative of lambda
+	 */
+	uint8_t derivative[RS_PARITY] = {};
+	for(int i = 1; i <= n_errors; i += 2)
+		derivative[i - 1] = lambda[i];
+
+	/*
+	 * Chien search of the roots, the inverses of the locations, and
+	 * the magnitudes by Forney. The byte t has the degree n - 1 - t.
+	 */
+	int n_found = 0;
+	for(size_t t = 0; t < n; t++){
+		size_t e = n - 1 - t;
+		uint8_t x_inv = f.pow((RS_BLOCK - e)%RS_BLOCK);
+
+		if(f.eval(lambda, n_errors + 1, x_inv))
+			continue;
+
+		uint8_t den = f.eval(derivative, n_errors, x_inv);
+		if(den == 0)
+			return -1;
+
+		uint8_t num = f.eval(omega, RS_PARITY, x_inv);
+		cw[t] ^= f.mul(f.pow(e), f.div(num, den));
+		n_found++;
+	}
+
+	if(n_found != n_errors)
+		return -1;
+
+	return n_found;
+}
+
+/*
+ * corrects the codewords of `frame` in place and returns the number
+ * of corrected bytes, or -1 if a codeword cannot be corrected
+ */
+long frame_correct(uint8_t* frame, const frame_layout& layout)
+{
+	const kernel_table& kt = kernels();
+	const gf_field& f = gf();
+
+	size_t n = layout.k + RS_PARITY;
+	size_t n_codewords = layout.n_codewords;
+	size_t stride = layout.stride();
+
+	stegim::scratch_vector<uint8_t> code(n*stride, 0);
+	stegim::scratch_vector<uint8_t> syndromes(RS_PARITY*stride);
+
+	copy_rows(code.data(), stride, frame, n_codewords, n_codewords, n);
+	kt.rs_syndromes(code.data(), n, stride, f.power, RS_PARITY,
+		syndromes.data());
+
+	long n_corrected = 0;
+	for(size_t c = 0; c < n_codewords; c++){
+		uint8_t s[RS_PARITY];
+		uint8_t any = 0;
+		for(int j = 0; j < RS_PARITY; j++){
+			s[j] = syndromes[j*stride + c];
+			any |= s[j];
+		}
+
+		if(any == 0)
+			continue;
+
+		uint8_t cw[RS_BLOCK];
+		for(size_t t = 0; t < n; t++)
+			cw[t] = frame[t*n_codewords + c];
+
+		int n_fixed = rs_correct(cw, n, s);
+		if(n_fixed < 0)
+			return -1;
+
+		for(size_t t = 0; t < n; t++)
+			frame[t*n_codewords + c] = cw[t];
+
+		n_corrected += n_fixed;
+	}
+
+	return n_corrected;
+}
+
+/*
+ * writes the header and the parity of the message of `size` bytes of
+ * data already at `f` + frame_header_size, in the frame of `layout` at
+ * `f`, whose other bytes are zero
+ */
+void encode_message(uint8_t* f, size_t size, const frame_layout& layout)
+{
+	write_le32(f, size);
+	write_le32(f + 4, length_crc(f));
+	write_le32(f + 8, message_crc(f, size));
+
+	if(!layout.n_codewords)
+		return;
+
+	/*
+	 * the rows in whole vectors, the lanes past the codewords
+	 * are zero and thrown away
+	 */
+	size_t n_codewords = layout.n_codewords;
+	size_t stride = layout.stride();
+
+	stegim::scratch_vector<uint8_t> rows(layout.k*stride, 0);
+	stegim::scratch_vector<uint8_t> parity(RS_PARITY*stride);
+
+	copy_rows(rows.data(), stride, f, n_codewords, n_codewords, layout.k);
+	kernels().rs_encode(rows.data(), layout.k, stride, gf().generator,
+		RS_PARITY, parity.data());
+	copy_rows(f + layout.k*n_codewords, n_codewords, parity.data(), stride,
+		n_codewords, RS_PARITY);
+}
+
+/*
+ * the message of `size` bytes of data of the frame of `layout` at `f`,
+ * or its copy corrected in `fixed`, or null if it cannot be corrected
+ */
+const uint8_t* decode_message(
+	const uint8_t* f,
+	size_t size,
+	const frame_layout& layout,
+	stegim::scratch_vector<uint8_t>& fixed,
+	stegim::stats* stats)
+{
+	if(message_intact(f, size))
+		return f;
+
+	if(!layout.n_codewords)
+		return nullptr;
+
+	fixed.assign(f, f + layout.size);
+
+	long n_corrected = frame_correct(fixed.data(), layout);
+	if(n_corrected < 0 || !message_intact(fixed.data(), size))
+		return nullptr;
+
+	if(stats)
+		stats->bytes_corrected += n_corrected;
+
+	return fixed.data();
+}
+
+/*
+ * the bytes of the compressed stream of `size` bytes of data at most,
+ * with every block stored raw
+ */
+size_t stream_bound(size_t size)
+{
+	size_t n_blocks = (size + COMPRESS_BLOCK - 1)/COMPRESS_BLOCK;
+	return 4*n_blocks + size;
+}
+
+/*
+ * compresses the `size` bytes of `data` block by block in `dst`, of
+ * stream_bound bytes, and returns the bytes of the stream
+ */
+size_t stream_encode(
+	stegim::frame_compression compression,
+	const char* data,
+	size_t size,
+	uint8_t* dst)
+{
+	const uint8_t* src = reinterpret_cast<const uint8_t*>(data);
+	uint8_t* op = dst;
+
+	for(size_t b = 0; b < size; b += COMPRESS_BLOCK){
+		size_t n = std::min((size_t) COMPRESS_BLOCK, size - b);
+
+		/*
+		 * a block is only kept compressed if it shrinks
+		 */
+		size_t n_compressed = compress_block(compression, src + b, n,
+			op + 4, n - 1);
+
+		if(n_compressed){
+			write_le32(op, n_compressed);
+			op += 4 + n_compressed;
+		}else{
+			write_le32(op, n | COMPRESS_STORED);
+			std::memcpy(op + 4, src + b, n);
+			op += 4 + n;
+		}
+	}
+
+	return op - dst;
+}
+
+/*
+ * decompresses the stream of `n` bytes of `src` block by block in
+ * `data`, of `size` bytes, and returns whether it is well formed
+ */
+bool stream_decode(
+	stegim::frame_compression compression,
+	const uint8_t* src,
+	size_t n,
+	std::vector<char>& data,
+	size_t size)
+{
+	data.resize(size);
+	uint8_t* dst = reinterpret_cast<uint8_t*>(data.data());
+
+	size_t ip = 0;
+	for(size_t b = 0; b < size; b += COMPRESS_BLOCK){
+		size_t block_size = std::min((size_t) COMPRESS_BLOCK, size - b);
+
+		if(n - ip < 4)
+			return false;
+
+		uint32_t word = read_le32(src + ip);
+		size_t n_block = word & ~COMPRESS_STORED;
+		ip += 4;
+
+		if(n_block > n - ip)
+			return false;
+
+		if(word & COMPRESS_STORED){
+			if(n_block != block_size)
+				return false;
+
+			std::memcpy(dst + b, src + ip, n_block);
+		}else if(!decompress_block(compression, src + ip, n_block, dst + b,
+			block_size)){
+			return false;
+		}
+
+		ip += n_block;
+	}
+
+	return ip == n;
+}
+
+/*
+ * the head of a compressed frame, the frame of the size of its stream
+ * and of the size of its data
+ */
+frame_layout head_layout(bool parity)
+{
+	return frame_layout(8, parity);
+}
+
+/*
+ * reads the head at `f`, of `available` bytes, and writes the bytes of
+ * the compressed stream in `n` and of the data in `size`. False if the
+ * head is corrupted.
+ */
+bool read_head(
+	const uint8_t* f,
+	size_t available,
+	bool parity,
+	size_t& n,
+	size_t& size,
+	stegim::stats* stats)
+{
+	frame_layout head = head_layout(parity);
+	if(available < head.size)
+		return false;
+
+	stegim::scratch_vector<uint8_t> fixed;
+	const uint8_t* message = decode_message(f, 8, head, fixed, stats);
+	if(!message)
+		return false;
+
+	n = read_le32(message + stegim::frame_header_size);
+	size = read_le32(message + stegim::frame_header_size + 4);
+
+	return n <= stream_bound(size);
+}
+
+/*
+ * the bytes of the compressed stream of `size` bytes of data held by
+ * the head at `f`, of `available` bytes, or SIZE_MAX if the head is
+ * corrupted or holds another size
+ */
+size_t stream_size(
+	const uint8_t* f,
+	size_t available,
+	size_t size,
+	bool parity,
+	stegim::stats* stats)
+{
+	size_t n, head_size;
+	if(!read_head(f, available, parity, n, head_size, stats) || head_size != size)
+		return SIZE_MAX;
+
+	return n;
+}
+
+bool stegim::compression_supported(stegim::frame_compression compression)
+{
+	switch(compression){
+	case stegim::COMPRESSION_NONE:
+	case stegim::COMPRESSION_LZ4:
+		return true;
+
+	case stegim::COMPRESSION_ZSTD:
+#ifdef STEGIM_ZSTD
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	return false;
+}
+
+uint32_t stegim::crc32c(const char* data, size_t size)
+{
+	return ~kernels().crc32c(~0u, reinterpret_cast<const uint8_t*>(data), size);
+}
+
+size_t stegim::frame_size(size_t size, const stegim::frame_options& frame_opt)
+{
+	bool parity = frame_opt.get_parity();
+
+	if(frame_opt.get_compression() == stegim::COMPRESSION_NONE)
+		return frame_layout(size, parity).size;
+
+	return head_layout(parity).size + frame_layout(stream_bound(size), parity).size;
+}
+
+size_t stegim::frame_capacity(size_t raw_capacity, const stegim::frame_options& frame_opt)
+{
+	if(stegim::frame_size(0, frame_opt) > raw_capacity)
+		return 0;
+
+	/*
+	 * the frame grows with the data, the largest size that fits is
+	 * found by bisection, the frame being at least as large as its
+	 * data
+	 */
+	size_t low = 0;
+	size_t high = std::min(raw_capacity, (size_t) UINT32_MAX);
+	while(low < high){
+		size_t mid = low + (high - low + 1)/2;
+		if(stegim::frame_size(mid, frame_opt) <= raw_capacity)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+
+	return low;
+}
+
+size_t stegim::frame_head_size(const stegim::frame_options& frame_opt)
+{
+	if(frame_opt.get_compression() == stegim::COMPRESSION_NONE)
+		return 0;
+
+	return head_layout(frame_opt.get_parity()).size;
+}
+
+size_t stegim::frame_size_from_head(
+	const std::vector<char>& head,
+	size_t size,
+	const stegim::frame_options& frame_opt)
+{
+	bool parity = frame_opt.get_parity();
+
+	if(frame_opt.get_compression() == stegim::COMPRESSION_NONE)
+		return frame_layout(size, parity).size;
+
+	size_t n = stream_size(reinterpret_cast<const uint8_t*>(head.data()),
+		head.size(), size, parity, nullptr);
+	if(n == SIZE_MAX)
+		return 0;
+
+	return head_layout(parity).size + frame_layout(n, parity).size;
+}
+
+size_t stegim::frame_data_size(
+	const std::vector<char>& head,
+	const stegim::frame_options& frame_opt)
+{
+	const uint8_t* f = reinterpret_cast<const uint8_t*>(head.data());
+
+	if(frame_opt.get_compression() == stegim::COMPRESSION_NONE){
+		if(	head.size() < stegim::frame_header_size ||
+			read_le32(f + 4) != length_crc(f))
+			return SIZE_MAX;
+
+		return read_le32(f);
+	}
+
+	size_t n, size;
+	if(!read_head(f, head.size(), frame_opt.get_parity(), n, size, nullptr))
+		return SIZE_MAX;
+
+	return size;
+}
+
+void stegim::frame_encode(
+	const std::vector<char>& data,
+	std::vector<char>& frame,
+	const stegim::frame_options& frame_opt)
+{
+	assert(data.size() <= UINT32_MAX);
+	assert(compression_supported(frame_opt.get_compression()));
+
+	stegim::stats* stats = frame_opt.get_stats();
+	scope_timer framing_timer(STATS_FIELD(stats, framing_ns));
+
+	bool parity = frame_opt.get_parity();
+	stegim::frame_compression compression = frame_opt.get_compression();
+
+	if(compression == stegim::COMPRESSION_NONE){
+		frame_layout layout(data.size(), parity);
+
+		frame.assign(layout.size, 0);
+		uint8_t* f = reinterpret_cast<uint8_t*>(frame.data());
+
+		if(!data.empty())
+			std::memcpy(f + stegim::frame_header_size, data.data(), data.size());
+		encode_message(f, data.size(), layout);
+		return;
+	}
+
+	/*
+	 * the blocks are compressed in place of the data of the frame,
+	 * which is then cut to the stream
+	 */
+	frame_layout head = head_layout(parity);
+
+	frame.assign(stegim::frame_size(data.size(), frame_opt), 0);
+	size_t n = stream_encode(compression, data.data(), data.size(),
+		reinterpret_cast<uint8_t*>(frame.data()) + head.size +
+		stegim::frame_header_size);
+
+	frame_layout layout(n, parity);
+	frame.resize(head.size + layout.size);
+
+	uint8_t* f = reinterpret_cast<uint8_t*>(frame.data());
+	write_le32(f + stegim::frame_header_size, n);
+	write_le32(f + stegim::frame_header_size + 4, data.size());
+	encode_message(f, 8, head);
+	encode_message(f + head.size, n, layout);
+}
+
+bool stegim::frame_decode(
+	const std::vector<char>& frame,
+	std::vector<char>& data,
+	size_t size,
+	const stegim::frame_options& frame_opt)
+{
+	stegim::stats* stats = frame_opt.get_stats();
+	scope_timer framing_timer(STATS_FIELD(stats, framing_ns));
+
+	data.clear();
+
+	bool parity = frame_opt.get_parity();
+	stegim::frame_compression compression = frame_opt.get_compression();
+	if(size > UINT32_MAX)
+		return false;
+
+	const uint8_t* f = reinterpret_cast<const uint8_t*>(frame.data());
+	stegim::scratch_vector<uint8_t> fixed;
+
+	if(compression == stegim::COMPRESSION_NONE){
+		frame_layout layout(size, parity);
+		if(frame.size() < layout.size)
+			return false;
+
+		const uint8_t* message = decode_message(f, size, layout, fixed, stats);
+		if(!message)
+			return false;
+
+		const char* begin = reinterpret_cast<const char*>(message)
+			+ stegim::frame_header_size;
+		data.assign(begin, begin + size);
+		return true;
+	}
+
+	size_t n = stream_size(f, frame.size(), size, parity, stats);
+	if(n == SIZE_MAX)
+		return false;
+
+	frame_layout head = head_layout(parity);
+	frame_layout layout(n, parity);
+	if(frame.size() < head.size + layout.size)
+		return false;
+
+	const uint8_t* message = decode_message(f + head.size, n, layout, fixed, stats);
+	if(!message)
+		return false;
+
+	if(!stream_decode(compression, message + stegim::frame_header_size, n,
+		data, size)){
+		data.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool stegim::lsb_embed_framed(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const stegim::lsb_options& lsb_opt,
+	const stegim::frame_options& frame_opt)
+{
+	std::vector<char> frame;
+	stegim::frame_encode(data, frame, frame_opt);
+
+	/*
+	 * a truncated frame could not be decoded
+	 */
+	if(frame.size() > stegim::capacity(cover, lsb_opt))
+		return false;
+
+	stegim::lsb_embed(cover, stego, frame, lsb_opt);
+	return true;
+}
+
+bool stegim::lsb_extract_framed(
+	const cv::Mat& stego,
+	std::vector<char>& data,
+	size_t size,
+	const stegim::lsb_options& lsb_opt,
+	const stegim::frame_options& frame_opt)
+{
+	std::vector<char> frame;
+	size_t n = stegim::frame_size(size, frame_opt);
+
+	/*
+	 * the size of a compressed frame is held by its head
+	 */
+	size_t head = stegim::frame_head_size(frame_opt);
+	if(head){
+		stegim::lsb_extract(stego, frame, head, lsb_opt);
+		n = stegim::frame_size_from_head(frame, size, frame_opt);
+		if(!n){
+			data.clear();
+			return false;
+		}
+	}
+
+	stegim::lsb_extract(stego, frame, n, lsb_opt);
+	return stegim::frame_decode(frame, data, size, frame_opt);
+}
+
+bool stegim::lsb_matching_embed_framed(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt,
+	const stegim::frame_options& frame_opt)
+{
+	std::vector<char> frame;
+	stegim::frame_encode(data, frame, frame_opt);
+
+	size_t capacity = lsbm_opt.get_edge_adaptive() ?
+		stegim::edge_region(cover).capacity(0) :
+		stegim::lsb_matching_capacity(cover);
+	if(frame.size() > capacity)
+		return false;
+
+	stegim::lsb_matching_embed(cover, stego, frame, key, lsbm_opt);
+	return true;
+}
+
+bool stegim::lsb_matching_embed_framed(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const std::string& key,
+	const stegim::lsb_matching_options& lsbm_opt,
+	const stegim::frame_options& frame_opt)
+{
+	std::vector<char> k(key.data(), key.data() + key.size());
+	return stegim::lsb_matching_embed_framed(cover, stego, data, k, lsbm_opt,
+		frame_opt);
+}
+
+bool stegim::lsb_matching_extract_framed(
+	const cv::Mat& stego,
+	std::vector<char>& data,
+	size_t size,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt,
+	const stegim::frame_options& frame_opt)
+{
+	std::vector<char> frame;
+
+	size_t head = stegim::frame_head_size(frame_opt);
+	if(!head){
+		stegim::lsb_matching_extract(stego, frame,
+			stegim::frame_size(size, frame_opt), key, lsbm_opt);
+		return stegim::frame_decode(frame, data, size, frame_opt);
+	}
+
+	/*
+	 * the head and the frame are extracted with the same permutation
+	 */
+	stegim::lsb_matching_permutation permutation(stego, key, lsbm_opt);
+
+	stegim::lsb_matching_extract(stego, frame, head, permutation, lsbm_opt);
+	size_t n = stegim::frame_size_from_head(frame, size, frame_opt);
+	if(!n){
+		data.clear();
+		return false;
+	}
+
+	stegim::lsb_matching_extract(stego, frame, n, permutation, lsbm_opt);
+	return stegim::frame_decode(frame, data, size, frame_opt);
+}
+
+bool stegim::lsb_matching_extract_framed(
+	const cv::Mat& stego,
+	std::vector<char>& data,
+	size_t size,
+	const std::string& key,
+	const stegim::lsb_matching_options& lsbm_opt,
+	const stegim::frame_options& frame_opt)
+{
+	std::vector<char> k(key.data(), key.data() + key.size());
+	return stegim::lsb_matching_extract_framed(stego, data, size, k,
+		lsbm_opt, frame_opt);
+}
+
+/*
+ * frame_options
+ */
+stegim::frame_options::frame_options()
+	: parity(true),
+	stats_sink(nullptr),
+	compression(stegim::COMPRESSION_NONE)
+{}
+
+stegim::frame_options::~frame_options()
+{}
+
+stegim::frame_options& stegim::frame_options::set_parity(bool parity)
+{
+	this->parity = parity;
+	return *this;
+}
+
+stegim::frame_options& stegim::frame_options::set_stats(stegim::stats* stats_sink)
+{
+	this->stats_sink = stats_sink;
+	return *this;
+}
+
+stegim::frame_options& stegim::frame_options::set_compression(
+	stegim::frame_compression compression)
+{
+	assert(stegim::compression_supported(compression));
+	this->compression = compression;
+	return *this;
+}
+
+bool stegim::frame_options::get_parity() const
+{
+	return this->parity;
+}
+
+stegim::stats* stegim::frame_options::get_stats() const
+{
+	return this->stats_sink;
+}
+
+stegim::frame_compression stegim::frame_options::get_compression() const
+{
+	return this->compression;
+}
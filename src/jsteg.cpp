@@ -0,0 +1,412 @@
+#include <algorithm>
+#include <cassert>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#include <jpeglib.h>
+
+#include "jsteg.hpp"
+#include "lsb_matching_kernel.hpp"
+#include "scratch.hpp"
+#include "scope_timer.hpp"
+
+/*
+ * the largest magnitude of an AC coefficient of a baseline JPEG, the
+ * huffman coding of libjpeg refuses anything larger
+ */
+#define JSTEG_MAX_COEF 1023
+
+/*
+ * a coefficient carries a bit if it is neither 0 nor 1. The lsb
+ * replacement and the matching keep it so.
+ */
+#define JSTEG_USABLE(X) ((X) != 0 && (X) != 1)
+
+/*
+ * the decoder and the encoder of the coefficients of a JPEG in memory.
+ * The errors of libjpeg jump to `jump` instead of exiting the process,
+ * so the functions calling libjpeg set it and own nothing with a
+ * destructor. The codec is released by its own destructor.
+ */
+struct jsteg_codec {
+	jpeg_error_mgr error;
+	jmp_buf jump;
+
+	jpeg_decompress_struct src;
+	jpeg_compress_struct dst;
+
+	/*
+	 * the coefficients of each component of `src`
+	 */
+	jvirt_barray_ptr* coef;
+
+	/*
+	 * the usable coefficients, in the order of the components,
+	 * the blocks and the zigzag
+	 */
+	stegim::scratch_vector<JCOEF*> usable;
+
+	/*
+	 * the JPEG written by `dst`, allocated by libjpeg
+	 */
+	unsigned char* out;
+	unsigned long out_size;
+
+	jsteg_codec()
+		: coef(nullptr),
+		out(nullptr),
+		out_size(0)
+	{
+		std::memset(&src, 0, sizeof(src));
+		std::memset(&dst, 0, sizeof(dst));
+	}
+
+	~jsteg_codec()
+	{
+		jpeg_destroy_decompress(&src);
+		jpeg_destroy_compress(&dst);
+		free(out);
+	}
+};
+
+void jsteg_error_exit(j_common_ptr cinfo)
+{
+	/*
+	 * `error` is the first member of the codec
+	 */
+	longjmp(reinterpret_cast<jsteg_codec*>(cinfo->err)->jump, 1);
+}
+
+void jsteg_output_message(j_common_ptr)
+{}
+
+/*
+ * reads the coefficients of `jpeg` and finds the usable ones. The
+ * APP and COM markers are saved to be written in the stego image.
+ * Returns false if `jpeg` cannot be decoded.
+ */
+bool jsteg_read(jsteg_codec& codec, const std::vector<char>& jpeg)
+{
+	if(setjmp(codec.jump))
+		return false;
+
+	codec.src.err = jpeg_std_error(&codec.error);
+	codec.error.error_exit = jsteg_error_exit;
+	codec.error.output_message = jsteg_output_message;
+
+	jpeg_create_decompress(&codec.src);
+
+	/*
+	 * older libjpeg take a non const buffer, it is not written
+	 */
+	jpeg_mem_src(&codec.src,
+		(unsigned char*) jpeg.data(),
+		jpeg.size());
+
+	jpeg_save_markers(&codec.src, JPEG_COM, 0xffff);
+	for(int m = 0; m < 16; m++)
+		jpeg_save_markers(&codec.src, JPEG_APP0 + m, 0xffff);
+
+	jpeg_read_header(&codec.src, TRUE);
+	codec.coef = jpeg_read_coefficients(&codec.src);
+
+	/*
+	 * room for every AC coefficient, only the pages of the
+	 * usable ones are touched
+	 */
+	size_t n_blocks = 0;
+	for(int c = 0; c < codec.src.num_components; c++)
+		n_blocks += (size_t) codec.src.comp_info[c].height_in_blocks*
+			codec.src.comp_info[c].width_in_blocks;
+
+	codec.usable.reserve(n_blocks*(DCTSIZE2 - 1));
+
+	/*
+	 * the whole image fits in the memory of libjpeg, the default,
+	 * so the rows stay where access_virt_barray returns them
+	 */
+	for(int c = 0; c < codec.src.num_components; c++){
+		jpeg_component_info* comp = codec.src.comp_info + c;
+
+		for(JDIMENSION row = 0; row < comp->height_in_blocks; row++){
+			JBLOCKARRAY block = (*codec.src.mem->access_virt_barray)(
+				(j_common_ptr) &codec.src,
+				codec.coef[c],
+				row,
+				1,
+				TRUE);
+
+			/*
+			 * the usable coefficients of a block are gathered
+			 * without branches, about half of them are usable
+			 * in no predictable pattern
+			 */
+			for(JDIMENSION col = 0; col < comp->width_in_blocks; col++){
+				JCOEF* gathered[DCTSIZE2];
+				size_t n = 0;
+
+				for(int k = 1; k < DCTSIZE2; k++){
+					gathered[n] = &block[0][col][k];
+					n += JSTEG_USABLE(block[0][col][k]);
+				}
+
+				codec.usable.insert(codec.usable.end(), gathered, gathered + n);
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+ * writes the coefficients read by `jsteg_read`, with its markers, in
+ * `codec.out`. Returns false on an error of libjpeg.
+ */
+bool jsteg_write(jsteg_codec& codec)
+{
+	if(setjmp(codec.jump))
+		return false;
+
+	codec.dst.err = &codec.error;
+	jpeg_create_compress(&codec.dst);
+
+	jpeg_copy_critical_parameters(&codec.src, &codec.dst);
+	if(codec.src.progressive_mode)
+		jpeg_simple_progression(&codec.dst);
+
+	jpeg_mem_dest(&codec.dst, &codec.out, &codec.out_size);
+	jpeg_write_coefficients(&codec.dst, codec.coef);
+
+	for(jpeg_saved_marker_ptr m = codec.src.marker_list; m; m = m->next){
+		/*
+		 * the JFIF and Adobe headers may be written by libjpeg
+		 */
+		if(m->marker == JPEG_APP0 && codec.dst.write_JFIF_header &&
+			m->data_length >= 5 && !std::memcmp(m->data, "JFIF", 5))
+			continue;
+
+		if(m->marker == JPEG_APP0 + 14 && codec.dst.write_Adobe_marker &&
+			m->data_length >= 5 && !std::memcmp(m->data, "Adobe", 5))
+			continue;
+
+		jpeg_write_marker(&codec.dst, m->marker, m->data, m->data_length);
+	}
+
+	jpeg_finish_compress(&codec.dst);
+	jpeg_finish_decompress(&codec.src);
+
+	return true;
+}
+
+/*
+ * shuffles the first `n` usable coefficients of `codec` by `key`, as
+ * the edge adaptive lsb matching shuffles its pairs
+ */
+void jsteg_shuffle(jsteg_codec& codec, size_t n, const std::vector<char>& key)
+{
+	std::default_random_engine random_generator(
+		prime_hash(key.data(), key.size()));
+
+	stegim::scratch_vector<JCOEF*>& usable = codec.usable;
+	for(size_t i = 0; i < n && i < usable.size(); i++){
+		std::uniform_int_distribution<size_t> uniform(i, usable.size() - 1);
+		std::swap(usable[i], usable[uniform(random_generator)]);
+	}
+}
+
+/*
+ * embeds the bits of `data` in the first usable coefficients of
+ * `codec` and returns the number of modified coefficients
+ */
+size_t jsteg_embed_data(
+	jsteg_codec& codec,
+	const std::vector<char>& data,
+	bool matching)
+{
+	size_t n_modified = 0;
+	uint64_t random = 0;
+	size_t n_random = 0;
+
+	for(size_t n_bits = 0; n_bits < data.size()*CHAR_BIT; n_bits++){
+		JCOEF* p = codec.usable[n_bits];
+		int bit = (data[n_bits/CHAR_BIT] >> (n_bits%CHAR_BIT)) & 1;
+
+		if(LSB(*p) == bit)
+			continue;
+
+		n_modified++;
+
+		/*
+		 * -JSTEG_MAX_COEF is odd, it goes up to keep in the
+		 * baseline range
+		 */
+		if(!matching){
+			*p = *p == -JSTEG_MAX_COEF ? *p + 1 : (*p & ~1) | bit;
+			continue;
+		}
+
+		if(n_random == 0){
+			random = random_word();
+			n_random = 64;
+		}
+
+		/*
+		 * the side is random unless it reaches 0 or 1, which
+		 * would not be usable, or leaves the baseline range
+		 */
+		int d = (random & 1) ? 1 : -1;
+		random >>= 1;
+		n_random--;
+
+		int s = *p + d;
+		if(!JSTEG_USABLE(s) || s > JSTEG_MAX_COEF || s < -JSTEG_MAX_COEF)
+			s = *p - d;
+
+		*p = s;
+	}
+
+	return n_modified;
+}
+
+bool stegim::jsteg_embed(
+	const std::vector<char>& cover_jpeg,
+	std::vector<char>& stego_jpeg,
+	const std::vector<char>& data,
+	const std::vector<char>& key,
+	const stegim::jsteg_options& jsteg_opt)
+{
+	stegim::stats* stats = jsteg_opt.get_stats();
+	jsteg_codec codec;
+
+	scope_timer permutation_timer(STATS_FIELD(stats, permutation_ns));
+
+	if(	!jsteg_read(codec, cover_jpeg) ||
+		data.size()*CHAR_BIT > codec.usable.size())
+		return false;
+
+	jsteg_shuffle(codec, data.size()*CHAR_BIT, key);
+
+	permutation_timer.stop();
+
+	scope_timer embedding_timer(STATS_FIELD(stats, embedding_ns));
+	size_t n_modified = jsteg_embed_data(codec, data,
+		jsteg_opt.get_matching());
+	embedding_timer.stop();
+
+	if(!jsteg_write(codec))
+		return false;
+
+	stego_jpeg.assign(codec.out, codec.out + codec.out_size);
+
+	if(stats){
+		stats->samples_visited += data.size()*CHAR_BIT;
+		stats->samples_modified += n_modified;
+		stats->bytes_processed += data.size();
+	}
+
+	return true;
+}
+
+bool stegim::jsteg_embed(
+	const std::vector<char>& cover_jpeg,
+	std::vector<char>& stego_jpeg,
+	const std::vector<char>& data,
+	const std::string& key,
+	const stegim::jsteg_options& jsteg_opt)
+{
+	std::vector<char> k(key.data(), key.data() + key.size());
+	return stegim::jsteg_embed(cover_jpeg, stego_jpeg, data, k, jsteg_opt);
+}
+
+bool stegim::jsteg_extract(
+	const std::vector<char>& stego_jpeg,
+	std::vector<char>& data,
+	size_t size,
+	const std::vector<char>& key,
+	const stegim::jsteg_options& jsteg_opt)
+{
+	stegim::stats* stats = jsteg_opt.get_stats();
+	jsteg_codec codec;
+
+	scope_timer permutation_timer(STATS_FIELD(stats, permutation_ns));
+
+	if(	!jsteg_read(codec, stego_jpeg) ||
+		size*CHAR_BIT > codec.usable.size())
+		return false;
+
+	jsteg_shuffle(codec, size*CHAR_BIT, key);
+
+	permutation_timer.stop();
+
+	scope_timer embedding_timer(STATS_FIELD(stats, embedding_ns));
+
+	data.assign(size, 0);
+	for(size_t n_bits = 0; n_bits < size*CHAR_BIT; n_bits++)
+		data[n_bits/CHAR_BIT] |= LSB(*codec.usable[n_bits]) << (n_bits%CHAR_BIT);
+
+	embedding_timer.stop();
+
+	if(stats){
+		stats->samples_visited += size*CHAR_BIT;
+		stats->bytes_processed += size;
+	}
+
+	return true;
+}
+
+bool stegim::jsteg_extract(
+	const std::vector<char>& stego_jpeg,
+	std::vector<char>& data,
+	size_t size,
+	const std::string& key,
+	const stegim::jsteg_options& jsteg_opt)
+{
+	std::vector<char> k(key.data(), key.data() + key.size());
+	return stegim::jsteg_extract(stego_jpeg, data, size, k, jsteg_opt);
+}
+
+size_t stegim::jsteg_capacity(const std::vector<char>& cover_jpeg)
+{
+	jsteg_codec codec;
+
+	if(!jsteg_read(codec, cover_jpeg))
+		return 0;
+
+	return codec.usable.size()/CHAR_BIT;
+}
+
+/*
+ * jsteg_options
+ */
+stegim::jsteg_options::jsteg_options()
+	: stats_sink(nullptr),
+	matching(false)
+{}
+
+stegim::jsteg_options::~jsteg_options()
+{}
+
+stegim::jsteg_options& stegim::jsteg_options::set_stats(stegim::stats* stats_sink)
+{
+	this->stats_sink = stats_sink;
+	return *this;
+}
+
+stegim::jsteg_options& stegim::jsteg_options::set_matching(bool matching)
+{
+	this->matching = matching;
+	return *this;
+}
+
+stegim::stats* stegim::jsteg_options::get_stats() const
+{
+	return this->stats_sink;
+}
+
+bool stegim::jsteg_options::get_matching() const
+{
+	return this->matching;
+}
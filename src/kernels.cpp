@@ -0,0 +1,61 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "kernels.hpp"
+
+/*
+ * a table and whether the cpu runs it
+ */
+struct kernel_variant {
+	const kernel_table* table;
+	bool supported;
+};
+
+/*
+ * selects the best table supported by the cpu, or the one named
+ * by STEGIM_ISA if it is supported
+ */
+const kernel_table* select_kernels()
+{
+	kernel_variant variants[] = {
+		{ scalar_kernels(), true },
+		{ sse42_kernels(), false },
+		{ avx2_kernels(), false },
+		{ avx512_kernels(), false }
+	};
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+	__builtin_cpu_init();
+
+	variants[1].supported =
+		__builtin_cpu_supports("sse4.2") &&
+		__builtin_cpu_supports("popcnt");
+
+	variants[2].supported = variants[1].supported &&
+		__builtin_cpu_supports("avx2") &&
+		__builtin_cpu_supports("bmi2");
+
+	variants[3].supported = variants[2].supported &&
+		__builtin_cpu_supports("avx512f") &&
+		__builtin_cpu_supports("avx512bw");
+#endif
+
+	const kernel_table* best = nullptr;
+	for(const kernel_variant& v : variants)
+		if(v.table && v.supported)
+			best = v.table;
+
+	const char* isa = std::getenv("STEGIM_ISA");
+	if(isa)
+		for(const kernel_variant& v : variants)
+			if(v.table && v.supported && std::strcmp(v.table->name, isa) == 0)
+				return v.table;
+
+	return best;
+}
+
+const kernel_table& kernels()
+{
+	static const kernel_table* table = select_kernels();
+	return *table;
+}
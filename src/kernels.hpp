@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * number of samples packed in a 64 bit word
+ */
+#define PLANE_WORD_BIT 64
+
+/*
+ * largest number of parity bytes of a Reed-Solomon codeword
+ */
+#define RS_MAX_PARITY 32
+
+/*
+ * size in bytes of a ChaCha20 block
+ */
+#define CHACHA20_BLOCK 64
+
+/*
+ * the vectorized loops of the library. There is a table for each
+ * instruction set, built in its own translation unit with the flags of
+ * that instruction set, and the best one supported by the cpu is
+ * selected at the first call of `kernels`.
+ */
+struct kernel_table {
+	/*
+	 * "scalar", "sse42", "avx2" or "avx512"
+	 */
+	const char* name;
+
+	/*
+	 * packs the `k`-th bit of the `n` samples in `src` in `dst`,
+	 * writing (`n` + 7)/8 bytes. The bits after the `n`-th bit of
+	 * the last byte are written with zero.
+	 */
+	void (*pack_plane)(const uint8_t* src, size_t n, int k, uint8_t* dst);
+
+	/*
+	 * replaces the `k`-th bit of the `n` samples in `src` with the
+	 * bits in `bits` and writes the result in `dst`. `src` and `dst`
+	 * may be the same buffer.
+	 */
+	void (*unpack_plane)(
+		const uint8_t* bits,
+		size_t n,
+		int k,
+		const uint8_t* src,
+		uint8_t* dst);
+
+	/*
+	 * writes |`a`[i] - `b`[i]| in `diff`[i] for the `n` samples
+	 */
+	void (*absdiff)(const uint8_t* a, const uint8_t* b, size_t n, uint8_t* diff);
+
+	/*
+	 * returns a mask with the i-th bit set if `diff`[i] >= `threshold`,
+	 * for the `n` (<= 64) differences
+	 */
+	uint64_t (*threshold_mask)(const uint8_t* diff, size_t n, uint8_t threshold);
+
+	/*
+	 * counts in `histogram` the `n` differences of `diff` of the
+	 * pairs of a row, the ones with i%(2*`channels`) < `channels`
+	 */
+	void (*pair_histogram)(
+		const uint8_t* diff,
+		size_t n,
+		size_t channels,
+		size_t* histogram);
+
+	/*
+	 * embeds by lsb matching revised the bits i of `m0` and `m1` in
+	 * the pair (`c0`[i], `c1`[i]) and writes it in (`s0`[i], `s1`[i]),
+	 * for the `n` (<= 64) pairs. The bit i of `random` gives the side
+	 * of a change of `c1`[i], 1 for +1. Returns the number of
+	 * saturated first samples that were adjusted.
+	 */
+	size_t (*lsbmr_embed)(
+		const uint8_t* c0,
+		const uint8_t* c1,
+		uint64_t m0,
+		uint64_t m1,
+		uint64_t random,
+		size_t n,
+		uint8_t* s0,
+		uint8_t* s1);
+
+	/*
+	 * parallel bit extract, gathers the bits of `x` selected by
+	 * `mask` in the least significant bits of the result
+	 */
+	uint64_t (*pext)(uint64_t x, uint64_t mask);
+
+	/*
+	 * `pack_plane`, `unpack_plane` and `lsbmr_embed` for samples of
+	 * 16 bits, `k` < 16, saturated at 0 and 65535
+	 */
+	void (*pack_plane16)(const uint16_t* src, size_t n, int k, uint8_t* dst);
+
+	void (*unpack_plane16)(
+		const uint8_t* bits,
+		size_t n,
+		int k,
+		const uint16_t* src,
+		uint16_t* dst);
+
+	size_t (*lsbmr_embed16)(
+		const uint16_t* c0,
+		const uint16_t* c1,
+		uint64_t m0,
+		uint64_t m1,
+		uint64_t random,
+		size_t n,
+		uint16_t* s0,
+		uint16_t* s1);
+
+	/*
+	 * updates the CRC32C register `crc` with the `n` bytes of `p`,
+	 * without the initial and final inversions
+	 */
+	uint32_t (*crc32c)(uint32_t crc, const uint8_t* p, size_t n);
+
+	/*
+	 * the Reed-Solomon parity of `n_lanes` interleaved codewords,
+	 * the byte t of the codeword c is `data`[t*`n_lanes` + c], for
+	 * the `k` data bytes of each. `tables` has the GF(2^8) nibble
+	 * tables of the `n_parity` (<= RS_MAX_PARITY) coefficients of
+	 * the generator, the lowest degree first: 16 products of the low
+	 * nibbles and 16 of the high nibbles by each coefficient. The
+	 * parity byte p of the codeword c is written in
+	 * `parity`[p*`n_lanes` + c].
+	 */
+	void (*rs_encode)(
+		const uint8_t* data,
+		size_t k,
+		size_t n_lanes,
+		const uint8_t* tables,
+		size_t n_parity,
+		uint8_t* parity);
+
+	/*
+	 * the `n_syndromes` syndromes of `n_lanes` interleaved codewords
+	 * of `n` bytes, laid out as in `rs_encode`. `tables` has the
+	 * nibble tables of the powers of the primitive element, the
+	 * syndrome j of the codeword c is written in
+	 * `syndromes`[j*`n_lanes` + c].
+	 */
+	void (*rs_syndromes)(
+		const uint8_t* code,
+		size_t n,
+		size_t n_lanes,
+		const uint8_t* tables,
+		size_t n_syndromes,
+		uint8_t* syndromes);
+
+	/*
+	 * writes in `out` the `n_blocks` ChaCha20 keystream blocks of
+	 * 64 bytes of the initial `state`, whose counter (the word 12)
+	 * is incremented after each block
+	 */
+	void (*chacha20)(const uint32_t* state, size_t n_blocks, uint8_t* out);
+};
+
+/*
+ * the table of each instruction set, null if the library was not
+ * built with it
+ */
+const kernel_table* scalar_kernels();
+const kernel_table* sse42_kernels();
+const kernel_table* avx2_kernels();
+const kernel_table* avx512_kernels();
+
+/*
+ * returns the table selected for this cpu. The environment variable
+ * STEGIM_ISA may name the table to be used instead, for testing, it is
+ * ignored if the cpu does not support that table.
+ */
+const kernel_table& kernels();
+
+/*
+ * writes the `n` (<= 64) least significant bits of `bits` in `plane`
+ * beginning in the `pos`-th bit. `plane` must be zeroed in this range.
+ */
+inline void append_bits(uint8_t* plane, size_t pos, uint64_t bits, size_t n)
+{
+	for(size_t written = 0; written < n;){
+		size_t shift = (pos + written)%CHAR_BIT;
+		size_t count = std::min(n - written, CHAR_BIT - shift);
+
+		plane[(pos + written)/CHAR_BIT] |=
+			(uint8_t)(((bits >> written) & ((1u << count) - 1)) << shift);
+
+		written += count;
+	}
+}
+
+/*
+ * reads `n` (<= 64) bits of `plane` beginning in the `pos`-th bit
+ */
+inline uint64_t read_bits(const uint8_t* plane, size_t pos, size_t n)
+{
+	uint64_t bits = 0;
+	for(size_t read = 0; read < n;){
+		size_t shift = (pos + read)%CHAR_BIT;
+		size_t count = std::min(n - read, CHAR_BIT - shift);
+
+		uint64_t b = (plane[(pos + read)/CHAR_BIT] >> shift)
+			& ((1u << count) - 1);
+
+		bits |= b << read;
+		read += count;
+	}
+
+	return bits;
+}
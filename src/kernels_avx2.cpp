@@ -0,0 +1,9 @@
+/*
+ * kernels for avx2 and bmi2, built with -mavx2 -mbmi2
+ */
+#define KERNEL_LEVEL 2
+#define KERNEL_NAME "avx2"
+#define KERNEL_NAMESPACE avx2_kernels_impl
+#define KERNEL_TABLE avx2_kernels
+
+#include "kernels_impl.hpp"
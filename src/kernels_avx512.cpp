@@ -0,0 +1,9 @@
+/*
+ * kernels for avx512bw, built with -mavx512f -mavx512bw
+ */
+#define KERNEL_LEVEL 3
+#define KERNEL_NAME "avx512"
+#define KERNEL_NAMESPACE avx512_kernels_impl
+#define KERNEL_TABLE avx512_kernels
+
+#include "kernels_impl.hpp"
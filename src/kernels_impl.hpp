@@ -0,0 +1,1409 @@
+/*
+ * body of the kernel tables, included once by each kernels_*.cpp
+ * after defining
+ *
+ *	KERNEL_LEVEL		0 scalar, 1 sse4.2, 2 avx2 and bmi2,
+ *				3 avx512bw
+ *	KERNEL_NAME		name of the table
+ *	KERNEL_NAMESPACE	namespace of the kernels of the table
+ *	KERNEL_TABLE		function returning the table
+ *
+ * The translation unit is built with the flags of its instruction set,
+ * so nothing here may call an inline function of another header, the
+ * linker could keep that copy for the rest of the library.
+ */
+
+#include <cstring>
+
+#if KERNEL_LEVEL >= 1 && defined(__SSE4_2__)
+#include <nmmintrin.h>
+#define KERNEL_SSE
+#endif
+
+#if KERNEL_LEVEL >= 2 && defined(__AVX2__) && defined(__BMI2__)
+#include <immintrin.h>
+#define KERNEL_AVX2
+#endif
+
+#if KERNEL_LEVEL >= 3 && defined(__AVX512BW__)
+#define KERNEL_AVX512
+#endif
+
+#include "kernels.hpp"
+#include "pixel_kernel.hpp"
+
+/*
+ * the table is only given if the compiler supports every instruction
+ * set of its level
+ */
+#if	(KERNEL_LEVEL == 0) || \
+	(KERNEL_LEVEL == 1 && defined(KERNEL_SSE)) || \
+	(KERNEL_LEVEL == 2 && defined(KERNEL_AVX2)) || \
+	(KERNEL_LEVEL == 3 && defined(KERNEL_AVX512))
+
+namespace KERNEL_NAMESPACE {
+
+void pack_plane(const uint8_t* src, size_t n, int k, uint8_t* dst)
+{
+	size_t i = 0;
+
+#if defined(KERNEL_AVX512)
+	/*
+	 * moves the bit `k` to the most significant bit of each
+	 * byte and let vpmovb2m gather them
+	 */
+	const __m128i shift512 = _mm_cvtsi32_si128(7 - k);
+	for(; i + 64 <= n; i += 64){
+		__m512i v = _mm512_loadu_si512(src + i);
+		uint64_t m = _mm512_movepi8_mask(_mm512_sll_epi16(v, shift512));
+		std::memcpy(dst + i/CHAR_BIT, &m, sizeof(m));
+	}
+#endif
+
+#if defined(KERNEL_AVX2)
+	const __m128i shift256 = _mm_cvtsi32_si128(7 - k);
+	for(; i + 32 <= n; i += 32){
+		__m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+		uint32_t m = _mm256_movemask_epi8(_mm256_sll_epi16(v, shift256));
+		std::memcpy(dst + i/CHAR_BIT, &m, sizeof(m));
+	}
+#endif
+
+#if defined(KERNEL_SSE)
+	const __m128i shift128 = _mm_cvtsi32_si128(7 - k);
+	for(; i + 16 <= n; i += 16){
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+		uint16_t m = _mm_movemask_epi8(_mm_sll_epi16(v, shift128));
+		std::memcpy(dst + i/CHAR_BIT, &m, sizeof(m));
+	}
+#endif
+
+	/*
+	 * remaining samples
+	 */
+	for(; i < n; i += CHAR_BIT){
+		uint8_t b = 0;
+		for(size_t j = 0; j < CHAR_BIT && i + j < n; j++)
+			b |= ((src[i + j] >> k) & 1) << j;
+
+		dst[i/CHAR_BIT] = b;
+	}
+}
+
+void unpack_plane(
+	const uint8_t* bits,
+	size_t n,
+	int k,
+	const uint8_t* src,
+	uint8_t* dst)
+{
+	size_t i = 0;
+	const uint8_t bit_k = 1 << k;
+
+#if defined(KERNEL_AVX512)
+	const __m512i k512 = _mm512_set1_epi8(bit_k);
+	const __m512i clear512 = _mm512_set1_epi8(~bit_k);
+	for(; i + 64 <= n; i += 64){
+		uint64_t m;
+		std::memcpy(&m, bits + i/CHAR_BIT, sizeof(m));
+
+		__m512i v = _mm512_and_si512(clear512,
+				_mm512_loadu_si512(src + i));
+
+		v = _mm512_mask_blend_epi8(m, v, _mm512_or_si512(v, k512));
+		_mm512_storeu_si512(dst + i, v);
+	}
+#endif
+
+#if defined(KERNEL_AVX2)
+	/*
+	 * spread each byte of the mask over 8 lanes and test
+	 * one bit per lane
+	 */
+	const __m256i k256 = _mm256_set1_epi8(bit_k);
+	const __m256i spread256 = _mm256_setr_epi8(
+			0, 0, 0, 0, 0, 0, 0, 0,
+			1, 1, 1, 1, 1, 1, 1, 1,
+			2, 2, 2, 2, 2, 2, 2, 2,
+			3, 3, 3, 3, 3, 3, 3, 3);
+	const __m256i select256 = _mm256_set1_epi64x(
+			(int64_t)0x8040201008040201ULL);
+	for(; i + 32 <= n; i += 32){
+		uint32_t m;
+		std::memcpy(&m, bits + i/CHAR_BIT, sizeof(m));
+
+		__m256i b = _mm256_shuffle_epi8(_mm256_set1_epi32(m), spread256);
+		b = _mm256_cmpeq_epi8(_mm256_and_si256(b, select256), select256);
+
+		__m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+		v = _mm256_or_si256(
+			_mm256_andnot_si256(k256, v),
+			_mm256_and_si256(b, k256));
+		_mm256_storeu_si256((__m256i*)(dst + i), v);
+	}
+#endif
+
+#if defined(KERNEL_SSE)
+	/*
+	 * byte 0 of the mask in the lanes 0-7 and
+	 * byte 1 in the lanes 8-15
+	 */
+	const __m128i k128 = _mm_set1_epi8(bit_k);
+	const __m128i spread128 = _mm_setr_epi8(
+			0, 0, 0, 0, 0, 0, 0, 0,
+			1, 1, 1, 1, 1, 1, 1, 1);
+	const __m128i select128 = _mm_set1_epi64x(
+			(int64_t)0x8040201008040201ULL);
+	for(; i + 16 <= n; i += 16){
+		uint16_t m;
+		std::memcpy(&m, bits + i/CHAR_BIT, sizeof(m));
+
+		__m128i b = _mm_shuffle_epi8(_mm_cvtsi32_si128(m), spread128);
+		b = _mm_cmpeq_epi8(_mm_and_si128(b, select128), select128);
+
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+		v = _mm_or_si128(
+			_mm_andnot_si128(k128, v),
+			_mm_and_si128(b, k128));
+		_mm_storeu_si128((__m128i*)(dst + i), v);
+	}
+#endif
+
+	/*
+	 * remaining samples
+	 */
+	for(; i < n; i++){
+		int x = (bits[i/CHAR_BIT] >> (i%CHAR_BIT)) & 1;
+		dst[i] = (src[i] & ~bit_k) | (x << k);
+	}
+}
+
+void absdiff(const uint8_t* a, const uint8_t* b, size_t n, uint8_t* diff)
+{
+	size_t i = 0;
+
+#if defined(KERNEL_AVX512)
+	for(; i + 64 <= n; i += 64){
+		__m512i va = _mm512_loadu_si512(a + i);
+		__m512i vb = _mm512_loadu_si512(b + i);
+		__m512i d = _mm512_or_si512(
+			_mm512_subs_epu8(va, vb),
+			_mm512_subs_epu8(vb, va));
+		_mm512_storeu_si512(diff + i, d);
+	}
+#endif
+
+#if defined(KERNEL_AVX2)
+	for(; i + 32 <= n; i += 32){
+		__m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+		__m256i d = _mm256_or_si256(
+			_mm256_subs_epu8(va, vb),
+			_mm256_subs_epu8(vb, va));
+		_mm256_storeu_si256((__m256i*)(diff + i), d);
+	}
+#endif
+
+#if defined(KERNEL_SSE)
+	for(; i + 16 <= n; i += 16){
+		__m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+		__m128i d = _mm_or_si128(
+			_mm_subs_epu8(va, vb),
+			_mm_subs_epu8(vb, va));
+		_mm_storeu_si128((__m128i*)(diff + i), d);
+	}
+#endif
+
+	for(; i < n; i++)
+		diff[i] = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+}
+
+uint64_t threshold_mask(const uint8_t* diff, size_t n, uint8_t threshold)
+{
+	uint64_t mask = 0;
+	size_t i = 0;
+
+#if defined(KERNEL_AVX512)
+	if(n == 64)
+		return _mm512_cmpge_epu8_mask(
+			_mm512_loadu_si512(diff),
+			_mm512_set1_epi8(threshold));
+#endif
+
+#if defined(KERNEL_AVX2)
+	const __m256i t256 = _mm256_set1_epi8(threshold);
+	for(; i + 32 <= n; i += 32){
+		__m256i d = _mm256_loadu_si256((const __m256i*)(diff + i));
+		uint32_t m = _mm256_movemask_epi8(
+			_mm256_cmpeq_epi8(_mm256_max_epu8(d, t256), d));
+		mask |= (uint64_t) m << i;
+	}
+#endif
+
+#if defined(KERNEL_SSE)
+	const __m128i t128 = _mm_set1_epi8(threshold);
+	for(; i + 16 <= n; i += 16){
+		__m128i d = _mm_loadu_si128((const __m128i*)(diff + i));
+		uint32_t m = _mm_movemask_epi8(
+			_mm_cmpeq_epi8(_mm_max_epu8(d, t128), d));
+		mask |= (uint64_t) m << i;
+	}
+#endif
+
+	for(; i < n; i++)
+		mask |= (uint64_t)(diff[i] >= threshold) << i;
+
+	return mask;
+}
+
+void pair_histogram(
+	const uint8_t* diff,
+	size_t n,
+	size_t channels,
+	size_t* histogram)
+{
+	for(size_t j = 0; j < n; j += 2*channels)
+		for(size_t c = 0; c < channels && j + c < n; c++)
+			histogram[diff[j + c]]++;
+}
+
+#if defined(KERNEL_SSE)
+/*
+ * 0xff in the lane i if the bit i of `m` is set
+ */
+__m128i mask_lanes128(uint16_t m)
+{
+	const __m128i spread = _mm_setr_epi8(
+			0, 0, 0, 0, 0, 0, 0, 0,
+			1, 1, 1, 1, 1, 1, 1, 1);
+	const __m128i select = _mm_set1_epi64x(
+			(int64_t)0x8040201008040201ULL);
+
+	__m128i b = _mm_shuffle_epi8(_mm_cvtsi32_si128(m), spread);
+	return _mm_cmpeq_epi8(_mm_and_si128(b, select), select);
+}
+#endif
+
+#if defined(KERNEL_AVX2)
+__m256i mask_lanes256(uint32_t m)
+{
+	const __m256i spread = _mm256_setr_epi8(
+			0, 0, 0, 0, 0, 0, 0, 0,
+			1, 1, 1, 1, 1, 1, 1, 1,
+			2, 2, 2, 2, 2, 2, 2, 2,
+			3, 3, 3, 3, 3, 3, 3, 3);
+	const __m256i select = _mm256_set1_epi64x(
+			(int64_t)0x8040201008040201ULL);
+
+	__m256i b = _mm256_shuffle_epi8(_mm256_set1_epi32(m), spread);
+	return _mm256_cmpeq_epi8(_mm256_and_si256(b, select), select);
+}
+#endif
+
+/*
+ * the decision of `lsbmr_make_step` with masks: with t = m1 ^ LSB(c1),
+ * c0 is kept if LSB(c0) == m0, and c1 then changes if LSB(c0/2) != t.
+ * Otherwise c0 moves by -1 if LSB((c0 - 1)/2) == t and by +1 if not,
+ * which becomes +3 and -3 on the saturated values 0 and 255.
+ */
+size_t lsbmr_embed(
+	const uint8_t* c0,
+	const uint8_t* c1,
+	uint64_t m0,
+	uint64_t m1,
+	uint64_t random,
+	size_t n,
+	uint8_t* s0,
+	uint8_t* s1)
+{
+	size_t i = 0;
+	size_t n_saturated = 0;
+
+#if defined(KERNEL_AVX512)
+	if(n == 64){
+		const __m512i one = _mm512_set1_epi8(1);
+		const __m512i two = _mm512_set1_epi8(2);
+		const __m512i minus_one = _mm512_set1_epi8(-1);
+
+		__m512i a = _mm512_loadu_si512(c0);
+		__m512i b = _mm512_loadu_si512(c1);
+
+		__mmask64 t = m1 ^ _mm512_test_epi8_mask(b, one);
+		__mmask64 keep = ~(m0 ^ _mm512_test_epi8_mask(a, one));
+		__mmask64 change1 = keep & (t ^ _mm512_test_epi8_mask(a, two));
+		__mmask64 down = ~(t ^ _mm512_test_epi8_mask(
+				_mm512_sub_epi8(a, one), two));
+
+		__mmask64 zero0 = _mm512_cmpeq_epi8_mask(a, _mm512_setzero_si512());
+		__mmask64 full0 = _mm512_cmpeq_epi8_mask(a, minus_one);
+
+		__m512i d0 = _mm512_mask_blend_epi8(down, one, minus_one);
+		d0 = _mm512_mask_mov_epi8(d0, zero0 & down, _mm512_set1_epi8(3));
+		d0 = _mm512_mask_mov_epi8(d0, full0 & ~down, _mm512_set1_epi8(-3));
+
+		__m512i d1 = _mm512_mask_blend_epi8(random, minus_one, one);
+		d1 = _mm512_mask_mov_epi8(d1,
+			_mm512_cmpeq_epi8_mask(b, _mm512_setzero_si512()), one);
+		d1 = _mm512_mask_mov_epi8(d1,
+			_mm512_cmpeq_epi8_mask(b, minus_one), minus_one);
+
+		_mm512_storeu_si512(s0, _mm512_mask_add_epi8(a, ~keep, a, d0));
+		_mm512_storeu_si512(s1, _mm512_mask_add_epi8(b, change1, b, d1));
+
+		return __builtin_popcountll(~keep & (zero0 | full0));
+	}
+#endif
+
+#if defined(KERNEL_AVX2)
+	const __m256i one256 = _mm256_set1_epi8(1);
+	const __m256i three256 = _mm256_set1_epi8(3);
+	const __m256i ones256 = _mm256_set1_epi8(-1);
+	const __m256i zero256 = _mm256_setzero_si256();
+	for(; i + 32 <= n; i += 32){
+		__m256i a = _mm256_loadu_si256((const __m256i*)(c0 + i));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(c1 + i));
+
+		/*
+		 * the bits as 0 or 1 in each lane
+		 */
+		__m256i vm0 = _mm256_and_si256(mask_lanes256(m0 >> i), one256);
+		__m256i vm1 = _mm256_and_si256(mask_lanes256(m1 >> i), one256);
+		__m256i r = mask_lanes256(random >> i);
+
+		__m256i t = _mm256_xor_si256(vm1, _mm256_and_si256(b, one256));
+		__m256i keep = _mm256_cmpeq_epi8(_mm256_and_si256(a, one256), vm0);
+
+		__m256i h = _mm256_and_si256(_mm256_srli_epi16(a, 1), one256);
+		__m256i change1 = _mm256_andnot_si256(_mm256_cmpeq_epi8(h, t), keep);
+
+		__m256i hm = _mm256_and_si256(
+			_mm256_srli_epi16(_mm256_sub_epi8(a, one256), 1), one256);
+		__m256i down = _mm256_cmpeq_epi8(hm, t);
+
+		__m256i zero0 = _mm256_cmpeq_epi8(a, zero256);
+		__m256i full0 = _mm256_cmpeq_epi8(a, ones256);
+
+		__m256i d0 = _mm256_blendv_epi8(one256, ones256, down);
+		d0 = _mm256_blendv_epi8(d0, three256,
+			_mm256_and_si256(zero0, down));
+		d0 = _mm256_blendv_epi8(d0, _mm256_sub_epi8(zero256, three256),
+			_mm256_andnot_si256(down, full0));
+		d0 = _mm256_andnot_si256(keep, d0);
+
+		__m256i d1 = _mm256_blendv_epi8(ones256, one256, r);
+		d1 = _mm256_blendv_epi8(d1, one256, _mm256_cmpeq_epi8(b, zero256));
+		d1 = _mm256_blendv_epi8(d1, ones256, _mm256_cmpeq_epi8(b, ones256));
+		d1 = _mm256_and_si256(change1, d1);
+
+		_mm256_storeu_si256((__m256i*)(s0 + i), _mm256_add_epi8(a, d0));
+		_mm256_storeu_si256((__m256i*)(s1 + i), _mm256_add_epi8(b, d1));
+
+		uint32_t saturated = _mm256_movemask_epi8(
+			_mm256_andnot_si256(keep, _mm256_or_si256(zero0, full0)));
+		n_saturated += __builtin_popcount(saturated);
+	}
+#endif
+
+#if defined(KERNEL_SSE)
+	const __m128i one128 = _mm_set1_epi8(1);
+	const __m128i three128 = _mm_set1_epi8(3);
+	const __m128i ones128 = _mm_set1_epi8(-1);
+	const __m128i zero128 = _mm_setzero_si128();
+	for(; i + 16 <= n; i += 16){
+		__m128i a = _mm_loadu_si128((const __m128i*)(c0 + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(c1 + i));
+
+		__m128i vm0 = _mm_and_si128(mask_lanes128(m0 >> i), one128);
+		__m128i vm1 = _mm_and_si128(mask_lanes128(m1 >> i), one128);
+		__m128i r = mask_lanes128(random >> i);
+
+		__m128i t = _mm_xor_si128(vm1, _mm_and_si128(b, one128));
+		__m128i keep = _mm_cmpeq_epi8(_mm_and_si128(a, one128), vm0);
+
+		__m128i h = _mm_and_si128(_mm_srli_epi16(a, 1), one128);
+		__m128i change1 = _mm_andnot_si128(_mm_cmpeq_epi8(h, t), keep);
+
+		__m128i hm = _mm_and_si128(
+			_mm_srli_epi16(_mm_sub_epi8(a, one128), 1), one128);
+		__m128i down = _mm_cmpeq_epi8(hm, t);
+
+		__m128i zero0 = _mm_cmpeq_epi8(a, zero128);
+		__m128i full0 = _mm_cmpeq_epi8(a, ones128);
+
+		__m128i d0 = _mm_blendv_epi8(one128, ones128, down);
+		d0 = _mm_blendv_epi8(d0, three128, _mm_and_si128(zero0, down));
+		d0 = _mm_blendv_epi8(d0, _mm_sub_epi8(zero128, three128),
+			_mm_andnot_si128(down, full0));
+		d0 = _mm_andnot_si128(keep, d0);
+
+		__m128i d1 = _mm_blendv_epi8(ones128, one128, r);
+		d1 = _mm_blendv_epi8(d1, one128, _mm_cmpeq_epi8(b, zero128));
+		d1 = _mm_blendv_epi8(d1, ones128, _mm_cmpeq_epi8(b, ones128));
+		d1 = _mm_and_si128(change1, d1);
+
+		_mm_storeu_si128((__m128i*)(s0 + i), _mm_add_epi8(a, d0));
+		_mm_storeu_si128((__m128i*)(s1 + i), _mm_add_epi8(b, d1));
+
+		uint32_t saturated = _mm_movemask_epi8(
+			_mm_andnot_si128(keep, _mm_or_si128(zero0, full0)));
+		n_saturated += __builtin_popcount(saturated);
+	}
+#endif
+
+	/*
+	 * remaining pairs, by the decision table
+	 */
+	for(; i < n; i++){
+		unsigned code = ((m0 >> i) & 1) << 1 | (((m1 >> i) & 1) ^ (c1[i] & 1));
+		const stegim::lsbmr_step& step = stegim::lsbmr_steps.step[c0[i]][code];
+
+		/*
+		 * +1 or -1 by the random bit, +1 on 0 and -1 on 255
+		 */
+		int r = (int)((random >> i) & 1)*2 - 1;
+		int d1 = (c1[i] == 0) - (c1[i] == UINT8_MAX)
+			+ (c1[i] != 0 && c1[i] != UINT8_MAX)*r;
+
+		s0[i] = c0[i] + step.delta0;
+		s1[i] = c1[i] + step.change1*d1;
+		n_saturated += step.saturated;
+	}
+
+	return n_saturated;
+}
+
+uint64_t pext(uint64_t x, uint64_t mask)
+{
+#if defined(KERNEL_AVX2)
+	return _pext_u64(x, mask);
+#else
+	uint64_t r = 0;
+	for(uint64_t bb = 1; mask; bb <<= 1){
+		if(x & mask & -mask)
+			r |= bb;
+		mask &= mask - 1;
+	}
+	return r;
+#endif
+}
+
+void pack_plane16(const uint16_t* src, size_t n, int k, uint8_t* dst)
+{
+	size_t i = 0;
+
+#if defined(KERNEL_AVX512)
+	const __m512i k512 = _mm512_set1_epi16(1 << k);
+	for(; i + 64 <= n; i += 64){
+		uint64_t m = _mm512_test_epi16_mask(_mm512_loadu_si512(src + i), k512)
+			| (uint64_t) _mm512_test_epi16_mask(
+				_mm512_loadu_si512(src + i + 32), k512) << 32;
+		std::memcpy(dst + i/CHAR_BIT, &m, sizeof(m));
+	}
+#endif
+
+#if defined(KERNEL_AVX2)
+	/*
+	 * moves the bit `k` to the sign of each lane, the signed pack
+	 * keeps it in the bytes, in the order of the 128 bit halves
+	 */
+	const __m128i shift256 = _mm_cvtsi32_si128(15 - k);
+	for(; i + 32 <= n; i += 32){
+		__m256i a = _mm256_sll_epi16(
+			_mm256_loadu_si256((const __m256i*)(src + i)), shift256);
+		__m256i b = _mm256_sll_epi16(
+			_mm256_loadu_si256((const __m256i*)(src + i + 16)), shift256);
+
+		__m256i p = _mm256_permute4x64_epi64(
+			_mm256_packs_epi16(a, b), 0xd8);
+
+		uint32_t m = _mm256_movemask_epi8(p);
+		std::memcpy(dst + i/CHAR_BIT, &m, sizeof(m));
+	}
+#endif
+
+#if defined(KERNEL_SSE)
+	const __m128i shift128 = _mm_cvtsi32_si128(15 - k);
+	for(; i + 16 <= n; i += 16){
+		__m128i a = _mm_sll_epi16(
+			_mm_loadu_si128((const __m128i*)(src + i)), shift128);
+		__m128i b = _mm_sll_epi16(
+			_mm_loadu_si128((const __m128i*)(src + i + 8)), shift128);
+
+		uint16_t m = _mm_movemask_epi8(_mm_packs_epi16(a, b));
+		std::memcpy(dst + i/CHAR_BIT, &m, sizeof(m));
+	}
+#endif
+
+	for(; i < n; i += CHAR_BIT){
+		uint8_t b = 0;
+		for(size_t j = 0; j < CHAR_BIT && i + j < n; j++)
+			b |= ((src[i + j] >> k) & 1) << j;
+
+		dst[i/CHAR_BIT] = b;
+	}
+}
+
+#if defined(KERNEL_SSE)
+/*
+ * 0xffff in the 16 bit lane i if the bit i of `m` is set
+ */
+__m128i mask_lanes128_16(uint8_t m)
+{
+	const __m128i select = _mm_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128);
+
+	__m128i b = _mm_and_si128(_mm_set1_epi16(m), select);
+	return _mm_cmpeq_epi16(b, select);
+}
+#endif
+
+#if defined(KERNEL_AVX2)
+__m256i mask_lanes256_16(uint16_t m)
+{
+	const __m256i select = _mm256_setr_epi16(
+			1, 2, 4, 8, 16, 32, 64, 128,
+			256, 512, 1024, 2048, 4096, 8192, 16384, -32768);
+
+	__m256i b = _mm256_and_si256(_mm256_set1_epi16(m), select);
+	return _mm256_cmpeq_epi16(b, select);
+}
+#endif
+
+void unpack_plane16(
+	const uint8_t* bits,
+	size_t n,
+	int k,
+	const uint16_t* src,
+	uint16_t* dst)
+{
+	size_t i = 0;
+	const uint16_t bit_k = 1 << k;
+
+#if defined(KERNEL_AVX512)
+	const __m512i k512 = _mm512_set1_epi16(bit_k);
+	const __m512i clear512 = _mm512_set1_epi16((uint16_t) ~bit_k);
+	for(; i + 32 <= n; i += 32){
+		uint32_t m;
+		std::memcpy(&m, bits + i/CHAR_BIT, sizeof(m));
+
+		__m512i v = _mm512_and_si512(clear512,
+				_mm512_loadu_si512(src + i));
+
+		v = _mm512_mask_blend_epi16(m, v, _mm512_or_si512(v, k512));
+		_mm512_storeu_si512(dst + i, v);
+	}
+#endif
+
+#if defined(KERNEL_AVX2)
+	const __m256i k256 = _mm256_set1_epi16(bit_k);
+	for(; i + 16 <= n; i += 16){
+		uint16_t m;
+		std::memcpy(&m, bits + i/CHAR_BIT, sizeof(m));
+
+		__m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+		v = _mm256_or_si256(
+			_mm256_andnot_si256(k256, v),
+			_mm256_and_si256(mask_lanes256_16(m), k256));
+		_mm256_storeu_si256((__m256i*)(dst + i), v);
+	}
+#endif
+
+#if defined(KERNEL_SSE)
+	const __m128i k128 = _mm_set1_epi16(bit_k);
+	for(; i + 8 <= n; i += 8){
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+		v = _mm_or_si128(
+			_mm_andnot_si128(k128, v),
+			_mm_and_si128(mask_lanes128_16(bits[i/CHAR_BIT]), k128));
+		_mm_storeu_si128((__m128i*)(dst + i), v);
+	}
+#endif
+
+	for(; i < n; i++){
+		int x = (bits[i/CHAR_BIT] >> (i%CHAR_BIT)) & 1;
+		dst[i] = (src[i] & ~bit_k) | (x << k);
+	}
+}
+
+/*
+ * `lsbmr_embed` in lanes of 16 bits, with the same masks
+ */
+size_t lsbmr_embed16(
+	const uint16_t* c0,
+	const uint16_t* c1,
+	uint64_t m0,
+	uint64_t m1,
+	uint64_t random,
+	size_t n,
+	uint16_t* s0,
+	uint16_t* s1)
+{
+	size_t i = 0;
+	size_t n_saturated = 0;
+
+#if defined(KERNEL_AVX512)
+	const __m512i one512 = _mm512_set1_epi16(1);
+	const __m512i two512 = _mm512_set1_epi16(2);
+	const __m512i minus_one512 = _mm512_set1_epi16(-1);
+	for(; i + 32 <= n; i += 32){
+		__m512i a = _mm512_loadu_si512(c0 + i);
+		__m512i b = _mm512_loadu_si512(c1 + i);
+
+		__mmask32 t = (m1 >> i) ^ _mm512_test_epi16_mask(b, one512);
+		__mmask32 keep = ~((m0 >> i) ^ _mm512_test_epi16_mask(a, one512));
+		__mmask32 change1 = keep & (t ^ _mm512_test_epi16_mask(a, two512));
+		__mmask32 down = ~(t ^ _mm512_test_epi16_mask(
+				_mm512_sub_epi16(a, one512), two512));
+
+		__mmask32 zero0 = _mm512_cmpeq_epi16_mask(a, _mm512_setzero_si512());
+		__mmask32 full0 = _mm512_cmpeq_epi16_mask(a, minus_one512);
+
+		__m512i d0 = _mm512_mask_blend_epi16(down, one512, minus_one512);
+		d0 = _mm512_mask_mov_epi16(d0, zero0 & down, _mm512_set1_epi16(3));
+		d0 = _mm512_mask_mov_epi16(d0, full0 & ~down, _mm512_set1_epi16(-3));
+
+		__m512i d1 = _mm512_mask_blend_epi16(random >> i, minus_one512, one512);
+		d1 = _mm512_mask_mov_epi16(d1,
+			_mm512_cmpeq_epi16_mask(b, _mm512_setzero_si512()), one512);
+		d1 = _mm512_mask_mov_epi16(d1,
+			_mm512_cmpeq_epi16_mask(b, minus_one512), minus_one512);
+
+		_mm512_storeu_si512(s0 + i, _mm512_mask_add_epi16(a, ~keep, a, d0));
+		_mm512_storeu_si512(s1 + i, _mm512_mask_add_epi16(b, change1, b, d1));
+
+		n_saturated += __builtin_popcount((uint32_t)(~keep & (zero0 | full0)));
+	}
+#endif
+
+#if defined(KERNEL_AVX2)
+	const __m256i one256 = _mm256_set1_epi16(1);
+	const __m256i three256 = _mm256_set1_epi16(3);
+	const __m256i ones256 = _mm256_set1_epi16(-1);
+	const __m256i zero256 = _mm256_setzero_si256();
+	for(; i + 16 <= n; i += 16){
+		__m256i a = _mm256_loadu_si256((const __m256i*)(c0 + i));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(c1 + i));
+
+		__m256i vm0 = _mm256_and_si256(mask_lanes256_16(m0 >> i), one256);
+		__m256i vm1 = _mm256_and_si256(mask_lanes256_16(m1 >> i), one256);
+		__m256i r = mask_lanes256_16(random >> i);
+
+		__m256i t = _mm256_xor_si256(vm1, _mm256_and_si256(b, one256));
+		__m256i keep = _mm256_cmpeq_epi16(_mm256_and_si256(a, one256), vm0);
+
+		__m256i h = _mm256_and_si256(_mm256_srli_epi16(a, 1), one256);
+		__m256i change1 = _mm256_andnot_si256(_mm256_cmpeq_epi16(h, t), keep);
+
+		__m256i hm = _mm256_and_si256(
+			_mm256_srli_epi16(_mm256_sub_epi16(a, one256), 1), one256);
+		__m256i down = _mm256_cmpeq_epi16(hm, t);
+
+		__m256i zero0 = _mm256_cmpeq_epi16(a, zero256);
+		__m256i full0 = _mm256_cmpeq_epi16(a, ones256);
+
+		__m256i d0 = _mm256_blendv_epi8(one256, ones256, down);
+		d0 = _mm256_blendv_epi8(d0, three256,
+			_mm256_and_si256(zero0, down));
+		d0 = _mm256_blendv_epi8(d0, _mm256_sub_epi16(zero256, three256),
+			_mm256_andnot_si256(down, full0));
+		d0 = _mm256_andnot_si256(keep, d0);
+
+		__m256i d1 = _mm256_blendv_epi8(ones256, one256, r);
+		d1 = _mm256_blendv_epi8(d1, one256, _mm256_cmpeq_epi16(b, zero256));
+		d1 = _mm256_blendv_epi8(d1, ones256, _mm256_cmpeq_epi16(b, ones256));
+		d1 = _mm256_and_si256(change1, d1);
+
+		_mm256_storeu_si256((__m256i*)(s0 + i), _mm256_add_epi16(a, d0));
+		_mm256_storeu_si256((__m256i*)(s1 + i), _mm256_add_epi16(b, d1));
+
+		/*
+		 * two bits of the byte mask for each lane
+		 */
+		uint32_t saturated = _mm256_movemask_epi8(
+			_mm256_andnot_si256(keep, _mm256_or_si256(zero0, full0)));
+		n_saturated += __builtin_popcount(saturated)/2;
+	}
+#endif
+
+#if defined(KERNEL_SSE)
+	const __m128i one128 = _mm_set1_epi16(1);
+	const __m128i three128 = _mm_set1_epi16(3);
+	const __m128i ones128 = _mm_set1_epi16(-1);
+	const __m128i zero128 = _mm_setzero_si128();
+	for(; i + 8 <= n; i += 8){
+		__m128i a = _mm_loadu_si128((const __m128i*)(c0 + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(c1 + i));
+
+		__m128i vm0 = _mm_and_si128(mask_lanes128_16(m0 >> i), one128);
+		__m128i vm1 = _mm_and_si128(mask_lanes128_16(m1 >> i), one128);
+		__m128i r = mask_lanes128_16(random >> i);
+
+		__m128i t = _mm_xor_si128(vm1, _mm_and_si128(b, one128));
+		__m128i keep = _mm_cmpeq_epi16(_mm_and_si128(a, one128), vm0);
+
+		__m128i h = _mm_and_si128(_mm_srli_epi16(a, 1), one128);
+		__m128i change1 = _mm_andnot_si128(_mm_cmpeq_epi16(h, t), keep);
+
+		__m128i hm = _mm_and_si128(
+			_mm_srli_epi16(_mm_sub_epi16(a, one128), 1), one128);
+		__m128i down = _mm_cmpeq_epi16(hm, t);
+
+		__m128i zero0 = _mm_cmpeq_epi16(a, zero128);
+		__m128i full0 = _mm_cmpeq_epi16(a, ones128);
+
+		__m128i d0 = _mm_blendv_epi8(one128, ones128, down);
+		d0 = _mm_blendv_epi8(d0, three128, _mm_and_si128(zero0, down));
+		d0 = _mm_blendv_epi8(d0, _mm_sub_epi16(zero128, three128),
+			_mm_andnot_si128(down, full0));
+		d0 = _mm_andnot_si128(keep, d0);
+
+		__m128i d1 = _mm_blendv_epi8(ones128, one128, r);
+		d1 = _mm_blendv_epi8(d1, one128, _mm_cmpeq_epi16(b, zero128));
+		d1 = _mm_blendv_epi8(d1, ones128, _mm_cmpeq_epi16(b, ones128));
+		d1 = _mm_and_si128(change1, d1);
+
+		_mm_storeu_si128((__m128i*)(s0 + i), _mm_add_epi16(a, d0));
+		_mm_storeu_si128((__m128i*)(s1 + i), _mm_add_epi16(b, d1));
+
+		uint32_t saturated = _mm_movemask_epi8(
+			_mm_andnot_si128(keep, _mm_or_si128(zero0, full0)));
+		n_saturated += __builtin_popcount(saturated)/2;
+	}
+#endif
+
+	/*
+	 * remaining pairs, the decision of `lsbmr_make_step_max`
+	 * written out, as the 65536 values of c0 have no table
+	 */
+	for(; i < n; i++){
+		unsigned a = c0[i], b = c1[i];
+		unsigned t = ((m1 >> i) & 1) ^ (b & 1);
+		int d0 = 0, d1 = 0;
+
+		if((a & 1) == ((m0 >> i) & 1)){
+			int r = (int)((random >> i) & 1)*2 - 1;
+
+			if(((a >> 1) & 1) != t)
+				d1 = b == 0 ? 1 : b == UINT16_MAX ? -1 : r;
+		}else{
+			bool down = ((((a - 1) & UINT16_MAX) >> 1) & 1) == t;
+
+			d0 = down ? -1 : 1;
+			if(a == 0 && down)
+				d0 = 3;
+			if(a == UINT16_MAX && !down)
+				d0 = -3;
+
+			n_saturated += a == 0 || a == UINT16_MAX;
+		}
+
+		s0[i] = a + d0;
+		s1[i] = b + d1;
+	}
+
+	return n_saturated;
+}
+
+#if defined(KERNEL_SSE) && defined(__x86_64__)
+/*
+ * the CRC32C register shifted by a run of zero bytes, a linear map
+ * kept as the images of its 32 bits
+ */
+struct crc32c_shift {
+	uint32_t column[32];
+
+	crc32c_shift(size_t n_bytes)
+	{
+		for(int b = 0; b < 32; b++){
+			uint64_t crc = (uint32_t) 1 << b;
+			for(size_t i = 0; i < n_bytes; i += sizeof(uint64_t))
+				crc = _mm_crc32_u64(crc, 0);
+
+			column[b] = crc;
+		}
+	}
+
+	uint32_t operator()(uint32_t crc) const
+	{
+		uint32_t r = 0;
+		for(int b = 0; b < 32; b++)
+			r ^= column[b] & -((crc >> b) & 1);
+
+		return r;
+	}
+};
+
+/*
+ * bytes of each of the three streams of `crc32c`
+ */
+#define CRC32C_STREAM 1024
+#endif
+
+#if !defined(KERNEL_SSE)
+/*
+ * the CRC32C of each byte, reflected polynomial 0x82f63b78
+ */
+struct crc32c_table_t {
+	uint32_t v[256];
+};
+
+constexpr crc32c_table_t make_crc32c_table()
+{
+	crc32c_table_t t = {};
+	for(uint32_t i = 0; i < 256; i++){
+		uint32_t crc = i;
+		for(int b = 0; b < CHAR_BIT; b++)
+			crc = (crc >> 1) ^ (0x82f63b78u & -(crc & 1));
+
+		t.v[i] = crc;
+	}
+
+	return t;
+}
+
+constexpr crc32c_table_t crc32c_table = make_crc32c_table();
+#endif
+
+uint32_t crc32c(uint32_t crc, const uint8_t* p, size_t n)
+{
+	size_t i = 0;
+
+#if defined(KERNEL_SSE) && defined(__x86_64__)
+	/*
+	 * the crc32 instruction has a latency of three cycles, three
+	 * independent streams keep it busy. The register is linear in
+	 * its state, so the streams are joined by shifting the first
+	 * ones over the bytes of the next.
+	 */
+	static const crc32c_shift shift1(CRC32C_STREAM);
+	static const crc32c_shift shift2(2*CRC32C_STREAM);
+
+	for(; i + 3*CRC32C_STREAM <= n; i += 3*CRC32C_STREAM){
+		uint64_t a = crc, b = 0, c = 0;
+		const uint8_t* q = p + i;
+
+		for(size_t j = 0; j < CRC32C_STREAM; j += sizeof(uint64_t)){
+			uint64_t wa, wb, wc;
+			std::memcpy(&wa, q + j, sizeof(wa));
+			std::memcpy(&wb, q + CRC32C_STREAM + j, sizeof(wb));
+			std::memcpy(&wc, q + 2*CRC32C_STREAM + j, sizeof(wc));
+
+			a = _mm_crc32_u64(a, wa);
+			b = _mm_crc32_u64(b, wb);
+			c = _mm_crc32_u64(c, wc);
+		}
+
+		crc = shift2(a) ^ shift1(b) ^ c;
+	}
+
+	uint64_t c = crc;
+	for(; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)){
+		uint64_t w;
+		std::memcpy(&w, p + i, sizeof(w));
+		c = _mm_crc32_u64(c, w);
+	}
+
+	crc = c;
+#endif
+
+#if defined(KERNEL_SSE)
+	for(; i < n; i++)
+		crc = _mm_crc32_u8(crc, p[i]);
+#else
+	for(; i < n; i++)
+		crc = (crc >> 8) ^ crc32c_table.v[(crc ^ p[i]) & 0xff];
+#endif
+
+	return crc;
+}
+
+/*
+ * the GF(2^8) product of `x` by the constant of the nibble tables `t`
+ */
+uint8_t gf_mul(uint8_t x, const uint8_t* t)
+{
+	return t[x & 0x0f] ^ t[16 + (x >> 4)];
+}
+
+#if defined(KERNEL_SSE)
+/*
+ * the same in each byte, the tables are looked up by pshufb
+ */
+__m128i gf_mul128(__m128i x, const uint8_t* t)
+{
+	const __m128i low = _mm_set1_epi8(0x0f);
+
+	__m128i lo = _mm_shuffle_epi8(
+		_mm_loadu_si128((const __m128i*) t),
+		_mm_and_si128(x, low));
+	__m128i hi = _mm_shuffle_epi8(
+		_mm_loadu_si128((const __m128i*)(t + 16)),
+		_mm_and_si128(_mm_srli_epi16(x, 4), low));
+
+	return _mm_xor_si128(lo, hi);
+}
+#endif
+
+#if defined(KERNEL_AVX2)
+__m256i gf_mul256(__m256i x, const uint8_t* t)
+{
+	const __m256i low = _mm256_set1_epi8(0x0f);
+
+	__m256i lo = _mm256_shuffle_epi8(
+		_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) t)),
+		_mm256_and_si256(x, low));
+	__m256i hi = _mm256_shuffle_epi8(
+		_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(t + 16))),
+		_mm256_and_si256(_mm256_srli_epi16(x, 4), low));
+
+	return _mm256_xor_si256(lo, hi);
+}
+#endif
+
+#if defined(KERNEL_AVX512)
+/*
+ * the broadcast is written with a full zero mask, the unmasked
+ * intrinsic leaves the undefined source to GCC, which warns about it
+ * once inlined. Both give the same instruction.
+ */
+__m512i gf_broadcast512(const uint8_t* t)
+{
+	return _mm512_maskz_broadcast_i32x4((__mmask16) -1,
+		_mm_loadu_si128((const __m128i*) t));
+}
+
+__m512i gf_mul512(__m512i x, const uint8_t* t)
+{
+	const __m512i low = _mm512_set1_epi8(0x0f);
+
+	__m512i lo = _mm512_shuffle_epi8(
+		gf_broadcast512(t),
+		_mm512_and_si512(x, low));
+	__m512i hi = _mm512_shuffle_epi8(
+		gf_broadcast512(t + 16),
+		_mm512_and_si512(_mm512_srli_epi16(x, 4), low));
+
+	return _mm512_xor_si512(lo, hi);
+}
+#endif
+
+/*
+ * the division by the generator of the codewords in a lane of each
+ * width, the remainder r[i] is the coefficient of degree i
+ */
+void rs_encode(
+	const uint8_t* data,
+	size_t k,
+	size_t n_lanes,
+	const uint8_t* tables,
+	size_t n_parity,
+	uint8_t* parity)
+{
+	size_t c = 0;
+
+#if defined(KERNEL_AVX512)
+	for(; c + 64 <= n_lanes; c += 64){
+		__m512i r[RS_MAX_PARITY];
+		for(size_t i = 0; i < n_parity; i++)
+			r[i] = _mm512_setzero_si512();
+
+		for(size_t t = 0; t < k; t++){
+			__m512i f = _mm512_xor_si512(
+				_mm512_loadu_si512(data + t*n_lanes + c),
+				r[n_parity - 1]);
+
+			for(size_t i = n_parity - 1; i > 0; i--)
+				r[i] = _mm512_xor_si512(r[i - 1],
+					gf_mul512(f, tables + 32*i));
+			r[0] = gf_mul512(f, tables);
+		}
+
+		for(size_t p = 0; p < n_parity; p++)
+			_mm512_storeu_si512(parity + p*n_lanes + c, r[n_parity - 1 - p]);
+	}
+#endif
+
+#if defined(KERNEL_AVX2)
+	for(; c + 32 <= n_lanes; c += 32){
+		__m256i r[RS_MAX_PARITY];
+		for(size_t i = 0; i < n_parity; i++)
+			r[i] = _mm256_setzero_si256();
+
+		for(size_t t = 0; t < k; t++){
+			__m256i f = _mm256_xor_si256(
+				_mm256_loadu_si256((const __m256i*)(data + t*n_lanes + c)),
+				r[n_parity - 1]);
+
+			for(size_t i = n_parity - 1; i > 0; i--)
+				r[i] = _mm256_xor_si256(r[i - 1],
+					gf_mul256(f, tables + 32*i));
+			r[0] = gf_mul256(f, tables);
+		}
+
+		for(size_t p = 0; p < n_parity; p++)
+			_mm256_storeu_si256((__m256i*)(parity + p*n_lanes + c),
+				r[n_parity - 1 - p]);
+	}
+#endif
+
+#if defined(KERNEL_SSE)
+	for(; c + 16 <= n_lanes; c += 16){
+		__m128i r[RS_MAX_PARITY];
+		for(size_t i = 0; i < n_parity; i++)
+			r[i] = _mm_setzero_si128();
+
+		for(size_t t = 0; t < k; t++){
+			__m128i f = _mm_xor_si128(
+				_mm_loadu_si128((const __m128i*)(data + t*n_lanes + c)),
+				r[n_parity - 1]);
+
+			for(size_t i = n_parity - 1; i > 0; i--)
+				r[i] = _mm_xor_si128(r[i - 1], gf_mul128(f, tables + 32*i));
+			r[0] = gf_mul128(f, tables);
+		}
+
+		for(size_t p = 0; p < n_parity; p++)
+			_mm_storeu_si128((__m128i*)(parity + p*n_lanes + c),
+				r[n_parity - 1 - p]);
+	}
+#endif
+
+	for(; c < n_lanes; c++){
+		uint8_t r[RS_MAX_PARITY] = {};
+
+		for(size_t t = 0; t < k; t++){
+			uint8_t f = data[t*n_lanes + c] ^ r[n_parity - 1];
+
+			for(size_t i = n_parity - 1; i > 0; i--)
+				r[i] = r[i - 1] ^ gf_mul(f, tables + 32*i);
+			r[0] = gf_mul(f, tables);
+		}
+
+		for(size_t p = 0; p < n_parity; p++)
+			parity[p*n_lanes + c] = r[n_parity - 1 - p];
+	}
+}
+
+/*
+ * the codewords evaluated at each power by Horner's rule, the first
+ * byte has the highest degree
+ */
+void rs_syndromes(
+	const uint8_t* code,
+	size_t n,
+	size_t n_lanes,
+	const uint8_t* tables,
+	size_t n_syndromes,
+	uint8_t* syndromes)
+{
+	size_t c = 0;
+
+#if defined(KERNEL_AVX512)
+	for(; c + 64 <= n_lanes; c += 64){
+		__m512i s[RS_MAX_PARITY];
+		for(size_t j = 0; j < n_syndromes; j++)
+			s[j] = _mm512_setzero_si512();
+
+		for(size_t t = 0; t < n; t++){
+			__m512i x = _mm512_loadu_si512(code + t*n_lanes + c);
+
+			for(size_t j = 0; j < n_syndromes; j++)
+				s[j] = _mm512_xor_si512(gf_mul512(s[j], tables + 32*j), x);
+		}
+
+		for(size_t j = 0; j < n_syndromes; j++)
+			_mm512_storeu_si512(syndromes + j*n_lanes + c, s[j]);
+	}
+#endif
+
+#if defined(KERNEL_AVX2)
+	for(; c + 32 <= n_lanes; c += 32){
+		__m256i s[RS_MAX_PARITY];
+		for(size_t j = 0; j < n_syndromes; j++)
+			s[j] = _mm256_setzero_si256();
+
+		for(size_t t = 0; t < n; t++){
+			__m256i x = _mm256_loadu_si256(
+				(const __m256i*)(code + t*n_lanes + c));
+
+			for(size_t j = 0; j < n_syndromes; j++)
+				s[j] = _mm256_xor_si256(gf_mul256(s[j], tables + 32*j), x);
+		}
+
+		for(size_t j = 0; j < n_syndromes; j++)
+			_mm256_storeu_si256((__m256i*)(syndromes + j*n_lanes + c), s[j]);
+	}
+#endif
+
+#if defined(KERNEL_SSE)
+	for(; c + 16 <= n_lanes; c += 16){
+		__m128i s[RS_MAX_PARITY];
+		for(size_t j = 0; j < n_syndromes; j++)
+			s[j] = _mm_setzero_si128();
+
+		for(size_t t = 0; t < n; t++){
+			__m128i x = _mm_loadu_si128((const __m128i*)(code + t*n_lanes + c));
+
+			for(size_t j = 0; j < n_syndromes; j++)
+				s[j] = _mm_xor_si128(gf_mul128(s[j], tables + 32*j), x);
+		}
+
+		for(size_t j = 0; j < n_syndromes; j++)
+			_mm_storeu_si128((__m128i*)(syndromes + j*n_lanes + c), s[j]);
+	}
+#endif
+
+	for(; c < n_lanes; c++){
+		uint8_t s[RS_MAX_PARITY] = {};
+
+		for(size_t t = 0; t < n; t++)
+			for(size_t j = 0; j < n_syndromes; j++)
+				s[j] = gf_mul(s[j], tables + 32*j) ^ code[t*n_lanes + c];
+
+		for(size_t j = 0; j < n_syndromes; j++)
+			syndromes[j*n_lanes + c] = s[j];
+	}
+}
+
+/*
+ * the quarter round of ChaCha20 on the words `a`, `b`, `c` and `d`,
+ * with the operations ADD, XOR and ROTL of a width
+ */
+#define CHACHA20_QUARTER(ADD, XOR, ROTL, a, b, c, d) \
+	a = ADD(a, b); d = ROTL(XOR(d, a), 16); \
+	c = ADD(c, d); b = ROTL(XOR(b, c), 12); \
+	a = ADD(a, b); d = ROTL(XOR(d, a), 8); \
+	c = ADD(c, d); b = ROTL(XOR(b, c), 7)
+
+/*
+ * a column round and a diagonal round of the 16 words `x`
+ */
+#define CHACHA20_DOUBLE_ROUND(ADD, XOR, ROTL, x) \
+	CHACHA20_QUARTER(ADD, XOR, ROTL, x[0], x[4], x[8], x[12]); \
+	CHACHA20_QUARTER(ADD, XOR, ROTL, x[1], x[5], x[9], x[13]); \
+	CHACHA20_QUARTER(ADD, XOR, ROTL, x[2], x[6], x[10], x[14]); \
+	CHACHA20_QUARTER(ADD, XOR, ROTL, x[3], x[7], x[11], x[15]); \
+	CHACHA20_QUARTER(ADD, XOR, ROTL, x[0], x[5], x[10], x[15]); \
+	CHACHA20_QUARTER(ADD, XOR, ROTL, x[1], x[6], x[11], x[12]); \
+	CHACHA20_QUARTER(ADD, XOR, ROTL, x[2], x[7], x[8], x[13]); \
+	CHACHA20_QUARTER(ADD, XOR, ROTL, x[3], x[4], x[9], x[14])
+
+#define CHACHA20_ADD32(a, b) ((uint32_t)((a) + (b)))
+#define CHACHA20_XOR32(a, b) ((a) ^ (b))
+#define CHACHA20_ROTL32(a, k) ((uint32_t)((a) << (k) | (a) >> (32 - (k))))
+
+#if defined(KERNEL_SSE)
+/*
+ * the rotations by 16 and 8 move whole bytes, pshufb does them in one
+ * instruction
+ */
+__m128i chacha20_rotl128(__m128i x, int k)
+{
+	if(k == 16)
+		return _mm_shuffle_epi8(x, _mm_setr_epi8(
+			2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+	if(k == 8)
+		return _mm_shuffle_epi8(x, _mm_setr_epi8(
+			3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14));
+
+	return _mm_or_si128(_mm_slli_epi32(x, k), _mm_srli_epi32(x, 32 - k));
+}
+
+/*
+ * writes the blocks of the `n_lanes` lanes of `x`, the word i of the
+ * lane b in `x`[i*`n_lanes` + b], transposing 4x4 words at a time
+ */
+void chacha20_store(const uint32_t* x, size_t n_lanes, uint8_t* out)
+{
+	for(size_t b = 0; b < n_lanes; b += 4){
+		for(size_t i = 0; i < 16; i += 4){
+			__m128i r0 = _mm_loadu_si128((const __m128i*)(x + i*n_lanes + b));
+			__m128i r1 = _mm_loadu_si128((const __m128i*)(x + (i + 1)*n_lanes + b));
+			__m128i r2 = _mm_loadu_si128((const __m128i*)(x + (i + 2)*n_lanes + b));
+			__m128i r3 = _mm_loadu_si128((const __m128i*)(x + (i + 3)*n_lanes + b));
+
+			__m128i t0 = _mm_unpacklo_epi32(r0, r1);
+			__m128i t1 = _mm_unpacklo_epi32(r2, r3);
+			__m128i t2 = _mm_unpackhi_epi32(r0, r1);
+			__m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+			uint8_t* o = out + b*CHACHA20_BLOCK + 4*i;
+			_mm_storeu_si128((__m128i*) o, _mm_unpacklo_epi64(t0, t1));
+			_mm_storeu_si128((__m128i*)(o + CHACHA20_BLOCK),
+				_mm_unpackhi_epi64(t0, t1));
+			_mm_storeu_si128((__m128i*)(o + 2*CHACHA20_BLOCK),
+				_mm_unpacklo_epi64(t2, t3));
+			_mm_storeu_si128((__m128i*)(o + 3*CHACHA20_BLOCK),
+				_mm_unpackhi_epi64(t2, t3));
+		}
+	}
+}
+#endif
+
+#if defined(KERNEL_AVX512)
+/*
+ * the rotation with a full zero mask, as gf_broadcast512
+ */
+#define CHACHA20_ROTL512(x, k) _mm512_maskz_rol_epi32((__mmask16) -1, x, k)
+#endif
+
+#if defined(KERNEL_AVX2)
+__m256i chacha20_rotl256(__m256i x, int k)
+{
+	if(k == 16)
+		return _mm256_shuffle_epi8(x, _mm256_setr_epi8(
+			2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+			2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+	if(k == 8)
+		return _mm256_shuffle_epi8(x, _mm256_setr_epi8(
+			3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+			3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14));
+
+	return _mm256_or_si256(_mm256_slli_epi32(x, k), _mm256_srli_epi32(x, 32 - k));
+}
+#endif
+
+/*
+ * the blocks are computed in the lanes of each width, one block per
+ * 32 bit lane, and transposed to the output
+ */
+void chacha20(const uint32_t* state, size_t n_blocks, uint8_t* out)
+{
+	size_t k = 0;
+	uint32_t counter = state[12];
+
+#if defined(KERNEL_AVX512)
+	for(; k + 16 <= n_blocks; k += 16){
+		__m512i x[16], s[16];
+		for(int i = 0; i < 16; i++)
+			s[i] = _mm512_set1_epi32(state[i]);
+		s[12] = _mm512_add_epi32(_mm512_set1_epi32(counter + k),
+			_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7,
+				8, 9, 10, 11, 12, 13, 14, 15));
+
+		for(int i = 0; i < 16; i++)
+			x[i] = s[i];
+
+		for(int r = 0; r < 10; r++){
+			CHACHA20_DOUBLE_ROUND(_mm512_add_epi32, _mm512_xor_si512,
+				CHACHA20_ROTL512, x);
+		}
+
+		alignas(64) uint32_t words[16*16];
+		for(int i = 0; i < 16; i++)
+			_mm512_store_si512(words + 16*i, _mm512_add_epi32(x[i], s[i]));
+
+		chacha20_store(words, 16, out + k*CHACHA20_BLOCK);
+	}
+#endif
+
+#if defined(KERNEL_AVX2)
+	for(; k + 8 <= n_blocks; k += 8){
+		__m256i x[16], s[16];
+		for(int i = 0; i < 16; i++)
+			s[i] = _mm256_set1_epi32(state[i]);
+		s[12] = _mm256_add_epi32(_mm256_set1_epi32(counter + k),
+			_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+		for(int i = 0; i < 16; i++)
+			x[i] = s[i];
+
+		for(int r = 0; r < 10; r++){
+			CHACHA20_DOUBLE_ROUND(_mm256_add_epi32, _mm256_xor_si256,
+				chacha20_rotl256, x);
+		}
+
+		alignas(32) uint32_t words[16*8];
+		for(int i = 0; i < 16; i++)
+			_mm256_store_si256((__m256i*)(words + 8*i),
+				_mm256_add_epi32(x[i], s[i]));
+
+		chacha20_store(words, 8, out + k*CHACHA20_BLOCK);
+	}
+#endif
+
+#if defined(KERNEL_SSE)
+	for(; k + 4 <= n_blocks; k += 4){
+		__m128i x[16], s[16];
+		for(int i = 0; i < 16; i++)
+			s[i] = _mm_set1_epi32(state[i]);
+		s[12] = _mm_add_epi32(_mm_set1_epi32(counter + k),
+			_mm_setr_epi32(0, 1, 2, 3));
+
+		for(int i = 0; i < 16; i++)
+			x[i] = s[i];
+
+		for(int r = 0; r < 10; r++){
+			CHACHA20_DOUBLE_ROUND(_mm_add_epi32, _mm_xor_si128,
+				chacha20_rotl128, x);
+		}
+
+		alignas(16) uint32_t words[16*4];
+		for(int i = 0; i < 16; i++)
+			_mm_store_si128((__m128i*)(words + 4*i), _mm_add_epi32(x[i], s[i]));
+
+		chacha20_store(words, 4, out + k*CHACHA20_BLOCK);
+	}
+#endif
+
+	for(; k < n_blocks; k++){
+		uint32_t x[16], s[16];
+		std::memcpy(s, state, sizeof(s));
+		s[12] = counter + k;
+		std::memcpy(x, s, sizeof(x));
+
+		for(int r = 0; r < 10; r++){
+			CHACHA20_DOUBLE_ROUND(CHACHA20_ADD32, CHACHA20_XOR32,
+				CHACHA20_ROTL32, x);
+		}
+
+		/*
+		 * the words are serialized in little endian
+		 */
+		uint8_t* o = out + k*CHACHA20_BLOCK;
+		for(int i = 0; i < 16; i++){
+			uint32_t w = x[i] + s[i];
+			o[4*i] = w;
+			o[4*i + 1] = w >> 8;
+			o[4*i + 2] = w >> 16;
+			o[4*i + 3] = w >> 24;
+		}
+	}
+}
+
+/*
+ * end of KERNEL_NAMESPACE
+ */
+}
+
+const kernel_table* KERNEL_TABLE()
+{
+	static const kernel_table table = {
+		KERNEL_NAME,
+		KERNEL_NAMESPACE::pack_plane,
+		KERNEL_NAMESPACE::unpack_plane,
+		KERNEL_NAMESPACE::absdiff,
+		KERNEL_NAMESPACE::threshold_mask,
+		KERNEL_NAMESPACE::pair_histogram,
+		KERNEL_NAMESPACE::lsbmr_embed,
+		KERNEL_NAMESPACE::pext,
+		KERNEL_NAMESPACE::pack_plane16,
+		KERNEL_NAMESPACE::unpack_plane16,
+		KERNEL_NAMESPACE::lsbmr_embed16,
+		KERNEL_NAMESPACE::crc32c,
+		KERNEL_NAMESPACE::rs_encode,
+		KERNEL_NAMESPACE::rs_syndromes,
+		KERNEL_NAMESPACE::chacha20
+	};
+
+	return &table;
+}
+
+#else
+
+const kernel_table* KERNEL_TABLE()
+{
+	return nullptr;
+}
+
+#endif
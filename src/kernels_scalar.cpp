@@ -0,0 +1,9 @@
+/*
+ * kernels in plain c++, for any cpu
+ */
+#define KERNEL_LEVEL 0
+#define KERNEL_NAME "scalar"
+#define KERNEL_NAMESPACE scalar_kernels_impl
+#define KERNEL_TABLE scalar_kernels
+
+#include "kernels_impl.hpp"
@@ -0,0 +1,9 @@
+/*
+ * kernels for sse4.2, built with -msse4.2 -mpopcnt
+ */
+#define KERNEL_LEVEL 1
+#define KERNEL_NAME "sse42"
+#define KERNEL_NAMESPACE sse42_kernels_impl
+#define KERNEL_TABLE sse42_kernels
+
+#include "kernels_impl.hpp"
@@ -0,0 +1,259 @@
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include <cassert>
+#include <cstdint>
+
+#include "feistel.hpp"
+#include "key_trial.hpp"
+#include "keystream.hpp"
+#include "lsb_matching_kernel.hpp"
+#include "parallel.hpp"
+
+typedef std::pair<cv::Point2i, cv::Point2i> lsbm_pair;
+
+/*
+ * how the trial of a key ended
+ */
+enum trial_outcome {
+	TRIAL_HEADER,
+	TRIAL_FRAME,
+	TRIAL_MATCH
+};
+
+/*
+ * writes in `frame` the bytes [`begin`, `end`) embedded in `stego`,
+ * whose samples are of type `T`, in the pairs given by `pair_at`,
+ * decrypted by `cipher` if not null
+ */
+template<typename T, typename PAIR>
+void trial_extract(
+	const cv::Mat& stego,
+	const PAIR& pair_at,
+	keystream* cipher,
+	size_t begin,
+	size_t end,
+	std::vector<char>& frame)
+{
+	for(size_t b = begin; b < end; b++){
+		uchar byte = 0;
+		for(size_t bit = 0; bit < CHAR_BIT; bit += 2){
+			lsbm_pair p = pair_at((b*CHAR_BIT + bit)/2);
+			byte = lsbm_extract_pixel_little_endian(
+				byte,
+				stego.ptr<T>(p.first.x)[p.first.y],
+				stego.ptr<T>(p.second.x)[p.second.y],
+				bit);
+		}
+
+		if(cipher)
+			byte ^= cipher->byte(b);
+
+		frame[b] = byte;
+	}
+}
+
+/*
+ * reads the head of the frame in the pairs given by `pair_at`, the
+ * header or the head of a compressed frame, and the rest of the frame
+ * only if the head is intact and its size fits in `stego`
+ */
+template<typename T, typename PAIR>
+trial_outcome trial_frame(
+	const cv::Mat& stego,
+	const PAIR& pair_at,
+	keystream* cipher,
+	const stegim::frame_options& frame_opt,
+	std::vector<char>& data)
+{
+	size_t capacity = stegim::lsb_matching_capacity(stego);
+
+	size_t head = stegim::frame_head_size(frame_opt);
+	if(!head)
+		head = stegim::frame_header_size;
+
+	if(head > capacity)
+		return TRIAL_HEADER;
+
+	std::vector<char> frame(head);
+	trial_extract<T>(stego, pair_at, cipher, 0, head, frame);
+
+	size_t size = stegim::frame_data_size(frame, frame_opt);
+	if(size == SIZE_MAX || size > UINT32_MAX)
+		return TRIAL_HEADER;
+
+	size_t n = stegim::frame_size_from_head(frame, size, frame_opt);
+	if(!n || n > capacity)
+		return TRIAL_HEADER;
+
+	frame.resize(n);
+	trial_extract<T>(stego, pair_at, cipher, head, n, frame);
+
+	return stegim::frame_decode(frame, data, size, frame_opt) ?
+		TRIAL_MATCH : TRIAL_FRAME;
+}
+
+/*
+ * tests `key` on `stego`, whose samples are of type `T`. The pairs of
+ * the Feistel permutation are computed as they are read, the other
+ * permutations are computed whole.
+ */
+template<typename T>
+trial_outcome trial_key(
+	const cv::Mat& stego,
+	const std::vector<char>& key,
+	const stegim::key_trial_options& trial_opt,
+	std::vector<char>& data)
+{
+	const stegim::lsb_matching_options& lsbm_opt =
+		trial_opt.get_lsb_matching_options();
+
+	uint8_t cipher_key[stegim::chacha20_key_size] = {};
+	if(lsbm_opt.get_encryption())
+		lsbm_cipher_key(key, cipher_key);
+
+	keystream stream(cipher_key);
+	keystream* cipher = lsbm_opt.get_encryption() ? &stream : nullptr;
+
+	if(lsbm_opt.get_feistel()){
+		size_t width = stego.cols*stego.channels();
+		feistel_permutation f((size_t) stego.rows*width, key);
+
+		auto pair_at = [&](size_t i){
+			return feistel_pair(f, i, width);
+		};
+
+		return trial_frame<T>(stego, pair_at, cipher,
+			trial_opt.get_frame_options(), data);
+	}
+
+	stegim::lsb_matching_permutation permutation(stego, key,
+		stegim::lsb_matching_options(lsbm_opt).set_threads(1),
+		stegim::get_scratch_resource());
+	const stegim::lsb_matching_permutation::pair_list& pairs =
+		permutation.get_pairs();
+
+	auto pair_at = [&](size_t i){
+		return pairs[i];
+	};
+
+	return trial_frame<T>(stego, pair_at, cipher,
+		trial_opt.get_frame_options(), data);
+}
+
+stegim::key_trial_result stegim::lsb_matching_try_keys(
+	const cv::Mat& stego,
+	const std::vector<std::vector<char>>& keys,
+	const stegim::key_trial_options& trial_opt)
+{
+	assert(	stego.type() == CV_8UC1 ||
+		stego.type() == CV_8UC3 ||
+		stego.type() == CV_8UC4 ||
+		stego.type() == CV_16UC1 ||
+		stego.type() == CV_16UC3 ||
+		stego.type() == CV_16UC4);
+	assert(stego.cols && stego.rows);
+	assert(!trial_opt.get_lsb_matching_options().get_edge_adaptive());
+
+	/*
+	 * the sinks are not shared by the threads
+	 */
+	stegim::key_trial_options opt(trial_opt);
+	opt.set_frame_options(stegim::frame_options(
+		trial_opt.get_frame_options()).set_stats(nullptr));
+
+	stegim::key_trial_result result;
+	result.found = false;
+	result.key_index = 0;
+
+	/*
+	 * the keys are taken in order, so once a key is accepted only
+	 * the ones before it, already taken, may still replace it
+	 */
+	std::atomic<size_t> best(keys.size());
+	std::atomic<size_t> n_tried(0), n_rejected(0);
+	std::mutex result_mutex;
+
+	auto begin = std::chrono::steady_clock::now();
+
+	parallel_for(keys.size(), trial_opt.get_threads(), [&](size_t i){
+		if(i > best)
+			return;
+
+		std::vector<char> data;
+		trial_outcome outcome = stego.depth() == CV_16U ?
+			trial_key<uint16_t>(stego, keys[i], opt, data) :
+			trial_key<uchar>(stego, keys[i], opt, data);
+
+		n_tried++;
+		if(outcome == TRIAL_HEADER)
+			n_rejected++;
+
+		if(outcome != TRIAL_MATCH)
+			return;
+
+		std::lock_guard<std::mutex> lock(result_mutex);
+		if(i < best){
+			best = i;
+			result.data.swap(data);
+		}
+	});
+
+	double seconds = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - begin).count();
+
+	result.found = best < keys.size();
+	result.key_index = result.found ? (size_t) best : 0;
+	result.keys_tried = n_tried;
+	result.keys_rejected_by_header = n_rejected;
+	result.keys_per_second = seconds > 0 ? n_tried/seconds : 0;
+
+	return result;
+}
+
+/*
+ * key_trial_options
+ */
+stegim::key_trial_options::key_trial_options()
+	: n_threads(0)
+{}
+
+stegim::key_trial_options::~key_trial_options()
+{}
+
+stegim::key_trial_options& stegim::key_trial_options::set_threads(int n_threads)
+{
+	this->n_threads = n_threads;
+	return *this;
+}
+
+stegim::key_trial_options& stegim::key_trial_options::set_lsb_matching_options(
+	const stegim::lsb_matching_options& lsbm_opt)
+{
+	this->lsbm_opt = lsbm_opt;
+	return *this;
+}
+
+stegim::key_trial_options& stegim::key_trial_options::set_frame_options(
+	const stegim::frame_options& frame_opt)
+{
+	this->frame_opt = frame_opt;
+	return *this;
+}
+
+int stegim::key_trial_options::get_threads() const
+{
+	return this->n_threads;
+}
+
+const stegim::lsb_matching_options&
+stegim::key_trial_options::get_lsb_matching_options() const
+{
+	return this->lsbm_opt;
+}
+
+const stegim::frame_options& stegim::key_trial_options::get_frame_options() const
+{
+	return this->frame_opt;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <climits>
+
+#include "cipher.hpp"
+#include "kernels.hpp"
+
+/*
+ * number of ChaCha20 blocks generated by each refill of a keystream
+ */
+#define KEYSTREAM_BLOCKS 16
+
+/*
+ * the ChaCha20 keystream of a key with the zero nonce, read at any bit
+ * position. The blocks are generated KEYSTREAM_BLOCKS at a time as the
+ * reads move past them, so a stream read in order is generated once,
+ * in the loop consuming it, without a buffer of the size of the data.
+ * Each thread must have its own stream.
+ */
+class keystream {
+public:
+	keystream(const uint8_t* key);
+
+	/*
+	 * the `n` (<= 64) bits of the keystream beginning in the
+	 * `pos`-th bit, in the order of read_bits
+	 */
+	uint64_t bits(size_t pos, size_t n)
+	{
+		size_t first = pos/CHAR_BIT;
+		size_t last = (pos + n - 1)/CHAR_BIT;
+		if(first < this->begin || last >= this->end)
+			fill(first/CHACHA20_BLOCK);
+
+		return read_bits(this->buffer, pos - this->begin*CHAR_BIT, n);
+	}
+
+	/*
+	 * the `i`-th byte of the keystream
+	 */
+	uint8_t byte(size_t i)
+	{
+		if(i < this->begin || i >= this->end)
+			fill(i/CHACHA20_BLOCK);
+
+		return this->buffer[i - this->begin];
+	}
+
+private:
+	/*
+	 * generates the blocks beginning in the `block`-th one
+	 */
+	void fill(size_t block);
+
+	uint32_t state[16];
+
+	/*
+	 * the bytes [`begin`, `end`) of the keystream held by `buffer`,
+	 * none before the first read
+	 */
+	size_t begin, end;
+	alignas(64) uint8_t buffer[KEYSTREAM_BLOCKS*CHACHA20_BLOCK];
+};
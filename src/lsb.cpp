@@ -1,4 +1,10 @@
+#include <cstring>
+
+#include "distortion.hpp"
+#include "kernels.hpp"
 #include "lsb.hpp"
+#include "pixel_kernel.hpp"
+#include "scope_timer.hpp"
 
 /*
  * embeds the `bit` in `data` positioned in `ibit` bit index
@@ -8,13 +14,7 @@ inline uchar lsb_embed_pixel_little_endian(uchar pixel, uchar data, uchar ibit)
 {
 	assert(ibit < CHAR_BIT);
 
-	/*
-	 * set the the last bit of pixel
-	 * with `x`
-	 */
-	int x = (data >> ibit) & 1;
-
-	return (pixel & ~1) | x;
+	return stegim::lsb_embed_sample(pixel, (data >> ibit) & 1);
 }
 
 /*
@@ -25,77 +25,241 @@ inline uchar lsb_extract_pixel_little_endian(uchar pixel, uchar data, uchar ibit
 {
 	assert(ibit < CHAR_BIT);
 
-	int last_bit = pixel & 1;
+	return (data & ~(1 << ibit)) | (stegim::lsb_extract_sample(pixel) << ibit);
+}
+
+inline uint16_t lsb_embed_pixel_little_endian(uint16_t pixel, uchar data, uchar ibit)
+{
+	assert(ibit < CHAR_BIT);
 
-	return (data & ~(1 << ibit)) | (last_bit << ibit);
+	return stegim::lsb_embed_sample16(pixel, (data >> ibit) & 1);
+}
+
+inline uchar lsb_extract_pixel_little_endian(uint16_t pixel, uchar data, uchar ibit)
+{
+	assert(ibit < CHAR_BIT);
+
+	return (data & ~(1 << ibit)) | (stegim::lsb_extract_sample16(pixel) << ibit);
+}
+
+/*
+ * the bit plane kernels of the samples of 8 and 16 bits
+ */
+inline void unpack_plane_samples(
+	const kernel_table& kt,
+	const uchar* bits,
+	size_t n,
+	const uchar* src,
+	uchar* dst)
+{
+	kt.unpack_plane(bits, n, 0, src, dst);
+}
+
+inline void unpack_plane_samples(
+	const kernel_table& kt,
+	const uchar* bits,
+	size_t n,
+	const uint16_t* src,
+	uint16_t* dst)
+{
+	kt.unpack_plane16(bits, n, 0, src, dst);
+}
+
+inline void pack_plane_samples(
+	const kernel_table& kt,
+	const uchar* src,
+	size_t n,
+	uchar* bits)
+{
+	kt.pack_plane(src, n, 0, bits);
+}
+
+inline void pack_plane_samples(
+	const kernel_table& kt,
+	const uint16_t* src,
+	size_t n,
+	uchar* bits)
+{
+	kt.pack_plane16(src, n, 0, bits);
+}
+
+/*
+ * true if the samples of `a` and `b` can be walked as a single row,
+ * which needs both images to be continuous. A ROI of a larger frame
+ * is not, its rows are apart by the step of the frame.
+ */
+inline bool continuous(const cv::Mat& a, const cv::Mat& b)
+{
+	return a.isContinuous() && b.isContinuous();
 }
 
 /*
  * copy image beginning in `begin` and ending in `end`
- * range of pixels
+ * range of pixels, `end` = 0 is the end of the image. The
+ * rows are copied a run at a time, so a ROI only touches its
+ * own rectangle of the frame. Nothing is copied if `dst` is
+ * `src`, as in an embedding in place.
  */
 void copy_mat_range(
 	cv::Mat& dst,
 	const cv::Mat& src,
-	int begin = 0,
-	int end = 0)
+	size_t begin = 0,
+	size_t end = 0)
 {
+	size_t cols = src.cols;
+	size_t n_pixel = (size_t) src.rows*cols;
 
-	assert(begin < src.cols*src.rows*src.channels());
-	assert(end <= src.cols*src.rows*src.channels());
-
-	if(begin >= end)
-		end = src.cols*src.rows*src.channels();
+	if(end == 0 || end > n_pixel)
+		end = n_pixel;
 
 	/*
-	 * calculate the i, j inicial position
+	 * `begin` may be the end of the image when all
+	 * of it was used, so there is nothing to copy
 	 */
-	size_t i_ini = begin/src.cols;
-	size_t j_ini = begin%src.cols;
-
-	int rows = src.rows;
-	int cols = src.cols;
-	 
-	if(src.isContinuous())
-	{
-		cols *= rows;
-		rows = 1;
-		i_ini = 0;
-		j_ini = begin;
+	if(begin >= end || dst.data == src.data)
+		return;
+
+	assert(dst.size() == src.size() && dst.type() == src.type());
+
+	size_t pixel_size = src.elemSize();
+
+	if(continuous(dst, src)){
+		std::memcpy(
+			dst.ptr<uchar>(0) + begin*pixel_size,
+			src.ptr<uchar>(0) + begin*pixel_size,
+			(end - begin)*pixel_size);
+		return;
+	}
+
+	for(size_t pos = begin; pos < end;){
+		size_t i = pos/cols;
+		size_t j = pos%cols;
+		size_t n = std::min(cols - j, end - pos);
+
+		std::memcpy(
+			dst.ptr<uchar>(i) + j*pixel_size,
+			src.ptr<uchar>(i) + j*pixel_size,
+			n*pixel_size);
+
+		pos += n;
+	}
+}
+
+/*
+ * calls `f(i, j, pos, n)` for each run of `n` samples in the row `i`
+ * of an image of `cols` columns, beginning in the column `j`, of the
+ * `n_samples` samples beginning in the `offset`-th sample of a single
+ * channel image. `pos` is the number of samples visited before the
+ * run. A `continuous` image is a single run in the row 0.
+ */
+template<typename F>
+void for_each_row_run(
+	size_t cols,
+	bool continuous,
+	size_t offset,
+	size_t n_samples,
+	F f)
+{
+	if(continuous){
+		if(n_samples)
+			f(0, offset, 0, n_samples);
+		return;
+	}
+
+	size_t i = offset/cols;
+	size_t j = offset%cols;
+
+	for(size_t pos = 0; pos < n_samples; i++, j = 0){
+		size_t n = std::min(cols - j, n_samples - pos);
+		f(i, j, pos, n);
+		pos += n;
+	}
+}
+
+/*
+ * embeds the `data` in `cover` in a sigle channel of samples of type
+ * `T` with the bit plane kernels, which write the samples in blocks.
+ * Used when no delta is attached, the modified samples are counted
+ * afterwards if there is a stats sink.
+ */
+template<typename T>
+void lsb_embed_single_channel_plane(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const stegim::lsb_options& lsb_opt)
+{
+	stegim::stats* stats = lsb_opt.get_stats();
+	const kernel_table& kt = kernels();
+
+	size_t offset = lsb_opt.get_offset();
+	size_t n_samples = (size_t) cover.rows*cover.cols;
+	size_t n_free = offset < n_samples ? n_samples - offset : 0;
+	size_t n_bits = std::min(data.size()*CHAR_BIT, n_free);
+
+	if(offset){
+		scope_timer copy_timer(STATS_FIELD(stats, copy_ns));
+		copy_mat_range(stego, cover, 0, offset);
 	}
 
-	int n_uc_to_copy = end - begin;
+	scope_timer embedding_timer(STATS_FIELD(stats, embedding_ns));
+
+	const uchar* bits = reinterpret_cast<const uchar*>(data.data());
+	for_each_row_run(cover.cols, continuous(cover, stego), offset, n_bits,
+		[&](size_t i, size_t j, size_t pos, size_t n){
+			const T* src = cover.ptr<T>(i) + j;
+			T* dst = stego.ptr<T>(i) + j;
 
-	for(int i = i_ini, uc_count = 0; i < rows && uc_count < n_uc_to_copy; i++){
-		const uchar* ptr_src = src.ptr<uchar>(i);
-		uchar* ptr_dst = dst.ptr<uchar>(i);
+			if(pos%CHAR_BIT == 0){
+				unpack_plane_samples(kt, bits + pos/CHAR_BIT, n, src, dst);
+				return;
+			}
 
-		for (int j = j_ini; j < cols && uc_count < n_uc_to_copy; j++){
 			/*
-			 * reset j_ini
+			 * the run does not begin in a byte of the
+			 * data, its bits are realigned in words
 			 */
-			if(j_ini > 0){
-				ptr_src += j_ini*src.channels();
-				ptr_dst += j_ini*dst.channels();
-				j_ini = 0;
+			for(size_t r = 0; r < n; r += PLANE_WORD_BIT){
+				size_t m = std::min((size_t) PLANE_WORD_BIT, n - r);
+				uint64_t word = read_bits(bits, pos + r, m);
+
+				unpack_plane_samples(kt, (const uchar*) &word, m,
+					src + r, dst + r);
 			}
+		});
 
-			for(	int c = 0;
-				c < src.channels();
-				c++){
+	embedding_timer.stop();
 
-				*ptr_dst = *ptr_src;
+	scope_timer copy_timer(STATS_FIELD(stats, copy_ns));
+	copy_mat_range(stego, cover, offset + n_bits);
+	copy_timer.stop();
 
-				ptr_dst++;
-				ptr_src++;
-			}
-			uc_count++;
-		}
+	if(stats){
+		size_t n_modified = 0;
+		distortion dist;
+		for_each_row_run(cover.cols, continuous(cover, stego), offset, n_bits,
+			[&](size_t i, size_t j, size_t, size_t n){
+				const T* src = cover.ptr<T>(i) + j;
+				const T* dst = stego.ptr<T>(i) + j;
+
+				for(size_t r = 0; r < n; r++){
+					n_modified += src[r] != dst[r];
+					dist.add(src[r], dst[r]);
+				}
+			});
+
+		dist.flush(stats, stego);
+		stats->samples_visited += n_bits;
+		stats->samples_modified += n_modified;
+		stats->bytes_processed += n_bits/CHAR_BIT;
+		stats->isa = kt.name;
 	}
 }
 
 /*
- * embeds the `data` in `cover` in a sigle channel
+ * embeds the `data` in `cover` in a sigle channel, sample by sample,
+ * recording the counters of the stats sink and the delta. The delta
+ * holds samples of 8 bits only.
  */
 void lsb_embed_single_channel(
 	const cv::Mat& cover,
@@ -103,12 +267,17 @@ void lsb_embed_single_channel(
 	const std::vector<char>& data,
 	const stegim::lsb_options& lsb_opt)
 {
+	stegim::stats* stats = lsb_opt.get_stats();
+	stegim::sample_delta* delta = lsb_opt.get_delta();
+
 	size_t rows = cover.rows;
 	size_t cols = cover.cols;
 	int offset = lsb_opt.get_offset();
 
-	if(offset)
+	if(offset){
+		scope_timer copy_timer(STATS_FIELD(stats, copy_ns));
 		copy_mat_range(stego, cover, 0, offset);
+	}
 
 	/*
 	 * calculate the i, j inicial position
@@ -116,14 +285,18 @@ void lsb_embed_single_channel(
 	size_t i_ini = offset/cover.cols;
 	size_t j_ini = offset%cover.cols;
 
-	if(cover.isContinuous()){
+	if(continuous(cover, stego)){
 		cols *= rows;
 		rows = 1;
 		i_ini = 0;
 		j_ini = offset;
 	}
 
+	scope_timer embedding_timer(STATS_FIELD(stats, embedding_ns));
+
 	size_t n_bits = 0;
+	size_t n_modified = 0;
+	distortion dist;
 	for(	size_t i = i_ini, n_bytes = 0;
 		i < rows && n_bytes < data.size();
 		i++){
@@ -146,11 +319,20 @@ void lsb_embed_single_channel(
 			/*
 			 * embedding
 			 */
-			*ptr_stego = lsb_embed_pixel_little_endian(
+			uchar s = lsb_embed_pixel_little_endian(
 					*ptr_cover,
 					data[n_bytes],
 					n_bits%CHAR_BIT);
 
+			if(s != *ptr_cover){
+				n_modified++;
+				if(delta)
+					delta->add(i*cols + j, s);
+			}
+
+			dist.add(*ptr_cover, s);
+			*ptr_stego = s;
+
 			n_bits++;
 			n_bytes = n_bits/CHAR_BIT;
 			ptr_cover += cover.channels();
@@ -159,28 +341,44 @@ void lsb_embed_single_channel(
 		}
 	}
 
+	embedding_timer.stop();
+
 	/*
 	 * we can use the offset+n_bits count to the rest of the image
 	 */
+	scope_timer copy_timer(STATS_FIELD(stats, copy_ns));
 	copy_mat_range(stego, cover, offset+n_bits);
+
+	if(stats){
+		dist.flush(stats, stego);
+		stats->samples_visited += n_bits;
+		stats->samples_modified += n_modified;
+		stats->bytes_processed += n_bits/CHAR_BIT;
+	}
 }
 
 /*
- * embeds the data in a multichannel image.
+ * embeds the data in a multichannel image of samples of type `T`.
  */
+template<bool RECORD, typename T>
 void lsb_embed_multiple_channel(
 	const cv::Mat& cover,
 	cv::Mat& stego,
 	const std::vector<char>& data,
 	const stegim::lsb_options& lsb_opt)
 {
+	stegim::stats* stats = lsb_opt.get_stats();
+	stegim::sample_delta* delta = lsb_opt.get_delta();
+
 	size_t rows = cover.rows;
 	size_t cols = cover.cols;
 
 	int offset = lsb_opt.get_offset();
 
-	if(offset)
+	if(offset){
+		scope_timer copy_timer(STATS_FIELD(stats, copy_ns));
 		copy_mat_range(stego, cover, 0, offset);
+	}
 
 	/*
 	 * calculate the i, j inicial position
@@ -188,7 +386,7 @@ void lsb_embed_multiple_channel(
 	size_t i_ini = offset/cover.cols;
 	size_t j_ini = offset%cover.cols;
 
-	if(cover.isContinuous()){
+	if(continuous(cover, stego)){
 		cols *= rows;
 		rows = 1;
 		i_ini = 0;
@@ -198,19 +396,25 @@ void lsb_embed_multiple_channel(
 	/*
 	 * vector for a channel i is for embed
 	 */
-	std::vector<bool> embed_channel;
-	embed_channel.push_back(lsb_opt.get_b());
-	embed_channel.push_back(lsb_opt.get_g());
-	embed_channel.push_back(lsb_opt.get_r());
-	embed_channel.push_back(lsb_opt.get_a());
+	bool embed_channel[] = {
+		lsb_opt.get_b(),
+		lsb_opt.get_g(),
+		lsb_opt.get_r(),
+		lsb_opt.get_a()
+	};
+
+	scope_timer embedding_timer(STATS_FIELD(stats, embedding_ns));
 
 	size_t n_pixel = 0;
-	for(	size_t i = i_ini, n_bytes = 0, n_bits = 0;
+	size_t n_bits = 0;
+	size_t n_modified = 0;
+	distortion dist;
+	for(	size_t i = i_ini, n_bytes = 0;
 		i < rows && n_bytes < data.size();
 		i++){
 
-		const uchar* ptr_cover = cover.ptr<uchar>(i);
-		uchar* ptr_stego = stego.ptr<uchar>(i);
+		const T* ptr_cover = cover.ptr<T>(i);
+		T* ptr_stego = stego.ptr<T>(i);
 		for(	size_t j = j_ini;
 			j < cols && n_bytes < data.size();
 	 		j++){
@@ -224,21 +428,36 @@ void lsb_embed_multiple_channel(
 				j_ini = 0;
 			}
 
-			for(int c = 0; c < cover.channels() && n_bytes < data.size(); c++){
+			/*
+			 * the channels of the last pixel past the
+			 * data keep the cover values
+			 */
+			for(int c = 0; c < cover.channels(); c++){
 
 				/*
 				 * if embeds in this channel
 				 */
-				if(embed_channel[c]){
+				if(embed_channel[c] && n_bytes < data.size()){
 
 					/*
 					 * embedding
 					 */
-					ptr_stego[c] = lsb_embed_pixel_little_endian(
+					T s = lsb_embed_pixel_little_endian(
 							ptr_cover[c],
 							data[n_bytes],
 							n_bits%CHAR_BIT);
 
+					if(RECORD && s != ptr_cover[c]){
+						n_modified++;
+						if(delta)
+							delta->add((i*cols + j)*cover.channels() + c, s);
+					}
+
+					if(RECORD)
+						dist.add(ptr_cover[c], s);
+
+					ptr_stego[c] = s;
+
 					n_bits++;
 					n_bytes = n_bits/CHAR_BIT;
 
@@ -253,95 +472,92 @@ void lsb_embed_multiple_channel(
 		}
 	}
 
+	embedding_timer.stop();
+
 	/*
 	 * we can use the offset+n_bits count to the rest of the image
 	 */
+	scope_timer copy_timer(STATS_FIELD(stats, copy_ns));
 	copy_mat_range(stego, cover, offset+n_pixel);
+
+	if(RECORD && stats){
+		dist.flush(stats, stego);
+		stats->samples_visited += n_bits;
+		stats->samples_modified += n_modified;
+		stats->bytes_processed += n_bits/CHAR_BIT;
+	}
 }
 
 /*
- * extracts the data embedded in `stego` in one channel
- * beginning in `offset`-th pixel and writes
+ * extracts the data embedded in `stego` in one channel of samples
+ * of type `T` beginning in `offset`-th pixel and writes
  * it in `data` vector
  */
+template<typename T>
 void lsb_extract_single_channel(
 	const cv::Mat& stego,
 	std::vector<char>& data,
 	int size,
 	const stegim::lsb_options& lsb_opt)
 {
+	stegim::stats* stats = lsb_opt.get_stats();
+	const kernel_table& kt = kernels();
 
-	size_t rows = stego.rows;
-	size_t cols = stego.cols;
-
-	int offset = lsb_opt.get_offset();
-
-	/*
-	 * calculate the i, j inicial position
-	 */
-	size_t i_ini = offset/stego.cols;
-	size_t j_ini = offset%stego.cols;
-
-	if(stego.isContinuous()){
-		cols *= rows;
-		rows = 1;
-		i_ini = 0;
-		j_ini = offset;
-	}
+	size_t offset = lsb_opt.get_offset();
+	size_t n_samples = (size_t) stego.rows*stego.cols;
 
 	size_t max_bytes;
 	if(size == -1)
-		max_bytes = (stego.cols*stego.rows)/CHAR_BIT;
+		max_bytes = n_samples/CHAR_BIT;
 	else
 		max_bytes = size;
 
 	data.resize(max_bytes, 0);
 
-	for(	size_t i = i_ini, n_bits = 0, n_bytes = 0;
-		i < rows && n_bytes < max_bytes;
-		i++){
+	scope_timer embedding_timer(STATS_FIELD(stats, embedding_ns));
 
-		const uchar* ptr_stego = stego.ptr<uchar>(i);
-		for(	size_t j = j_ini;
-			j < cols && n_bytes < max_bytes;
-			j++){
+	size_t n_free = offset < n_samples ? n_samples - offset : 0;
+	size_t n_bits = std::min(max_bytes*CHAR_BIT, n_free);
 
-			/*
-			 * reset j_ini
-			 */
-			if(j_ini > 0){
-				ptr_stego += j_ini;
-				j_ini = 0;
+	uchar* bits = reinterpret_cast<uchar*>(data.data());
+	for_each_row_run(stego.cols, stego.isContinuous(), offset, n_bits,
+		[&](size_t i, size_t j, size_t pos, size_t n){
+			const T* src = stego.ptr<T>(i) + j;
+
+			if(pos%CHAR_BIT == 0){
+				pack_plane_samples(kt, src, n, bits + pos/CHAR_BIT);
+				return;
 			}
 
-			/*
-			 * extracting
-			 */
-			data[n_bytes] = lsb_extract_pixel_little_endian(
-						*ptr_stego,
-						data[n_bytes],
-						n_bits%CHAR_BIT);
+			for(size_t r = 0; r < n; r += PLANE_WORD_BIT){
+				size_t m = std::min((size_t) PLANE_WORD_BIT, n - r);
+				uint64_t word = 0;
 
-			n_bits++;
-			n_bytes = n_bits/CHAR_BIT;
-			ptr_stego += stego.channels();
+				pack_plane_samples(kt, src + r, m, (uchar*) &word);
+				append_bits(bits, pos + r, word, m);
+			}
+		});
 
-		}
+	if(stats){
+		stats->samples_visited += n_bits;
+		stats->bytes_processed += n_bits/CHAR_BIT;
+		stats->isa = kt.name;
 	}
-
 }
 
 /*
- * extracts the data embedded in `stego` in multiple channels
- * beginning in `offset`-th pixel and writes
+ * extracts the data embedded in `stego` in multiple channels of
+ * samples of type `T` beginning in `offset`-th pixel and writes
  * it in `data` vector
  */
+template<typename T>
 void lsb_extract_multiple_channel(
 	const cv::Mat& stego,
 	std::vector<char>& data,
 	int size,
 	const stegim::lsb_options& lsb_opt)
 {
+	stegim::stats* stats = lsb_opt.get_stats();
 	size_t rows = stego.rows;
 	size_t cols = stego.cols;
 
@@ -371,17 +587,21 @@ void lsb_extract_multiple_channel(
 	/*
 	 * vector for a channel i is for embed
 	 */
-	std::vector<bool> embed_channel;
-	embed_channel.push_back(lsb_opt.get_b());
-	embed_channel.push_back(lsb_opt.get_g());
-	embed_channel.push_back(lsb_opt.get_r());
-	embed_channel.push_back(lsb_opt.get_a());
+	bool embed_channel[] = {
+		lsb_opt.get_b(),
+		lsb_opt.get_g(),
+		lsb_opt.get_r(),
+		lsb_opt.get_a()
+	};
 
-	for(	size_t i = i_ini, n_bytes = 0, n_bits = 0;
+	scope_timer embedding_timer(STATS_FIELD(stats, embedding_ns));
+
+	size_t n_bits = 0;
+	for(	size_t i = i_ini, n_bytes = 0;
 		i < rows && n_bytes < max_bytes;
 		i++){
 
-		const uchar* ptr_stego = stego.ptr<uchar>(i);
+		const T* ptr_stego = stego.ptr<T>(i);
 		for(	size_t j = j_ini;
 			j < cols && n_bytes < max_bytes;
 			j++){
@@ -394,7 +614,7 @@ void lsb_extract_multiple_channel(
 				j_ini = 0;
 			}
 
-			for(int c = 0; c < stego.channels(); c++){
+			for(int c = 0; c < stego.channels() && n_bytes < max_bytes; c++){
 
 				/*
 				 * if this channel has embedded data
@@ -416,37 +636,83 @@ void lsb_extract_multiple_channel(
 			ptr_stego += stego.channels();
 		}
 	}
+
+	if(stats){
+		stats->samples_visited += n_bits;
+		stats->bytes_processed += n_bits/CHAR_BIT;
+	}
 }
 
-void stegim::lsb_embed (
+/*
+ * embeds the `data` in `cover`, whose samples are of type `T`
+ */
+template<typename T>
+void lsb_embed_samples(
 	const cv::Mat& cover,
 	cv::Mat& stego,
 	const std::vector<char>& data,
 	const stegim::lsb_options& lsb_opt)
 {
-	assert(	cover.type() == CV_8UC1 ||
-		cover.type() == CV_8UC3 ||
-		cover.type() == CV_8UC4);
-	assert(cover.cols && cover.rows);
-	stego.create(cover.size(), cover.type());
-
 	/*
 	 * Separation of the lsb_embed in single_channel and multiple_channel
 	 * is just for optimization in the comparison number for single channel.
 	 * Maybe there is a more elegant way to do this, with the same result.
 	 */
-	if(cover.type() == CV_8UC1){
-		lsb_embed_single_channel(cover, stego, data, lsb_opt);
+	stegim::sample_delta* delta = lsb_opt.get_delta();
+	bool record = lsb_opt.get_stats() || delta;
+
+	if(cover.channels() == 1){
+		if(delta)
+			lsb_embed_single_channel(cover, stego, data, lsb_opt);
+		else
+			lsb_embed_single_channel_plane<T>(cover, stego, data, lsb_opt);
 	}else{
 		assert(lsb_opt.get_b()
 			|| lsb_opt.get_g()
 			|| lsb_opt.get_r()
 			|| lsb_opt.get_a());
 
-		lsb_embed_multiple_channel(cover, stego, data, lsb_opt);
+		if(record)
+			lsb_embed_multiple_channel<true, T>(cover, stego, data, lsb_opt);
+		else
+			lsb_embed_multiple_channel<false, T>(cover, stego, data, lsb_opt);
 	}
 }
 
+void stegim::lsb_embed (
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const stegim::lsb_options& lsb_opt)
+{
+	assert(	cover.type() == CV_8UC1 ||
+		cover.type() == CV_8UC3 ||
+		cover.type() == CV_8UC4 ||
+		cover.type() == CV_16UC1 ||
+		cover.type() == CV_16UC3 ||
+		cover.type() == CV_16UC4);
+	assert(cover.cols && cover.rows);
+	stego.create(cover.size(), cover.type());
+
+	stegim::sample_delta* delta = lsb_opt.get_delta();
+
+	/*
+	 * the delta holds samples of 8 bits
+	 */
+	assert(!delta || cover.depth() == CV_8U);
+
+	if(delta)
+		delta->begin(cover.rows, cover.cols*cover.channels());
+
+	if(cover.depth() == CV_16U)
+		lsb_embed_samples<uint16_t>(cover, stego, data, lsb_opt);
+	else
+		lsb_embed_samples<uchar>(cover, stego, data, lsb_opt);
+
+	if(delta)
+		delta->finish();
+}
+
 void stegim::lsb_extract(
 	const cv::Mat& stego,
 	std::vector<char>& data,
@@ -457,22 +723,134 @@ void stegim::lsb_extract(
 
 	assert(	stego.type() == CV_8UC1 ||
 		stego.type() == CV_8UC3 ||
-		stego.type() == CV_8UC4);
+		stego.type() == CV_8UC4 ||
+		stego.type() == CV_16UC1 ||
+		stego.type() == CV_16UC3 ||
+		stego.type() == CV_16UC4);
 	assert(stego.cols && stego.rows);
 
+	bool wide = stego.depth() == CV_16U;
+
 	/*
 	 * Separate the lsb_extract in single_channel and multiple_channel
 	 * just for optimization in the comparison number for single channel.
 	 * Maybe there is a more elegant way to do this, with the same result.
 	 */
-	if(stego.type() == CV_8UC1){
-		lsb_extract_single_channel(stego, data, size, lsb_opt);
+	if(stego.channels() == 1){
+		if(wide)
+			lsb_extract_single_channel<uint16_t>(stego, data, size, lsb_opt);
+		else
+			lsb_extract_single_channel<uchar>(stego, data, size, lsb_opt);
 	}else{
 		assert(lsb_opt.get_b()
 			|| lsb_opt.get_g()
 			|| lsb_opt.get_r()
 			|| lsb_opt.get_a());
-		lsb_extract_multiple_channel(stego, data, size, lsb_opt);
+
+		if(wide)
+			lsb_extract_multiple_channel<uint16_t>(stego, data, size, lsb_opt);
+		else
+			lsb_extract_multiple_channel<uchar>(stego, data, size, lsb_opt);
+	}
+}
+
+void stegim::lsb_update(
+	cv::Mat& stego,
+	const std::vector<char>& old_data,
+	const std::vector<char>& new_data,
+	const stegim::lsb_options& lsb_opt)
+{
+	assert(	stego.type() == CV_8UC1 ||
+		stego.type() == CV_8UC3 ||
+		stego.type() == CV_8UC4);
+	assert(stego.cols && stego.rows);
+
+	stegim::stats* stats = lsb_opt.get_stats();
+	stegim::sample_delta* delta = lsb_opt.get_delta();
+
+	scope_timer embedding_timer(STATS_FIELD(stats, embedding_ns));
+
+	/*
+	 * the channels used by lsb_embed, in embedding order
+	 */
+	int channel[4];
+	size_t n_channels = 0;
+	if(stego.channels() == 1){
+		channel[n_channels++] = 0;
+	}else{
+		bool embed_channel[] = {
+			lsb_opt.get_b(),
+			lsb_opt.get_g(),
+			lsb_opt.get_r(),
+			lsb_opt.get_a()
+		};
+
+		for(int c = 0; c < stego.channels(); c++)
+			if(embed_channel[c])
+				channel[n_channels++] = c;
+	}
+
+	assert(n_channels);
+
+	size_t offset = lsb_opt.get_offset();
+	size_t n_pixel = (size_t) stego.rows*stego.cols;
+
+	/*
+	 * the bits past the capacity are dropped, as lsb_embed does
+	 */
+	size_t n_free = offset < n_pixel ? (n_pixel - offset)*n_channels : 0;
+	size_t n_bits_max = std::min(new_data.size()*CHAR_BIT, n_free);
+	size_t n_bytes_max = (n_bits_max + CHAR_BIT - 1)/CHAR_BIT;
+
+	if(delta)
+		delta->begin(stego.rows, stego.cols*stego.channels());
+
+	size_t n_visited = 0;
+	size_t n_modified = 0;
+	for(size_t n_bytes = 0; n_bytes < n_bytes_max; n_bytes++){
+
+		/*
+		 * the bits past the old data are all written
+		 */
+		uchar changed = n_bytes < old_data.size() ?
+			old_data[n_bytes] ^ new_data[n_bytes] : UCHAR_MAX;
+
+		for(int b = 0; changed; b++, changed >>= 1){
+			if(!(changed & 1))
+				continue;
+
+			/*
+			 * the same bit to sample mapping of lsb_embed
+			 */
+			size_t n_bits = n_bytes*CHAR_BIT + b;
+			if(n_bits >= n_bits_max)
+				break;
+
+			size_t pixel = offset + n_bits/n_channels;
+			int c = channel[n_bits%n_channels];
+
+			uchar* ptr = stego.ptr<uchar>(pixel/stego.cols)
+				+ (pixel%stego.cols)*stego.channels() + c;
+
+			uchar s = lsb_embed_pixel_little_endian(*ptr, new_data[n_bytes], b);
+			if(s != *ptr){
+				n_modified++;
+				if(delta)
+					delta->add(pixel*stego.channels() + c, s);
+			}
+
+			*ptr = s;
+			n_visited++;
+		}
+	}
+
+	if(delta)
+		delta->finish();
+
+	if(stats){
+		stats->samples_visited += n_visited;
+		stats->samples_modified += n_modified;
+		stats->bytes_processed += n_bits_max/CHAR_BIT;
 	}
 }
 
@@ -489,7 +867,9 @@ stegim::lsb_options::lsb_options(
 	g(g),
 	r(r),
 	a(a),
-	offset(offset)
+	offset(offset),
+	stats_sink(nullptr),
+	delta(nullptr)
 {}
 
 stegim::lsb_options::~lsb_options()
@@ -525,6 +905,18 @@ stegim::lsb_options& stegim::lsb_options::set_offset(int offset)
 	return *this;
 }
 
+stegim::lsb_options& stegim::lsb_options::set_stats(stegim::stats* stats_sink)
+{
+	this->stats_sink = stats_sink;
+	return *this;
+}
+
+stegim::lsb_options& stegim::lsb_options::set_delta(stegim::sample_delta* delta)
+{
+	this->delta = delta;
+	return *this;
+}
+
 bool stegim::lsb_options::get_b() const
 {
 	return this->b;
@@ -549,3 +941,13 @@ int stegim::lsb_options::get_offset() const
 {
 	return this->offset;
 }
+
+stegim::stats* stegim::lsb_options::get_stats() const
+{
+	return this->stats_sink;
+}
+
+stegim::sample_delta* stegim::lsb_options::get_delta() const
+{
+	return this->delta;
+}
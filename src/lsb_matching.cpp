@@ -1,165 +1,86 @@
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 
+#include "distortion.hpp"
+#include "feistel.hpp"
+#include "kernels.hpp"
+#include "keystream.hpp"
 #include "lsb_matching.hpp"
-
-#define LSB(X) ((X)&1)
-
-#define BIGGEST_64BIT_PRIME 18446744073709551557ULL
-
-typedef std::pair<cv::Point2i, cv::Point2i> lsbm_pair;
+#include "lsb_matching_edge.hpp"
+#include "lsb_matching_kernel.hpp"
+#include "parallel.hpp"
+#include "scope_timer.hpp"
+#include "thread_pool.hpp"
 
 /*
- * simple hash function to derivate a key to a uint64_t
+ * number of pairs embedded by each call of the kernel
  */
-inline uint64_t prime_hash(const char* str, size_t len)
-{
-	uint64_t h = BIGGEST_64BIT_PRIME;
-
-	size_t i = 0;
-	for(i = 0; i < len; i++)
-		h = h*31 + str[i] + 1;
-
-	return h;
-}
+#define LSBM_PAIR_BLOCK 64
 
 /*
- * this functions is the same of the paper
- * "LSB Matching Revised"
+ * samples shuffled between two polls of the cancellation of an async
+ * job
  */
-inline uchar correlation_function(uchar a, uchar b)
-{
-	return LSB(a/2 + b);
-}
-
-/*
- * return +/- 1 if the pixel is not saturated
- */
-int rand_plus_minus_one(uchar c)
-{
-	static std::random_device random;
-
-	if(c == 0)
-		return 1;
-	else if(c == UCHAR_MAX)
-		return -1;
-
-	return (random()%2)?1:-1;
-}
-
-/*
- * embed the `ibit`-th and the `ibit`+1-th bits of
- * `m` in `s0` and `s1`, respectively
- */
-inline void lsbm_embed_pixel_little_endian(
-		uchar m,
-		uchar ibit,
-		const uchar c0,
-		const uchar c1,
-		uchar& s0,
-		uchar& s1)
-{
-	int m0 = LSB(m >> ibit);
-	int m1 = LSB(m >> (ibit+1));
-
-	if(m0 == LSB(c0)){
-		if(m1 == correlation_function(c0, c1))
-			s1 = c1;
-		else
-			s1 = c1 + rand_plus_minus_one(c1);
-
-		s0 = c0;
-	}else{
-
-		/*
-		 * these 2 next conditions are added to the algorithm
-		 * to treat the saturated pixel issue
-		 */
-		if(c0 == 0){
-			if(m1 == correlation_function(c0 + 1, c1))
-				s0 = c0 + 1;
-			else
-				s0 = c0 + 3;
-		}else if(c0 == 255){
-			if(m1 == correlation_function(c0 - 1, c1))
-				s0 = c0 - 1;
-			else
-				s0 = c0 - 3;
-		}else if(m1 == correlation_function(c0 - 1, c1)){
-			s0 = c0 - 1;
-		}else{
-			s0 = c0 + 1;
-		}
-
-		s1 = c1;
-	}
-
-}
-
-/*
- * extract the embed message in `s0` and `s1`
- * and put in `ibit`-th bit, and `ibit`+1-th bit
- * of d respectively
- */
-inline uchar lsbm_extract_pixel_little_endian(
-		uchar d,
-		uchar s0,
-		uchar s1,
-		uchar ibit)
-{
-	int m0 = LSB(s0);
-	int m1 = correlation_function(s0, s1);
-
-	d = (d & ~(1 << ibit)) | m0 << ibit;
-	ibit++;
-	d = (d & ~(1 << ibit)) | m1 << ibit;
-
-	return d;
-}
+#define LSBM_CANCEL_STRIDE (1 << 16)
 
+typedef std::pair<cv::Point2i, cv::Point2i> lsbm_pair;
+typedef stegim::lsb_matching_permutation::pair_list lsbm_pair_list;
 
 /*
- * returns a list of pair of points shuffled
+ * writes in `v` a list of pair of points shuffled
  */
-std::vector<lsbm_pair> lsbm_pair_shuffled(
+void lsbm_pair_shuffled(
 	int rows,
 	int cols,
 	std::default_random_engine& random_generator,
-	std::uniform_int_distribution<int>& uniform)
+	std::uniform_int_distribution<int>& uniform,
+	lsbm_pair_list& v)
 {
-	std::vector<cv::Point2i> point;
-	std::vector<lsbm_pair> v;
-
 	int n_pixel = rows*cols;
+
+	stegim::scratch_vector<cv::Point2i> point;
+	point.reserve(n_pixel);
+
 	for(int i=0; i<n_pixel; i++)
 		point.push_back(cv::Point2i(i/cols, i%cols));
 
-	if(n_pixel%2 != 0){
-		v[n_pixel - 1].second.x = -1;
-		v[n_pixel - 1].second.y = -1;
-	}
+	v.clear();
 
 	/*
 	 * shuffle!
 	 */
 	for(size_t i=0; i<point.size(); i++){
+		if(i%LSBM_CANCEL_STRIDE == 0 && chunk_cancelled())
+			return;
+
 		int random_index = uniform(random_generator)%point.size();
 		std::swap(point[i], point[random_index]);
 	}
 
-	for(size_t i=0; i<point.size(); i += 2){
+	v.reserve((n_pixel + 1)/2);
+
+	for(size_t i=0; i + 1 < point.size(); i += 2){
 		v.push_back(lsbm_pair(point[i], point[i+1]));
 	}
 
-	return v;
+	/*
+	 * in an odd image the last sample is left out of the pairs, it is
+	 * paired with itself so it is copied to the stego image but never
+	 * used to embed
+	 */
+	if(n_pixel%2 != 0)
+		v.push_back(lsbm_pair(point.back(), point.back()));
 }
 
 /*
  * deviate a sequence of image positions based on `key`
  */
-std::vector<lsbm_pair> lsbm_deviate_pair_list(
+void lsbm_deviate_pair_list(
 	int rows,
 	int cols,
-	const std::vector<char>& key)
+	const std::vector<char>& key,
+	lsbm_pair_list& pair)
 {
 	int64_t hash_seed = prime_hash(key.data(), key.size());
 
@@ -173,94 +94,255 @@ std::vector<lsbm_pair> lsbm_deviate_pair_list(
 	 */
 	std::uniform_int_distribution<int> uniform;
 
-	std::vector<lsbm_pair> pair = lsbm_pair_shuffled(
+	lsbm_pair_shuffled(
 		rows,
 		cols,
 		random_generator,
-		uniform);
+		uniform,
+		pair);
+}
+
+/*
+ * the lsb matching revisited kernels of the samples of 8 and 16 bits
+ */
+inline size_t lsbmr_embed_samples(
+	const kernel_table& kt,
+	const uchar* c0,
+	const uchar* c1,
+	uint64_t m0,
+	uint64_t m1,
+	size_t n,
+	uchar* s0,
+	uchar* s1)
+{
+	return kt.lsbmr_embed(c0, c1, m0, m1, random_word(), n, s0, s1);
+}
+
+inline size_t lsbmr_embed_samples(
+	const kernel_table& kt,
+	const uint16_t* c0,
+	const uint16_t* c1,
+	uint64_t m0,
+	uint64_t m1,
+	size_t n,
+	uint16_t* s0,
+	uint16_t* s1)
+{
+	return kt.lsbmr_embed16(c0, c1, m0, m1, random_word(), n, s0, s1);
+}
+
+/*
+ * embeds the bits 2*`begin` to 2*`end` of `bits` in the pairs [`begin`,
+ * `end`) of `pair`, in place in `stego`, whose samples are of type `T`.
+ * The bits are XORed with the same bits of `cipher`, if not null, as
+ * they are read. The modified samples are only counted and added to
+ * `delta` and `dist`, if not null, if `RECORD` is true.
+ */
+template<bool RECORD, typename T>
+void lsbm_embed_pairs(
+	cv::Mat& stego,
+	const uchar* bits,
+	const lsbm_pair_list& pair,
+	size_t begin,
+	size_t end,
+	keystream* cipher,
+	stegim::sample_delta* delta,
+	distortion* dist,
+	size_t& n_modified,
+	size_t& n_saturated)
+{
+	const kernel_table& kt = kernels();
+	size_t width = stego.cols*stego.channels();
 
-	return pair;
+	/*
+	 * the pairs are gathered in blocks of contiguous lanes, embedded
+	 * without branches and scattered back. The pairs do not share
+	 * samples, so the blocks may be embedded in place.
+	 */
+	for(size_t i = begin; i < end; i += LSBM_PAIR_BLOCK){
+		size_t n = std::min((size_t) LSBM_PAIR_BLOCK, end - i);
+
+		T* ptr0[LSBM_PAIR_BLOCK];
+		T* ptr1[LSBM_PAIR_BLOCK];
+		T c0[LSBM_PAIR_BLOCK], c1[LSBM_PAIR_BLOCK];
+		T s0[LSBM_PAIR_BLOCK], s1[LSBM_PAIR_BLOCK];
+
+		for(size_t k = 0; k < n; k++){
+			const lsbm_pair& p = pair[i + k];
+			ptr0[k] = stego.ptr<T>(p.first.x) + p.first.y;
+			ptr1[k] = stego.ptr<T>(p.second.x) + p.second.y;
+			c0[k] = *ptr0[k];
+			c1[k] = *ptr1[k];
+		}
+
+		/*
+		 * the pair k takes the bits 2k and 2k+1 of the block
+		 */
+		uint64_t m[2] = {};
+		for(size_t w = 0; w*PLANE_WORD_BIT < 2*n; w++){
+			size_t pos = 2*i + w*PLANE_WORD_BIT;
+			size_t len = std::min((size_t) PLANE_WORD_BIT, 2*n - w*PLANE_WORD_BIT);
+
+			m[w] = read_bits(bits, pos, len);
+			if(cipher)
+				m[w] ^= cipher->bits(pos, len);
+		}
+
+		const uint64_t even = 0x5555555555555555ULL;
+		uint64_t m0 = kt.pext(m[0], even) | kt.pext(m[1], even) << 32;
+		uint64_t m1 = kt.pext(m[0], ~even) | kt.pext(m[1], ~even) << 32;
+
+		n_saturated += lsbmr_embed_samples(kt, c0, c1, m0, m1, n, s0, s1);
+
+		for(size_t k = 0; k < n; k++){
+			*ptr0[k] = s0[k];
+			*ptr1[k] = s1[k];
+		}
+
+		if(RECORD){
+			for(size_t k = 0; k < n; k++){
+				const lsbm_pair& p = pair[i + k];
+
+				n_modified += (s0[k] != c0[k]) + (s1[k] != c1[k]);
+
+				if(dist){
+					dist->add(c0[k], s0[k]);
+					dist->add(c1[k], s1[k]);
+				}
+
+				if(delta && s0[k] != c0[k])
+					delta->add(p.first.x*width + p.first.y, s0[k]);
+				if(delta && s1[k] != c1[k])
+					delta->add(p.second.x*width + p.second.y, s1[k]);
+			}
+		}
+	}
 }
 
 /*
- * embeds the `data` in `stego` using the `cover` image
- * and the key `key` using one channel.
+ * embeds the `data` in `stego` using the `cover` image, of samples of
+ * type `T`, and the pairs of `permutation`. The counters of the stats
+ * sink and the delta are only computed if `RECORD` is true.
  */
+template<bool RECORD, typename T>
 void lsb_matching_embed_data(
 	const cv::Mat& cover,
 	cv::Mat& stego,
 	const std::vector<char>& data,
-	const std::vector<char>& key)
+	const stegim::lsb_matching_permutation& permutation,
+	const stegim::lsb_matching_options& lsbm_opt)
 {
+	stegim::stats* stats = lsbm_opt.get_stats();
+	stegim::sample_delta* delta = lsbm_opt.get_delta();
 
-	std::vector<lsbm_pair> pair = lsbm_deviate_pair_list(
-					cover.rows,
-					cover.cols * cover.channels(),
-					key);
+	/*
+	 * the pairs not used keep the cover values, a sequential
+	 * copy is cheaper than going through them
+	 */
+	scope_timer copy_timer(STATS_FIELD(stats, copy_ns));
+	if(stego.data != cover.data)
+		cover.copyTo(stego);
+	copy_timer.stop();
 
-	size_t n_bytes = 0;
-	size_t i = 0;
-	size_t n_bits = 0;
-	while(i < pair.size()){
-		lsbm_pair& p = pair[i];
+	scope_timer embedding_timer(STATS_FIELD(stats, embedding_ns));
 
-		const uchar* ptr_first_cover =
-			cover.ptr<uchar>(p.first.x) + p.first.y;
+	const lsbm_pair_list& pair = permutation.get_pairs();
 
-		const uchar* ptr_second_cover =
-			cover.ptr<uchar>(p.second.x) + p.second.y;
+	/*
+	 * every pair holds two bits, the last one may be cut
+	 * by the end of the image
+	 */
+	size_t n_pairs = std::min(
+		(size_t)(cover.rows*cover.cols*cover.channels())/2,
+		(data.size()*CHAR_BIT + 1)/2);
 
-		uchar* ptr_first_stego = 
-			stego.ptr<uchar>(p.first.x) + p.first.y;
+	const uchar* bits = reinterpret_cast<const uchar*>(data.data());
+	size_t n_modified = 0;
+	size_t n_saturated = 0;
+	distortion dist;
 
-		uchar* ptr_second_stego =
-			stego.ptr<uchar>(p.second.x) + p.second.y;
+	const std::vector<size_t>& tiles = permutation.get_tile_bounds();
+	bool encryption = lsbm_opt.get_encryption();
 
-		if(n_bytes < data.size()){
+	if(RECORD || tiles.empty() || lsbm_opt.get_threads() == 1){
+		keystream stream(permutation.get_cipher_key());
+		lsbm_embed_pairs<RECORD, T>(stego, bits, pair, 0, n_pairs,
+			encryption ? &stream : nullptr, delta, &dist, n_modified,
+			n_saturated);
+	}else{
+		/*
+		 * the tiles do not share samples, the last range has
+		 * the pairs of the samples left out of the tiles. Nothing
+		 * is counted without RECORD. The keystream is seekable, so
+		 * each tile generates its own range of it. A stream
+		 * context runs them on its own team, without starting
+		 * threads for every frame.
+		 */
+		auto embed_tile = [&](size_t t){
+			size_t begin = std::min(tiles[t], n_pairs);
+			size_t end = t + 1 < tiles.size() ?
+				std::min(tiles[t + 1], n_pairs) : n_pairs;
 
-			lsbm_embed_pixel_little_endian(
-					data[n_bytes],
-					n_bits%CHAR_BIT,
-					*ptr_first_cover,
-					*ptr_second_cover,
-					*ptr_first_stego,
-					*ptr_second_stego);
+			keystream stream(permutation.get_cipher_key());
+			size_t n_tile_modified = 0, n_tile_saturated = 0;
+			lsbm_embed_pairs<false, T>(stego, bits, pair, begin, end,
+				encryption ? &stream : nullptr, nullptr, nullptr,
+				n_tile_modified, n_tile_saturated);
+		};
 
-			n_bits += 2;
-			n_bytes = n_bits/CHAR_BIT;
-		}else{
-			*ptr_first_stego = *ptr_first_cover;
-			*ptr_second_stego = *ptr_second_cover;
-		}
+		if(current_worker_team)
+			current_worker_team->run(tiles.size(), embed_tile);
+		else
+			parallel_for(tiles.size(), lsbm_opt.get_threads(), embed_tile);
+	}
 
-		i++;
+	embedding_timer.stop();
+
+	if(RECORD && stats){
+		dist.flush(stats, stego);
+		stats->samples_visited += 2*n_pairs;
+		stats->samples_modified += n_modified;
+		stats->saturated_adjustments += n_saturated;
+		stats->bytes_processed += 2*n_pairs/CHAR_BIT;
+		stats->isa = kernels().name;
 	}
 }
 
 /*
- * extracts the embedded data from stego
+ * extracts the bytes [`begin`, `end`) of the embedded data from stego,
+ * whose samples are of type `T`, in the pairs of `permutation`
  */
+template<typename T>
 void lsb_matching_extract_embedded_data(
 	const cv::Mat& stego,
 	std::vector<char>& data,
-	size_t size,
-	const std::vector<char>& key)
+	size_t begin,
+	size_t end,
+	const stegim::lsb_matching_permutation& permutation,
+	const stegim::lsb_matching_options& lsbm_opt)
 {
-	std::vector<lsbm_pair> pair = lsbm_deviate_pair_list(
-					stego.rows,
-					stego.cols * stego.channels(),
-					key);
+	stegim::stats* stats = lsbm_opt.get_stats();
+	const lsbm_pair_list& pair = permutation.get_pairs();
+
+	scope_timer embedding_timer(STATS_FIELD(stats, embedding_ns));
+
+	/*
+	 * each byte is decrypted once its last pair is read
+	 */
+	keystream stream(permutation.get_cipher_key());
+	bool encryption = lsbm_opt.get_encryption();
 
-	size_t i = 0;
-	size_t n_bytes = 0;
-	size_t n_bits = 0;
-	while(i < pair.size() && n_bytes < size){
+	size_t n_pairs = ((size_t) stego.rows*stego.cols*stego.channels())/2;
+	size_t i = begin*CHAR_BIT/2;
+	size_t n_bytes = begin;
+	size_t n_bits = begin*CHAR_BIT;
+	while(i < n_pairs && n_bytes < end){
 
-		lsbm_pair& p = pair[i];
-		const uchar* ptr_first_stego =
-			stego.ptr<uchar>(p.first.x) + p.first.y;
-		const uchar* ptr_second_stego =
-			stego.ptr<uchar>(p.second.x) + p.second.y;
+		const lsbm_pair& p = pair[i];
+		const T* ptr_first_stego =
+			stego.ptr<T>(p.first.x) + p.first.y;
+		const T* ptr_second_stego =
+			stego.ptr<T>(p.second.x) + p.second.y;
 
 		data[n_bytes] = lsbm_extract_pixel_little_endian(
 				data[n_bytes],
@@ -269,62 +351,682 @@ void lsb_matching_extract_embedded_data(
 				n_bits%CHAR_BIT);
 
 		n_bits += 2;
+		if(encryption && n_bits%CHAR_BIT == 0)
+			data[n_bytes] ^= stream.byte(n_bytes);
 		n_bytes = n_bits/CHAR_BIT;
 
 		i++;
 	}
 
+	if(stats){
+		stats->samples_visited += 2*(i - begin*CHAR_BIT/2);
+		stats->bytes_processed += n_bytes - begin;
+	}
 }
 
 void stegim::lsb_matching_embed(
 	const cv::Mat& cover,
 	cv::Mat& stego,
 	const std::vector<char>& data,
-	const std::vector<char>& key)
+	const stegim::lsb_matching_permutation& permutation,
+	const stegim::lsb_matching_options& lsbm_opt)
 {
 	assert(	cover.type() == CV_8UC1 ||
 		cover.type() == CV_8UC3 ||
-		cover.type() == CV_8UC4);
-	assert(cover.cols && cover.rows);
+		cover.type() == CV_8UC4 ||
+		cover.type() == CV_16UC1 ||
+		cover.type() == CV_16UC3 ||
+		cover.type() == CV_16UC4);
+	assert(	cover.rows == permutation.get_rows() &&
+		cover.cols*cover.channels() == permutation.get_width());
+	assert(!lsbm_opt.get_edge_adaptive());
 	stego.create(cover.size(), cover.type());
 
-	lsb_matching_embed_data(cover, stego, data, key);
+	stegim::sample_delta* delta = lsbm_opt.get_delta();
+	bool record = lsbm_opt.get_stats() || delta;
+
+	/*
+	 * the delta holds samples of 8 bits
+	 */
+	assert(!delta || cover.depth() == CV_8U);
+
+	if(delta)
+		delta->begin(cover.rows, cover.cols*cover.channels());
+
+	if(cover.depth() == CV_16U){
+		if(record)
+			lsb_matching_embed_data<true, uint16_t>(
+				cover, stego, data, permutation, lsbm_opt);
+		else
+			lsb_matching_embed_data<false, uint16_t>(
+				cover, stego, data, permutation, lsbm_opt);
+	}else{
+		if(record)
+			lsb_matching_embed_data<true, uchar>(
+				cover, stego, data, permutation, lsbm_opt);
+		else
+			lsb_matching_embed_data<false, uchar>(
+				cover, stego, data, permutation, lsbm_opt);
+	}
+
+	if(delta)
+		delta->finish();
+}
+
+void stegim::lsb_matching_embed(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt)
+{
+	assert(	cover.type() == CV_8UC1 ||
+		cover.type() == CV_8UC3 ||
+		cover.type() == CV_8UC4 ||
+		cover.type() == CV_16UC1 ||
+		cover.type() == CV_16UC3 ||
+		cover.type() == CV_16UC4);
+	assert(cover.cols && cover.rows);
+
+	if(lsbm_opt.get_edge_adaptive()){
+		/*
+		 * the edges are measured on samples of 8 bits
+		 */
+		assert(cover.depth() == CV_8U);
+
+		stegim::sample_delta* delta = lsbm_opt.get_delta();
+
+		stego.create(cover.size(), cover.type());
+
+		if(delta)
+			delta->begin(cover.rows, cover.cols*cover.channels());
+
+		lsb_matching_edge_embed(cover, stego, data, key, lsbm_opt);
+
+		if(delta)
+			delta->finish();
+
+		return;
+	}
+
+	stegim::stats* stats = lsbm_opt.get_stats();
+
+	scope_timer permutation_timer(STATS_FIELD(stats, permutation_ns));
+	stegim::lsb_matching_permutation permutation(
+		cover, key, lsbm_opt, stegim::get_scratch_resource());
+	permutation_timer.stop();
+
+	stegim::lsb_matching_embed(cover, stego, data, permutation, lsbm_opt);
 }
 
 void stegim::lsb_matching_embed(
 	const cv::Mat& cover,
 	cv::Mat& stego,
 	const std::vector<char>& data,
-	const std::string key)
+	const std::string key,
+	const stegim::lsb_matching_options& lsbm_opt)
 {
 	std::vector<char> k(key.data(), key.data() + key.size());
-	return stegim::lsb_matching_embed(cover, stego, data, k);
+	return stegim::lsb_matching_embed(cover, stego, data, k, lsbm_opt);
 }
 
 void stegim::lsb_matching_extract(
 	const cv::Mat& stego,
 	std::vector<char>& data,
 	size_t size,
-	const std::vector<char>& key)
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt)
 {
 
 	assert(	stego.type() == CV_8UC1 ||
 		stego.type() == CV_8UC3 ||
-		stego.type() == CV_8UC4);
+		stego.type() == CV_8UC4 ||
+		stego.type() == CV_16UC1 ||
+		stego.type() == CV_16UC3 ||
+		stego.type() == CV_16UC4);
 	assert(stego.cols && stego.rows);
+	assert(!lsbm_opt.get_edge_adaptive() || stego.depth() == CV_8U);
+
+	if(lsbm_opt.get_edge_adaptive()){
+		data.clear();
+		data.resize(size);
+		lsb_matching_edge_extract(stego, data, size, key, lsbm_opt);
+		return;
+	}
+
+	stegim::stats* stats = lsbm_opt.get_stats();
+
+	scope_timer permutation_timer(STATS_FIELD(stats, permutation_ns));
+	stegim::lsb_matching_permutation permutation(
+		stego, key, lsbm_opt, stegim::get_scratch_resource());
+	permutation_timer.stop();
+
+	stegim::lsb_matching_extract(stego, data, size, permutation, lsbm_opt);
+}
+
+void stegim::lsb_matching_extract(
+	const cv::Mat& stego,
+	std::vector<char>& data,
+	size_t size,
+	const stegim::lsb_matching_permutation& permutation,
+	const stegim::lsb_matching_options& lsbm_opt)
+{
+	assert(	stego.type() == CV_8UC1 ||
+		stego.type() == CV_8UC3 ||
+		stego.type() == CV_8UC4 ||
+		stego.type() == CV_16UC1 ||
+		stego.type() == CV_16UC3 ||
+		stego.type() == CV_16UC4);
+	assert(	stego.rows == permutation.get_rows() &&
+		stego.cols*stego.channels() == permutation.get_width());
+	assert(!lsbm_opt.get_edge_adaptive());
 
 	data.clear();
 	data.resize(size);
 
-	lsb_matching_extract_embedded_data(stego, data, size, key);
+	if(stego.depth() == CV_16U)
+		lsb_matching_extract_embedded_data<uint16_t>(
+			stego, data, 0, size, permutation, lsbm_opt);
+	else
+		lsb_matching_extract_embedded_data<uchar>(
+			stego, data, 0, size, permutation, lsbm_opt);
+}
+
+void lsbm_embed_range(
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const stegim::lsb_matching_permutation& permutation,
+	const stegim::lsb_matching_options& lsbm_opt,
+	size_t begin,
+	size_t end)
+{
+	size_t n_pairs = std::min(
+		((size_t) stego.rows*stego.cols*stego.channels())/2,
+		(data.size()*CHAR_BIT + 1)/2);
+
+	const uchar* bits = reinterpret_cast<const uchar*>(data.data());
+	size_t first = std::min(begin*CHAR_BIT/2, n_pairs);
+	size_t last = std::min(end*CHAR_BIT/2, n_pairs);
+
+	keystream stream(permutation.get_cipher_key());
+	keystream* cipher = lsbm_opt.get_encryption() ? &stream : nullptr;
+	size_t n_modified = 0, n_saturated = 0;
+
+	if(stego.depth() == CV_16U)
+		lsbm_embed_pairs<false, uint16_t>(stego, bits, permutation.get_pairs(),
+			first, last, cipher, nullptr, nullptr, n_modified, n_saturated);
+	else
+		lsbm_embed_pairs<false, uchar>(stego, bits, permutation.get_pairs(),
+			first, last, cipher, nullptr, nullptr, n_modified, n_saturated);
+}
+
+void lsbm_extract_range(
+	const cv::Mat& stego,
+	std::vector<char>& data,
+	const stegim::lsb_matching_permutation& permutation,
+	const stegim::lsb_matching_options& lsbm_opt,
+	size_t begin,
+	size_t end)
+{
+	if(stego.depth() == CV_16U)
+		lsb_matching_extract_embedded_data<uint16_t>(
+			stego, data, begin, end, permutation, lsbm_opt);
+	else
+		lsb_matching_extract_embedded_data<uchar>(
+			stego, data, begin, end, permutation, lsbm_opt);
 }
 
 void stegim::lsb_matching_extract(
 	const cv::Mat& stego,
 	std::vector<char>& data,
 	size_t size,
-	const std::string& key)
+	const std::string& key,
+	const stegim::lsb_matching_options& lsbm_opt)
 {
 	std::vector<char> k(key.data(), key.data() + key.size());
-	lsb_matching_extract(stego, data, size, k);
+	lsb_matching_extract(stego, data, size, k, lsbm_opt);
+}
+
+void stegim::lsb_matching_update(
+	cv::Mat& stego,
+	const std::vector<char>& old_data,
+	const std::vector<char>& new_data,
+	const stegim::lsb_matching_permutation& permutation,
+	const stegim::lsb_matching_options& lsbm_opt)
+{
+	assert(	stego.type() == CV_8UC1 ||
+		stego.type() == CV_8UC3 ||
+		stego.type() == CV_8UC4);
+	assert(	stego.rows == permutation.get_rows() &&
+		stego.cols*stego.channels() == permutation.get_width());
+	assert(!lsbm_opt.get_edge_adaptive());
+
+	stegim::stats* stats = lsbm_opt.get_stats();
+	stegim::sample_delta* delta = lsbm_opt.get_delta();
+	size_t width = permutation.get_width();
+	const lsbm_pair_list& pair = permutation.get_pairs();
+
+	/*
+	 * data beyond the capacity is truncated, as in the embedding
+	 */
+	size_t n_pairs = ((size_t) stego.rows*width)/2;
+	size_t size = std::min(new_data.size(), (2*n_pairs + CHAR_BIT - 1)/CHAR_BIT);
+
+	scope_timer embedding_timer(STATS_FIELD(stats, embedding_ns));
+
+	/*
+	 * the bytes are compared in the clear, they differ in the same
+	 * bits when encrypted
+	 */
+	keystream stream(permutation.get_cipher_key());
+	bool encryption = lsbm_opt.get_encryption();
+
+	if(delta)
+		delta->begin(stego.rows, width);
+
+	size_t n_visited = 0;
+	size_t n_modified = 0;
+	size_t n_saturated = 0;
+	for(size_t n_bytes = 0; n_bytes < size; n_bytes++){
+		if(n_bytes < old_data.size() && old_data[n_bytes] == new_data[n_bytes])
+			continue;
+
+		char byte = new_data[n_bytes];
+		if(encryption)
+			byte ^= stream.byte(n_bytes);
+
+		/*
+		 * the pairs of the byte, a pair already holding its
+		 * bits is not modified
+		 */
+		for(size_t n_bits = 0; n_bits < CHAR_BIT; n_bits += 2){
+			size_t i = (n_bytes*CHAR_BIT + n_bits)/2;
+			if(i >= n_pairs)
+				break;
+
+			const lsbm_pair& p = pair[i];
+
+			uchar* ptr_first = stego.ptr<uchar>(p.first.x) + p.first.y;
+			uchar* ptr_second = stego.ptr<uchar>(p.second.x) + p.second.y;
+
+			uchar s0, s1;
+			n_saturated += lsbm_embed_pixel_little_endian(
+					byte,
+					n_bits,
+					*ptr_first,
+					*ptr_second,
+					s0,
+					s1);
+
+			if(s0 != *ptr_first){
+				n_modified++;
+				if(delta)
+					delta->add(p.first.x*width + p.first.y, s0);
+			}
+
+			if(s1 != *ptr_second){
+				n_modified++;
+				if(delta)
+					delta->add(p.second.x*width + p.second.y, s1);
+			}
+
+			*ptr_first = s0;
+			*ptr_second = s1;
+			n_visited += 2;
+		}
+	}
+
+	if(delta)
+		delta->finish();
+
+	if(stats){
+		stats->samples_visited += n_visited;
+		stats->samples_modified += n_modified;
+		stats->saturated_adjustments += n_saturated;
+		stats->bytes_processed += size;
+	}
+}
+
+void stegim::lsb_matching_update(
+	cv::Mat& stego,
+	const std::vector<char>& old_data,
+	const std::vector<char>& new_data,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt)
+{
+	stegim::stats* stats = lsbm_opt.get_stats();
+
+	scope_timer permutation_timer(STATS_FIELD(stats, permutation_ns));
+	stegim::lsb_matching_permutation permutation(
+		stego, key, lsbm_opt, stegim::get_scratch_resource());
+	permutation_timer.stop();
+
+	lsb_matching_update(stego, old_data, new_data, permutation, lsbm_opt);
+}
+
+/*
+ * lsb_matching_permutation
+ */
+stegim::lsb_matching_permutation::lsb_matching_permutation(
+	const stegim::cover_geometry& geometry,
+	const std::vector<char>& key,
+	stegim::scratch_resource* resource)
+	: rows(geometry.get_rows()),
+	width(geometry.get_cols()*geometry.get_channels()),
+	channels(geometry.get_channels()),
+	tile_size(0),
+	pairs(stegim::scratch_allocator<lsbm_pair>(resource))
+{
+	lsbm_deviate_pair_list(this->rows, this->width, key, this->pairs);
+	lsbm_cipher_key(key, this->cipher_key);
+}
+
+stegim::lsb_matching_permutation::lsb_matching_permutation(
+	const stegim::cover_geometry& geometry,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt,
+	stegim::scratch_resource* resource)
+	: rows(geometry.get_rows()),
+	width(geometry.get_cols()*geometry.get_channels()),
+	channels(geometry.get_channels()),
+	tile_size(lsbm_opt.get_tile_size()),
+	pairs(stegim::scratch_allocator<lsbm_pair>(resource))
+{
+	assert(this->tile_size >= 0);
+	assert(this->tile_size == 0 || !lsbm_opt.get_feistel());
+
+	if(lsbm_opt.get_feistel())
+		feistel_pairs(key, lsbm_opt.get_threads());
+	else if(this->tile_size == 0)
+		lsbm_deviate_pair_list(this->rows, this->width, key, this->pairs);
+	else
+		tile_pairs(prime_hash(key.data(), key.size()), lsbm_opt.get_threads());
+
+	lsbm_cipher_key(key, this->cipher_key);
+}
+
+/*
+ * shuffles the order of the tiles and the samples inside each tile,
+ * whose pairs take a contiguous range of the list. Each tile has its
+ * own generator, so they are shuffled in parallel.
+ */
+void stegim::lsb_matching_permutation::tile_pairs(uint64_t seed, int n_threads)
+{
+	size_t tile_rows = this->tile_size;
+	size_t tile_width = (size_t) this->tile_size*this->channels;
+	size_t n_tile_rows = (this->rows + tile_rows - 1)/tile_rows;
+	size_t n_tile_cols = (this->width + tile_width - 1)/tile_width;
+	size_t n_tiles = n_tile_rows*n_tile_cols;
+
+	stegim::scratch_vector<size_t> order(n_tiles);
+	for(size_t t = 0; t < n_tiles; t++)
+		order[t] = t;
+
+	std::default_random_engine random_generator(seed);
+	for(size_t t = 0; t + 1 < n_tiles; t++){
+		std::uniform_int_distribution<size_t> uniform(t, n_tiles - 1);
+		std::swap(order[t], order[uniform(random_generator)]);
+	}
+
+	/*
+	 * the samples of the tile `t`
+	 */
+	auto tile_box = [&](size_t t, size_t& i0, size_t& j0, size_t& i1, size_t& j1){
+		i0 = (t/n_tile_cols)*tile_rows;
+		j0 = (t%n_tile_cols)*tile_width;
+		i1 = std::min(i0 + tile_rows, (size_t) this->rows);
+		j1 = std::min(j0 + tile_width, (size_t) this->width);
+	};
+
+	this->tile_bounds.resize(n_tiles + 1);
+	this->tile_bounds[0] = 0;
+	for(size_t k = 0; k < n_tiles; k++){
+		size_t i0, j0, i1, j1;
+		tile_box(order[k], i0, j0, i1, j1);
+		this->tile_bounds[k + 1] = this->tile_bounds[k] + (i1 - i0)*(j1 - j0)/2;
+	}
+
+	size_t n_samples = (size_t) this->rows*this->width;
+	this->pairs.resize((n_samples + 1)/2);
+
+	/*
+	 * a tile with an odd number of samples leaves one out
+	 */
+	const cv::Point2i none(-1, -1);
+	stegim::scratch_vector<cv::Point2i> leftover(n_tiles, none);
+
+	/*
+	 * each worker takes the tiles from a shared counter and
+	 * shuffles them in its own buffer, of the size of a full tile
+	 */
+	if(n_threads <= 0)
+		n_threads = default_thread_count();
+
+	size_t n_workers = std::min((size_t) n_threads, n_tiles);
+	std::atomic<size_t> next_tile(0);
+
+	parallel_for(n_workers, n_workers, [&](size_t){
+		stegim::scratch_vector<cv::Point2i> point;
+		point.reserve(std::min(tile_rows, (size_t) this->rows)*
+			std::min(tile_width, (size_t) this->width));
+
+		for(size_t k = next_tile++; k < n_tiles; k = next_tile++){
+			if(chunk_cancelled())
+				return;
+
+			size_t i0, j0, i1, j1;
+			tile_box(order[k], i0, j0, i1, j1);
+
+			point.clear();
+			for(size_t i = i0; i < i1; i++)
+				for(size_t j = j0; j < j1; j++)
+					point.push_back(cv::Point2i(i, j));
+
+			std::default_random_engine tile_generator(
+				seed ^ ((order[k] + 1)*0x9e3779b97f4a7c15ULL));
+
+			for(size_t i = 0; i + 1 < point.size(); i++){
+				std::uniform_int_distribution<size_t> uniform(i, point.size() - 1);
+				std::swap(point[i], point[uniform(tile_generator)]);
+			}
+
+			lsbm_pair* tile = &this->pairs[this->tile_bounds[k]];
+			for(size_t i = 0; i + 1 < point.size(); i += 2)
+				tile[i/2] = lsbm_pair(point[i], point[i + 1]);
+
+			if(point.size()%2 != 0)
+				leftover[k] = point.back();
+		}
+	});
+
+	if(chunk_cancelled())
+		return;
+
+	/*
+	 * the left out samples are paired in the order of their tiles,
+	 * the last one is paired with itself in an odd image
+	 */
+	size_t next = this->tile_bounds[n_tiles];
+	const cv::Point2i* pending = nullptr;
+	for(const cv::Point2i& p : leftover){
+		if(p.x < 0)
+			continue;
+
+		if(pending){
+			this->pairs[next++] = lsbm_pair(*pending, p);
+			pending = nullptr;
+		}else{
+			pending = &p;
+		}
+	}
+
+	if(pending)
+		this->pairs[next++] = lsbm_pair(*pending, *pending);
+
+	assert(next == this->pairs.size());
+}
+
+/*
+ * the pairs of the Feistel permutation are independent, so they are
+ * computed in chunks by the threads
+ */
+void stegim::lsb_matching_permutation::feistel_pairs(
+	const std::vector<char>& key,
+	int n_threads)
+{
+	size_t n_samples = (size_t) this->rows*this->width;
+	feistel_permutation f(n_samples, key);
+
+	size_t n_pairs = (n_samples + 1)/2;
+	this->pairs.resize(n_pairs);
+
+	const size_t chunk = 1 << 16;
+	parallel_for((n_pairs + chunk - 1)/chunk, n_threads, [&](size_t c){
+		if(chunk_cancelled())
+			return;
+
+		size_t end = std::min(n_pairs, (c + 1)*chunk);
+		for(size_t i = c*chunk; i < end; i++)
+			this->pairs[i] = feistel_pair(f, i, this->width);
+	});
+}
+
+stegim::lsb_matching_permutation::~lsb_matching_permutation()
+{}
+
+size_t stegim::lsb_matching_permutation::size() const
+{
+	return this->pairs.size();
+}
+
+const stegim::lsb_matching_permutation::pair_list&
+stegim::lsb_matching_permutation::get_pairs() const
+{
+	return this->pairs;
+}
+
+int stegim::lsb_matching_permutation::get_rows() const
+{
+	return this->rows;
+}
+
+int stegim::lsb_matching_permutation::get_width() const
+{
+	return this->width;
+}
+
+int stegim::lsb_matching_permutation::get_tile_size() const
+{
+	return this->tile_size;
+}
+
+const std::vector<size_t>&
+stegim::lsb_matching_permutation::get_tile_bounds() const
+{
+	return this->tile_bounds;
+}
+
+const uint8_t* stegim::lsb_matching_permutation::get_cipher_key() const
+{
+	return this->cipher_key;
+}
+
+/*
+ * lsb_matching_options
+ */
+stegim::lsb_matching_options::lsb_matching_options()
+	: stats_sink(nullptr),
+	delta(nullptr),
+	edge_adaptive(false),
+	tile_size(0),
+	n_threads(1),
+	encryption(false),
+	feistel(false)
+{}
+
+stegim::lsb_matching_options::~lsb_matching_options()
+{}
+
+stegim::lsb_matching_options& stegim::lsb_matching_options::set_stats(
+	stegim::stats* stats_sink)
+{
+	this->stats_sink = stats_sink;
+	return *this;
+}
+
+stegim::lsb_matching_options& stegim::lsb_matching_options::set_delta(
+	stegim::sample_delta* delta)
+{
+	this->delta = delta;
+	return *this;
+}
+
+stegim::lsb_matching_options& stegim::lsb_matching_options::set_edge_adaptive(
+	bool edge_adaptive)
+{
+	this->edge_adaptive = edge_adaptive;
+	return *this;
+}
+
+stegim::lsb_matching_options& stegim::lsb_matching_options::set_tile_size(
+	int tile_size)
+{
+	this->tile_size = tile_size;
+	return *this;
+}
+
+stegim::lsb_matching_options& stegim::lsb_matching_options::set_threads(
+	int n_threads)
+{
+	this->n_threads = n_threads;
+	return *this;
+}
+
+stegim::lsb_matching_options& stegim::lsb_matching_options::set_encryption(
+	bool encryption)
+{
+	this->encryption = encryption;
+	return *this;
+}
+
+stegim::lsb_matching_options& stegim::lsb_matching_options::set_feistel(
+	bool feistel)
+{
+	this->feistel = feistel;
+	return *this;
+}
+
+stegim::stats* stegim::lsb_matching_options::get_stats() const
+{
+	return this->stats_sink;
+}
+
+stegim::sample_delta* stegim::lsb_matching_options::get_delta() const
+{
+	return this->delta;
+}
+
+bool stegim::lsb_matching_options::get_edge_adaptive() const
+{
+	return this->edge_adaptive;
+}
+
+int stegim::lsb_matching_options::get_tile_size() const
+{
+	return this->tile_size;
+}
+
+int stegim::lsb_matching_options::get_threads() const
+{
+	return this->n_threads;
+}
+
+bool stegim::lsb_matching_options::get_encryption() const
+{
+	return this->encryption;
+}
+
+bool stegim::lsb_matching_options::get_feistel() const
+{
+	return this->feistel;
 }
@@ -0,0 +1,461 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "distortion.hpp"
+#include "kernels.hpp"
+#include "keystream.hpp"
+#include "lsb_matching_edge.hpp"
+#include "lsb_matching_kernel.hpp"
+#include "scope_timer.hpp"
+
+/*
+ * number of samples in the end of the image reserved
+ * to embed the threshold
+ */
+#define EDGE_THRESHOLD_SAMPLES CHAR_BIT
+
+/*
+ * number of pairs tested by each threshold mask
+ */
+#define EDGE_MASK_BIT 64
+
+/*
+ * the first of the last samples of `image` reserved to the threshold,
+ * which may span several rows, or SIZE_MAX if the image has fewer
+ * samples than them and no room for a threshold
+ */
+inline size_t edge_threshold_first(const cv::Mat& image)
+{
+	size_t total = (size_t) image.rows*image.cols*image.channels();
+	if(total < EDGE_THRESHOLD_SAMPLES)
+		return SIZE_MAX;
+
+	return total - EDGE_THRESHOLD_SAMPLES;
+}
+
+/*
+ * number of samples of the `i`-th row that can be used by the pairs,
+ * up to the samples reserved to the threshold. The pairs are indexed
+ * in 32 bits, the rows past them have no pair.
+ */
+inline size_t edge_row_limit(const cv::Mat& image, int i)
+{
+	size_t width = image.cols*image.channels();
+	size_t first = edge_threshold_first(image);
+	size_t row_begin = (size_t) i*width;
+
+	if(first == SIZE_MAX || row_begin >= first)
+		return 0;
+
+	if((uint64_t) (i + 1)*width - 1 > UINT32_MAX)
+		return 0;
+
+	return std::min(width, first - row_begin);
+}
+
+/*
+ * computes the histogram of the pair differences of `image`. A pair
+ * is made of the samples of the same channel in the pixels 2k and
+ * 2k+1 of a row, so the pair beginning in the sample j of a row is
+ * valid if j%(2*channels) < channels.
+ */
+void edge_histogram(const cv::Mat& image, size_t histogram[UCHAR_MAX + 1])
+{
+	size_t ch = image.channels();
+	stegim::scratch_vector<uchar> diff(image.cols*ch);
+
+	const kernel_table& kt = kernels();
+	std::fill(histogram, histogram + UCHAR_MAX + 1, 0);
+
+	for(int i = 0; i < image.rows; i++){
+		size_t limit = edge_row_limit(image, i);
+		if(limit <= ch)
+			continue;
+
+		const uchar* ptr = image.ptr<uchar>(i);
+		kt.absdiff(ptr, ptr + ch, limit - ch, diff.data());
+		kt.pair_histogram(diff.data(), limit - ch, ch, histogram);
+	}
+}
+
+/*
+ * writes in `index` the first sample of every pair of `image` whose
+ * difference is at least `threshold`, in raster order
+ */
+void edge_pair_index(
+	const cv::Mat& image,
+	int threshold,
+	stegim::scratch_vector<uint32_t>& index)
+{
+	size_t ch = image.channels();
+	size_t width = image.cols*ch;
+	stegim::scratch_vector<uchar> diff(width);
+
+	/*
+	 * valid[r] has the valid pairs of a block of
+	 * lanes beginning in a lane j with j%(2*ch) == r
+	 */
+	uint64_t valid[8] = {};
+	for(size_t r = 0; r < 2*ch; r++)
+		for(size_t b = 0; b < EDGE_MASK_BIT; b++)
+			if((r + b)%(2*ch) < ch)
+				valid[r] |= 1ULL << b;
+
+	const kernel_table& kt = kernels();
+	index.clear();
+	for(int i = 0; i < image.rows; i++){
+		size_t limit = edge_row_limit(image, i);
+		if(limit <= ch)
+			continue;
+
+		const uchar* ptr = image.ptr<uchar>(i);
+		size_t n = limit - ch;
+		kt.absdiff(ptr, ptr + ch, n, diff.data());
+
+		uint32_t row_base = i*width;
+		for(size_t j = 0; j < n; j += EDGE_MASK_BIT){
+			uint64_t mask = kt.threshold_mask(
+				diff.data() + j,
+				std::min((size_t) EDGE_MASK_BIT, n - j),
+				threshold);
+
+			mask &= valid[j%(2*ch)];
+
+			while(mask){
+				index.push_back(row_base + j + __builtin_ctzll(mask));
+				mask &= mask - 1;
+			}
+		}
+	}
+}
+
+/*
+ * shuffles the first `n` positions of `index` using the key
+ */
+void edge_shuffle(
+	stegim::scratch_vector<uint32_t>& index,
+	size_t n,
+	const std::vector<char>& key)
+{
+	std::default_random_engine random_generator(
+		prime_hash(key.data(), key.size()));
+
+	for(size_t i = 0; i < n && i < index.size(); i++){
+		std::uniform_int_distribution<size_t> uniform(i, index.size() - 1);
+		std::swap(index[i], index[uniform(random_generator)]);
+	}
+}
+
+/*
+ * reads the threshold embedded in the last samples of `stego`, 0 if
+ * it has no room for one
+ */
+int edge_read_threshold(const cv::Mat& stego)
+{
+	size_t first = edge_threshold_first(stego);
+	if(first == SIZE_MAX)
+		return 0;
+
+	size_t width = stego.cols*stego.channels();
+
+	int threshold = 0;
+	for(size_t i = first; i < first + EDGE_THRESHOLD_SAMPLES; i++)
+		threshold |= LSB(stego.ptr<uchar>(i/width)[i%width]) << (i - first);
+
+	return threshold;
+}
+
+/*
+ * embeds the `threshold` in the last samples of `stego` and returns
+ * the number of samples modified, which are added to `delta` if any,
+ * and to `dist` if not null
+ */
+size_t edge_write_threshold(
+	cv::Mat& stego,
+	int threshold,
+	stegim::sample_delta* delta,
+	distortion* dist)
+{
+	size_t first = edge_threshold_first(stego);
+	if(first == SIZE_MAX)
+		return 0;
+
+	size_t width = stego.cols*stego.channels();
+
+	size_t n_modified = 0;
+	for(size_t i = first; i < first + EDGE_THRESHOLD_SAMPLES; i++){
+		uchar* ptr = stego.ptr<uchar>(i/width) + i%width;
+		uchar s = (*ptr & ~1) | LSB(threshold >> (i - first));
+		if(s != *ptr){
+			n_modified++;
+			if(delta)
+				delta->add(i, s);
+		}
+
+		if(dist)
+			dist->add(*ptr, s);
+		*ptr = s;
+	}
+
+	return n_modified;
+}
+
+/*
+ * the lsb matching may move a pair below the threshold, in this case
+ * (`s0`, `s1`) is readjusted to (`s0` + 4*k0, `s1` + 2*k1), which
+ * keeps the embedded bits, choosing the closest to (`c0`, `c1`) with
+ * difference still greater than or equal to `threshold`
+ */
+inline void edge_readjust(
+	const uchar c0,
+	const uchar c1,
+	uchar& s0,
+	uchar& s1,
+	int threshold)
+{
+	if(std::abs(s0 - s1) >= threshold)
+		return;
+
+	int best = INT_MAX;
+	int best_s0 = s0;
+	int best_s1 = s1;
+	for(int k0 = -2; k0 <= 2; k0++){
+		for(int k1 = -2; k1 <= 2; k1++){
+			int x0 = s0 + 4*k0;
+			int x1 = s1 + 2*k1;
+
+			if(	x0 < 0 || x0 > UCHAR_MAX ||
+				x1 < 0 || x1 > UCHAR_MAX ||
+				std::abs(x0 - x1) < threshold)
+				continue;
+
+			int d = (x0 - c0)*(x0 - c0) + (x1 - c1)*(x1 - c1);
+			if(d < best){
+				best = d;
+				best_s0 = x0;
+				best_s1 = x1;
+			}
+		}
+	}
+
+	assert(best != INT_MAX);
+
+	s0 = best_s0;
+	s1 = best_s1;
+}
+
+/*
+ * The counters of the stats sink and the delta are only computed if
+ * `RECORD` is true.
+ */
+template<bool RECORD>
+void lsb_matching_edge_embed_data(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt)
+{
+	stegim::stats* stats = lsbm_opt.get_stats();
+	stegim::sample_delta* delta = lsbm_opt.get_delta();
+
+	size_t ch = cover.channels();
+	size_t width = cover.cols*ch;
+
+	/*
+	 * the pairs not used keep the cover values
+	 */
+	scope_timer copy_timer(STATS_FIELD(stats, copy_ns));
+	if(stego.data != cover.data)
+		cover.copyTo(stego);
+	copy_timer.stop();
+
+	scope_timer permutation_timer(STATS_FIELD(stats, permutation_ns));
+
+	/*
+	 * data beyond the capacity takes every pair and is truncated,
+	 * as in the other modes
+	 */
+	int threshold = std::max(0,
+		stegim::edge_region(cover).threshold(data.size()));
+
+	stegim::scratch_vector<uint32_t> index;
+	edge_pair_index(cover, threshold, index);
+
+	size_t n_pairs = std::min(index.size(), (data.size()*CHAR_BIT + 1)/2);
+	edge_shuffle(index, n_pairs, key);
+
+	permutation_timer.stop();
+
+	scope_timer embedding_timer(STATS_FIELD(stats, embedding_ns));
+
+	uint8_t cipher_key[stegim::chacha20_key_size];
+	lsbm_cipher_key(key, cipher_key);
+	keystream stream(cipher_key);
+	bool encryption = lsbm_opt.get_encryption();
+
+	size_t n_modified = 0;
+	size_t n_saturated = 0;
+	distortion dist;
+	for(size_t i = 0, n_bits = 0; i < n_pairs; i++, n_bits += 2){
+		char byte = data[n_bits/CHAR_BIT];
+		if(encryption)
+			byte ^= stream.byte(n_bits/CHAR_BIT);
+
+		const uchar* ptr_cover = cover.ptr<uchar>(index[i]/width)
+			+ index[i]%width;
+
+		uchar* ptr_stego = stego.ptr<uchar>(index[i]/width)
+			+ index[i]%width;
+
+		uchar c0 = ptr_cover[0];
+		uchar c1 = ptr_cover[ch];
+		uchar s0, s1;
+
+		bool saturated = lsbm_embed_pixel_little_endian(
+				byte,
+				n_bits%CHAR_BIT,
+				c0,
+				c1,
+				s0,
+				s1);
+
+		edge_readjust(c0, c1, s0, s1, threshold);
+
+		if(RECORD){
+			n_modified += (s0 != c0) + (s1 != c1);
+			n_saturated += saturated;
+
+			dist.add(c0, s0);
+			dist.add(c1, s1);
+
+			if(delta && s0 != c0)
+				delta->add(index[i], s0);
+			if(delta && s1 != c1)
+				delta->add(index[i] + ch, s1);
+		}
+
+		ptr_stego[0] = s0;
+		ptr_stego[ch] = s1;
+	}
+
+	n_modified += edge_write_threshold(stego, threshold, delta,
+		RECORD ? &dist : nullptr);
+
+	embedding_timer.stop();
+
+	if(RECORD && stats){
+		dist.flush(stats, stego);
+		stats->samples_visited += 2*n_pairs;
+		stats->samples_modified += n_modified;
+		stats->saturated_adjustments += n_saturated;
+		stats->bytes_processed += data.size();
+		stats->isa = kernels().name;
+	}
+}
+
+void lsb_matching_edge_embed(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt)
+{
+	if(lsbm_opt.get_stats() || lsbm_opt.get_delta())
+		lsb_matching_edge_embed_data<true>(cover, stego, data, key, lsbm_opt);
+	else
+		lsb_matching_edge_embed_data<false>(cover, stego, data, key, lsbm_opt);
+}
+
+void lsb_matching_edge_extract(
+	const cv::Mat& stego,
+	std::vector<char>& data,
+	size_t size,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt)
+{
+	stegim::stats* stats = lsbm_opt.get_stats();
+
+	size_t ch = stego.channels();
+	size_t width = stego.cols*ch;
+
+	scope_timer permutation_timer(STATS_FIELD(stats, permutation_ns));
+
+	stegim::scratch_vector<uint32_t> index;
+	edge_pair_index(stego, edge_read_threshold(stego), index);
+
+	size_t n_pairs = std::min(index.size(), (size*CHAR_BIT + 1)/2);
+	edge_shuffle(index, n_pairs, key);
+
+	permutation_timer.stop();
+
+	scope_timer embedding_timer(STATS_FIELD(stats, embedding_ns));
+
+	uint8_t cipher_key[stegim::chacha20_key_size];
+	lsbm_cipher_key(key, cipher_key);
+	keystream stream(cipher_key);
+	bool encryption = lsbm_opt.get_encryption();
+
+	for(size_t i = 0, n_bits = 0; i < n_pairs; i++, n_bits += 2){
+		const uchar* ptr_stego = stego.ptr<uchar>(index[i]/width)
+			+ index[i]%width;
+
+		data[n_bits/CHAR_BIT] = lsbm_extract_pixel_little_endian(
+				data[n_bits/CHAR_BIT],
+				ptr_stego[0],
+				ptr_stego[ch],
+				n_bits%CHAR_BIT);
+
+		/*
+		 * each byte is decrypted once its last pair is read
+		 */
+		if(encryption && (n_bits + 2)%CHAR_BIT == 0)
+			data[n_bits/CHAR_BIT] ^= stream.byte(n_bits/CHAR_BIT);
+	}
+
+	if(stats){
+		stats->samples_visited += 2*n_pairs;
+		stats->bytes_processed += size;
+		stats->isa = kernels().name;
+	}
+}
+
+/*
+ * edge_region
+ */
+stegim::edge_region::edge_region(const cv::Mat& cover)
+{
+	assert(	cover.type() == CV_8UC1 ||
+		cover.type() == CV_8UC3 ||
+		cover.type() == CV_8UC4);
+
+	size_t histogram[UCHAR_MAX + 1];
+	edge_histogram(cover, histogram);
+
+	cumulative[UCHAR_MAX + 1] = 0;
+	for(int t = UCHAR_MAX; t >= 0; t--)
+		cumulative[t] = cumulative[t + 1] + histogram[t];
+}
+
+stegim::edge_region::~edge_region()
+{}
+
+size_t stegim::edge_region::pairs(int threshold) const
+{
+	threshold = std::max(0, std::min(threshold, UCHAR_MAX + 1));
+	return cumulative[threshold];
+}
+
+size_t stegim::edge_region::capacity(int threshold) const
+{
+	return pairs(threshold)*2/CHAR_BIT;
+}
+
+int stegim::edge_region::threshold(size_t size) const
+{
+	for(int t = max_threshold; t >= 0; t--)
+		if(capacity(t) >= size)
+			return t;
+
+	return -1;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "lsb_matching.hpp"
+
+/*
+ * embeds `data` in the edge pairs of `cover`, see
+ * `lsb_matching_options::set_edge_adaptive`
+ */
+void lsb_matching_edge_embed(
+	const cv::Mat& cover,
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt);
+
+/*
+ * extracts `size` bytes embedded by `lsb_matching_edge_embed`
+ */
+void lsb_matching_edge_extract(
+	const cv::Mat& stego,
+	std::vector<char>& data,
+	size_t size,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt);
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <climits>
+#include <random>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "cipher.hpp"
+#include "lsb_matching.hpp"
+#include "pixel_kernel.hpp"
+
+/*
+ * per sample helpers shared by the lsb matching embedding modes
+ */
+
+#define LSB(X) ((X)&1)
+
+#define BIGGEST_64BIT_PRIME 18446744073709551557ULL
+
+/*
+ * simple hash function to derivate a key to a uint64_t
+ */
+inline uint64_t prime_hash(const char* str, size_t len)
+{
+	uint64_t h = BIGGEST_64BIT_PRIME;
+
+	size_t i = 0;
+	for(i = 0; i < len; i++)
+		h = h*31 + str[i] + 1;
+
+	return h;
+}
+
+/*
+ * derives from `key` the ChaCha20 key of the encryption of the data,
+ * independent of the seed of the pairs
+ */
+inline void lsbm_cipher_key(const std::vector<char>& key, uint8_t* cipher_key)
+{
+	const char info[] = "stegim lsb matching chacha20";
+
+	stegim::hkdf_sha256(key.data(), key.size(), nullptr, 0,
+		info, sizeof(info) - 1, cipher_key, stegim::chacha20_key_size);
+}
+
+/*
+ * return +/- 1 if the pixel is not saturated
+ */
+inline int rand_plus_minus_one(uchar c)
+{
+	static thread_local std::random_device random;
+
+	if(c == 0)
+		return 1;
+	else if(c == UCHAR_MAX)
+		return -1;
+
+	return (random()%2)?1:-1;
+}
+
+/*
+ * 64 random bits, the sides of the changes of the second samples
+ * of a block of pairs
+ */
+inline uint64_t random_word()
+{
+	static thread_local std::random_device random;
+
+	return (uint64_t) random() << 32 | random();
+}
+
+/*
+ * embed the `ibit`-th and the `ibit`+1-th bits of
+ * `m` in `s0` and `s1`, respectively. Returns true if
+ * `c0` was a saturated pixel that needed an adjustment.
+ */
+inline bool lsbm_embed_pixel_little_endian(
+		uchar m,
+		uchar ibit,
+		const uchar c0,
+		const uchar c1,
+		uchar& s0,
+		uchar& s1)
+{
+	stegim::lsbmr_step step = stegim::lsbmr_embed_step(
+		c0, c1, LSB(m >> ibit), LSB(m >> (ibit+1)));
+
+	s0 = c0 + step.delta0;
+
+	if(step.change1)
+		s1 = c1 + rand_plus_minus_one(c1);
+	else
+		s1 = c1;
+
+	return step.saturated;
+}
+
+/*
+ * extract the embed message in `s0` and `s1`
+ * and put in `ibit`-th bit, and `ibit`+1-th bit
+ * of d respectively
+ */
+inline uchar lsbm_extract_pixel_little_endian(
+		uchar d,
+		uchar s0,
+		uchar s1,
+		uchar ibit)
+{
+	return (d & ~(3 << ibit)) | stegim::lsbmr_extract_pair(s0, s1) << ibit;
+}
+
+inline uchar lsbm_extract_pixel_little_endian(
+		uchar d,
+		uint16_t s0,
+		uint16_t s1,
+		uchar ibit)
+{
+	return (d & ~(3 << ibit)) | stegim::lsbmr_extract_pair16(s0, s1) << ibit;
+}
+
+/*
+ * embeds the bytes [`begin`, `end`) of `data` in place in `stego`,
+ * which already holds the cover, in their pairs of `permutation`. Two
+ * ranges do not share samples, so they may be embedded in parallel.
+ * The stats sink and the delta are not used.
+ */
+void lsbm_embed_range(
+	cv::Mat& stego,
+	const std::vector<char>& data,
+	const stegim::lsb_matching_permutation& permutation,
+	const stegim::lsb_matching_options& lsbm_opt,
+	size_t begin,
+	size_t end);
+
+/*
+ * writes in `data`, already sized, the bytes [`begin`, `end`) of the
+ * data embedded in `stego` in the pairs of `permutation`
+ */
+void lsbm_extract_range(
+	const cv::Mat& stego,
+	std::vector<char>& data,
+	const stegim::lsb_matching_permutation& permutation,
+	const stegim::lsb_matching_options& lsbm_opt,
+	size_t begin,
+	size_t end);
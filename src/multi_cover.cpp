@@ -0,0 +1,259 @@
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+#include "capacity.hpp"
+#include "multi_cover.hpp"
+#include "parallel.hpp"
+
+#define MULTI_COVER_MAGIC "SGMC"
+#define MULTI_COVER_MAGIC_SIZE 4
+
+/*
+ * header embedded before each chunk
+ */
+struct chunk_header {
+	uint32_t sequence;
+	uint32_t n_chunks;
+	uint32_t length;
+	uint64_t offset;
+	uint64_t total;
+};
+
+/*
+ * writes the `n` least significant bytes of `v` in `buffer`,
+ * in little endian
+ */
+inline void write_little_endian(char* buffer, uint64_t v, int n)
+{
+	for(int i = 0; i < n; i++)
+		buffer[i] = (v >> (CHAR_BIT*i)) & 0xff;
+}
+
+/*
+ * reads `n` bytes of `buffer` in little endian
+ */
+inline uint64_t read_little_endian(const char* buffer, int n)
+{
+	uint64_t v = 0;
+	for(int i = 0; i < n; i++)
+		v |= (uint64_t)(uchar) buffer[i] << (CHAR_BIT*i);
+
+	return v;
+}
+
+void encode_chunk_header(const chunk_header& h, char* buffer)
+{
+	std::memcpy(buffer, MULTI_COVER_MAGIC, MULTI_COVER_MAGIC_SIZE);
+	write_little_endian(buffer + 4, h.sequence, 4);
+	write_little_endian(buffer + 8, h.n_chunks, 4);
+	write_little_endian(buffer + 12, h.length, 4);
+	write_little_endian(buffer + 16, h.offset, 8);
+	write_little_endian(buffer + 24, h.total, 8);
+}
+
+/*
+ * returns false if `buffer` does not hold a valid header
+ */
+bool decode_chunk_header(const char* buffer, chunk_header& h)
+{
+	if(std::memcmp(buffer, MULTI_COVER_MAGIC, MULTI_COVER_MAGIC_SIZE))
+		return false;
+
+	h.sequence = read_little_endian(buffer + 4, 4);
+	h.n_chunks = read_little_endian(buffer + 8, 4);
+	h.length = read_little_endian(buffer + 12, 4);
+	h.offset = read_little_endian(buffer + 16, 8);
+	h.total = read_little_endian(buffer + 24, 8);
+
+	return	h.sequence < h.n_chunks &&
+		h.offset <= h.total &&
+		h.length <= h.total - h.offset;
+}
+
+void stegim::multi_cover_embed(
+	const std::vector<cv::Mat>& covers,
+	std::vector<cv::Mat>& stegos,
+	const std::vector<char>& data,
+	const stegim::lsb_options& lsb_opt,
+	int n_threads)
+{
+	/*
+	 * maps the chunks onto the covers by capacity, a cover
+	 * without chunk has length 0 and offset past the data
+	 */
+	std::vector<chunk_header> chunk(covers.size());
+	size_t offset = 0;
+	uint32_t n_chunks = 0;
+
+	for(size_t i = 0; i < covers.size(); i++){
+		size_t capacity = stegim::capacity(covers[i], lsb_opt);
+		size_t room = capacity > multi_cover_header_size ?
+			capacity - multi_cover_header_size : 0;
+
+		/*
+		 * an empty data still takes a chunk, so the
+		 * extraction can tell it from no data at all
+		 */
+		bool first = n_chunks == 0 && capacity >= multi_cover_header_size;
+
+		chunk[i].length = 0;
+		chunk[i].offset = UINT64_MAX;
+
+		if(!first && (room == 0 || offset >= data.size()))
+			continue;
+
+		chunk[i].sequence = n_chunks++;
+		chunk[i].length = std::min(room, data.size() - offset);
+		chunk[i].offset = offset;
+		chunk[i].total = data.size();
+
+		offset += chunk[i].length;
+	}
+
+	assert(offset == data.size() && n_chunks > 0);
+
+	for(chunk_header& h : chunk)
+		h.n_chunks = n_chunks;
+
+	stegim::stats* stats = lsb_opt.get_stats();
+	std::mutex stats_mutex;
+
+	stegos.resize(covers.size());
+	parallel_for(covers.size(), n_threads, [&](size_t i){
+		if(chunk[i].offset == UINT64_MAX){
+			covers[i].copyTo(stegos[i]);
+			return;
+		}
+
+		std::vector<char> buffer(multi_cover_header_size + chunk[i].length);
+		encode_chunk_header(chunk[i], buffer.data());
+		if(chunk[i].length)
+			std::memcpy(
+				buffer.data() + multi_cover_header_size,
+				data.data() + chunk[i].offset,
+				chunk[i].length);
+
+		stegim::stats local_stats;
+		stegim::lsb_options opt(lsb_opt);
+		opt.set_stats(stats ? &local_stats : nullptr);
+		opt.set_delta(nullptr);
+
+		stegim::lsb_embed(covers[i], stegos[i], buffer, opt);
+
+		if(stats){
+			std::lock_guard<std::mutex> lock(stats_mutex);
+			*stats += local_stats;
+		}
+	});
+}
+
+bool stegim::multi_cover_extract(
+	const std::vector<cv::Mat>& stegos,
+	std::vector<char>& data,
+	const stegim::lsb_options& lsb_opt,
+	int n_threads)
+{
+	stegim::stats* stats = lsb_opt.get_stats();
+	std::mutex stats_mutex;
+
+	/*
+	 * the stats of each extraction are merged in the sink
+	 */
+	auto extract = [&](const cv::Mat& stego, std::vector<char>& buffer, size_t size){
+		stegim::stats local_stats;
+		stegim::lsb_options opt(lsb_opt);
+		opt.set_stats(stats ? &local_stats : nullptr);
+
+		stegim::lsb_extract(stego, buffer, size, opt);
+
+		if(stats){
+			std::lock_guard<std::mutex> lock(stats_mutex);
+			*stats += local_stats;
+		}
+	};
+
+	/*
+	 * reads the headers, the data is only allocated
+	 * once all the chunks are known
+	 */
+	std::vector<chunk_header> chunk(stegos.size());
+	std::vector<char> found(stegos.size(), false);
+	std::vector<size_t> room(stegos.size(), 0);
+
+	parallel_for(stegos.size(), n_threads, [&](size_t i){
+		size_t capacity = stegim::capacity(stegos[i], lsb_opt);
+		if(capacity < multi_cover_header_size)
+			return;
+
+		room[i] = capacity - multi_cover_header_size;
+
+		std::vector<char> buffer;
+		extract(stegos[i], buffer, multi_cover_header_size);
+
+		found[i] = decode_chunk_header(buffer.data(), chunk[i])
+			&& chunk[i].length <= room[i]
+			&& chunk[i].n_chunks <= stegos.size();
+	});
+
+	data.clear();
+
+	/*
+	 * a total the images cannot hold is not allocated
+	 */
+	uint64_t total_room = 0;
+	for(size_t r : room)
+		total_room += r;
+
+	for(size_t i = 0; i < stegos.size(); i++)
+		if(found[i] && chunk[i].total > total_room)
+			found[i] = false;
+
+	int reference = -1;
+	for(size_t i = 0; i < stegos.size() && reference == -1; i++)
+		if(found[i])
+			reference = i;
+
+	if(reference == -1)
+		return false;
+
+	/*
+	 * the headers of chunks from other data are ignored
+	 */
+	uint64_t total = chunk[reference].total;
+	uint32_t n_chunks = chunk[reference].n_chunks;
+	std::vector<char> seen(n_chunks, false);
+	size_t n_seen = 0;
+
+	for(size_t i = 0; i < stegos.size(); i++){
+		if(!found[i])
+			continue;
+
+		if(	chunk[i].total != total ||
+			chunk[i].n_chunks != n_chunks ||
+			seen[chunk[i].sequence]){
+			found[i] = false;
+			continue;
+		}
+
+		seen[chunk[i].sequence] = true;
+		n_seen++;
+	}
+
+	data.resize(total);
+
+	parallel_for(stegos.size(), n_threads, [&](size_t i){
+		if(!found[i] || chunk[i].length == 0)
+			return;
+
+		std::vector<char> buffer;
+		extract(stegos[i], buffer, multi_cover_header_size + chunk[i].length);
+
+		std::memcpy(
+			data.data() + chunk[i].offset,
+			buffer.data() + multi_cover_header_size,
+			chunk[i].length);
+	});
+
+	return n_seen == n_chunks;
+}
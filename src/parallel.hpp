@@ -0,0 +1,50 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/*
+ * number of threads to be used when the caller asks for 0
+ */
+inline int default_thread_count()
+{
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/*
+ * calls `f(i)` for every i in [0, `n`) using `n_threads` threads,
+ * or one thread per core if `n_threads` is 0. The indexes are taken
+ * in order from a shared counter, so slow items do not hold a thread
+ * with a fixed share of the work.
+ */
+template<typename F>
+void parallel_for(size_t n, int n_threads, F f)
+{
+	if(n_threads <= 0)
+		n_threads = default_thread_count();
+
+	n_threads = std::min((size_t) n_threads, n);
+
+	if(n_threads <= 1){
+		for(size_t i = 0; i < n; i++)
+			f(i);
+		return;
+	}
+
+	std::atomic<size_t> next(0);
+	auto worker = [&](){
+		for(size_t i = next++; i < n; i = next++)
+			f(i);
+	};
+
+	std::vector<std::thread> thread;
+	for(int t = 1; t < n_threads; t++)
+		thread.push_back(std::thread(worker));
+
+	worker();
+
+	for(std::thread& t : thread)
+		t.join();
+}
@@ -0,0 +1,393 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "bounded_queue.hpp"
+#include "pipeline.hpp"
+#include "scope_timer.hpp"
+
+typedef bounded_queue<size_t> job_queue;
+
+/*
+ * the link between two stages, closed when the last thread
+ * of the stage before exits. The threads waiting on the queue, for a
+ * job or for room, sleep on `changed`, which is only locked and
+ * notified when one of them waits.
+ */
+struct stage_link {
+	job_queue queue;
+	std::atomic<int> producers;
+	std::atomic<bool> closed;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::atomic<int> n_waiting;
+
+	stage_link(size_t size, int n_producers)
+		: queue(size),
+		producers(n_producers),
+		closed(false),
+		n_waiting(0)
+	{}
+};
+
+/*
+ * wakes the threads waiting on `link` after a push, a pop or the close.
+ * The fence orders the change before the read of the waiters, and the
+ * waiters raise their count behind a fence before they look at the
+ * queue, so either the waiter sees the change or it is seen waiting.
+ */
+void notify_link(stage_link& link)
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(!link.n_waiting.load())
+		return;
+
+	std::lock_guard<std::mutex> lock(link.mutex);
+	link.changed.notify_all();
+}
+
+/*
+ * takes the next job from `in`, waiting while it is empty. Returns
+ * false once `in` is closed and empty.
+ */
+bool pop_job(stage_link& in, size_t& job, uint64_t* stall_ns)
+{
+	if(in.queue.try_pop(job)){
+		notify_link(in);
+		return true;
+	}
+
+	scope_timer stall_timer(stall_ns);
+	std::unique_lock<std::mutex> lock(in.mutex);
+	in.n_waiting++;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	bool popped;
+	for(;;){
+		bool closed = in.closed.load();
+
+		popped = in.queue.try_pop(job);
+		if(popped || closed)
+			break;
+
+		in.changed.wait(lock);
+	}
+
+	in.n_waiting--;
+	lock.unlock();
+
+	if(popped)
+		notify_link(in);
+
+	return popped;
+}
+
+/*
+ * gives `job` to the stage after, waiting while `out` is full
+ */
+void push_job(stage_link& out, size_t job, uint64_t* stall_ns)
+{
+	if(!out.queue.try_push(job)){
+		scope_timer stall_timer(stall_ns);
+		std::unique_lock<std::mutex> lock(out.mutex);
+		out.n_waiting++;
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		while(!out.queue.try_push(job))
+			out.changed.wait(lock);
+
+		out.n_waiting--;
+	}
+
+	notify_link(out);
+}
+
+/*
+ * starts the threads of a stage. Each thread takes the jobs from `in`,
+ * or from [0, `n_jobs`) when `in` is null, calls `f(job)` and gives the
+ * job to `out` if `f` returns true and `out` is not null.
+ */
+template<typename F>
+void start_stage(
+	std::vector<std::thread>& threads,
+	stegim::stage_report& report,
+	std::mutex& report_mutex,
+	std::atomic<size_t>& next_job,
+	size_t n_jobs,
+	stage_link* in,
+	stage_link* out,
+	F f)
+{
+	auto worker = [&report, &report_mutex, &next_job, n_jobs, in, out, f](){
+		stegim::stage_report local;
+
+		for(;;){
+			size_t job;
+			if(in){
+				if(!pop_job(*in, job, &local.stall_ns))
+					break;
+			}else{
+				job = next_job++;
+				if(job >= n_jobs)
+					break;
+			}
+
+			scope_timer busy_timer(&local.busy_ns);
+			bool pass = f(job);
+			busy_timer.stop();
+
+			local.items++;
+
+			if(pass && out)
+				push_job(*out, job, &local.stall_ns);
+		}
+
+		if(out && --out->producers == 0){
+			out->closed = true;
+			notify_link(*out);
+		}
+
+		std::lock_guard<std::mutex> lock(report_mutex);
+		report.items += local.items;
+		report.busy_ns += local.busy_ns;
+		report.stall_ns += local.stall_ns;
+	};
+
+	for(int t = 0; t < report.n_threads; t++)
+		threads.push_back(std::thread(worker));
+}
+
+/*
+ * a stage with at least one thread
+ */
+stegim::stage_report make_stage(const char* name, int n_threads)
+{
+	stegim::stage_report report;
+	report.name = name;
+	report.n_threads = std::max(n_threads, 1);
+
+	return report;
+}
+
+/*
+ * collects the indexes of the failed jobs
+ */
+std::vector<size_t> failed_jobs(const std::vector<char>& failed)
+{
+	std::vector<size_t> v;
+	for(size_t i = 0; i < failed.size(); i++)
+		if(failed[i])
+			v.push_back(i);
+
+	return v;
+}
+
+stegim::pipeline_report stegim::pipeline_embed(
+	const std::vector<stegim::pipeline_job>& jobs,
+	const stegim::embed_function& embed,
+	const stegim::pipeline_options& pipe_opt)
+{
+	stegim::pipeline_report report;
+	scope_timer wall_timer(&report.wall_ns);
+
+	report.stages.push_back(make_stage("decode", pipe_opt.get_decode_threads()));
+	report.stages.push_back(make_stage("embed", pipe_opt.get_embed_threads()));
+	report.stages.push_back(make_stage("encode", pipe_opt.get_encode_threads()));
+
+	/*
+	 * each job is only held by a stage at a time, the queues
+	 * order the accesses to its images
+	 */
+	std::vector<cv::Mat> cover(jobs.size());
+	std::vector<cv::Mat> stego(jobs.size());
+	std::vector<char> failed(jobs.size(), false);
+
+	stage_link decoded(pipe_opt.get_queue_size(), report.stages[0].n_threads);
+	stage_link embedded(pipe_opt.get_queue_size(), report.stages[1].n_threads);
+
+	std::vector<std::thread> threads;
+	std::mutex report_mutex;
+	std::atomic<size_t> next_job(0);
+
+	start_stage(threads, report.stages[0], report_mutex, next_job, jobs.size(),
+		nullptr, &decoded, [&](size_t i){
+			cover[i] = cv::imread(jobs[i].input, pipe_opt.get_imread_flags());
+			failed[i] = cover[i].data == nullptr;
+			return !failed[i];
+		});
+
+	start_stage(threads, report.stages[1], report_mutex, next_job, jobs.size(),
+		&decoded, &embedded, [&](size_t i){
+			embed(cover[i], stego[i], jobs[i].data);
+			cover[i].release();
+			return true;
+		});
+
+	start_stage(threads, report.stages[2], report_mutex, next_job, jobs.size(),
+		&embedded, nullptr, [&](size_t i){
+			failed[i] = !cv::imwrite(jobs[i].output, stego[i]);
+			stego[i].release();
+			return true;
+		});
+
+	for(std::thread& t : threads)
+		t.join();
+
+	wall_timer.stop();
+	report.failed = failed_jobs(failed);
+
+	return report;
+}
+
+stegim::pipeline_report stegim::pipeline_extract(
+	const std::vector<std::string>& paths,
+	std::vector<std::vector<char>>& data,
+	const stegim::extract_function& extract,
+	const stegim::pipeline_options& pipe_opt)
+{
+	stegim::pipeline_report report;
+	scope_timer wall_timer(&report.wall_ns);
+
+	report.stages.push_back(make_stage("decode", pipe_opt.get_decode_threads()));
+	report.stages.push_back(make_stage("extract", pipe_opt.get_embed_threads()));
+
+	std::vector<cv::Mat> stego(paths.size());
+	std::vector<char> failed(paths.size(), false);
+
+	data.clear();
+	data.resize(paths.size());
+
+	stage_link decoded(pipe_opt.get_queue_size(), report.stages[0].n_threads);
+
+	std::vector<std::thread> threads;
+	std::mutex report_mutex;
+	std::atomic<size_t> next_job(0);
+
+	start_stage(threads, report.stages[0], report_mutex, next_job, paths.size(),
+		nullptr, &decoded, [&](size_t i){
+			stego[i] = cv::imread(paths[i], pipe_opt.get_imread_flags());
+			failed[i] = stego[i].data == nullptr;
+			return !failed[i];
+		});
+
+	start_stage(threads, report.stages[1], report_mutex, next_job, paths.size(),
+		&decoded, nullptr, [&](size_t i){
+			extract(stego[i], data[i]);
+			stego[i].release();
+			return true;
+		});
+
+	for(std::thread& t : threads)
+		t.join();
+
+	wall_timer.stop();
+	report.failed = failed_jobs(failed);
+
+	return report;
+}
+
+/*
+ * stage_report
+ */
+stegim::stage_report::stage_report()
+	: n_threads(0),
+	items(0),
+	busy_ns(0),
+	stall_ns(0)
+{}
+
+double stegim::stage_report::items_per_second() const
+{
+	if(this->busy_ns == 0)
+		return 0;
+
+	return this->items*1e9/this->busy_ns*this->n_threads;
+}
+
+/*
+ * pipeline_report
+ */
+stegim::pipeline_report::pipeline_report()
+	: wall_ns(0)
+{}
+
+/*
+ * pipeline_options
+ */
+stegim::pipeline_options::pipeline_options(
+	int decode_threads,
+	int embed_threads,
+	int encode_threads,
+	int queue_size,
+	int imread_flags)
+	: decode_threads(decode_threads),
+	embed_threads(embed_threads),
+	encode_threads(encode_threads),
+	queue_size(queue_size),
+	imread_flags(imread_flags)
+{}
+
+stegim::pipeline_options::~pipeline_options()
+{}
+
+stegim::pipeline_options& stegim::pipeline_options::set_decode_threads(
+	int decode_threads)
+{
+	this->decode_threads = decode_threads;
+	return *this;
+}
+
+stegim::pipeline_options& stegim::pipeline_options::set_embed_threads(
+	int embed_threads)
+{
+	this->embed_threads = embed_threads;
+	return *this;
+}
+
+stegim::pipeline_options& stegim::pipeline_options::set_encode_threads(
+	int encode_threads)
+{
+	this->encode_threads = encode_threads;
+	return *this;
+}
+
+stegim::pipeline_options& stegim::pipeline_options::set_queue_size(
+	int queue_size)
+{
+	this->queue_size = queue_size;
+	return *this;
+}
+
+stegim::pipeline_options& stegim::pipeline_options::set_imread_flags(
+	int imread_flags)
+{
+	this->imread_flags = imread_flags;
+	return *this;
+}
+
+int stegim::pipeline_options::get_decode_threads() const
+{
+	return this->decode_threads;
+}
+
+int stegim::pipeline_options::get_embed_threads() const
+{
+	return this->embed_threads;
+}
+
+int stegim::pipeline_options::get_encode_threads() const
+{
+	return this->encode_threads;
+}
+
+int stegim::pipeline_options::get_queue_size() const
+{
+	return this->queue_size;
+}
+
+int stegim::pipeline_options::get_imread_flags() const
+{
+	return this->imread_flags;
+}
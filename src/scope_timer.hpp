@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+/*
+ * measures the time spent in a scope, or until `stop`, and accumulates
+ * it in `*ns`. If `ns` is null the clock is never read.
+ */
+class scope_timer {
+public:
+	scope_timer(uint64_t* ns)
+		: ns(ns)
+	{
+		if(ns)
+			begin = std::chrono::steady_clock::now();
+	}
+
+	~scope_timer()
+	{
+		stop();
+	}
+
+	/*
+	 * accumulates the time until now, before the end of the scope
+	 */
+	void stop()
+	{
+		if(ns)
+			*ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - begin).count();
+
+		ns = nullptr;
+	}
+
+private:
+	uint64_t* ns;
+	std::chrono::steady_clock::time_point begin;
+};
+
+/*
+ * returns the address of a `field` of a stats sink,
+ * or null if there is no sink
+ */
+#define STATS_FIELD(STATS, FIELD) ((STATS) ? &(STATS)->FIELD : nullptr)
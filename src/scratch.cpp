@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "scratch.hpp"
+
+#define HUGE_PAGE_SIZE (2 << 20)
+
+/*
+ * rounds `n` up to a multiple of `m`, a power of two
+ */
+inline size_t round_up(size_t n, size_t m)
+{
+	return (n + m - 1) & ~(m - 1);
+}
+
+/*
+ * the resource on operator new and operator delete
+ */
+class new_delete_resource : public stegim::scratch_resource {
+public:
+	virtual void* allocate(size_t bytes, size_t alignment)
+	{
+		assert(alignment <= alignof(std::max_align_t));
+		(void) alignment;
+
+		return ::operator new(bytes);
+	}
+
+	virtual void deallocate(void* p, size_t, size_t)
+	{
+		::operator delete(p);
+	}
+};
+
+/*
+ * the resource set in the calling thread, null for the default
+ */
+thread_local stegim::scratch_resource* thread_resource = nullptr;
+
+stegim::scratch_resource::~scratch_resource()
+{}
+
+stegim::scratch_resource* stegim::new_delete_scratch_resource()
+{
+	static new_delete_resource resource;
+	return &resource;
+}
+
+stegim::scratch_resource* stegim::get_scratch_resource()
+{
+	if(thread_resource)
+		return thread_resource;
+
+	static thread_local stegim::arena_resource arena;
+	return &arena;
+}
+
+void stegim::set_scratch_resource(stegim::scratch_resource* resource)
+{
+	thread_resource = resource;
+}
+
+/*
+ * arena_resource
+ */
+stegim::arena_resource::arena_resource(size_t block_size, bool huge_pages)
+	: block_size(block_size),
+	huge_pages(huge_pages),
+	used(0),
+	live(0),
+	n_mapped(0)
+{}
+
+stegim::arena_resource::~arena_resource()
+{
+	assert(this->live == 0);
+
+	for(const block& b : this->blocks)
+		this->unmap_block(b);
+}
+
+void* stegim::arena_resource::allocate(size_t bytes, size_t alignment)
+{
+	size_t offset = round_up(this->used, alignment);
+
+	if(this->blocks.empty() || offset + bytes > this->blocks.back().size){
+		this->blocks.push_back(this->map_block(
+			std::max(this->block_size, bytes + alignment)));
+		offset = 0;
+	}
+
+	/*
+	 * the mapped blocks are page aligned
+	 */
+	this->used = offset + bytes;
+	this->live++;
+
+	return this->blocks.back().data + offset;
+}
+
+void stegim::arena_resource::deallocate(void*, size_t, size_t)
+{
+	assert(this->live > 0);
+
+	if(--this->live > 0)
+		return;
+
+	/*
+	 * the round is over, the blocks are merged so the
+	 * next one with the same sizes fits in one block
+	 */
+	this->used = 0;
+	if(this->blocks.size() > 1){
+		size_t total = 0;
+		for(const block& b : this->blocks){
+			total += b.size;
+			this->unmap_block(b);
+		}
+
+		this->blocks.clear();
+		this->blocks.push_back(this->map_block(total));
+	}
+}
+
+void stegim::arena_resource::release()
+{
+	assert(this->live == 0);
+
+	for(const block& b : this->blocks)
+		this->unmap_block(b);
+
+	this->blocks.clear();
+	this->used = 0;
+}
+
+size_t stegim::arena_resource::reserved() const
+{
+	size_t total = 0;
+	for(const block& b : this->blocks)
+		total += b.size;
+
+	return total;
+}
+
+size_t stegim::arena_resource::blocks_mapped() const
+{
+	return this->n_mapped;
+}
+
+stegim::arena_resource::block stegim::arena_resource::map_block(size_t size)
+{
+	size_t page = this->huge_pages ? HUGE_PAGE_SIZE : sysconf(_SC_PAGESIZE);
+	size = round_up(size, page);
+
+	/*
+	 * a huge page must be aligned to its size, so a page more is
+	 * mapped and the ends out of the alignment are unmapped
+	 */
+	size_t extra = this->huge_pages ? HUGE_PAGE_SIZE : 0;
+
+	void* p = mmap(nullptr, size + extra, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if(p == MAP_FAILED)
+		throw std::bad_alloc();
+
+	char* data = static_cast<char*>(p);
+
+	if(extra){
+		char* aligned = (char*) round_up((uintptr_t) data, HUGE_PAGE_SIZE);
+
+		if(aligned > data)
+			munmap(data, aligned - data);
+		if(data + extra > aligned)
+			munmap(aligned + size, data + extra - aligned);
+
+		data = aligned;
+
+#ifdef MADV_HUGEPAGE
+		madvise(data, size, MADV_HUGEPAGE);
+#endif
+	}
+
+	this->n_mapped++;
+
+	block b = { data, size };
+	return b;
+}
+
+void stegim::arena_resource::unmap_block(const block& b)
+{
+	munmap(b.data, b.size);
+}
@@ -0,0 +1,815 @@
+#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "capacity.hpp"
+#include "service.hpp"
+
+/*
+ * the jobs of the protocol
+ */
+enum service_op {
+	SERVICE_EMBED = 1,
+	SERVICE_EXTRACT,
+	SERVICE_RELEASE
+};
+
+/*
+ * the options of lsb matching sent with a job
+ */
+#define SERVICE_FEISTEL		1
+#define SERVICE_ENCRYPTION	2
+
+/*
+ * the seals required on the memory file of a frame, whose size cannot
+ * change once it is mapped by the service
+ */
+#define SERVICE_SEALS	(F_SEAL_SHRINK | F_SEAL_GROW)
+
+/*
+ * the largest key accepted, so a corrupt header cannot make the
+ * service allocate without bound
+ */
+#define SERVICE_MAX_KEY_SIZE	(1 << 16)
+
+/*
+ * the header of a job, followed by the key and, for an embedding, the
+ * data. The client and the service share the host, the fields are in
+ * its byte order. The memory file of a frame not yet mapped by the
+ * service is attached to the header.
+ */
+struct service_request {
+	uint32_t op;
+	uint32_t flags;
+	uint64_t frame_id;
+	int32_t rows, cols, type, tile_size;
+	uint64_t key_size;
+	uint64_t data_size;
+	uint32_t has_fd;
+	uint32_t padding;
+};
+
+/*
+ * the reply of a job, followed by the data extracted
+ */
+struct service_reply {
+	uint32_t ok;
+	uint32_t padding;
+	uint64_t data_size;
+};
+
+/*
+ * a frame of a client mapped by the service
+ */
+struct service_mapping {
+	void* memory;
+	size_t size;
+	cv::Mat image;
+};
+
+bool service_valid_type(int type)
+{
+	return	type == CV_8UC1 ||
+		type == CV_8UC3 ||
+		type == CV_8UC4 ||
+		type == CV_16UC1 ||
+		type == CV_16UC3 ||
+		type == CV_16UC4;
+}
+
+size_t service_frame_size(int rows, int cols, int type)
+{
+	size_t sample = CV_MAT_DEPTH(type) == CV_16U ? 2 : 1;
+	return (size_t) rows*cols*CV_MAT_CN(type)*sample;
+}
+
+bool service_send(int fd, const void* buffer, size_t size)
+{
+	const char* p = static_cast<const char*>(buffer);
+	while(size){
+		ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+		if(n < 0 && errno == EINTR)
+			continue;
+		if(n <= 0)
+			return false;
+
+		p += n;
+		size -= n;
+	}
+
+	return true;
+}
+
+bool service_recv(int fd, void* buffer, size_t size)
+{
+	char* p = static_cast<char*>(buffer);
+	while(size){
+		ssize_t n = recv(fd, p, size, 0);
+		if(n < 0 && errno == EINTR)
+			continue;
+		if(n <= 0)
+			return false;
+
+		p += n;
+		size -= n;
+	}
+
+	return true;
+}
+
+/*
+ * sends `request`, with `frame_fd` attached if it is not negative
+ */
+bool service_send_request(int fd, const service_request& request, int frame_fd)
+{
+	if(frame_fd < 0)
+		return service_send(fd, &request, sizeof(request));
+
+	char control[CMSG_SPACE(sizeof(int))];
+	std::memset(control, 0, sizeof(control));
+
+	struct iovec iov;
+	iov.iov_base = const_cast<service_request*>(&request);
+	iov.iov_len = sizeof(request);
+
+	struct msghdr msg;
+	std::memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	std::memcpy(CMSG_DATA(cmsg), &frame_fd, sizeof(int));
+
+	ssize_t n;
+	do
+		n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+	while(n < 0 && errno == EINTR);
+
+	if(n <= 0)
+		return false;
+
+	/*
+	 * the descriptor went with the first byte
+	 */
+	return service_send(fd, reinterpret_cast<const char*>(&request) + n,
+		sizeof(request) - n);
+}
+
+/*
+ * receives a request and the descriptor attached to it, -1 if none
+ */
+bool service_recv_request(int fd, service_request& request, int& frame_fd)
+{
+	frame_fd = -1;
+
+	char control[CMSG_SPACE(sizeof(int))];
+
+	struct iovec iov;
+	iov.iov_base = &request;
+	iov.iov_len = sizeof(request);
+
+	struct msghdr msg;
+	std::memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	ssize_t n;
+	do
+		n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+	while(n < 0 && errno == EINTR);
+
+	if(n <= 0)
+		return false;
+
+	for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+		cmsg = CMSG_NXTHDR(&msg, cmsg))
+		if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+			std::memcpy(&frame_fd, CMSG_DATA(cmsg), sizeof(int));
+
+	if(service_recv(fd, reinterpret_cast<char*>(&request) + n,
+		sizeof(request) - n))
+		return true;
+
+	if(frame_fd >= 0)
+		close(frame_fd);
+	return false;
+}
+
+/*
+ * the options of the lsb matching calls of a job
+ */
+stegim::lsb_matching_options service_lsbm_options(
+	const service_request& request,
+	int n_threads)
+{
+	return stegim::lsb_matching_options()
+		.set_tile_size(request.tile_size)
+		.set_feistel(request.flags & SERVICE_FEISTEL)
+		.set_encryption(request.flags & SERVICE_ENCRYPTION)
+		.set_threads(n_threads);
+}
+
+/*
+ * whether a job on a `rows`x`cols` frame of `type` is well formed, so
+ * it can be run without failing an assert of the library
+ */
+bool service_valid_request(const service_request& request)
+{
+	if(request.op == SERVICE_RELEASE)
+		return true;
+
+	if(request.op != SERVICE_EMBED && request.op != SERVICE_EXTRACT)
+		return false;
+
+	if(request.rows <= 0 || request.cols <= 0 ||
+		!service_valid_type(request.type))
+		return false;
+
+	if(request.tile_size < 0 ||
+		(request.tile_size && (request.flags & SERVICE_FEISTEL)))
+		return false;
+
+	if(request.key_size > SERVICE_MAX_KEY_SIZE)
+		return false;
+
+	stegim::cover_geometry geometry(request.rows, request.cols,
+		CV_MAT_CN(request.type));
+	return request.data_size <= stegim::lsb_matching_capacity(geometry);
+}
+
+/*
+ * service_options
+ */
+stegim::service_options::service_options()
+	: cache_size(16),
+	n_threads(1)
+{}
+
+stegim::service_options::~service_options()
+{}
+
+stegim::service_options& stegim::service_options::set_cache_size(int cache_size)
+{
+	assert(cache_size >= 0);
+	this->cache_size = cache_size;
+	return *this;
+}
+
+stegim::service_options& stegim::service_options::set_threads(int n_threads)
+{
+	this->n_threads = n_threads;
+	return *this;
+}
+
+int stegim::service_options::get_cache_size() const
+{
+	return this->cache_size;
+}
+
+int stegim::service_options::get_threads() const
+{
+	return this->n_threads;
+}
+
+/*
+ * service
+ */
+stegim::service::service(
+	const std::string& socket_path,
+	const stegim::service_options& service_opt)
+	: socket_path(socket_path),
+	service_opt(service_opt),
+	listen_fd(-1),
+	n_hits(0),
+	n_misses(0)
+{
+	stop_pipe[0] = stop_pipe[1] = -1;
+	if(pipe2(stop_pipe, O_NONBLOCK | O_CLOEXEC) != 0)
+		return;
+
+	struct sockaddr_un addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if(socket_path.size() >= sizeof(addr.sun_path))
+		return;
+	std::memcpy(addr.sun_path, socket_path.data(), socket_path.size());
+
+	/*
+	 * only a socket left by a service that did not exit cleanly is
+	 * replaced
+	 */
+	struct stat st;
+	if(lstat(socket_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+		unlink(socket_path.c_str());
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if(fd < 0)
+		return;
+
+	if(bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 ||
+		listen(fd, SOMAXCONN) != 0){
+		close(fd);
+		return;
+	}
+
+	this->listen_fd = fd;
+}
+
+stegim::service::~service()
+{
+	reap(true);
+
+	if(this->listen_fd >= 0){
+		close(this->listen_fd);
+		unlink(this->socket_path.c_str());
+	}
+
+	for(int fd : this->stop_pipe)
+		if(fd >= 0)
+			close(fd);
+}
+
+bool stegim::service::listening() const
+{
+	return this->listen_fd >= 0;
+}
+
+void stegim::service::run()
+{
+	if(this->listen_fd < 0)
+		return;
+
+	for(;;){
+		struct pollfd fds[2];
+		fds[0].fd = this->listen_fd;
+		fds[0].events = POLLIN;
+		fds[1].fd = this->stop_pipe[0];
+		fds[1].events = POLLIN;
+
+		if(poll(fds, 2, -1) < 0){
+			if(errno == EINTR)
+				continue;
+			break;
+		}
+
+		if(fds[1].revents){
+			char c;
+			while(read(this->stop_pipe[0], &c, 1) > 0);
+			break;
+		}
+
+		if(!(fds[0].revents & POLLIN))
+			continue;
+
+		int fd = accept4(this->listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+		if(fd < 0)
+			continue;
+
+		reap(false);
+
+		std::unique_ptr<connection> c(new connection);
+		c->fd = fd;
+		c->done = false;
+		c->thread = std::thread(&stegim::service::serve, this, c.get());
+
+		std::lock_guard<std::mutex> lock(this->connections_mutex);
+		this->connections.push_back(std::move(c));
+	}
+
+	/*
+	 * the clients still waiting to be accepted are reset with the
+	 * socket, instead of waiting for a reply that never comes
+	 */
+	close(this->listen_fd);
+	unlink(this->socket_path.c_str());
+	this->listen_fd = -1;
+
+	reap(true);
+}
+
+void stegim::service::stop()
+{
+	/*
+	 * write is safe in a signal handler, a full pipe already
+	 * holds a stop
+	 */
+	ssize_t n = write(this->stop_pipe[1], "", 1);
+	(void) n;
+}
+
+size_t stegim::service::cache_hits() const
+{
+	return this->n_hits;
+}
+
+size_t stegim::service::cache_misses() const
+{
+	return this->n_misses;
+}
+
+/*
+ * joins the connections finished, or all of them once shut down
+ */
+void stegim::service::reap(bool all)
+{
+	std::lock_guard<std::mutex> lock(this->connections_mutex);
+
+	for(auto it = this->connections.begin(); it != this->connections.end();){
+		connection* c = it->get();
+		if(!all && !c->done){
+			++it;
+			continue;
+		}
+
+		shutdown(c->fd, SHUT_RDWR);
+		c->thread.join();
+		close(c->fd);
+		it = this->connections.erase(it);
+	}
+}
+
+/*
+ * runs the jobs of a client until it disconnects or sends a malformed
+ * job. The descriptor is closed by reap, so it is not reused while
+ * the connection may still be shut down.
+ */
+void stegim::service::serve(connection* c)
+{
+	std::map<uint64_t, service_mapping> frames;
+	std::vector<char> key, data;
+
+	for(;;){
+		service_request request;
+		int frame_fd;
+		if(!service_recv_request(c->fd, request, frame_fd))
+			break;
+
+		bool valid = service_valid_request(request);
+
+		/*
+		 * a new frame replaces the one of the same id
+		 */
+		if(valid && frame_fd >= 0){
+			struct stat st;
+			size_t size = service_frame_size(request.rows, request.cols,
+				request.type);
+			/*
+			 * a frame whose size may still change is refused
+			 */
+			int seals = fcntl(frame_fd, F_GET_SEALS);
+			void* memory = MAP_FAILED;
+			if(	seals >= 0 && (seals & SERVICE_SEALS) == SERVICE_SEALS &&
+				fstat(frame_fd, &st) == 0 && (size_t) st.st_size >= size)
+				memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+					MAP_SHARED, frame_fd, 0);
+
+			if(memory == MAP_FAILED){
+				valid = false;
+			}else{
+				auto old = frames.find(request.frame_id);
+				if(old != frames.end())
+					munmap(old->second.memory, old->second.size);
+
+				service_mapping& m = frames[request.frame_id];
+				m.memory = memory;
+				m.size = size;
+				m.image = cv::Mat(request.rows, request.cols,
+					request.type, memory);
+			}
+		}
+
+		if(frame_fd >= 0)
+			close(frame_fd);
+
+		auto frame = frames.find(request.frame_id);
+		if(valid && request.op == SERVICE_RELEASE){
+			if(frame != frames.end()){
+				munmap(frame->second.memory, frame->second.size);
+				frames.erase(frame);
+			}
+		}else if(valid){
+			valid = frame != frames.end() &&
+				frame->second.image.rows == request.rows &&
+				frame->second.image.cols == request.cols &&
+				frame->second.image.type() == request.type;
+		}
+
+		key.resize(valid ? request.key_size : 0);
+		if(valid && !service_recv(c->fd, key.data(), key.size()))
+			break;
+
+		service_reply reply;
+		std::memset(&reply, 0, sizeof(reply));
+		reply.ok = valid;
+
+		if(valid && request.op == SERVICE_EMBED){
+			data.resize(request.data_size);
+			if(!service_recv(c->fd, data.data(), data.size()))
+				break;
+
+			cv::Mat& image = frame->second.image;
+			stegim::lsb_matching_options lsbm_opt = service_lsbm_options(
+				request, this->service_opt.get_threads());
+
+			stegim::lsb_matching_embed(image, image, data,
+				*get_permutation(image, key, lsbm_opt), lsbm_opt);
+		}else if(valid && request.op == SERVICE_EXTRACT){
+			const cv::Mat& image = frame->second.image;
+			stegim::lsb_matching_options lsbm_opt = service_lsbm_options(
+				request, this->service_opt.get_threads());
+
+			stegim::lsb_matching_extract(image, data, request.data_size,
+				*get_permutation(image, key, lsbm_opt), lsbm_opt);
+			reply.data_size = data.size();
+		}
+
+		if(!service_send(c->fd, &reply, sizeof(reply)) ||
+			!service_send(c->fd, data.data(), reply.data_size))
+			break;
+
+		/*
+		 * the stream cannot be followed after a malformed job
+		 */
+		if(!valid)
+			break;
+	}
+
+	for(auto& f : frames)
+		munmap(f.second.memory, f.second.size);
+
+	c->done = true;
+}
+
+/*
+ * the permutation of `key` on the geometry of `frame`, computed
+ * outside of the lock: two connections missing the same permutation
+ * both compute it
+ */
+stegim::service::permutation_ptr stegim::service::get_permutation(
+	const cv::Mat& frame,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt)
+{
+	/*
+	 * the tiles are cut in pixels, the frames of the same samples
+	 * per row but not of the same channels have other permutations
+	 */
+	std::string id = std::to_string(frame.rows) + ":" +
+		std::to_string(frame.cols) + ":" +
+		std::to_string(frame.type()) + ":" +
+		std::to_string(lsbm_opt.get_tile_size()) + ":" +
+		std::to_string(lsbm_opt.get_feistel()) + ":" +
+		std::string(key.begin(), key.end());
+
+	{
+		std::lock_guard<std::mutex> lock(this->cache_mutex);
+		auto it = this->cache_index.find(id);
+		if(it != this->cache_index.end()){
+			this->cache.splice(this->cache.begin(), this->cache, it->second);
+			this->n_hits++;
+			return it->second->permutation;
+		}
+	}
+
+	this->n_misses++;
+	permutation_ptr permutation(
+		new stegim::lsb_matching_permutation(frame, key, lsbm_opt));
+
+	std::lock_guard<std::mutex> lock(this->cache_mutex);
+	if(this->service_opt.get_cache_size() == 0 ||
+		this->cache_index.count(id))
+		return permutation;
+
+	this->cache.push_front(cache_entry{id, permutation});
+	this->cache_index[id] = this->cache.begin();
+
+	if(this->cache.size() > (size_t) this->service_opt.get_cache_size()){
+		this->cache_index.erase(this->cache.back().id);
+		this->cache.pop_back();
+	}
+
+	return permutation;
+}
+
+/*
+ * shared_frame
+ */
+stegim::shared_frame::shared_frame(int rows, int cols, int type)
+	: memory(MAP_FAILED),
+	size(service_frame_size(rows, cols, type))
+{
+	assert(rows > 0 && cols > 0 && service_valid_type(type));
+
+	static std::atomic<uint64_t> next_id(1);
+	this->frame_id = next_id++;
+
+	this->memfd = memfd_create("stegim frame", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if(this->memfd < 0)
+		return;
+
+	/*
+	 * the size is sealed, so the service can map the frame without
+	 * being faulted by a truncation
+	 */
+	if(	ftruncate(this->memfd, this->size) == 0 &&
+		fcntl(this->memfd, F_ADD_SEALS, SERVICE_SEALS) == 0)
+		this->memory = mmap(nullptr, this->size, PROT_READ | PROT_WRITE,
+			MAP_SHARED, this->memfd, 0);
+
+	if(this->memory != MAP_FAILED)
+		this->image = cv::Mat(rows, cols, type, this->memory);
+}
+
+stegim::shared_frame::~shared_frame()
+{
+	if(this->memory != MAP_FAILED)
+		munmap(this->memory, this->size);
+
+	if(this->memfd >= 0)
+		close(this->memfd);
+}
+
+bool stegim::shared_frame::valid() const
+{
+	return this->memory != MAP_FAILED;
+}
+
+cv::Mat& stegim::shared_frame::mat()
+{
+	return this->image;
+}
+
+const cv::Mat& stegim::shared_frame::mat() const
+{
+	return this->image;
+}
+
+int stegim::shared_frame::fd() const
+{
+	return this->memfd;
+}
+
+uint64_t stegim::shared_frame::id() const
+{
+	return this->frame_id;
+}
+
+/*
+ * service_client
+ */
+stegim::service_client::service_client()
+	: fd(-1)
+{}
+
+stegim::service_client::~service_client()
+{
+	disconnect();
+}
+
+bool stegim::service_client::connect(const std::string& socket_path)
+{
+	disconnect();
+
+	struct sockaddr_un addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if(socket_path.size() >= sizeof(addr.sun_path))
+		return false;
+	std::memcpy(addr.sun_path, socket_path.data(), socket_path.size());
+
+	this->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if(this->fd < 0)
+		return false;
+
+	if(::connect(this->fd, (struct sockaddr*) &addr, sizeof(addr)) != 0){
+		disconnect();
+		return false;
+	}
+
+	return true;
+}
+
+bool stegim::service_client::connected() const
+{
+	return this->fd >= 0;
+}
+
+void stegim::service_client::disconnect()
+{
+	if(this->fd >= 0)
+		close(this->fd);
+
+	this->fd = -1;
+	this->frames_sent.clear();
+}
+
+bool stegim::service_client::embed(
+	stegim::shared_frame& frame,
+	const std::vector<char>& data,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt)
+{
+	return submit(SERVICE_EMBED, frame, data, data.size(), key, lsbm_opt,
+		nullptr);
+}
+
+bool stegim::service_client::extract(
+	const stegim::shared_frame& frame,
+	std::vector<char>& data,
+	size_t size,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt)
+{
+	return submit(SERVICE_EXTRACT, frame, std::vector<char>(), size, key,
+		lsbm_opt, &data);
+}
+
+bool stegim::service_client::release(const stegim::shared_frame& frame)
+{
+	if(!this->frames_sent.count(frame.id()))
+		return this->fd >= 0;
+
+	return submit(SERVICE_RELEASE, frame, std::vector<char>(), 0,
+		std::vector<char>(), stegim::lsb_matching_options(), nullptr);
+}
+
+/*
+ * sends a job and waits for its reply. A job the service would refuse
+ * is refused here, keeping the connection, the service closes it.
+ */
+bool stegim::service_client::submit(
+	uint32_t op,
+	const stegim::shared_frame& frame,
+	const std::vector<char>& data,
+	size_t size,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt,
+	std::vector<char>* reply_data)
+{
+	if(this->fd < 0 || !frame.valid() || lsbm_opt.get_edge_adaptive())
+		return false;
+
+	const cv::Mat& image = frame.mat();
+
+	service_request request;
+	std::memset(&request, 0, sizeof(request));
+	request.op = op;
+	request.flags =
+		(lsbm_opt.get_feistel() ? SERVICE_FEISTEL : 0) |
+		(lsbm_opt.get_encryption() ? SERVICE_ENCRYPTION : 0);
+	request.frame_id = frame.id();
+	request.rows = image.rows;
+	request.cols = image.cols;
+	request.type = image.type();
+	request.tile_size = lsbm_opt.get_tile_size();
+	request.key_size = key.size();
+	request.data_size = size;
+	request.has_fd = op != SERVICE_RELEASE &&
+		!this->frames_sent.count(frame.id());
+
+	if(!service_valid_request(request))
+		return false;
+
+	bool sent =
+		service_send_request(this->fd, request,
+			request.has_fd ? frame.fd() : -1) &&
+		service_send(this->fd, key.data(), key.size()) &&
+		service_send(this->fd, data.data(), data.size());
+
+	service_reply reply;
+	if(!sent || !service_recv(this->fd, &reply, sizeof(reply)) || !reply.ok){
+		disconnect();
+		return false;
+	}
+
+	if(reply_data){
+		reply_data->resize(reply.data_size);
+		if(!service_recv(this->fd, reply_data->data(), reply_data->size())){
+			disconnect();
+			return false;
+		}
+	}
+
+	if(request.has_fd)
+		this->frames_sent.insert(frame.id());
+	if(op == SERVICE_RELEASE)
+		this->frames_sent.erase(frame.id());
+
+	return true;
+}
@@ -0,0 +1,68 @@
+#include <cmath>
+#include <limits>
+
+#include "stats.hpp"
+
+stegim::stats::stats()
+{
+	reset();
+}
+
+void stegim::stats::reset()
+{
+	permutation_ns = 0;
+	embedding_ns = 0;
+	copy_ns = 0;
+	samples_visited = 0;
+	samples_modified = 0;
+	saturated_adjustments = 0;
+	bytes_processed = 0;
+	framing_ns = 0;
+	bytes_corrected = 0;
+	squared_error = 0;
+	samples_total = 0;
+	sample_max = 0;
+	for(size_t& n : change_histogram)
+		n = 0;
+	isa = nullptr;
+}
+
+stegim::stats& stegim::stats::operator+=(const stegim::stats& other)
+{
+	permutation_ns += other.permutation_ns;
+	embedding_ns += other.embedding_ns;
+	copy_ns += other.copy_ns;
+	samples_visited += other.samples_visited;
+	samples_modified += other.samples_modified;
+	saturated_adjustments += other.saturated_adjustments;
+	bytes_processed += other.bytes_processed;
+	framing_ns += other.framing_ns;
+	bytes_corrected += other.bytes_corrected;
+	squared_error += other.squared_error;
+	samples_total += other.samples_total;
+	if(other.sample_max > sample_max)
+		sample_max = other.sample_max;
+	for(int i = 0; i < STATS_CHANGE_BINS; i++)
+		change_histogram[i] += other.change_histogram[i];
+
+	if(other.isa)
+		isa = other.isa;
+
+	return *this;
+}
+
+double stegim::stats::mse() const
+{
+	if(!samples_total)
+		return 0;
+
+	return (double) squared_error/samples_total;
+}
+
+double stegim::stats::psnr() const
+{
+	if(!squared_error)
+		return std::numeric_limits<double>::infinity();
+
+	return 10*std::log10((double) sample_max*sample_max/mse());
+}
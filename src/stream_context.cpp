@@ -0,0 +1,181 @@
+#include "stream_context.hpp"
+#include "thread_pool.hpp"
+
+thread_local worker_team* current_worker_team = nullptr;
+
+stegim::stream_context::stream_context(
+	const stegim::cover_geometry& geometry,
+	const std::vector<char>& key,
+	const stegim::lsb_matching_options& lsbm_opt)
+	: geometry(geometry),
+	permutation(geometry, key, lsbm_opt),
+	lsbm_opt(lsbm_opt),
+	next_submit(0),
+	next_work(0),
+	next_retrieve(0),
+	stop(false)
+{
+	assert(	geometry.get_channels() == 1 ||
+		geometry.get_channels() == 3 ||
+		geometry.get_channels() == 4);
+	assert(!lsbm_opt.get_edge_adaptive());
+
+	/*
+	 * every buffer is allocated here, so the frames are embedded
+	 * without allocations
+	 */
+	for(slot& s : this->slots){
+		s.stego.create(
+			geometry.get_rows(),
+			geometry.get_cols(),
+			CV_8UC(geometry.get_channels()));
+
+		s.data.reserve(this->capacity());
+		s.state = FREE;
+	}
+
+	if(	!this->permutation.get_tile_bounds().empty() &&
+		lsbm_opt.get_threads() != 1)
+		this->tile_workers.reset(new worker_team(lsbm_opt.get_threads()));
+
+	this->worker = std::thread(&stegim::stream_context::work, this);
+}
+
+stegim::stream_context::~stream_context()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stop = true;
+	}
+
+	this->changed.notify_all();
+	this->worker.join();
+}
+
+const cv::Mat& stegim::stream_context::process(
+	const cv::Mat& frame,
+	const std::vector<char>& data)
+{
+	this->check_frame(frame);
+	assert(data.size() <= this->capacity());
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	slot& s = this->slots[this->next_submit];
+	assert(	this->next_submit == this->next_retrieve &&
+		(s.state == FREE || s.state == HELD));
+
+	worker_team* team = current_worker_team;
+	current_worker_team = this->tile_workers.get();
+	stegim::lsb_matching_embed(frame, s.stego, data, this->permutation, this->lsbm_opt);
+	current_worker_team = team;
+
+	/*
+	 * the other buffer is released, as by a retrieve
+	 */
+	for(slot& other : this->slots)
+		if(other.state == HELD)
+			other.state = FREE;
+
+	s.state = HELD;
+	this->next_submit = this->next_work = this->next_retrieve =
+		(this->next_submit + 1)%2;
+
+	return s.stego;
+}
+
+void stegim::stream_context::submit(
+	const cv::Mat& frame,
+	const std::vector<char>& data)
+{
+	this->check_frame(frame);
+	assert(data.size() <= this->capacity());
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		slot& s = this->slots[this->next_submit];
+		assert(s.state == FREE || s.state == HELD);
+
+		s.frame = frame;
+		s.data.assign(data.begin(), data.end());
+		s.state = PENDING;
+
+		this->next_submit = (this->next_submit + 1)%2;
+	}
+
+	this->changed.notify_all();
+}
+
+const cv::Mat& stegim::stream_context::retrieve()
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	slot& s = this->slots[this->next_retrieve];
+	assert(s.state == PENDING || s.state == DONE);
+
+	this->changed.wait(lock, [&s](){ return s.state == DONE; });
+
+	/*
+	 * the previous stego is released
+	 */
+	for(slot& other : this->slots)
+		if(other.state == HELD)
+			other.state = FREE;
+
+	s.state = HELD;
+	s.frame = cv::Mat();
+	this->next_retrieve = (this->next_retrieve + 1)%2;
+
+	return s.stego;
+}
+
+size_t stegim::stream_context::capacity() const
+{
+	return stegim::lsb_matching_capacity(this->geometry);
+}
+
+void stegim::stream_context::check_frame(const cv::Mat& frame) const
+{
+	assert(	frame.rows == this->geometry.get_rows() &&
+		frame.cols == this->geometry.get_cols() &&
+		frame.channels() == this->geometry.get_channels() &&
+		frame.depth() == CV_8U);
+	(void) frame;
+}
+
+/*
+ * embeds the submitted frames in order until the context
+ * is destroyed
+ */
+void stegim::stream_context::work()
+{
+	current_worker_team = this->tile_workers.get();
+
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	for(;;){
+		this->changed.wait(lock, [this](){
+			return	this->stop ||
+				this->slots[this->next_work].state == PENDING;
+		});
+
+		if(this->stop)
+			return;
+
+		slot& s = this->slots[this->next_work];
+
+		/*
+		 * the slot is not touched by the other functions while
+		 * it is pending, so it is embedded without the lock
+		 */
+		lock.unlock();
+		stegim::lsb_matching_embed(s.frame, s.stego, s.data,
+			this->permutation, this->lsbm_opt);
+		lock.lock();
+
+		s.state = DONE;
+		this->next_work = (this->next_work + 1)%2;
+		this->changed.notify_all();
+	}
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "parallel.hpp"
+
+/*
+ * a fixed set of threads running the tasks submitted in order
+ */
+class thread_pool {
+public:
+	thread_pool(int n_threads)
+		: stop(false)
+	{
+		if(n_threads <= 0)
+			n_threads = default_thread_count();
+
+		for(int t = 0; t < n_threads; t++)
+			this->threads.push_back(std::thread([this](){ work(); }));
+	}
+
+	/*
+	 * the tasks not started are dropped
+	 */
+	~thread_pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->stop = true;
+		}
+		this->changed.notify_all();
+
+		for(std::thread& t : this->threads)
+			t.join();
+	}
+
+	void submit(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->tasks.push_back(std::move(task));
+		}
+		this->changed.notify_one();
+	}
+
+	size_t size() const
+	{
+		return this->threads.size();
+	}
+
+private:
+	void work()
+	{
+		for(;;){
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				this->changed.wait(lock, [this](){
+					return this->stop || !this->tasks.empty();
+				});
+
+				if(this->stop)
+					return;
+
+				task = std::move(this->tasks.front());
+				this->tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+
+	bool stop;
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<std::function<void()>> tasks;
+	std::vector<std::thread> threads;
+};
+
+/*
+ * a fixed set of threads running a parallel_for with the calling
+ * thread, without allocations after the construction. Its loops
+ * run one at a time.
+ */
+class worker_team {
+public:
+	worker_team(int n_threads)
+		: stop(false),
+		generation(0),
+		n_active(0)
+	{
+		if(n_threads <= 0)
+			n_threads = default_thread_count();
+
+		for(int t = 1; t < n_threads; t++)
+			this->threads.push_back(std::thread([this](){ work(); }));
+	}
+
+	~worker_team()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->stop = true;
+		}
+		this->changed.notify_all();
+
+		for(std::thread& t : this->threads)
+			t.join();
+	}
+
+	/*
+	 * calls `f(i)` for every i in [0, `n`), as parallel_for
+	 */
+	template<typename F>
+	void run(size_t n, F f)
+	{
+		std::lock_guard<std::mutex> run_lock(this->run_mutex);
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->call = [](void* f, size_t i){ (*static_cast<F*>(f))(i); };
+			this->arg = &f;
+			this->n = n;
+			this->next = 0;
+			this->n_active = this->threads.size();
+			this->generation++;
+		}
+		this->changed.notify_all();
+
+		work_items();
+
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->finished.wait(lock, [this](){ return this->n_active == 0; });
+	}
+
+	size_t size() const
+	{
+		return this->threads.size() + 1;
+	}
+
+private:
+	void work()
+	{
+		size_t seen = 0;
+		for(;;){
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				this->changed.wait(lock, [&](){
+					return this->stop || this->generation != seen;
+				});
+
+				if(this->stop)
+					return;
+
+				seen = this->generation;
+			}
+
+			work_items();
+
+			std::lock_guard<std::mutex> lock(this->mutex);
+			if(--this->n_active == 0)
+				this->finished.notify_one();
+		}
+	}
+
+	void work_items()
+	{
+		for(size_t i = this->next++; i < this->n; i = this->next++)
+			this->call(this->arg, i);
+	}
+
+	bool stop;
+	size_t generation;
+	size_t n_active;
+	std::mutex mutex;
+	std::mutex run_mutex;
+	std::condition_variable changed;
+	std::condition_variable finished;
+	std::vector<std::thread> threads;
+
+	/*
+	 * the loop being run
+	 */
+	void (*call)(void*, size_t);
+	void* arg;
+	size_t n;
+	std::atomic<size_t> next;
+};
+
+/*
+ * the team of the embedding in the calling thread, null if the
+ * threads are started by each call. Set by the stream contexts.
+ */
+extern thread_local worker_team* current_worker_team;
+
+/*
+ * the pool of the async calls, one thread per core, started by the
+ * first call
+ */
+thread_pool& library_thread_pool();
+
+/*
+ * the cancellation flag of the async job whose chunk runs in the
+ * calling thread, null outside of a chunk. The long loops that run in
+ * a single chunk, as the shuffle of the permutation, poll it to give
+ * up early.
+ */
+extern thread_local const std::atomic<bool>* chunk_cancel_flag;
+
+inline bool chunk_cancelled()
+{
+	return chunk_cancel_flag && chunk_cancel_flag->load(std::memory_order_relaxed);
+}
@@ -0,0 +1,352 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cstdlib>
+#include <ctime>
+#include <climits>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "async.hpp"
+#include "capacity.hpp"
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+cv::Mat generate_image(int rows, int cols, int type)
+{
+	cv::Mat image(rows, cols, type);
+	for(int i = 0; i < image.rows; i++){
+		uchar* ptr = image.ptr<uchar>(i);
+		for(size_t j = 0; j < image.cols*image.elemSize(); j++)
+			ptr[j] = rand()%(UCHAR_MAX+1);
+	}
+
+	return image;
+}
+
+bool equal_images(const cv::Mat& a, const cv::Mat& b)
+{
+	if(a.rows != b.rows || a.cols != b.cols || a.type() != b.type())
+		return false;
+
+	for(int i = 0; i < a.rows; i++)
+		if(memcmp(a.ptr<uchar>(i), b.ptr<uchar>(i), a.cols*a.elemSize()))
+			return false;
+
+	return true;
+}
+
+void fail(const std::string& msg)
+{
+	std::cerr << msg << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+const int types[] = {
+	CV_8UC1, CV_8UC3, CV_8UC4, CV_16UC1, CV_16UC3, CV_16UC4
+};
+
+/*
+ * lsb replacement is deterministic, the async calls give the same
+ * image and data as the sync ones whatever the strips
+ */
+void test_lsb(int type)
+{
+	cv::Mat cover = generate_image(1 + rand()%200, 1 + rand()%200, type);
+
+	stegim::lsb_options lsb_opt;
+	if(cover.channels() > 1){
+		lsb_opt.set_b(rand()%2).set_g(rand()%2).set_r(rand()%2);
+		if(cover.channels() == 4)
+			lsb_opt.set_a(rand()%2);
+		if(!lsb_opt.get_b() && !lsb_opt.get_g() && !lsb_opt.get_r() &&
+			!(cover.channels() == 4 && lsb_opt.get_a()))
+			lsb_opt.set_g(true);
+	}
+	lsb_opt.set_offset(rand()%(cover.rows*cover.cols));
+
+	stegim::async_options async_opt;
+	async_opt.set_chunk_size(1 + rand()%4096);
+
+	std::vector<char> data = generate_data(rand()%(cover.rows*cover.cols/2 + 1));
+
+	cv::Mat expected, stego;
+	stegim::lsb_embed(cover, expected, data, lsb_opt);
+	if(!stegim::lsb_embed_async(cover, stego, data, lsb_opt, async_opt).wait())
+		fail("Async lsb embedding did not complete!");
+	if(!equal_images(expected, stego))
+		fail("Async lsb stego is different from sync stego!");
+
+	std::vector<char> expected_data, extracted;
+	stegim::lsb_extract(stego, expected_data, data.size(), lsb_opt);
+	if(!stegim::lsb_extract_async(stego, extracted, data.size(), lsb_opt,
+		async_opt).wait())
+		fail("Async lsb extraction did not complete!");
+	if(extracted != expected_data)
+		fail("Async lsb extracted data is different from sync data!");
+
+	stegim::lsb_extract(stego, expected_data, -1, lsb_opt);
+	stegim::lsb_extract_async(stego, extracted, -1, lsb_opt, async_opt).wait();
+	if(extracted != expected_data)
+		fail("Async lsb whole extraction is different from sync data!");
+}
+
+/*
+ * lsb matching is randomized, the async embedding is checked by
+ * extraction
+ */
+void test_lsbm(int type, const stegim::lsb_matching_options& lsbm_opt)
+{
+	cv::Mat cover = generate_image(1 + rand()%200, 1 + rand()%200, type);
+
+	stegim::async_options async_opt;
+	async_opt.set_chunk_size(1 + rand()%4096);
+
+	std::vector<char> data = generate_data(
+		rand()%(stegim::lsb_matching_capacity(cover) + 1));
+	std::vector<char> key = generate_data(1 + rand()%32);
+
+	cv::Mat stego;
+	if(!stegim::lsb_matching_embed_async(cover, stego, data, key, lsbm_opt,
+		async_opt).wait())
+		fail("Async lsbm embedding did not complete!");
+
+	std::vector<char> extracted;
+	stegim::lsb_matching_extract(stego, extracted, data.size(), key, lsbm_opt);
+	if(extracted != data)
+		fail("Sync lsbm extracted data is different from async embedded data!");
+
+	if(!stegim::lsb_matching_extract_async(stego, extracted, data.size(), key,
+		lsbm_opt, async_opt).wait())
+		fail("Async lsbm extraction did not complete!");
+	if(extracted != data)
+		fail("Async lsbm extracted data is different from embedded data!");
+
+	/*
+	 * in place
+	 */
+	cv::Mat frame = cover.clone();
+	stegim::lsb_matching_embed_async(frame, frame, data, key, lsbm_opt,
+		async_opt).wait();
+	stegim::lsb_matching_extract(frame, extracted, data.size(), key, lsbm_opt);
+	if(extracted != data)
+		fail("Async lsbm in place embedding is broken!");
+}
+
+void test_progress()
+{
+	cv::Mat cover = generate_image(300, 300, CV_8UC3), stego;
+	std::vector<char> data = generate_data(
+		stegim::lsb_matching_capacity(cover)/2);
+	std::vector<char> key = generate_data(16);
+
+	std::mutex mutex;
+	std::vector<size_t> done;
+	size_t total = 0;
+
+	stegim::async_options async_opt;
+	async_opt.set_chunk_size(4096).set_progress([&](size_t d, size_t t){
+		std::lock_guard<std::mutex> lock(mutex);
+		done.push_back(d);
+		total = t;
+	});
+
+	stegim::lsb_matching_embed_async(cover, stego, data, key,
+		stegim::lsb_matching_options(), async_opt).wait();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if(done.size() != total || total < 3)
+		fail("Progress was not reported for each chunk!");
+	for(size_t i = 0; i < done.size(); i++)
+		if(done[i] != i + 1)
+			fail("Progress is not monotonic!");
+}
+
+/*
+ * cancelled while the permutation is computed, the job ends well
+ * before a complete one would
+ */
+void test_cancel()
+{
+	cv::Mat cover = generate_image(2000, 2000, CV_8UC3), stego;
+	std::vector<char> data = generate_data(
+		stegim::lsb_matching_capacity(cover)/2);
+	std::vector<char> key = generate_data(16);
+
+	auto begin = std::chrono::steady_clock::now();
+	if(!stegim::lsb_matching_embed_async(cover, stego, data, key).wait())
+		fail("Async lsbm embedding did not complete!");
+	auto complete = std::chrono::steady_clock::now() - begin;
+
+	stegim::async_job job = stegim::lsb_matching_embed_async(cover, stego,
+		data, key);
+	std::this_thread::sleep_for(complete/10);
+
+	begin = std::chrono::steady_clock::now();
+	job.cancel();
+	if(job.wait())
+		fail("Cancelled job completed!");
+	auto cancelled = std::chrono::steady_clock::now() - begin;
+
+	if(cancelled > complete/2)
+		fail("Cancelled job did not stop early!");
+	if(!job.done())
+		fail("Cancelled job is not done!");
+
+	/*
+	 * a callback set after the end is called at once
+	 */
+	bool called = false, completed = true;
+	job.on_complete([&](bool c){ called = true; completed = c; });
+	if(!called || completed)
+		fail("Completion callback of a cancelled job is broken!");
+
+	stegim::async_job none;
+	if(!none.done() || none.wait())
+		fail("Default job is not done as cancelled!");
+}
+
+/*
+ * the samples of `stego` are the ones of `cover` changed by one at
+ * most, as embedded
+ */
+bool embedded_from(const cv::Mat& cover, const cv::Mat& stego)
+{
+	for(int i = 0; i < cover.rows; i++){
+		const uchar* c = cover.ptr<uchar>(i);
+		const uchar* s = stego.ptr<uchar>(i);
+		for(size_t j = 0; j < cover.cols*cover.elemSize(); j++)
+			if(std::abs(c[j] - s[j]) > 1)
+				return false;
+	}
+
+	return true;
+}
+
+/*
+ * a cancelled embedding leaves the cover with the chunks done embedded
+ */
+void test_cancel_output()
+{
+	cv::Mat cover = generate_image(1000, 1000, CV_8UC3);
+	std::vector<char> data = generate_data(stegim::lsb_matching_capacity(cover));
+	std::vector<char> key = generate_data(16);
+
+	stegim::async_options async_opt;
+	async_opt.set_chunk_size(4096);
+
+	for(int i = 0; i < 10; i++){
+		cv::Mat stego(cover.rows, cover.cols, cover.type());
+		stego.setTo(0x55);
+
+		stegim::async_job job = i%2 ?
+			stegim::lsb_embed_async(cover, stego, data,
+				stegim::lsb_options(), async_opt) :
+			stegim::lsb_matching_embed_async(cover, stego, data, key,
+				stegim::lsb_matching_options(), async_opt);
+
+		std::this_thread::sleep_for(std::chrono::microseconds(rand()%2000));
+		job.cancel();
+		job.wait();
+
+		if(!embedded_from(cover, stego))
+			fail("Cancelled stego is not a partial embedding!");
+	}
+}
+
+#ifdef STEGIM_COROUTINES
+
+/*
+ * a coroutine running eagerly to its first suspension, its result is
+ * read after it ends
+ */
+struct task {
+	struct promise_type {
+		task get_return_object() { return {}; }
+		std::suspend_never initial_suspend() { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+task embed_and_extract(
+	const cv::Mat& cover,
+	const std::vector<char>& data,
+	const std::vector<char>& key,
+	std::vector<char>& extracted,
+	std::atomic<int>& result)
+{
+	cv::Mat stego;
+	bool embedded = co_await stegim::lsb_matching_embed_async(cover, stego,
+		data, key);
+	bool extracted_ok = co_await stegim::lsb_matching_extract_async(stego,
+		extracted, data.size(), key);
+
+	result = embedded && extracted_ok ? 1 : -1;
+}
+
+void test_coroutine()
+{
+	cv::Mat cover = generate_image(200, 200, CV_8UC3);
+	std::vector<char> data = generate_data(
+		stegim::lsb_matching_capacity(cover)/2);
+	std::vector<char> key = generate_data(16);
+
+	std::vector<char> extracted;
+	std::atomic<int> result(0);
+	embed_and_extract(cover, data, key, extracted, result);
+
+	while(!result)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	if(result < 0 || extracted != data)
+		fail("Awaited jobs are broken!");
+}
+
+#endif
+
+int main()
+{
+	srand(time(NULL));
+
+	for(int i = 0; i < 50; i++)
+		for(int type : types)
+			test_lsb(type);
+
+	for(int i = 0; i < 5; i++)
+		for(int type : types){
+			test_lsbm(type, stegim::lsb_matching_options());
+			test_lsbm(type, stegim::lsb_matching_options()
+				.set_tile_size(1 + rand()%64));
+			test_lsbm(type, stegim::lsb_matching_options()
+				.set_feistel(true));
+			test_lsbm(type, stegim::lsb_matching_options()
+				.set_encryption(true));
+		}
+
+	test_progress();
+	test_cancel();
+	test_cancel_output();
+
+#ifdef STEGIM_COROUTINES
+	test_coroutine();
+
+#endif
+
+	return 0;
+}
@@ -0,0 +1,162 @@
+#include <iostream>
+#include <string>
+
+#include <cstdlib>
+#include <ctime>
+#include <climits>
+
+#include <glob.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "bit_plane.hpp"
+#include "lsb.hpp"
+
+std::vector<std::string> glob(const std::string& pat){
+	glob_t glob_result;
+	glob(pat.c_str(), GLOB_TILDE, NULL, &glob_result);
+
+	std::vector<std::string> v;
+	for(unsigned int i=0; i<glob_result.gl_pathc; i++)
+		v.push_back(std::string(glob_result.gl_pathv[i]));
+
+	globfree(&glob_result);
+	return v;
+}
+
+/*
+ * naive bit plane decomposition of the channel `c` of `image`, or of
+ * all the channels interleaved if `c` is -1
+ */
+std::vector<char> naive_plane(const cv::Mat& image, int k, int c = -1)
+{
+	std::vector<char> v;
+	size_t n = 0;
+
+	for(int i = 0; i < image.rows; i++){
+		const uchar* ptr = image.ptr<uchar>(i);
+		for(int j = 0; j < image.cols*image.channels(); j++){
+			if(c != -1 && j%image.channels() != c)
+				continue;
+
+			if(n%CHAR_BIT == 0)
+				v.push_back(0);
+
+			v.back() |= ((ptr[j] >> k) & 1) << (n%CHAR_BIT);
+			n++;
+		}
+	}
+
+	return v;
+}
+
+void fail(const std::string& f, const std::string& msg)
+{
+	std::cerr << f << ": " << msg << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+void test_image(const std::string& f, const cv::Mat& image)
+{
+	/*
+	 * a region of interest is not continuous and its
+	 * rows are not byte aligned in the bitmap
+	 */
+	cv::Mat roi = image(cv::Rect(3, 5, image.cols/2 + 1, image.rows/3));
+	int k = rand()%CHAR_BIT;
+
+	for(const cv::Mat& m : { image, roi }){
+		std::vector<char> plane;
+
+		stegim::bit_plane_pack(m, plane, k);
+		if(plane != naive_plane(m, k))
+			fail(f, "packed plane is different from naive plane");
+
+		std::vector<std::vector<char>> planes;
+		stegim::bit_plane_pack_channels(m, planes, k);
+		for(int c = 0; c < m.channels(); c++)
+			if(planes[c] != naive_plane(m, k, c))
+				fail(f, "packed channel is different from naive plane");
+
+		/*
+		 * writes the plane in a inverted copy
+		 */
+		cv::Mat inverted = m.clone();
+		for(int i = 0; i < inverted.rows; i++){
+			uchar* ptr = inverted.ptr<uchar>(i);
+			for(int j = 0; j < inverted.cols*inverted.channels(); j++)
+				ptr[j] = ~ptr[j];
+		}
+
+		stegim::bit_plane_unpack(plane, inverted, k);
+
+		for(int i = 0; i < m.rows; i++){
+			const uchar* a = m.ptr<uchar>(i);
+			const uchar* b = inverted.ptr<uchar>(i);
+			for(int j = 0; j < m.cols*m.channels(); j++)
+				if((uchar)(a[j] ^ b[j]) != (uchar) ~(1 << k))
+					fail(f, "unpacked plane is wrong");
+		}
+	}
+
+	/*
+	 * the lsb plane of a grayscale image is what lsb_extract
+	 * returns without a size
+	 */
+	if(image.channels() == 1){
+		std::vector<char> plane, extracted;
+		stegim::bit_plane_pack(image, plane);
+		stegim::lsb_extract(image, extracted);
+
+		plane.resize(extracted.size());
+		if(plane != extracted)
+			fail(f, "lsb plane is different from lsb_extract");
+	}
+}
+
+void test(
+	const std::vector<std::string>& image_path_list,
+	int flags = CV_LOAD_IMAGE_GRAYSCALE)
+{
+	for( const std::string& f : image_path_list ){
+		std::cout << "File: " << f << std::endl;
+
+		cv::Mat image = cv::imread(f, flags);
+		if(image.data == nullptr)
+			fail(f, "cannot open");
+
+		test_image(f, image);
+	}
+}
+
+/*
+ * there is no CV_8UC4 cover, so random images are used
+ */
+void test_alpha(int n)
+{
+	for(int i = 0; i < n; i++){
+		cv::Mat image(rand()%300 + 16, rand()%300 + 16, CV_8UC4);
+		for(int r = 0; r < image.rows; r++){
+			uchar* ptr = image.ptr<uchar>(r);
+			for(int j = 0; j < image.cols*image.channels(); j++)
+				ptr[j] = rand()%(UCHAR_MAX + 1);
+		}
+
+		test_image("random CV_8UC4", image);
+	}
+}
+
+int main()
+{
+	srand(time(NULL));
+
+	std::string cover_image_path(COVER_IMAGE_PATH);
+
+	test(glob(cover_image_path + "/*.pgm"));
+	test(glob(cover_image_path + "/*.ppm"), CV_LOAD_IMAGE_COLOR);
+	test_alpha(10);
+
+	return 0;
+}
@@ -0,0 +1,171 @@
+#include <iostream>
+#include <string>
+
+#include <cstdlib>
+#include <ctime>
+#include <climits>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "capacity.hpp"
+#include "lsb.hpp"
+#include "lsb_matching.hpp"
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+/*
+ * random image with odd and even sizes
+ */
+cv::Mat generate_image()
+{
+	int channels[] = { 1, 3, 4 };
+	int type[] = { CV_8UC1, CV_8UC3, CV_8UC4 };
+	int c = rand()%3;
+
+	cv::Mat image(rand()%100 + 1, rand()%100 + 1, type[c]);
+	for(int i = 0; i < image.rows; i++){
+		uchar* ptr = image.ptr<uchar>(i);
+		for(int j = 0; j < image.cols*channels[c]; j++)
+			ptr[j] = rand()%(UCHAR_MAX + 1);
+	}
+
+	return image;
+}
+
+void fail(const std::string& msg)
+{
+	std::cerr << msg << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+/*
+ * embeds one byte more than the capacity and checks that
+ * exactly the capacity is embedded
+ */
+void test_lsb(int n)
+{
+	for(int i = 0; i < n; i++){
+		cv::Mat cover = generate_image();
+		cv::Mat stego;
+
+		stegim::lsb_options lsb_opt;
+		lsb_opt	.set_b(rand()%2)
+			.set_g(rand()%2)
+			.set_r(rand()%2)
+			.set_a(rand()%2)
+			.set_offset(rand()%(cover.rows*cover.cols));
+
+		if(!lsb_opt.get_b() && !lsb_opt.get_g() && !lsb_opt.get_r())
+			lsb_opt.set_b(true);
+
+		size_t capacity = stegim::capacity(cover, lsb_opt);
+		std::vector<char> data = generate_data(capacity + 1);
+
+		stegim::stats stats;
+		lsb_opt.set_stats(&stats);
+		stegim::lsb_embed(cover, stego, data, lsb_opt);
+		lsb_opt.set_stats(nullptr);
+
+		if(stats.bytes_processed != capacity)
+			fail("lsb capacity is not exact");
+
+		std::vector<char> extracted_data;
+		stegim::lsb_extract(stego, extracted_data, capacity, lsb_opt);
+
+		data.resize(capacity);
+		if(data != extracted_data)
+			fail("lsb data is different from extracted");
+	}
+}
+
+void test_lsb_matching(int n)
+{
+	for(int i = 0; i < n; i++){
+		cv::Mat cover = generate_image();
+		cv::Mat stego;
+
+		size_t capacity = stegim::lsb_matching_capacity(cover);
+		std::vector<char> data = generate_data(capacity + 1);
+		std::vector<char> key = generate_data(10);
+
+		stegim::stats stats;
+		stegim::lsb_matching_options lsbm_opt;
+		lsbm_opt.set_stats(&stats);
+		stegim::lsb_matching_embed(cover, stego, data, key, lsbm_opt);
+
+		if(stats.bytes_processed != capacity)
+			fail("lsb matching capacity is not exact");
+
+		std::vector<char> extracted_data;
+		stegim::lsb_matching_extract(stego, extracted_data, capacity, key);
+
+		data.resize(capacity);
+		if(data != extracted_data)
+			fail("lsb matching data is different from extracted");
+	}
+}
+
+void test_pack_payloads(int n)
+{
+	for(int i = 0; i < n; i++){
+		std::vector<size_t> payload(rand()%50);
+		std::vector<size_t> capacity(rand()%10);
+
+		for(size_t& p : payload)
+			p = rand()%1000;
+		for(size_t& c : capacity)
+			c = rand()%3000;
+
+		std::vector<stegim::payload_slot> slot =
+			stegim::pack_payloads(payload, capacity);
+
+		std::vector<size_t> used(capacity.size(), 0);
+		for(size_t p = 0; p < payload.size(); p++){
+			if(slot[p].cover == -1)
+				continue;
+
+			used[slot[p].cover] += payload[p];
+
+			/*
+			 * slots in the same cover must not overlap
+			 */
+			for(size_t q = 0; q < p; q++)
+				if(	slot[q].cover == slot[p].cover &&
+					slot[q].offset < slot[p].offset + payload[p] &&
+					slot[p].offset < slot[q].offset + payload[q])
+					fail("overlapping payloads");
+		}
+
+		for(size_t c = 0; c < capacity.size(); c++)
+			if(used[c] > capacity[c])
+				fail("cover capacity exceeded");
+
+		/*
+		 * a payload left out does not fit in any cover
+		 */
+		for(size_t p = 0; p < payload.size(); p++)
+			for(size_t c = 0; slot[p].cover == -1 && c < capacity.size(); c++)
+				if(capacity[c] - used[c] >= payload[p])
+					fail("payload left out fits in a cover");
+	}
+}
+
+int main()
+{
+	srand(time(NULL));
+
+	test_lsb(500);
+	test_lsb_matching(500);
+	test_pack_payloads(500);
+
+	return 0;
+}
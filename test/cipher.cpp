@@ -0,0 +1,129 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <cstdlib>
+#include <ctime>
+
+#include "cipher.hpp"
+
+std::vector<uint8_t> from_hex(const std::string& hex)
+{
+	std::vector<uint8_t> v;
+	for(size_t i = 0; i + 1 < hex.size(); i += 2)
+		v.push_back(std::stoi(hex.substr(i, 2), nullptr, 16));
+
+	return v;
+}
+
+void fail(const std::string& msg)
+{
+	std::cerr << msg << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+/*
+ * the test cases 1, 2 and 3 of RFC 5869
+ */
+void test_hkdf()
+{
+	struct {
+		std::string ikm, salt, info, okm;
+	} cases[] = {
+		{	"0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b",
+			"000102030405060708090a0b0c",
+			"f0f1f2f3f4f5f6f7f8f9",
+			"3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c5db02d56ecc4c5bf"
+			"34007208d5b887185865" },
+		{	"000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+			"202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+			"404142434445464748494a4b4c4d4e4f",
+			"606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+			"808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+			"a0a1a2a3a4a5a6a7a8a9aaabacadaeaf",
+			"b0b1b2b3b4b5b6b7b8b9babbbcbdbebfc0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+			"d0d1d2d3d4d5d6d7d8d9dadbdcdddedfe0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+			"f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff",
+			"b11e398dc80327a1c8e7f78c596a49344f012eda2d4efad8a050cc4c19afa97c"
+			"59045a99cac7827271cb41c65e590e09da3275600c2f09b8367793a9aca3db71"
+			"cc30c58179ec3e87c14c01d5c1f3434f1d87" },
+		{	"0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b",
+			"",
+			"",
+			"8da4e775a563c18f715f802a063c5a31b8a11f5c5ee1879ec3454e5f3c738d2d"
+			"9d201395faa4b61a96c8" }
+	};
+
+	for(const auto& c : cases){
+		std::vector<uint8_t> ikm = from_hex(c.ikm);
+		std::vector<uint8_t> salt = from_hex(c.salt);
+		std::vector<uint8_t> info = from_hex(c.info);
+		std::vector<uint8_t> okm = from_hex(c.okm);
+
+		std::vector<uint8_t> out(okm.size());
+		stegim::hkdf_sha256(
+			(const char*) ikm.data(), ikm.size(),
+			salt.empty() ? nullptr : (const char*) salt.data(), salt.size(),
+			(const char*) info.data(), info.size(),
+			out.data(), out.size());
+
+		if(out != okm)
+			fail("Wrong HKDF-SHA256!");
+	}
+}
+
+/*
+ * the test vector of the section 2.4.2 of RFC 8439, and the blocks of
+ * the vectorized kernels against the ones generated one at a time
+ */
+void test_chacha20()
+{
+	std::vector<uint8_t> key = from_hex(
+		"000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f");
+	std::vector<uint8_t> nonce = from_hex("000000000000004a00000000");
+
+	std::string plaintext("Ladies and Gentlemen of the class of '99: If I "
+		"could offer you only one tip for the future, sunscreen would be it.");
+	std::vector<uint8_t> ciphertext = from_hex(
+		"6e2e359a2568f98041ba0728dd0d6981e97e7aec1d4360c20a27afccfd9fae0b"
+		"f91b65c5524733ab8f593dabcd62b3571639d624e65152ab8f530c359f0861d8"
+		"07ca0dbf500d6a6156a38e088a22b65e52bc514d16ccf806818ce91ab7793736"
+		"5af90bbf74a35be6b40b8eedf2785e42874d");
+
+	std::vector<char> data(plaintext.begin(), plaintext.end());
+	stegim::chacha20_xor(key.data(), nonce.data(), 1, data.data(), data.size());
+
+	if(std::vector<uint8_t>(data.begin(), data.end()) != ciphertext)
+		fail("Wrong ChaCha20 ciphertext!");
+
+	stegim::chacha20_xor(key.data(), nonce.data(), 1, data.data(), data.size());
+	if(std::string(data.begin(), data.end()) != plaintext)
+		fail("ChaCha20 is not its inverse!");
+
+	for(size_t size : { 0, 1, 63, 64, 65, 255, 256, 1000, 1024, 1025, 5000 }){
+		key.clear();
+		for(size_t i = 0; i < stegim::chacha20_key_size; i++)
+			key.push_back(rand());
+
+		std::vector<char> stream(size, 0), blocks(size, 0);
+		stegim::chacha20_xor(key.data(), nonce.data(), 7, stream.data(), size);
+
+		for(size_t i = 0; i < size; i += 64)
+			stegim::chacha20_xor(key.data(), nonce.data(), 7 + i/64,
+				blocks.data() + i, std::min(size - i, (size_t) 64));
+
+		if(stream != blocks)
+			fail("ChaCha20 blocks differ!");
+	}
+}
+
+int main()
+{
+	srand(time(NULL));
+
+	test_hkdf();
+	test_chacha20();
+
+	return 0;
+}
@@ -0,0 +1,166 @@
+#include <iostream>
+#include <string>
+
+#include <cstdlib>
+#include <ctime>
+#include <climits>
+
+#include <glob.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "capacity.hpp"
+#include "delta.hpp"
+#include "lsb.hpp"
+#include "lsb_matching.hpp"
+
+std::vector<std::string> glob(const std::string& pat){
+	glob_t glob_result;
+	glob(pat.c_str(), GLOB_TILDE, NULL, &glob_result);
+
+	std::vector<std::string> v;
+	for(unsigned int i=0; i<glob_result.gl_pathc; i++)
+		v.push_back(std::string(glob_result.gl_pathv[i]));
+
+	globfree(&glob_result);
+	return v;
+}
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+/*
+ * number of samples with different values in `a` and `b`
+ */
+size_t count_modified(const cv::Mat& a, const cv::Mat& b)
+{
+	size_t n = 0;
+	for(int i = 0; i < a.rows; i++){
+		const uchar* ptr_a = a.ptr<uchar>(i);
+		const uchar* ptr_b = b.ptr<uchar>(i);
+		for(int j = 0; j < a.cols*a.channels(); j++)
+			n += ptr_a[j] != ptr_b[j];
+	}
+
+	return n;
+}
+
+void fail(const std::string& msg)
+{
+	std::cerr << msg << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+/*
+ * applies `delta` to a copy of `cover` and compares it with `stego`,
+ * also through an encoded copy of the delta
+ */
+void check_delta(
+	const cv::Mat& cover,
+	const cv::Mat& stego,
+	const stegim::sample_delta& delta,
+	const stegim::stats& stats)
+{
+	if(delta.size() != stats.samples_modified)
+		fail("Delta size is different from the modified samples!");
+
+	stegim::sample_delta loaded;
+	if(!loaded.set_buffer(delta.get_buffer()) || loaded.size() != delta.size())
+		fail("Cannot load the delta buffer!");
+
+	cv::Mat patched = cover.clone();
+	if(!stegim::apply_delta(patched, loaded))
+		fail("Cannot apply the delta!");
+
+	if(count_modified(patched, stego))
+		fail("Patched cover is different from the stego!");
+
+	/*
+	 * a cover of another geometry is refused
+	 */
+	cv::Mat smaller(cover.rows/2, cover.cols, cover.type());
+	cv::Mat deeper(cover.rows, cover.cols, CV_MAKETYPE(CV_16U, cover.channels()));
+	if(	stegim::apply_delta(smaller, loaded) ||
+		stegim::apply_delta(deeper, loaded))
+		fail("Delta applied to a different cover!");
+
+	/*
+	 * a truncated buffer is rejected
+	 */
+	std::vector<uchar> truncated = delta.get_buffer();
+	if(delta.size()){
+		truncated.pop_back();
+		if(loaded.set_buffer(truncated))
+			fail("Truncated delta was accepted!");
+	}
+}
+
+void test(
+	const std::vector<std::string>& image_path_list,
+	int flags = CV_LOAD_IMAGE_GRAYSCALE)
+{
+	for(const std::string& path : image_path_list){
+		std::cout << "File: " << path << std::endl;
+		cv::Mat cover = cv::imread(path, flags);
+		if(cover.data == nullptr)
+			fail("Cannot open " + path);
+
+		cv::Mat stego;
+		stegim::sample_delta delta;
+
+		/*
+		 * lsb
+		 */
+		stegim::lsb_options lsb_opt;
+		lsb_opt.set_offset(rand()%100);
+		if(flags == CV_LOAD_IMAGE_COLOR)
+			lsb_opt.set_g(false);
+
+		size_t capacity = stegim::capacity(cover, lsb_opt);
+		std::vector<char> data = generate_data(rand()%(capacity + 1));
+
+		stegim::stats stats;
+		lsb_opt.set_stats(&stats).set_delta(&delta);
+		stegim::lsb_embed(cover, stego, data, lsb_opt);
+		check_delta(cover, stego, delta, stats);
+
+		/*
+		 * lsb matching and its edge adaptive mode
+		 */
+		std::vector<char> key = generate_data(10);
+		for(bool edge_adaptive : { false, true }){
+			stegim::lsb_matching_options lsbm_opt;
+			lsbm_opt.set_edge_adaptive(edge_adaptive);
+
+			capacity = edge_adaptive ?
+				stegim::edge_region(cover).capacity(0) :
+				stegim::lsb_matching_capacity(cover);
+			data = generate_data(rand()%(capacity + 1));
+
+			stats.reset();
+			lsbm_opt.set_stats(&stats).set_delta(&delta);
+			stegim::lsb_matching_embed(cover, stego, data, key, lsbm_opt);
+			check_delta(cover, stego, delta, stats);
+		}
+	}
+}
+
+int main()
+{
+	srand(time(NULL));
+
+	std::string cover_image_path(COVER_IMAGE_PATH);
+
+	test(glob(cover_image_path + "/*.pgm"));
+	test(glob(cover_image_path + "/*.ppm"), CV_LOAD_IMAGE_COLOR);
+
+	return 0;
+}
@@ -0,0 +1,437 @@
+#include <iostream>
+#include <string>
+#include <set>
+#include <algorithm>
+
+#include <cstdlib>
+#include <ctime>
+#include <climits>
+
+#include <glob.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "capacity.hpp"
+#include "frame.hpp"
+
+std::vector<std::string> glob(const std::string& pat){
+	glob_t glob_result;
+	glob(pat.c_str(), GLOB_TILDE, NULL, &glob_result);
+
+	std::vector<std::string> v;
+	for(unsigned int i=0; i<glob_result.gl_pathc; i++)
+		v.push_back(std::string(glob_result.gl_pathv[i]));
+
+	globfree(&glob_result);
+	return v;
+}
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+/*
+ * JSON records with random fields, which compress as the text payloads
+ */
+std::vector<char> generate_text(size_t n)
+{
+	const char* names[] = { "alpha", "beta", "gamma", "delta" };
+
+	std::string text;
+	while(text.size() < n)
+		text += "{\"id\": " + std::to_string(rand()%1000) +
+			", \"name\": \"" + names[rand()%4] +
+			"\", \"active\": " + (rand()%2 ? "true" : "false") + "}\n";
+
+	return std::vector<char>(text.begin(), text.begin() + n);
+}
+
+void fail(const std::string& msg)
+{
+	std::cerr << msg << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+/*
+ * the check value of the CRC32C, and the same CRC on every
+ * alignment and length around the streams of the kernels
+ */
+void test_crc()
+{
+	const char check[] = "123456789";
+	if(stegim::crc32c(check, 9) != 0xe3069283)
+		fail("Wrong CRC32C!");
+
+	std::vector<char> data = generate_data(20000);
+	for(size_t n : { 0, 1, 7, 8, 9, 3071, 3072, 3073, 6150, 19990 }){
+		size_t begin = rand()%8;
+
+		/*
+		 * the bitwise definition
+		 */
+		uint32_t crc = ~0u;
+		for(size_t i = begin; i < begin + n; i++){
+			crc ^= (uchar) data[i];
+			for(int b = 0; b < CHAR_BIT; b++)
+				crc = (crc >> 1) ^ (0x82f63b78u & -(crc & 1));
+		}
+
+		if(stegim::crc32c(data.data() + begin, n) != ~crc)
+			fail("CRC32C differs from its definition!");
+	}
+}
+
+/*
+ * frames of every size decode to their data, with and without
+ * parity, and a frame of the wrong size is refused
+ */
+void test_round_trip()
+{
+	for(bool parity : { false, true }){
+		stegim::frame_options frame_opt;
+		frame_opt.set_parity(parity);
+
+		for(size_t size : { 0, 1, 100, 215, 216, 1000, 20000 }){
+			std::vector<char> data = generate_data(size), frame, decoded;
+			stegim::frame_encode(data, frame, frame_opt);
+
+			if(frame.size() != stegim::frame_size(size, frame_opt))
+				fail("Wrong frame size!");
+
+			if(!parity && frame.size() != size + stegim::frame_header_size)
+				fail("Frame without parity bigger than its header!");
+
+			if(!stegim::frame_decode(frame, decoded, size, frame_opt) ||
+				decoded != data)
+				fail("Decoded data is different from framed data!");
+
+			if(stegim::frame_decode(frame, decoded, size + 1, frame_opt))
+				fail("Frame decoded with a wrong size!");
+
+			/*
+			 * the length of the header is checked alone
+			 */
+			std::vector<char> head(frame.begin(),
+				frame.begin() + stegim::frame_header_size);
+			if(stegim::frame_data_size(head, frame_opt) != size)
+				fail("Wrong size in the header!");
+
+			head[rand()%4] ^= 1 << rand()%CHAR_BIT;
+			if(stegim::frame_data_size(head, frame_opt) != SIZE_MAX)
+				fail("Corrupted length accepted!");
+
+			if(size && !parity){
+				frame[stegim::frame_header_size + rand()%size] ^= 1;
+				if(stegim::frame_decode(frame, decoded, size, frame_opt))
+					fail("Corrupted frame accepted!");
+			}
+		}
+	}
+}
+
+/*
+ * up to 16 wrong bytes in each codeword are corrected, a run of
+ * wrong bytes is spread over the interleaved codewords, and more
+ * errors are never decoded to wrong data
+ */
+void test_correction()
+{
+	stegim::stats stats;
+	stegim::frame_options frame_opt;
+	frame_opt.set_stats(&stats);
+
+	for(size_t size : { 10, 500, 5000, 30000 }){
+		std::vector<char> data = generate_data(size), frame, decoded;
+		stegim::frame_encode(data, frame, frame_opt);
+
+		size_t message = size + stegim::frame_header_size;
+		size_t n_codewords = (message + 222)/223;
+
+		/*
+		 * 16 random bytes of each codeword
+		 */
+		std::vector<char> corrupted(frame);
+		size_t n_wrong = 0;
+		for(size_t c = 0; c < n_codewords; c++){
+			std::set<size_t> rows;
+			while(rows.size() < 16)
+				rows.insert(rand()%(frame.size()/n_codewords));
+
+			for(size_t t : rows){
+				corrupted[t*n_codewords + c] ^= 1 + rand()%UCHAR_MAX;
+				n_wrong++;
+			}
+		}
+
+		stats.reset();
+		if(!stegim::frame_decode(corrupted, decoded, size, frame_opt) ||
+			decoded != data)
+			fail("Frame not corrected!");
+
+		if(stats.bytes_corrected != n_wrong)
+			fail("Wrong corrected bytes!");
+
+		/*
+		 * a run of wrong bytes
+		 */
+		corrupted = frame;
+		size_t run = std::min(frame.size(), 16*n_codewords);
+		size_t begin = rand()%(frame.size() - run + 1);
+		for(size_t i = begin; i < begin + run; i++)
+			corrupted[i] = ~corrupted[i];
+
+		if(!stegim::frame_decode(corrupted, decoded, size, frame_opt) ||
+			decoded != data)
+			fail("Run of wrong bytes not corrected!");
+
+		/*
+		 * too many errors in a codeword
+		 */
+		corrupted = frame;
+		for(size_t t = 0; t < 40; t++)
+			corrupted[t*n_codewords] ^= 1 + rand()%UCHAR_MAX;
+
+		if(stegim::frame_decode(corrupted, decoded, size, frame_opt) &&
+			decoded != data)
+			fail("Wrong data decoded!");
+	}
+}
+
+/*
+ * compressed frames decode to their data, on both sides of the
+ * blocks, shrink the text and grow the random data by their block
+ * words at most, and their head gives their size
+ */
+void test_compression()
+{
+	for(stegim::frame_compression compression : {
+		stegim::COMPRESSION_LZ4, stegim::COMPRESSION_ZSTD }){
+
+		if(!stegim::compression_supported(compression))
+			continue;
+
+		for(bool parity : { false, true }){
+			stegim::frame_options frame_opt;
+			frame_opt.set_parity(parity).set_compression(compression);
+
+			for(size_t size : { 0, 1, 12, 13, 100, 5000, 65535, 65536,
+				65537, 300000 }){
+				for(bool text : { false, true }){
+					std::vector<char> data = text ?
+						generate_text(size) : generate_data(size);
+					std::vector<char> frame, decoded;
+					stegim::frame_encode(data, frame, frame_opt);
+
+					if(frame.size() > stegim::frame_size(size, frame_opt))
+						fail("Compressed frame bigger than its bound!");
+
+					if(text && size >= 5000 && frame.size() > size/3)
+						fail("Text not compressed!");
+
+					std::vector<char> head(frame.begin(), frame.begin() +
+						stegim::frame_head_size(frame_opt));
+					if(stegim::frame_size_from_head(head, size, frame_opt) !=
+						frame.size())
+						fail("Wrong compressed frame size from its head!");
+
+					if(!stegim::frame_decode(frame, decoded, size, frame_opt) ||
+						decoded != data)
+						fail("Decompressed data is different from framed data!");
+
+					if(stegim::frame_decode(frame, decoded, size + 70000,
+						frame_opt))
+						fail("Compressed frame decoded with a wrong size!");
+
+					frame.pop_back();
+					if(stegim::frame_decode(frame, decoded, size, frame_opt))
+						fail("Truncated compressed frame decoded!");
+				}
+			}
+		}
+
+		/*
+		 * the head and the stream are corrected by the parity
+		 */
+		stegim::frame_options frame_opt;
+		frame_opt.set_compression(compression);
+
+		std::vector<char> data = generate_text(20000), frame, decoded;
+		stegim::frame_encode(data, frame, frame_opt);
+		for(size_t i = 0; i < 8; i++)
+			frame[i] = ~frame[i];
+		frame[stegim::frame_head_size(frame_opt) + 3] ^= 1;
+
+		if(!stegim::frame_decode(frame, decoded, data.size(), frame_opt) ||
+			decoded != data)
+			fail("Compressed frame not corrected!");
+	}
+
+	if(!stegim::compression_supported(stegim::COMPRESSION_NONE))
+		fail("Frames without compression not supported!");
+}
+
+/*
+ * the frame capacity is the largest data whose frame fits
+ */
+void test_frame_capacity()
+{
+	for(bool parity : { false, true })
+		for(stegim::frame_compression compression : {
+			stegim::COMPRESSION_NONE, stegim::COMPRESSION_LZ4 }){
+			stegim::frame_options frame_opt;
+			frame_opt.set_parity(parity).set_compression(compression);
+
+			for(size_t raw : { 0, 1, 8, 40, 255, 1000, 70000, 1000000 }){
+				size_t size = stegim::frame_capacity(raw, frame_opt);
+
+				if(stegim::frame_size(0, frame_opt) > raw){
+					if(size)
+						fail("Frame capacity without room for a frame!");
+					continue;
+				}
+
+				if(	stegim::frame_size(size, frame_opt) > raw ||
+					stegim::frame_size(size + 1, frame_opt) <= raw)
+					fail("Frame capacity is not the largest fitting size!");
+			}
+		}
+}
+
+/*
+ * flips the least significant bit of `n` random samples of the
+ * first `n_samples` samples of `image`
+ */
+void flip_samples(cv::Mat& image, size_t n_samples, size_t n)
+{
+	size_t width = image.cols*image.channels();
+	for(size_t i = 0; i < n; i++){
+		size_t s = rand()%n_samples;
+		image.ptr<uchar>(s/width)[s%width] ^= 1;
+	}
+}
+
+/*
+ * number of samples of the frame of `size` bytes embedded by lsb
+ * in `cover`, the pixels for a color image
+ */
+size_t frame_samples(
+	const cv::Mat& cover,
+	size_t size,
+	const stegim::frame_options& frame_opt)
+{
+	size_t n_samples = stegim::frame_size(size, frame_opt)*CHAR_BIT;
+	if(cover.channels() > 1)
+		n_samples /= cover.channels();
+
+	return n_samples;
+}
+
+/*
+ * the framed embeddings survive a few flipped samples
+ */
+void test_images(const std::vector<std::string>& image_path_list, int flags)
+{
+	for(size_t f = 0; f < image_path_list.size() && f < 5; f++){
+		std::cout << "File: " << image_path_list[f] << std::endl;
+
+		cv::Mat cover = cv::imread(image_path_list[f], flags);
+		if(cover.data == nullptr)
+			fail("Cannot open " + image_path_list[f]);
+
+		stegim::frame_options frame_opt;
+		size_t size = stegim::capacity(cover)/4;
+		std::vector<char> data = generate_data(size), extracted;
+
+		cv::Mat stego;
+		stegim::lsb_embed_framed(cover, stego, data);
+		flip_samples(stego, frame_samples(cover, size, frame_opt), 20);
+
+		if(	!stegim::lsb_extract_framed(stego, extracted, size) ||
+			extracted != data)
+			fail("Framed lsb data not recovered!");
+
+		std::string key("frame");
+		stegim::lsb_matching_embed_framed(cover, stego, data, key);
+		flip_samples(stego, cover.rows*cover.cols*cover.channels(), 20);
+
+		if(	!stegim::lsb_matching_extract_framed(stego, extracted, size, key) ||
+			extracted != data)
+			fail("Framed lsb matching data not recovered!");
+
+		/*
+		 * without parity a flipped sample is detected
+		 */
+		frame_opt.set_parity(false);
+		stegim::lsb_embed_framed(cover, stego, data, stegim::lsb_options(),
+			frame_opt);
+		flip_samples(stego, frame_samples(cover, size, frame_opt), 1);
+
+		if(stegim::lsb_extract_framed(stego, extracted, size,
+			stegim::lsb_options(), frame_opt))
+			fail("Flipped sample not detected!");
+
+		/*
+		 * compressed text takes fewer samples than its raw frame
+		 */
+		frame_opt.set_parity(true).set_compression(stegim::COMPRESSION_LZ4);
+		data = generate_text(size);
+
+		std::vector<char> frame;
+		stegim::frame_encode(data, frame, frame_opt);
+		if(frame.size() >= stegim::frame_size(size, stegim::frame_options()))
+			fail("Compressed frame not smaller than the raw frame!");
+
+		stegim::lsb_embed_framed(cover, stego, data, stegim::lsb_options(),
+			frame_opt);
+		if(	!stegim::lsb_extract_framed(stego, extracted, size,
+				stegim::lsb_options(), frame_opt) ||
+			extracted != data)
+			fail("Compressed framed lsb data not recovered!");
+
+		stegim::lsb_matching_embed_framed(cover, stego, data, key,
+			stegim::lsb_matching_options(), frame_opt);
+		if(	!stegim::lsb_matching_extract_framed(stego, extracted, size, key,
+				stegim::lsb_matching_options(), frame_opt) ||
+			extracted != data)
+			fail("Compressed framed lsb matching data not recovered!");
+
+		/*
+		 * a frame larger than the cover is refused
+		 */
+		size_t largest = stegim::frame_capacity(stegim::capacity(cover));
+		if(	!stegim::lsb_embed_framed(cover, stego, generate_data(largest)) ||
+			stegim::lsb_embed_framed(cover, stego, generate_data(largest + 1)))
+			fail("Wrong lsb frame capacity!");
+
+		largest = stegim::frame_capacity(stegim::lsb_matching_capacity(cover));
+		if(	!stegim::lsb_matching_embed_framed(cover, stego,
+				generate_data(largest), key) ||
+			stegim::lsb_matching_embed_framed(cover, stego,
+				generate_data(largest + 1), key))
+			fail("Wrong lsb matching frame capacity!");
+	}
+}
+
+int main()
+{
+	srand(time(NULL));
+
+	std::string cover_image_path(COVER_IMAGE_PATH);
+
+	test_crc();
+	test_round_trip();
+	test_correction();
+	test_compression();
+	test_frame_capacity();
+	test_images(glob(cover_image_path + "/*.pgm"), CV_LOAD_IMAGE_GRAYSCALE);
+	test_images(glob(cover_image_path + "/*.ppm"), CV_LOAD_IMAGE_COLOR);
+
+	return 0;
+}
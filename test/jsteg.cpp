@@ -0,0 +1,233 @@
+#include <iostream>
+#include <string>
+#include <algorithm>
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <climits>
+
+#include <glob.h>
+#include <jpeglib.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "jsteg.hpp"
+
+std::vector<std::string> glob(const std::string& pat){
+	glob_t glob_result;
+	glob(pat.c_str(), GLOB_TILDE, NULL, &glob_result);
+
+	std::vector<std::string> v;
+	for(unsigned int i=0; i<glob_result.gl_pathc; i++)
+		v.push_back(std::string(glob_result.gl_pathv[i]));
+
+	globfree(&glob_result);
+	return v;
+}
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+void fail(const std::string& msg)
+{
+	std::cerr << msg << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+const char comment[] = "stegim jsteg test";
+
+/*
+ * encodes `image` as a JPEG of `quality`, with a COM marker
+ */
+std::vector<char> encode_jpeg(const cv::Mat& image, int quality, bool progressive)
+{
+	jpeg_compress_struct cinfo;
+	jpeg_error_mgr jerr;
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_compress(&cinfo);
+
+	unsigned char* out = nullptr;
+	unsigned long out_size = 0;
+	jpeg_mem_dest(&cinfo, &out, &out_size);
+
+	cinfo.image_width = image.cols;
+	cinfo.image_height = image.rows;
+	cinfo.input_components = image.channels();
+	cinfo.in_color_space = image.channels() == 1 ? JCS_GRAYSCALE : JCS_RGB;
+
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, quality, TRUE);
+	if(progressive)
+		jpeg_simple_progression(&cinfo);
+
+	jpeg_start_compress(&cinfo, TRUE);
+	jpeg_write_marker(&cinfo, JPEG_COM, (const JOCTET*) comment, sizeof(comment));
+
+	while(cinfo.next_scanline < cinfo.image_height){
+		JSAMPROW row = (JSAMPROW) image.ptr<uchar>(cinfo.next_scanline);
+		jpeg_write_scanlines(&cinfo, &row, 1);
+	}
+
+	jpeg_finish_compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+
+	std::vector<char> jpeg(out, out + out_size);
+	free(out);
+
+	return jpeg;
+}
+
+/*
+ * the quantized coefficients of `jpeg`, block by block, and whether
+ * it is progressive
+ */
+std::vector<int> decode_coefficients(const std::vector<char>& jpeg, bool& progressive)
+{
+	jpeg_decompress_struct cinfo;
+	jpeg_error_mgr jerr;
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_decompress(&cinfo);
+
+	jpeg_mem_src(&cinfo, (unsigned char*) jpeg.data(), jpeg.size());
+	jpeg_read_header(&cinfo, TRUE);
+	jvirt_barray_ptr* coef = jpeg_read_coefficients(&cinfo);
+	progressive = cinfo.progressive_mode;
+
+	std::vector<int> v;
+	for(int c = 0; c < cinfo.num_components; c++){
+		jpeg_component_info* comp = cinfo.comp_info + c;
+
+		for(JDIMENSION row = 0; row < comp->height_in_blocks; row++){
+			JBLOCKARRAY block = (*cinfo.mem->access_virt_barray)(
+				(j_common_ptr) &cinfo, coef[c], row, 1, FALSE);
+
+			for(JDIMENSION col = 0; col < comp->width_in_blocks; col++)
+				v.insert(v.end(), block[0][col], block[0][col] + DCTSIZE2);
+		}
+	}
+
+	jpeg_finish_decompress(&cinfo);
+	jpeg_destroy_decompress(&cinfo);
+
+	return v;
+}
+
+/*
+ * embedding in the coefficients must extract the data, change only the
+ * usable AC coefficients by at most one, keep the capacity, the mode of
+ * the image and its markers
+ */
+void test(const std::vector<std::string>& image_path_list, int flags)
+{
+	for(size_t f = 0; f < image_path_list.size(); f++){
+		std::cout << "File: " << image_path_list[f] << std::endl;
+
+		cv::Mat image = cv::imread(image_path_list[f], flags);
+		if(image.data == nullptr)
+			fail("Cannot open " + image_path_list[f]);
+
+		bool progressive = f%2;
+		std::vector<char> cover = encode_jpeg(image, 50 + rand()%50, progressive);
+
+		size_t capacity = stegim::jsteg_capacity(cover);
+		if(capacity == 0)
+			fail("No capacity!");
+
+		for(bool matching : { false, true }){
+			std::vector<char> data = generate_data(rand()%(capacity + 1));
+			std::vector<char> key = generate_data(10);
+
+			stegim::stats stats;
+			stegim::jsteg_options jsteg_opt;
+			jsteg_opt.set_matching(matching).set_stats(&stats);
+
+			std::vector<char> stego, extracted;
+			if(!stegim::jsteg_embed(cover, stego, data, key, jsteg_opt))
+				fail("Cannot embed!");
+
+			if(	!stegim::jsteg_extract(stego, extracted, data.size(), key) ||
+				extracted != data)
+				fail("Extracted data is different from embedded data!");
+
+			if(stegim::jsteg_capacity(stego) != capacity)
+				fail("Capacity changed!");
+
+			bool cover_progressive, stego_progressive;
+			std::vector<int> c = decode_coefficients(cover, cover_progressive);
+			std::vector<int> s = decode_coefficients(stego, stego_progressive);
+
+			if(c.size() != s.size() || cover_progressive != stego_progressive)
+				fail("Different image!");
+
+			size_t n_modified = 0;
+			for(size_t i = 0; i < c.size(); i++){
+				if(c[i] == s[i])
+					continue;
+
+				n_modified++;
+				if(	i%DCTSIZE2 == 0 || abs(c[i] - s[i]) > 1 ||
+					c[i] == 0 || c[i] == 1 || s[i] == 0 || s[i] == 1)
+					fail("Wrong coefficient changed!");
+			}
+
+			if(	stats.samples_modified != n_modified ||
+				stats.samples_visited != data.size()*CHAR_BIT ||
+				stats.bytes_processed != data.size())
+				fail("Wrong stats!");
+
+			if(std::search(stego.begin(), stego.end(),
+				comment, comment + sizeof(comment)) == stego.end())
+				fail("Marker lost!");
+		}
+	}
+}
+
+/*
+ * anything but a JPEG is refused instead of exiting the process
+ */
+void test_invalid()
+{
+	std::vector<char> garbage = generate_data(1000);
+	std::vector<char> stego, data;
+
+	if(	stegim::jsteg_capacity(garbage) ||
+		stegim::jsteg_embed(garbage, stego, data, "key") ||
+		stegim::jsteg_extract(garbage, data, 1, "key"))
+		fail("Invalid JPEG accepted!");
+
+	cv::Mat image(16, 16, CV_8UC1);
+	image.setTo(128);
+	std::vector<char> flat = encode_jpeg(image, 90, false);
+
+	/*
+	 * a flat image has no usable coefficient
+	 */
+	if(	stegim::jsteg_capacity(flat) ||
+		stegim::jsteg_extract(flat, data, 1, "key"))
+		fail("Data extracted beyond the capacity!");
+
+	if(stegim::jsteg_embed(flat, stego, std::vector<char>(1), "key"))
+		fail("Data embedded beyond the capacity!");
+}
+
+int main()
+{
+	srand(time(NULL));
+
+	std::string cover_image_path(COVER_IMAGE_PATH);
+
+	test(glob(cover_image_path + "/*.pgm"), CV_LOAD_IMAGE_GRAYSCALE);
+	test(glob(cover_image_path + "/*.ppm"), CV_LOAD_IMAGE_COLOR);
+	test_invalid();
+
+	return 0;
+}
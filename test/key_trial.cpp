@@ -0,0 +1,157 @@
+#include <iostream>
+#include <string>
+
+#include <cstdlib>
+#include <ctime>
+#include <climits>
+
+#include <glob.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "key_trial.hpp"
+
+std::vector<std::string> glob(const std::string& pat){
+	glob_t glob_result;
+	glob(pat.c_str(), GLOB_TILDE, NULL, &glob_result);
+
+	std::vector<std::string> v;
+	for(unsigned int i=0; i<glob_result.gl_pathc; i++)
+		v.push_back(std::string(glob_result.gl_pathv[i]));
+
+	globfree(&glob_result);
+	return v;
+}
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+void fail(const std::string& msg)
+{
+	std::cerr << msg << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+std::vector<std::vector<char>> generate_keys(size_t n)
+{
+	std::vector<std::vector<char>> keys;
+	for(size_t i = 0; i < n; i++)
+		keys.push_back(generate_data(1 + rand()%32));
+
+	return keys;
+}
+
+/*
+ * the embedding key is found among `n_keys` candidates, and the first
+ * one is reported if it is given twice. Without it no key is accepted
+ * and every key is tried.
+ */
+void test_trial(
+	const cv::Mat& cover,
+	const stegim::lsb_matching_options& lsbm_opt,
+	const stegim::frame_options& frame_opt,
+	size_t n_keys)
+{
+	std::vector<char> data = generate_data(rand()%1000);
+	std::vector<char> key = generate_data(16);
+
+	cv::Mat stego;
+	stegim::lsb_matching_embed_framed(cover, stego, data, key, lsbm_opt,
+		frame_opt);
+
+	stegim::key_trial_options trial_opt;
+	trial_opt.set_lsb_matching_options(lsbm_opt).set_frame_options(frame_opt);
+
+	std::vector<std::vector<char>> keys = generate_keys(n_keys);
+	size_t index = rand()%n_keys;
+	keys[index] = key;
+
+	stegim::key_trial_result result =
+		stegim::lsb_matching_try_keys(stego, keys, trial_opt);
+
+	if(!result.found || result.key_index != index || result.data != data)
+		fail("Key not found!");
+
+	if(result.keys_tried < index + 1 || result.keys_tried > n_keys)
+		fail("Wrong number of keys tried!");
+
+	size_t second = index + 1 + rand()%(n_keys - index);
+	keys.insert(keys.begin() + second, key);
+
+	result = stegim::lsb_matching_try_keys(stego, keys,
+		stegim::key_trial_options(trial_opt).set_threads(4));
+
+	if(!result.found || result.key_index != index)
+		fail("Key found is not the first one!");
+
+	keys.erase(keys.begin() + second);
+	keys.erase(keys.begin() + index);
+
+	result = stegim::lsb_matching_try_keys(stego, keys, trial_opt);
+
+	if(result.found || result.keys_tried != keys.size())
+		fail("Wrong key accepted!");
+
+	if(result.keys_rejected_by_header != keys.size())
+		fail("Keys not rejected by the header!");
+}
+
+void test_images(const std::vector<std::string>& image_path_list, int flags)
+{
+	for(size_t f = 0; f < image_path_list.size() && f < 2; f++){
+		std::cout << "File: " << image_path_list[f] << std::endl;
+
+		cv::Mat cover = cv::imread(image_path_list[f], flags);
+		if(cover.data == nullptr)
+			fail("Cannot open " + image_path_list[f]);
+
+		stegim::lsb_matching_options lsbm_opt;
+		stegim::frame_options frame_opt;
+
+		lsbm_opt.set_feistel(true);
+		test_trial(cover, lsbm_opt, frame_opt, 500);
+
+		lsbm_opt.set_encryption(true);
+		frame_opt.set_parity(false);
+		test_trial(cover, lsbm_opt, frame_opt, 500);
+
+		/*
+		 * the shuffled permutations are computed whole for each key
+		 */
+		lsbm_opt.set_feistel(false);
+		test_trial(cover, lsbm_opt, frame_opt, 4);
+
+		lsbm_opt.set_tile_size(32);
+		test_trial(cover, lsbm_opt, frame_opt, 4);
+
+		/*
+		 * the size of a compressed frame is read from its head
+		 */
+		lsbm_opt.set_tile_size(0).set_feistel(true);
+		frame_opt.set_parity(true).set_compression(stegim::COMPRESSION_LZ4);
+		test_trial(cover, lsbm_opt, frame_opt, 500);
+
+		frame_opt.set_parity(false);
+		test_trial(cover, lsbm_opt, frame_opt, 500);
+	}
+}
+
+int main()
+{
+	srand(time(NULL));
+
+	std::string cover_image_path(COVER_IMAGE_PATH);
+
+	test_images(glob(cover_image_path + "/*.pgm"), CV_LOAD_IMAGE_GRAYSCALE);
+	test_images(glob(cover_image_path + "/*.ppm"), CV_LOAD_IMAGE_COLOR);
+
+	return 0;
+}
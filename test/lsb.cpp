@@ -6,6 +6,8 @@
 #include <cstdlib>
 #include <ctime>
 #include <climits>
+#include <cstring>
+#include <cmath>
 
 #include <glob.h>
 
@@ -13,6 +15,7 @@
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#include "capacity.hpp"
 #include "lsb.hpp"
 
 std::vector<std::string> glob(const std::string& pat){
@@ -36,6 +39,131 @@ std::vector<char> generate_data(int n)
 	return v;
 }
 
+/*
+ * number of samples with different values in `a` and `b`
+ */
+size_t count_modified(const cv::Mat& a, const cv::Mat& b)
+{
+	size_t n = 0;
+	for(int i = 0; i < a.rows; i++){
+		const uchar* ptr_a = a.ptr<uchar>(i);
+		const uchar* ptr_b = b.ptr<uchar>(i);
+		for(int j = 0; j < a.cols*a.channels(); j++)
+			n += ptr_a[j] != ptr_b[j];
+	}
+
+	return n;
+}
+
+/*
+ * the squared error of the samples of `a` and `b`
+ */
+uint64_t squared_error(const cv::Mat& a, const cv::Mat& b)
+{
+	uint64_t e = 0;
+	for(int i = 0; i < a.rows; i++){
+		const uchar* ptr_a = a.ptr<uchar>(i);
+		const uchar* ptr_b = b.ptr<uchar>(i);
+		for(int j = 0; j < a.cols*a.channels(); j++)
+			e += (ptr_b[j] - ptr_a[j])*(ptr_b[j] - ptr_a[j]);
+	}
+
+	return e;
+}
+
+/*
+ * the distortion of `stats` is the one of the images read again, and
+ * its histogram has the visited samples with no change of `gap`
+ */
+bool check_distortion(
+	const stegim::stats& stats,
+	const cv::Mat& cover,
+	const cv::Mat& stego,
+	size_t n_visited,
+	int gap)
+{
+	size_t n_samples = (size_t) cover.rows*cover.cols*cover.channels();
+	uint64_t e = squared_error(cover, stego);
+
+	size_t n_changes = 0;
+	for(int d = -STATS_MAX_CHANGE; d <= STATS_MAX_CHANGE; d++)
+		n_changes += stats.change_histogram[d + STATS_MAX_CHANGE];
+
+	double psnr = e ? 10*log10(255.0*255.0*n_samples/e) : INFINITY;
+
+	return	stats.squared_error == e &&
+		stats.samples_total == n_samples &&
+		stats.sample_max == UINT8_MAX &&
+		n_changes == n_visited &&
+		!stats.change_histogram[STATS_MAX_CHANGE - gap] &&
+		!stats.change_histogram[STATS_MAX_CHANGE + gap] &&
+		std::abs(stats.mse() - (double) e/n_samples) < 1e-9 &&
+		(e ? std::abs(stats.psnr() - psnr) < 1e-9 : std::isinf(stats.psnr()));
+}
+
+/*
+ * a frame larger than `image` with random samples, and `roi` the
+ * rectangle of the frame at (`x`, `y`) with the size of `image`
+ */
+cv::Mat generate_frame(const cv::Mat& image, int x, int y, cv::Rect& roi)
+{
+	cv::Mat frame(image.rows + y + 3, image.cols + x + 5, image.type());
+	for(int i = 0; i < frame.rows; i++){
+		uchar* ptr = frame.ptr<uchar>(i);
+		for(int j = 0; j < frame.cols*frame.channels(); j++)
+			ptr[j] = rand()%(UCHAR_MAX+1);
+	}
+
+	roi = cv::Rect(x, y, image.cols, image.rows);
+	return frame;
+}
+
+/*
+ * true if the samples of `a` and `b` out of `roi` are the same
+ */
+bool same_outside(const cv::Mat& a, const cv::Mat& b, const cv::Rect& roi)
+{
+	int ch = a.channels();
+	for(int i = 0; i < a.rows; i++){
+		const uchar* ptr_a = a.ptr<uchar>(i);
+		const uchar* ptr_b = b.ptr<uchar>(i);
+		for(int j = 0; j < a.cols*ch; j++){
+			bool inside = i >= roi.y && i < roi.y + roi.height &&
+				j/ch >= roi.x && j/ch < roi.x + roi.width;
+
+			if(!inside && ptr_a[j] != ptr_b[j])
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * copy of `data` with a few random bytes changed and `grow`
+ * random bytes appended
+ */
+std::vector<char> edit_data(const std::vector<char>& data, size_t grow)
+{
+	std::vector<char> v(data);
+	for(int i = 0; i < 8 && data.size(); i++)
+		v[rand()%data.size()] = rand()%(UCHAR_MAX+1);
+
+	std::vector<char> tail = generate_data(grow);
+	v.insert(v.end(), tail.begin(), tail.end());
+
+	return v;
+}
+
+size_t count_changed(const std::vector<char>& a, const std::vector<char>& b)
+{
+	size_t n = 0;
+	for(size_t i = 0; i < b.size(); i++)
+		n += i >= a.size() || a[i] != b[i];
+
+	return n;
+}
+
 void print_data(std::vector<char>& v)
 {
 	if(v.size() <= 20){
@@ -54,6 +182,22 @@ void print_data(std::vector<char>& v)
 	std::cout << std::endl;
 }
 
+/*
+ * the kernels must have been reported, and the scalar ones are
+ * always available when forced by STEGIM_ISA
+ */
+bool check_isa(const stegim::stats& stats)
+{
+	if(stats.isa == nullptr)
+		return false;
+
+	const char* forced = getenv("STEGIM_ISA");
+	if(forced && strcmp(forced, "scalar") == 0)
+		return strcmp(stats.isa, "scalar") == 0;
+
+	return true;
+}
+
 void test_grayscale(
 	const std::vector<std::string>& image_path_list)
 {
@@ -103,7 +247,22 @@ void test_grayscale(
 		/*
 		 * embed
 		 */
+		stegim::stats stats;
+		lsb_opt.set_stats(&stats);
+
 		stegim::lsb_embed(cover, stego, data, lsb_opt);
+
+		if(	stats.bytes_processed != data.size() ||
+			stats.samples_visited != CHAR_BIT*data.size() ||
+			stats.samples_modified != count_modified(cover, stego) ||
+			!check_distortion(stats, cover, stego, stats.samples_visited, 2) ||
+			stats.change_histogram[0] || stats.change_histogram[6] ||
+			!check_isa(stats)){
+			std::cerr << "Wrong embedding stats!" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+
+		lsb_opt.set_stats(nullptr);
 		stegim::lsb_extract(stego, extracted_data, data.size(), lsb_opt);
 
 		/*
@@ -231,6 +390,239 @@ void test_color(
 	}
 }
 
+void test_update(
+	const std::vector<std::string>& image_path_list,
+	int flags = CV_LOAD_IMAGE_GRAYSCALE)
+{
+	for( const std::string& f : image_path_list ){
+		std::cout << "File: " << f << std::endl;
+
+		cv::Mat cover = cv::imread(f, flags);
+		if(cover.data == nullptr){
+			std::cerr << "Cannot open " << f << std::endl;
+			exit(EXIT_FAILURE);
+		}
+
+		stegim::lsb_options lsb_opt;
+		lsb_opt.set_offset(rand()%100);
+		if(flags == CV_LOAD_IMAGE_COLOR)
+			lsb_opt.set_b(rand()%2).set_r(rand()%2);
+
+		size_t capacity = stegim::capacity(cover, lsb_opt);
+		std::vector<char> old_data = generate_data(rand()%(capacity/2 + 1));
+		std::vector<char> new_data = edit_data(old_data,
+			rand()%(capacity - old_data.size() + 1));
+
+		cv::Mat stego, expected;
+		stegim::lsb_embed(cover, stego, old_data, lsb_opt);
+		stegim::lsb_embed(cover, expected, new_data, lsb_opt);
+
+		cv::Mat old_stego = stego.clone();
+
+		stegim::stats stats;
+		stegim::sample_delta delta;
+		lsb_opt.set_stats(&stats).set_delta(&delta);
+		stegim::lsb_update(stego, old_data, new_data, lsb_opt);
+
+		/*
+		 * the update matches a full embedding and
+		 * only visits the bits of the changed bytes
+		 */
+		if(count_modified(stego, expected)){
+			std::cerr << "Updated stego is different from embedded!"
+				  << std::endl;
+			exit(EXIT_FAILURE);
+		}
+
+		if(	stats.samples_visited > CHAR_BIT*count_changed(old_data, new_data) ||
+			stats.samples_modified != count_modified(old_stego, stego) ||
+			delta.size() != stats.samples_modified){
+			std::cerr << "Wrong update stats!" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+
+		stegim::apply_delta(old_stego, delta);
+		if(count_modified(old_stego, stego)){
+			std::cerr << "Update delta is different from stego!"
+				  << std::endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+/*
+ * an update larger than the capacity of a ROI drops the bits past
+ * it, as lsb_embed does, and leaves the rest of the frame untouched
+ */
+void test_update_oversized()
+{
+	for(int type : { CV_8UC1, CV_8UC3 }){
+		cv::Mat frame(16, 20, type);
+		for(int i = 0; i < frame.rows; i++){
+			uchar* ptr = frame.ptr<uchar>(i);
+			for(int j = 0; j < frame.cols*frame.channels(); j++)
+				ptr[j] = rand()%(UCHAR_MAX + 1);
+		}
+
+		cv::Rect rect(3, 5, 10, 4);
+		cv::Mat original = frame.clone();
+		cv::Mat roi = frame(rect);
+
+		stegim::lsb_options lsb_opt;
+		lsb_opt.set_offset(rand()%3);
+
+		std::vector<char> old_data = generate_data(2);
+		std::vector<char> new_data = generate_data(16);
+
+		cv::Mat expected;
+		stegim::lsb_embed(roi, expected, new_data, lsb_opt);
+		stegim::lsb_embed(roi, roi, old_data, lsb_opt);
+
+		stegim::stats stats;
+		lsb_opt.set_stats(&stats);
+		stegim::lsb_update(roi, old_data, new_data, lsb_opt);
+
+		if(	count_modified(roi, expected) ||
+			!same_outside(frame, original, rect) ||
+			stats.bytes_processed > stegim::capacity(roi, lsb_opt)){
+			std::cerr << "Wrong oversized update!" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+/*
+ * embedding in a ROI of a larger frame, from a separate cover and
+ * in place, must give the stego of a continuous image and leave the
+ * rest of the frame untouched
+ */
+void test_roi(
+	const std::vector<std::string>& image_path_list,
+	int flags = CV_LOAD_IMAGE_GRAYSCALE)
+{
+	for( const std::string& f : image_path_list ){
+		std::cout << "File: " << f << std::endl;
+
+		cv::Mat cover = cv::imread(f, flags);
+		if(cover.data == nullptr){
+			std::cerr << "Cannot open " << f << std::endl;
+			exit(EXIT_FAILURE);
+		}
+
+		stegim::lsb_options lsb_opt;
+		lsb_opt.set_offset(rand()%100);
+		if(flags == CV_LOAD_IMAGE_COLOR)
+			lsb_opt.set_b(rand()%2).set_r(rand()%2);
+
+		std::vector<char> data = generate_data(
+			rand()%(stegim::capacity(cover, lsb_opt) + 1));
+
+		cv::Mat expected;
+		stegim::lsb_embed(cover, expected, data, lsb_opt);
+
+		cv::Rect rect;
+		cv::Mat frame = generate_frame(cover, 1 + rand()%7, rand()%4, rect);
+		cv::Mat original = frame.clone();
+
+		/*
+		 * into the ROI from the cover, then in place
+		 */
+		cv::Mat roi = frame(rect);
+		stegim::lsb_embed(cover, roi, data, lsb_opt);
+
+		bool ok = roi.data == frame(rect).data &&
+			!count_modified(roi, expected);
+
+		cover.copyTo(roi);
+		stegim::lsb_embed(roi, roi, data, lsb_opt);
+
+		std::vector<char> extracted;
+		stegim::lsb_extract(roi, extracted, data.size(), lsb_opt);
+
+		if(	!ok || count_modified(roi, expected) ||
+			!same_outside(frame, original, rect) ||
+			extracted != data){
+			std::cerr << "Wrong ROI embedding!" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+/*
+ * embedding in samples of 16 bits, continuous and in a ROI, must
+ * extract the data and change nothing but the least significant bit
+ * of the samples carrying it
+ */
+void test_wide()
+{
+	for(int type : { CV_16UC1, CV_16UC3, CV_16UC4 }){
+		for(bool in_roi : { false, true }){
+			cv::Mat frame(40 + rand()%40, 50 + rand()%50, type);
+			for(int i = 0; i < frame.rows; i++){
+				uint16_t* ptr = frame.ptr<uint16_t>(i);
+				for(int j = 0; j < frame.cols*frame.channels(); j++)
+					ptr[j] = rand()%4 ? rand()%(UINT16_MAX + 1) :
+						(rand()%2)*UINT16_MAX;
+			}
+
+			cv::Mat cover = frame;
+			if(in_roi)
+				cover = frame(cv::Rect(3, 2, frame.cols - 7, frame.rows - 5));
+
+			stegim::stats stats;
+			stegim::lsb_options lsb_opt;
+			lsb_opt.set_offset(rand()%100).set_stats(&stats);
+			if(cover.channels() > 1)
+				lsb_opt.set_b(rand()%2).set_r(rand()%2);
+
+			std::vector<char> data = generate_data(
+				rand()%(stegim::capacity(cover, lsb_opt) + 1));
+
+			cv::Mat stego;
+			stegim::lsb_embed(cover, stego, data, lsb_opt);
+
+			std::vector<char> extracted;
+			lsb_opt.set_stats(nullptr);
+			stegim::lsb_extract(stego, extracted, data.size(), lsb_opt);
+			if(extracted != data){
+				std::cerr << "Extracted data is different from embedded data!"
+					<< std::endl;
+				exit(EXIT_FAILURE);
+			}
+
+			size_t n_modified = 0;
+			for(int i = 0; i < cover.rows; i++){
+				const uint16_t* ptr_cover = cover.ptr<uint16_t>(i);
+				const uint16_t* ptr_stego = stego.ptr<uint16_t>(i);
+				for(int j = 0; j < cover.cols*cover.channels(); j++){
+					if((ptr_cover[j] ^ ptr_stego[j]) & ~1){
+						std::cerr << "Wide sample changed beyond its lsb!"
+							<< std::endl;
+						exit(EXIT_FAILURE);
+					}
+
+					n_modified += ptr_cover[j] != ptr_stego[j];
+				}
+			}
+
+			/*
+			 * the changes of the lsb are of one
+			 */
+			size_t n_changes = stats.change_histogram[STATS_MAX_CHANGE - 1] +
+				stats.change_histogram[STATS_MAX_CHANGE + 1];
+
+			if(	stats.samples_modified != n_modified ||
+				stats.bytes_processed != data.size() ||
+				stats.squared_error != n_modified ||
+				n_changes != n_modified ||
+				stats.sample_max != UINT16_MAX){
+				std::cerr << "Wrong wide stats!" << std::endl;
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+}
+
 int main()
 {
 	srand(time(NULL));
@@ -239,6 +631,12 @@ int main()
 
 	test_grayscale(glob(cover_image_path + "/*.pgm"));
 	test_color(glob(cover_image_path + "/*.ppm"));
+	test_update(glob(cover_image_path + "/*.pgm"));
+	test_update(glob(cover_image_path + "/*.ppm"), CV_LOAD_IMAGE_COLOR);
+	test_update_oversized();
+	test_roi(glob(cover_image_path + "/*.pgm"));
+	test_roi(glob(cover_image_path + "/*.ppm"), CV_LOAD_IMAGE_COLOR);
+	test_wide();
 
 	return 0;
 }
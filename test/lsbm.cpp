@@ -1,5 +1,7 @@
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+#include <cmath>
 
 #include <glob.h>
 
@@ -21,6 +23,68 @@ std::vector<std::string> glob(const std::string& pat){
 	return v;
 }
 
+/*
+ * number of samples with different values in `a` and `b`
+ */
+size_t count_modified(const cv::Mat& a, const cv::Mat& b)
+{
+	size_t n = 0;
+	for(int i = 0; i < a.rows; i++){
+		const uchar* ptr_a = a.ptr<uchar>(i);
+		const uchar* ptr_b = b.ptr<uchar>(i);
+		for(int j = 0; j < a.cols*a.channels(); j++)
+			n += ptr_a[j] != ptr_b[j];
+	}
+
+	return n;
+}
+
+/*
+ * the squared error of the samples of `a` and `b`
+ */
+uint64_t squared_error(const cv::Mat& a, const cv::Mat& b)
+{
+	uint64_t e = 0;
+	for(int i = 0; i < a.rows; i++){
+		const uchar* ptr_a = a.ptr<uchar>(i);
+		const uchar* ptr_b = b.ptr<uchar>(i);
+		for(int j = 0; j < a.cols*a.channels(); j++)
+			e += (ptr_b[j] - ptr_a[j])*(ptr_b[j] - ptr_a[j]);
+	}
+
+	return e;
+}
+
+/*
+ * the distortion of `stats` is the one of the images read again, and
+ * its histogram has the visited samples with no change of `gap`
+ */
+bool check_distortion(
+	const stegim::stats& stats,
+	const cv::Mat& cover,
+	const cv::Mat& stego,
+	size_t n_visited,
+	int gap)
+{
+	size_t n_samples = (size_t) cover.rows*cover.cols*cover.channels();
+	uint64_t e = squared_error(cover, stego);
+
+	size_t n_changes = 0;
+	for(int d = -STATS_MAX_CHANGE; d <= STATS_MAX_CHANGE; d++)
+		n_changes += stats.change_histogram[d + STATS_MAX_CHANGE];
+
+	double psnr = e ? 10*log10(255.0*255.0*n_samples/e) : INFINITY;
+
+	return	stats.squared_error == e &&
+		stats.samples_total == n_samples &&
+		stats.sample_max == UINT8_MAX &&
+		n_changes == n_visited &&
+		!stats.change_histogram[STATS_MAX_CHANGE - gap] &&
+		!stats.change_histogram[STATS_MAX_CHANGE + gap] &&
+		std::abs(stats.mse() - (double) e/n_samples) < 1e-9 &&
+		(e ? std::abs(stats.psnr() - psnr) < 1e-9 : std::isinf(stats.psnr()));
+}
+
 std::vector<char> generate_data(int n)
 {
 	std::vector<char> v;
@@ -30,6 +94,44 @@ std::vector<char> generate_data(int n)
 	return v;
 }
 
+/*
+ * a frame larger than `image` with random samples, and `roi` the
+ * rectangle of the frame at (`x`, `y`) with the size of `image`
+ */
+cv::Mat generate_frame(const cv::Mat& image, int x, int y, cv::Rect& roi)
+{
+	cv::Mat frame(image.rows + y + 3, image.cols + x + 5, image.type());
+	for(int i = 0; i < frame.rows; i++){
+		uchar* ptr = frame.ptr<uchar>(i);
+		for(int j = 0; j < frame.cols*frame.channels(); j++)
+			ptr[j] = rand()%(UCHAR_MAX+1);
+	}
+
+	roi = cv::Rect(x, y, image.cols, image.rows);
+	return frame;
+}
+
+/*
+ * true if the samples of `a` and `b` out of `roi` are the same
+ */
+bool same_outside(const cv::Mat& a, const cv::Mat& b, const cv::Rect& roi)
+{
+	int ch = a.channels();
+	for(int i = 0; i < a.rows; i++){
+		const uchar* ptr_a = a.ptr<uchar>(i);
+		const uchar* ptr_b = b.ptr<uchar>(i);
+		for(int j = 0; j < a.cols*ch; j++){
+			bool inside = i >= roi.y && i < roi.y + roi.height &&
+				j/ch >= roi.x && j/ch < roi.x + roi.width;
+
+			if(!inside && ptr_a[j] != ptr_b[j])
+				return false;
+		}
+	}
+
+	return true;
+}
+
 void test(
 	std::vector<std::string>& image_path_list,
 	int flags = CV_LOAD_IMAGE_GRAYSCALE,
@@ -48,7 +150,20 @@ void test(
 		std::vector<char> key = generate_data(10);
 		std::vector<char> extracted_data;
 
-		stegim::lsb_matching_embed(cover, stego, data, key);
+		stegim::stats stats;
+		stegim::lsb_matching_options lsbm_opt;
+		lsbm_opt.set_stats(&stats);
+
+		stegim::lsb_matching_embed(cover, stego, data, key, lsbm_opt);
+
+		if(	stats.bytes_processed != data.size() ||
+			stats.samples_visited != CHAR_BIT*data.size() ||
+			stats.samples_modified != count_modified(cover, stego) ||
+			!check_distortion(stats, cover, stego, stats.samples_visited, 2)){
+			std::cout << "Wrong embedding stats!" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+
 		stegim::lsb_matching_extract(stego, extracted_data, data.size(), key);
 
 		if(n_img < 5){
@@ -73,6 +188,476 @@ void test(
 	}
 }
 
+void test_update(
+	std::vector<std::string>& image_path_list,
+	int flags = CV_LOAD_IMAGE_GRAYSCALE)
+{
+	for(std::string& path : image_path_list){
+		std::cout << "File: " << path << std::endl;
+		cv::Mat cover = cv::imread(path, flags);
+		cv::Mat stego;
+
+		size_t max_bytes = (cover.rows*cover.cols*cover.channels())/CHAR_BIT;
+		std::vector<char> data = generate_data(rand()%(max_bytes/2 + 1));
+		std::vector<char> key = generate_data(10);
+
+		stegim::lsb_matching_embed(cover, stego, data, key);
+
+		/*
+		 * the permutation is computed once for all the updates
+		 */
+		stegim::lsb_matching_permutation permutation(stego, key);
+
+		for(int update = 0; update < 3; update++){
+			std::vector<char> new_data(data);
+			for(int i = 0; i < 8 && data.size(); i++)
+				new_data[rand()%data.size()] = rand()%(UCHAR_MAX+1);
+
+			std::vector<char> tail = generate_data(
+				rand()%((max_bytes - data.size())/4 + 1));
+			new_data.insert(new_data.end(), tail.begin(), tail.end());
+
+			size_t n_changed = 0;
+			for(size_t i = 0; i < new_data.size(); i++)
+				n_changed += i >= data.size() || data[i] != new_data[i];
+
+			cv::Mat old_stego = stego.clone();
+
+			stegim::stats stats;
+			stegim::sample_delta delta;
+			stegim::lsb_matching_options lsbm_opt;
+			lsbm_opt.set_stats(&stats).set_delta(&delta);
+
+			stegim::lsb_matching_update(stego, data, new_data,
+				permutation, lsbm_opt);
+
+			if(	stats.samples_visited != CHAR_BIT*n_changed ||
+				stats.samples_modified != count_modified(old_stego, stego) ||
+				delta.size() != stats.samples_modified){
+				std::cout << "Wrong update stats!" << std::endl;
+				exit(EXIT_FAILURE);
+			}
+
+			stegim::apply_delta(old_stego, delta);
+			if(count_modified(old_stego, stego)){
+				std::cout << "Update delta is different from stego!" << std::endl;
+				exit(EXIT_FAILURE);
+			}
+
+			std::vector<char> extracted_data;
+			stegim::lsb_matching_extract(stego, extracted_data,
+				new_data.size(), key);
+
+			if(new_data != extracted_data){
+				std::cout << "Updated data is different from extrated!"
+					<< std::endl;
+				exit(EXIT_FAILURE);
+			}
+
+			data = new_data;
+		}
+
+		/*
+		 * data beyond the capacity is truncated
+		 */
+		std::vector<char> oversized = generate_data(max_bytes + 100);
+		stegim::lsb_matching_update(stego, data, oversized, permutation);
+
+		std::vector<char> extracted_data;
+		stegim::lsb_matching_extract(stego, extracted_data, max_bytes, key);
+		if(!std::equal(extracted_data.begin(), extracted_data.end(),
+			oversized.begin())){
+			std::cout << "Oversized update not truncated!" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+void test_edge_adaptive(
+	std::vector<std::string>& image_path_list,
+	int flags = CV_LOAD_IMAGE_GRAYSCALE)
+{
+	for(std::string& path : image_path_list){
+		std::cout << "File: " << path << std::endl;
+		cv::Mat cover = cv::imread(path, flags);
+		cv::Mat stego;
+
+		stegim::edge_region region(cover);
+
+		size_t max_bytes = region.capacity(0);
+		size_t n_data = rand()%(max_bytes + 1);
+		std::vector<char> data = generate_data(n_data);
+
+		std::vector<char> key = generate_data(10);
+		std::vector<char> extracted_data;
+
+		stegim::stats stats;
+		stegim::lsb_matching_options lsbm_opt;
+		lsbm_opt.set_edge_adaptive(true).set_stats(&stats);
+
+		stegim::lsb_matching_embed(cover, stego, data, key, lsbm_opt);
+
+		if(	stats.bytes_processed != data.size() ||
+			stats.samples_modified != count_modified(cover, stego) ||
+			squared_error(cover, stego) != stats.squared_error){
+			std::cout << "Wrong embedding stats!" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+
+		/*
+		 * the pairs used by the threshold must stay above it
+		 */
+		int threshold = region.threshold(data.size());
+		if(stegim::edge_region(stego).pairs(threshold) != region.pairs(threshold)){
+			std::cout << "Edge region changed!" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+
+		stegim::lsb_matching_extract(stego, extracted_data, data.size(), key, lsbm_opt);
+
+		if(data != extracted_data){
+			std::cout << "Data is different from extrated!" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+/*
+ * data beyond the edge capacity is truncated to every pair
+ */
+void test_edge_oversized()
+{
+	cv::Mat cover(16, 16, CV_8UC1), stego;
+	for(int i = 0; i < cover.rows; i++)
+		for(int j = 0; j < cover.cols; j++)
+			cover.at<uchar>(i, j) = rand()%(UCHAR_MAX+1);
+
+	size_t capacity = stegim::edge_region(cover).capacity(0);
+	std::vector<char> data = generate_data(200);
+	std::vector<char> key = generate_data(10);
+	std::vector<char> extracted_data;
+
+	stegim::lsb_matching_options lsbm_opt;
+	lsbm_opt.set_edge_adaptive(true);
+
+	stegim::lsb_matching_embed(cover, stego, data, key, lsbm_opt);
+	stegim::lsb_matching_extract(stego, extracted_data, data.size(), key, lsbm_opt);
+
+	if(	extracted_data.size() != data.size() ||
+		!std::equal(data.begin(), data.begin() + capacity, extracted_data.begin())){
+		std::cout << "Oversized data not truncated!" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * images narrower than the threshold samples, which then span rows,
+ * or smaller than them, which have no capacity
+ */
+void test_edge_narrow()
+{
+	const int sizes[][3] = {
+		{ 5, 5, CV_8UC1 }, { 34, 5, CV_8UC1 }, { 34, 6, CV_8UC1 },
+		{ 40, 2, CV_8UC3 }, { 9, 1, CV_8UC1 }, { 1, 7, CV_8UC1 },
+		{ 2, 2, CV_8UC1 }, { 1, 1, CV_8UC3 }
+	};
+
+	for(const int* size : sizes){
+		cv::Mat cover(size[0], size[1], size[2]), stego;
+		for(int i = 0; i < cover.rows; i++){
+			uchar* ptr = cover.ptr<uchar>(i);
+			for(int j = 0; j < cover.cols*cover.channels(); j++)
+				ptr[j] = rand()%(UCHAR_MAX+1);
+		}
+
+		size_t capacity = stegim::edge_region(cover).capacity(0);
+		if(	(size_t) cover.rows*cover.cols*cover.channels() < CHAR_BIT &&
+			capacity){
+			std::cout << "Capacity without room for the threshold!" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+
+		std::vector<char> data = generate_data(capacity);
+		std::vector<char> key = generate_data(10);
+		std::vector<char> extracted_data;
+
+		stegim::lsb_matching_options lsbm_opt;
+		lsbm_opt.set_edge_adaptive(true);
+
+		stegim::lsb_matching_embed(cover, stego, data, key, lsbm_opt);
+		stegim::lsb_matching_extract(stego, extracted_data, data.size(), key,
+			lsbm_opt);
+
+		if(extracted_data != data){
+			std::cout << "Narrow image data is different from extracted!"
+				<< std::endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+/*
+ * the tiled permutation must use every sample once, keep the pairs of
+ * a tile inside it, and embed the same way with several threads
+ */
+void test_tiles(
+	std::vector<std::string>& image_path_list,
+	int flags = CV_LOAD_IMAGE_GRAYSCALE)
+{
+	const int tile_sizes[] = { 7, 64 };
+
+	for(size_t f = 0; f < image_path_list.size() && f < 5; f++){
+		std::cout << "File: " << image_path_list[f] << std::endl;
+		cv::Mat cover = cv::imread(image_path_list[f], flags);
+		cv::Mat stego;
+
+		for(int tile_size : tile_sizes){
+			stegim::lsb_matching_options lsbm_opt;
+			lsbm_opt.set_tile_size(tile_size).set_threads(0);
+
+			std::vector<char> key = generate_data(10);
+			stegim::lsb_matching_permutation permutation(cover, key, lsbm_opt);
+
+			const auto& pairs = permutation.get_pairs();
+			const std::vector<size_t>& tiles = permutation.get_tile_bounds();
+			size_t tile_width = tile_size*cover.channels();
+
+			size_t width = cover.cols*cover.channels();
+			std::vector<int> used(cover.rows*width, 0);
+			for(size_t i = 0; i < pairs.size(); i++){
+				const cv::Point2i& a = pairs[i].first;
+				const cv::Point2i& b = pairs[i].second;
+
+				used[a.x*width + a.y]++;
+				if(a.x != b.x || a.y != b.y)
+					used[b.x*width + b.y]++;
+
+				if(	i < tiles.back() && (
+					a.x/tile_size != b.x/tile_size ||
+					a.y/tile_width != b.y/tile_width)){
+					std::cout << "Pair out of its tile!" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+			}
+
+			if(std::count(used.begin(), used.end(), 1) != (long) used.size()){
+				std::cout << "Samples not used once!" << std::endl;
+				exit(EXIT_FAILURE);
+			}
+
+			size_t max_bytes = (cover.rows*cover.cols*cover.channels())/CHAR_BIT;
+			std::vector<char> data = generate_data(rand()%(max_bytes + 1));
+			std::vector<char> extracted;
+
+			stegim::lsb_matching_embed(cover, stego, data, key, lsbm_opt);
+			stegim::lsb_matching_extract(stego, extracted, data.size(), key, lsbm_opt);
+
+			if(extracted != data){
+				std::cout << "Extracted data is different from embedded data!"
+					<< std::endl;
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+}
+
+/*
+ * the Feistel permutation must use every sample once, be the same
+ * with several threads and extract the data embedded with it
+ */
+void test_feistel(
+	std::vector<std::string>& image_path_list,
+	int flags = CV_LOAD_IMAGE_GRAYSCALE)
+{
+	for(size_t f = 0; f < image_path_list.size() && f < 5; f++){
+		std::cout << "File: " << image_path_list[f] << std::endl;
+		cv::Mat cover = cv::imread(image_path_list[f], flags);
+		cv::Mat stego;
+
+		/*
+		 * an odd number of samples leaves one paired with itself
+		 */
+		if(f%2)
+			cover = cover(cv::Rect(0, 0, cover.cols - 1, cover.rows - 1));
+
+		stegim::lsb_matching_options lsbm_opt;
+		lsbm_opt.set_feistel(true);
+
+		std::vector<char> key = generate_data(10);
+		stegim::lsb_matching_permutation permutation(cover, key, lsbm_opt);
+		stegim::lsb_matching_permutation parallel_permutation(cover, key,
+			stegim::lsb_matching_options(lsbm_opt).set_threads(0));
+
+		const auto& pairs = permutation.get_pairs();
+		const auto& parallel_pairs = parallel_permutation.get_pairs();
+
+		size_t width = cover.cols*cover.channels();
+		std::vector<int> used(cover.rows*width, 0);
+		for(size_t i = 0; i < pairs.size(); i++){
+			const cv::Point2i& a = pairs[i].first;
+			const cv::Point2i& b = pairs[i].second;
+
+			if(	a.x != parallel_pairs[i].first.x ||
+				a.y != parallel_pairs[i].first.y ||
+				b.x != parallel_pairs[i].second.x ||
+				b.y != parallel_pairs[i].second.y){
+				std::cout << "Feistel pairs depend on the threads!" << std::endl;
+				exit(EXIT_FAILURE);
+			}
+
+			used[a.x*width + a.y]++;
+			if(a.x != b.x || a.y != b.y)
+				used[b.x*width + b.y]++;
+		}
+
+		if(std::count(used.begin(), used.end(), 1) != (long) used.size()){
+			std::cout << "Samples not used once!" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+
+		size_t max_bytes = (cover.rows*cover.cols*cover.channels())/CHAR_BIT;
+		std::vector<char> data = generate_data(rand()%(max_bytes + 1));
+		std::vector<char> extracted;
+
+		stegim::lsb_matching_embed(cover, stego, data, key, lsbm_opt);
+		stegim::lsb_matching_extract(stego, extracted, data.size(), key, lsbm_opt);
+
+		if(extracted != data){
+			std::cout << "Extracted data is different from embedded data!"
+				<< std::endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+/*
+ * the encrypted data is extracted with the encryption, and is the
+ * ChaCha20 ciphertext of the derived key without it, with the global,
+ * tiled and edge adaptive pairs and the update
+ */
+void test_encryption(
+	std::vector<std::string>& image_path_list,
+	int flags = CV_LOAD_IMAGE_GRAYSCALE)
+{
+	for(size_t f = 0; f < image_path_list.size() && f < 5; f++){
+		std::cout << "File: " << image_path_list[f] << std::endl;
+		cv::Mat cover = cv::imread(image_path_list[f], flags);
+		cv::Mat stego;
+
+		stegim::lsb_matching_options modes[3];
+		modes[1].set_tile_size(64).set_threads(0);
+		modes[2].set_edge_adaptive(true);
+
+		for(stegim::lsb_matching_options& lsbm_opt : modes){
+			std::vector<char> key = generate_data(10);
+			size_t max_bytes = lsbm_opt.get_edge_adaptive() ?
+				stegim::edge_region(cover).capacity(0) :
+				(cover.rows*cover.cols*cover.channels())/CHAR_BIT;
+			std::vector<char> data = generate_data(rand()%(max_bytes + 1));
+			std::vector<char> extracted;
+
+			lsbm_opt.set_encryption(true);
+			stegim::lsb_matching_embed(cover, stego, data, key, lsbm_opt);
+			stegim::lsb_matching_extract(stego, extracted, data.size(), key, lsbm_opt);
+
+			if(extracted != data){
+				std::cout << "Decrypted data is different from embedded data!"
+					<< std::endl;
+				exit(EXIT_FAILURE);
+			}
+
+			std::vector<char> ciphertext(data);
+			const uint8_t nonce[stegim::chacha20_nonce_size] = {};
+			stegim::chacha20_xor(
+				stegim::lsb_matching_permutation(cover, key).get_cipher_key(),
+				nonce, 0, ciphertext.data(), ciphertext.size());
+
+			lsbm_opt.set_encryption(false);
+			stegim::lsb_matching_extract(stego, extracted, data.size(), key, lsbm_opt);
+
+			if(extracted != ciphertext){
+				std::cout << "Embedded data is not the ciphertext!" << std::endl;
+				exit(EXIT_FAILURE);
+			}
+
+			if(lsbm_opt.get_edge_adaptive())
+				continue;
+
+			/*
+			 * the update rewrites the encrypted bytes that changed
+			 */
+			lsbm_opt.set_encryption(true);
+			stegim::lsb_matching_permutation permutation(cover, key, lsbm_opt);
+
+			std::vector<char> new_data(data);
+			for(size_t i = 0; i < new_data.size()/10; i++)
+				new_data[rand()%new_data.size()] ^= 1 + rand()%UCHAR_MAX;
+
+			stegim::lsb_matching_update(stego, data, new_data, permutation, lsbm_opt);
+			stegim::lsb_matching_extract(stego, extracted, data.size(), key, lsbm_opt);
+
+			if(extracted != new_data){
+				std::cout << "Updated data is different from extracted!"
+					<< std::endl;
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+}
+
+/*
+ * embedding in a ROI of a larger frame, from a separate cover and in
+ * place, with the global, tiled and edge adaptive pairs, must extract
+ * the data from the ROI and leave the rest of the frame untouched
+ */
+void test_roi(
+	std::vector<std::string>& image_path_list,
+	int flags = CV_LOAD_IMAGE_GRAYSCALE)
+{
+	for(size_t f = 0; f < image_path_list.size() && f < 5; f++){
+		std::cout << "File: " << image_path_list[f] << std::endl;
+		cv::Mat cover = cv::imread(image_path_list[f], flags);
+
+		stegim::lsb_matching_options options[3];
+		options[1].set_tile_size(64);
+		options[2].set_edge_adaptive(true);
+
+		for(const stegim::lsb_matching_options& lsbm_opt : options){
+			size_t max_bytes = lsbm_opt.get_edge_adaptive() ?
+				stegim::edge_region(cover).capacity(0) :
+				(cover.rows*cover.cols*cover.channels())/CHAR_BIT;
+
+			std::vector<char> data = generate_data(rand()%(max_bytes + 1));
+			std::vector<char> key = generate_data(10);
+
+			cv::Rect rect;
+			cv::Mat frame = generate_frame(cover, 1 + rand()%7, rand()%4, rect);
+			cv::Mat original = frame.clone();
+			cv::Mat roi = frame(rect);
+
+			for(int in_place = 0; in_place < 2; in_place++){
+				std::vector<char> extracted;
+
+				if(in_place){
+					cover.copyTo(roi);
+					stegim::lsb_matching_embed(roi, roi, data, key, lsbm_opt);
+				}else{
+					stegim::lsb_matching_embed(cover, roi, data, key, lsbm_opt);
+				}
+
+				stegim::lsb_matching_extract(roi, extracted, data.size(), key, lsbm_opt);
+
+				if(	roi.data != frame(rect).data ||
+					!same_outside(frame, original, rect) ||
+					extracted != data){
+					std::cout << "Wrong ROI embedding!" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+			}
+		}
+	}
+}
+
 int main()
 {
 
@@ -85,6 +670,26 @@ int main()
 	test(gray_image_list);
 	std::cout << "COLOR---------" << std::endl;
 	test(color_image_list, CV_LOAD_IMAGE_COLOR, "ppm");
+	std::cout << "UPDATE--------" << std::endl;
+	test_update(gray_image_list);
+	test_update(color_image_list, CV_LOAD_IMAGE_COLOR);
+	std::cout << "EDGE ADAPTIVE-" << std::endl;
+	test_edge_adaptive(gray_image_list);
+	test_edge_adaptive(color_image_list, CV_LOAD_IMAGE_COLOR);
+	test_edge_oversized();
+	test_edge_narrow();
+	std::cout << "TILES---------" << std::endl;
+	test_tiles(gray_image_list);
+	test_tiles(color_image_list, CV_LOAD_IMAGE_COLOR);
+	std::cout << "FEISTEL-------" << std::endl;
+	test_feistel(gray_image_list);
+	test_feistel(color_image_list, CV_LOAD_IMAGE_COLOR);
+	std::cout << "ENCRYPTION----" << std::endl;
+	test_encryption(gray_image_list);
+	test_encryption(color_image_list, CV_LOAD_IMAGE_COLOR);
+	std::cout << "ROI-----------" << std::endl;
+	test_roi(gray_image_list);
+	test_roi(color_image_list, CV_LOAD_IMAGE_COLOR);
 
 	return 0;
 }
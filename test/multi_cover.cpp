@@ -0,0 +1,187 @@
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <random>
+
+#include <cstdlib>
+#include <ctime>
+#include <climits>
+
+#include <glob.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "capacity.hpp"
+#include "lsb.hpp"
+#include "multi_cover.hpp"
+
+std::vector<std::string> glob(const std::string& pat){
+	glob_t glob_result;
+	glob(pat.c_str(), GLOB_TILDE, NULL, &glob_result);
+
+	std::vector<std::string> v;
+	for(unsigned int i=0; i<glob_result.gl_pathc; i++)
+		v.push_back(std::string(glob_result.gl_pathv[i]));
+
+	globfree(&glob_result);
+	return v;
+}
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+void fail(const std::string& msg)
+{
+	std::cerr << msg << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+void test(
+	const std::vector<std::string>& image_path_list,
+	int flags = CV_LOAD_IMAGE_GRAYSCALE)
+{
+	std::vector<cv::Mat> covers;
+	for(const std::string& f : image_path_list){
+		covers.push_back(cv::imread(f, flags));
+		if(covers.back().data == nullptr)
+			fail("Cannot open " + f);
+	}
+
+	/*
+	 * a cover too small for a chunk header
+	 */
+	covers.push_back(covers.front()(cv::Rect(0, 0, 4, 4)).clone());
+
+	stegim::lsb_options lsb_opt;
+	if(flags == CV_LOAD_IMAGE_COLOR)
+		lsb_opt.set_g(false).set_offset(rand()%100);
+
+	size_t max_bytes = 0;
+	for(const cv::Mat& c : covers){
+		size_t capacity = stegim::capacity(c, lsb_opt);
+		if(capacity > stegim::multi_cover_header_size)
+			max_bytes += capacity - stegim::multi_cover_header_size;
+	}
+
+	for(size_t data_size : { (size_t) 0, max_bytes/3, max_bytes }){
+		std::cout << "Data size: " << data_size
+			<< " of " << max_bytes << std::endl;
+
+		std::vector<char> data = generate_data(data_size);
+		std::vector<cv::Mat> stegos;
+
+		stegim::stats stats;
+		lsb_opt.set_stats(&stats);
+		stegim::multi_cover_embed(covers, stegos, data, lsb_opt, 4);
+		lsb_opt.set_stats(nullptr);
+
+		if(stats.bytes_processed < data.size())
+			fail("Data was not embedded!");
+
+		/*
+		 * the extraction does not depend on the order of the stegos
+		 */
+		std::shuffle(stegos.begin(), stegos.end(),
+			std::default_random_engine(rand()));
+
+		std::vector<char> extracted_data;
+		if(!stegim::multi_cover_extract(stegos, extracted_data, lsb_opt, 4))
+			fail("Missing chunks!");
+
+		if(data != extracted_data)
+			fail("Extracted data is different from embedded data!");
+
+		/*
+		 * without a stego with a chunk the extraction is incomplete
+		 */
+		if(data.size()){
+			for(size_t i = 0; i < stegos.size(); i++){
+				std::vector<char> header;
+				stegim::lsb_extract(stegos[i], header,
+					stegim::multi_cover_header_size, lsb_opt);
+
+				if(header[0] == 'S'){
+					stegos.erase(stegos.begin() + i);
+					break;
+				}
+			}
+
+			if(stegim::multi_cover_extract(stegos, extracted_data, lsb_opt, 4))
+				fail("Missing chunk was not detected!");
+		}
+	}
+}
+
+/*
+ * writes a chunk header in little endian, as multi_cover_embed
+ */
+std::vector<char> forge_header(
+	uint32_t sequence,
+	uint32_t n_chunks,
+	uint32_t length,
+	uint64_t offset,
+	uint64_t total)
+{
+	std::vector<char> h = { 'S', 'G', 'M', 'C' };
+	for(uint64_t v : { (uint64_t) sequence, (uint64_t) n_chunks, (uint64_t) length })
+		for(int i = 0; i < 4; i++)
+			h.push_back((v >> (CHAR_BIT*i)) & 0xff);
+	for(uint64_t v : { offset, total })
+		for(int i = 0; i < 8; i++)
+			h.push_back((v >> (CHAR_BIT*i)) & 0xff);
+
+	return h;
+}
+
+/*
+ * headers claiming more chunks than images, or more data than the
+ * images hold, are rejected before the data is allocated
+ */
+void test_forged()
+{
+	cv::Mat cover(64, 64, CV_8UC1);
+	for(int i = 0; i < cover.rows; i++)
+		for(int j = 0; j < cover.cols; j++)
+			cover.at<uchar>(i, j) = rand()%(UCHAR_MAX + 1);
+
+	size_t room = stegim::capacity(cover) - stegim::multi_cover_header_size;
+
+	std::vector<std::vector<char>> headers = {
+		forge_header(0, 3, 0, 0, 0),
+		forge_header(0, UINT32_MAX, 0, 0, 0),
+		forge_header(0, 1, 0, 0, 2*room + 1),
+		forge_header(0, 1, room, 0, UINT64_MAX)
+	};
+
+	for(const std::vector<char>& header : headers){
+		std::vector<cv::Mat> stegos(2);
+		stegim::lsb_embed(cover, stegos[0], header);
+		cover.copyTo(stegos[1]);
+
+		std::vector<char> extracted_data;
+		if(stegim::multi_cover_extract(stegos, extracted_data) ||
+			!extracted_data.empty())
+			fail("Forged chunk header was accepted!");
+	}
+}
+
+int main()
+{
+	srand(time(NULL));
+
+	std::string cover_image_path(COVER_IMAGE_PATH);
+
+	test(glob(cover_image_path + "/*.pgm"));
+	test(glob(cover_image_path + "/*.ppm"), CV_LOAD_IMAGE_COLOR);
+	test_forged();
+
+	return 0;
+}
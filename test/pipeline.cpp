@@ -0,0 +1,126 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <cstdlib>
+#include <ctime>
+#include <climits>
+
+#include <glob.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "capacity.hpp"
+#include "lsb.hpp"
+#include "pipeline.hpp"
+
+std::vector<std::string> glob(const std::string& pat){
+	glob_t glob_result;
+	glob(pat.c_str(), GLOB_TILDE, NULL, &glob_result);
+
+	std::vector<std::string> v;
+	for(unsigned int i=0; i<glob_result.gl_pathc; i++)
+		v.push_back(std::string(glob_result.gl_pathv[i]));
+
+	globfree(&glob_result);
+	return v;
+}
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+void fail(const std::string& msg)
+{
+	std::cerr << msg << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+void check_report(const stegim::pipeline_report& report, size_t n_items)
+{
+	for(const stegim::stage_report& s : report.stages){
+		std::cout << s.name << ": " << s.items << " items, "
+			<< s.items_per_second() << " items/s" << std::endl;
+
+		if(s.items != n_items && s.name != "decode")
+			fail("Wrong number of items in " + s.name + "!");
+	}
+}
+
+void test(const std::vector<std::string>& image_path_list, const std::string& ext)
+{
+	/*
+	 * the data size depends on the smallest cover
+	 */
+	size_t size = SIZE_MAX;
+	for(const std::string& f : image_path_list)
+		size = std::min(size, stegim::capacity(cv::imread(f, -1)));
+
+	std::vector<stegim::pipeline_job> jobs(image_path_list.size());
+	std::vector<std::string> stegos;
+	for(size_t i = 0; i < jobs.size(); i++){
+		std::stringstream output;
+		output << "pipeline_stego_" << i << "." << ext;
+
+		jobs[i].input = image_path_list[i];
+		jobs[i].output = output.str();
+		jobs[i].data = generate_data(rand()%(size + 1));
+		stegos.push_back(jobs[i].output);
+	}
+
+	/*
+	 * a missing cover fails without stopping the others
+	 */
+	jobs.push_back(stegim::pipeline_job());
+	jobs.back().input = "missing." + ext;
+	jobs.back().output = "pipeline_missing." + ext;
+
+	/*
+	 * small queues so the stages stall on each other
+	 */
+	stegim::pipeline_options pipe_opt(3, 2, 2, 2);
+
+	stegim::pipeline_report report = stegim::pipeline_embed(jobs,
+		[](const cv::Mat& cover, cv::Mat& stego, const std::vector<char>& data){
+			stegim::lsb_embed(cover, stego, data);
+		}, pipe_opt);
+
+	check_report(report, image_path_list.size());
+	if(report.failed != std::vector<size_t>(1, image_path_list.size()))
+		fail("Missing cover was not reported!");
+
+	std::vector<std::vector<char>> data;
+	report = stegim::pipeline_extract(stegos, data,
+		[size](const cv::Mat& stego, std::vector<char>& d){
+			stegim::lsb_extract(stego, d, size);
+		}, pipe_opt);
+
+	check_report(report, image_path_list.size());
+	if(!report.failed.empty())
+		fail("Stego images were not read!");
+
+	for(size_t i = 0; i < stegos.size(); i++){
+		data[i].resize(jobs[i].data.size());
+		if(data[i] != jobs[i].data)
+			fail("Extracted data is different from embedded data!");
+	}
+}
+
+int main()
+{
+	srand(time(NULL));
+
+	std::string cover_image_path(COVER_IMAGE_PATH);
+
+	test(glob(cover_image_path + "/*.pgm"), "pgm");
+	test(glob(cover_image_path + "/*.ppm"), "ppm");
+
+	return 0;
+}
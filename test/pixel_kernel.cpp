@@ -0,0 +1,296 @@
+#include <iostream>
+#include <string>
+
+#include <cstdlib>
+#include <ctime>
+#include <climits>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "lsb.hpp"
+#include "lsb_matching.hpp"
+#include "pixel_kernel.hpp"
+
+/*
+ * the tables are built by the compiler
+ */
+static_assert(stegim::lsbmr_steps.step[0][2].saturated, "c0 = 0 must saturate");
+static_assert(stegim::lsbmr_steps.step[UCHAR_MAX][0].delta0 < 0,
+	"c0 = 255 must decrease");
+static_assert(stegim::lsbmr_extract_pair(6, 2) == 2, "wrong extraction");
+static_assert(stegim::lsbmr_embed_step16(0, 0, 1, 0).saturated,
+	"c0 = 0 must saturate");
+static_assert(stegim::lsbmr_embed_step16(UINT16_MAX, 0, 0, 0).delta0 < 0,
+	"c0 = 65535 must decrease");
+
+void fail(const std::string& msg)
+{
+	std::cerr << msg << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+/*
+ * the steps of every pair and message embed the message, change
+ * at most one sample, and keep the samples in range
+ */
+void test_steps()
+{
+	for(int c0 = 0; c0 <= UCHAR_MAX; c0++)
+	for(int c1 = 0; c1 <= UCHAR_MAX; c1++)
+	for(unsigned m = 0; m < 4; m++){
+		unsigned m0 = m & 1;
+		unsigned m1 = m >> 1;
+
+		stegim::lsbmr_step step = stegim::lsbmr_embed_step(c0, c1, m0, m1);
+
+		int s0 = c0 + step.delta0;
+		if(s0 < 0 || s0 > UCHAR_MAX)
+			fail("First sample out of range!");
+
+		if(step.delta0 && step.change1)
+			fail("Both samples changed!");
+
+		if(step.saturated != (step.delta0 && (c0 == 0 || c0 == UCHAR_MAX)))
+			fail("Wrong saturation!");
+
+		/*
+		 * both sides of the change of c1 embed the message
+		 */
+		for(int d1 : { -1, 1 }){
+			int s1 = c1 + (step.change1 ? d1 : 0);
+			if(s1 < 0 || s1 > UCHAR_MAX)
+				continue;
+
+			if(stegim::lsbmr_extract_pair(s0, s1) != m)
+				fail("Wrong embedded bits!");
+		}
+	}
+}
+
+/*
+ * the samples of 16 bits near the ends of their range and a few
+ * others, the ones the steps may saturate
+ */
+const uint16_t wide_values[] = {
+	0, 1, 2, 3, 4, 127, 128, 255, 256, 32767, 32768,
+	65531, 65532, 65533, 65534, 65535
+};
+
+/*
+ * the same as test_steps for samples of 16 bits
+ */
+void test_steps16()
+{
+	for(uint16_t c0 : wide_values)
+	for(uint16_t c1 : wide_values)
+	for(unsigned m = 0; m < 4; m++){
+		unsigned m0 = m & 1;
+		unsigned m1 = m >> 1;
+
+		stegim::lsbmr_step step = stegim::lsbmr_embed_step16(c0, c1, m0, m1);
+
+		int s0 = c0 + step.delta0;
+		if(s0 < 0 || s0 > UINT16_MAX)
+			fail("First wide sample out of range!");
+
+		if(step.delta0 && step.change1)
+			fail("Both wide samples changed!");
+
+		if(step.saturated != (step.delta0 && (c0 == 0 || c0 == UINT16_MAX)))
+			fail("Wrong wide saturation!");
+
+		for(int d1 : { -1, 1 }){
+			int s1 = c1 + (step.change1 ? d1 : 0);
+			if(s1 < 0 || s1 > UINT16_MAX)
+				continue;
+
+			if(stegim::lsbmr_extract_pair16(s0, s1) != m)
+				fail("Wrong embedded wide bits!");
+		}
+	}
+}
+
+/*
+ * converts an image to gray and embeds in a single pass, which
+ * must give the same stego image as lsb_embed on the gray image
+ */
+void test_fused()
+{
+	cv::Mat color(64, 96, CV_8UC3);
+	for(int i = 0; i < color.rows; i++){
+		uchar* ptr = color.ptr<uchar>(i);
+		for(int j = 0; j < color.cols*3; j++)
+			ptr[j] = rand()%(UCHAR_MAX + 1);
+	}
+
+	std::vector<char> data((color.rows*color.cols)/CHAR_BIT);
+	for(char& c : data)
+		c = rand()%(UCHAR_MAX + 1);
+
+	cv::Mat gray(color.rows, color.cols, CV_8UC1);
+	cv::Mat fused(color.rows, color.cols, CV_8UC1);
+
+	size_t n = 0;
+	for(int i = 0; i < color.rows; i++){
+		const uchar* ptr = color.ptr<uchar>(i);
+		for(int j = 0; j < color.cols; j++, n++){
+			uchar y = (ptr[3*j] + 2*ptr[3*j + 1] + ptr[3*j + 2])/4;
+			unsigned bit = (data[n/CHAR_BIT] >> (n%CHAR_BIT)) & 1;
+
+			gray.at<uchar>(i, j) = y;
+			fused.at<uchar>(i, j) = stegim::lsb_embed_sample(y, bit);
+		}
+	}
+
+	cv::Mat stego;
+	stegim::lsb_embed(gray, stego, data);
+
+	for(int i = 0; i < stego.rows; i++)
+		for(int j = 0; j < stego.cols; j++)
+			if(stego.at<uchar>(i, j) != fused.at<uchar>(i, j))
+				fail("Fused embedding differs from lsb_embed!");
+}
+
+/*
+ * lsb_matching_embed, with its vectorized pairs, on an image full of
+ * saturated samples must embed the data changing each pair as the
+ * decision table says
+ */
+void test_pairs()
+{
+	const uchar values[] = { 0, 1, 2, 127, 128, 253, 254, 255 };
+
+	cv::Mat cover(37, 53, CV_8UC3);
+	for(int i = 0; i < cover.rows; i++){
+		uchar* ptr = cover.ptr<uchar>(i);
+		for(int j = 0; j < cover.cols*3; j++)
+			ptr[j] = values[rand()%8];
+	}
+
+	std::vector<char> data((cover.rows*cover.cols*3)/CHAR_BIT - 1);
+	for(char& c : data)
+		c = rand()%(UCHAR_MAX + 1);
+
+	std::string key("pairs");
+	std::vector<char> k(key.begin(), key.end());
+	stegim::lsb_matching_permutation permutation(cover, k);
+
+	stegim::stats stats;
+	stegim::lsb_matching_options lsbm_opt;
+	lsbm_opt.set_stats(&stats);
+
+	cv::Mat stego;
+	stegim::lsb_matching_embed(cover, stego, data, permutation, lsbm_opt);
+
+	std::vector<char> extracted;
+	stegim::lsb_matching_extract(stego, extracted, data.size(), key);
+	if(extracted != data)
+		fail("Extracted data is different from embedded data!");
+
+	size_t n_saturated = 0;
+	const auto& pairs = permutation.get_pairs();
+	for(size_t i = 0; i < data.size()*CHAR_BIT/2; i++){
+		const cv::Point2i& p0 = pairs[i].first;
+		const cv::Point2i& p1 = pairs[i].second;
+
+		uchar c0 = cover.ptr<uchar>(p0.x)[p0.y];
+		uchar c1 = cover.ptr<uchar>(p1.x)[p1.y];
+		uchar s0 = stego.ptr<uchar>(p0.x)[p0.y];
+		uchar s1 = stego.ptr<uchar>(p1.x)[p1.y];
+
+		unsigned m = (data[2*i/CHAR_BIT] >> (2*i%CHAR_BIT)) & 3;
+		stegim::lsbmr_step step = stegim::lsbmr_embed_step(
+			c0, c1, m & 1, m >> 1);
+
+		if(	s0 != c0 + step.delta0 ||
+			abs(s1 - c1) != step.change1)
+			fail("Pair not changed as the decision table!");
+
+		n_saturated += step.saturated;
+	}
+
+	if(	stats.saturated_adjustments != n_saturated ||
+		stats.isa == nullptr)
+		fail("Wrong pair stats!");
+}
+
+/*
+ * the same as test_pairs for samples of 16 bits, with the tiles
+ * embedded in parallel too
+ */
+void test_pairs16()
+{
+	cv::Mat cover(37, 53, CV_16UC3);
+	for(int i = 0; i < cover.rows; i++){
+		uint16_t* ptr = cover.ptr<uint16_t>(i);
+		for(int j = 0; j < cover.cols*3; j++)
+			ptr[j] = wide_values[rand()%16];
+	}
+
+	std::vector<char> data((cover.rows*cover.cols*3)/CHAR_BIT - 1);
+	for(char& c : data)
+		c = rand()%(UCHAR_MAX + 1);
+
+	std::string key("pairs");
+	std::vector<char> k(key.begin(), key.end());
+	stegim::lsb_matching_permutation permutation(cover, k);
+
+	stegim::stats stats;
+	stegim::lsb_matching_options lsbm_opt;
+	lsbm_opt.set_stats(&stats);
+
+	cv::Mat stego;
+	stegim::lsb_matching_embed(cover, stego, data, permutation, lsbm_opt);
+
+	std::vector<char> extracted;
+	stegim::lsb_matching_extract(stego, extracted, data.size(), key);
+	if(extracted != data)
+		fail("Extracted data is different from embedded data!");
+
+	size_t n_saturated = 0;
+	const auto& pairs = permutation.get_pairs();
+	for(size_t i = 0; i < data.size()*CHAR_BIT/2; i++){
+		const cv::Point2i& p0 = pairs[i].first;
+		const cv::Point2i& p1 = pairs[i].second;
+
+		uint16_t c0 = cover.ptr<uint16_t>(p0.x)[p0.y];
+		uint16_t c1 = cover.ptr<uint16_t>(p1.x)[p1.y];
+		uint16_t s0 = stego.ptr<uint16_t>(p0.x)[p0.y];
+		uint16_t s1 = stego.ptr<uint16_t>(p1.x)[p1.y];
+
+		unsigned m = (data[2*i/CHAR_BIT] >> (2*i%CHAR_BIT)) & 3;
+		stegim::lsbmr_step step = stegim::lsbmr_embed_step16(
+			c0, c1, m & 1, m >> 1);
+
+		if(	s0 != c0 + step.delta0 ||
+			abs(s1 - c1) != step.change1)
+			fail("Wide pair not changed as the decision table!");
+
+		n_saturated += step.saturated;
+	}
+
+	if(stats.saturated_adjustments != n_saturated)
+		fail("Wrong wide pair stats!");
+
+	lsbm_opt.set_stats(nullptr).set_tile_size(8).set_threads(0);
+
+	stegim::lsb_matching_embed(cover, stego, data, k, lsbm_opt);
+	stegim::lsb_matching_extract(stego, extracted, data.size(), k, lsbm_opt);
+	if(extracted != data)
+		fail("Extracted data is different from embedded data in tiles!");
+}
+
+int main()
+{
+	srand(time(NULL));
+
+	test_steps();
+	test_fused();
+	test_pairs();
+	test_steps16();
+	test_pairs16();
+
+	return 0;
+}
@@ -0,0 +1,258 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cstdlib>
+#include <ctime>
+#include <climits>
+
+#include <unistd.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "capacity.hpp"
+#include "service.hpp"
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+void fill_frame(cv::Mat& frame)
+{
+	for(int i = 0; i < frame.rows; i++){
+		uchar* ptr = frame.ptr<uchar>(i);
+		for(size_t j = 0; j < frame.cols*frame.elemSize(); j++)
+			ptr[j] = rand()%(UCHAR_MAX+1);
+	}
+}
+
+void fail(const std::string& msg)
+{
+	std::cerr << msg << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+/*
+ * the frame embedded by the service holds the data for the library,
+ * and for the service itself
+ */
+void test_job(
+	stegim::service_client& client,
+	int rows,
+	int cols,
+	int type,
+	const stegim::lsb_matching_options& lsbm_opt)
+{
+	stegim::shared_frame frame(rows, cols, type);
+	if(!frame.valid())
+		fail("Cannot allocate a shared frame!");
+	fill_frame(frame.mat());
+
+	size_t capacity = stegim::lsb_matching_capacity(frame.mat());
+	std::vector<char> data = generate_data(rand()%(capacity + 1));
+	std::vector<char> key = generate_data(1 + rand()%32);
+
+	if(!client.embed(frame, data, key, lsbm_opt))
+		fail("Embedding job failed!");
+
+	std::vector<char> extracted;
+	stegim::lsb_matching_extract(frame.mat(), extracted, data.size(), key,
+		lsbm_opt);
+	if(extracted != data)
+		fail("Library extracted data is different from embedded data!");
+
+	if(!client.extract(frame, extracted, data.size(), key, lsbm_opt) ||
+		extracted != data)
+		fail("Service extracted data is different from embedded data!");
+
+	/*
+	 * the frame is sent again after it is released
+	 */
+	if(!client.release(frame))
+		fail("Release failed!");
+
+	if(!client.extract(frame, extracted, data.size(), key, lsbm_opt) ||
+		extracted != data)
+		fail("Extraction of a released frame failed!");
+}
+
+void test_jobs(const std::string& socket_path)
+{
+	stegim::service_client client;
+	if(!client.connect(socket_path))
+		fail("Cannot connect!");
+
+	stegim::lsb_matching_options lsbm_opt;
+	int types[] = { CV_8UC1, CV_8UC3, CV_8UC4, CV_16UC1, CV_16UC3 };
+
+	for(int type : types){
+		int rows = 1 + rand()%200, cols = 1 + rand()%200;
+		test_job(client, rows, cols, type, lsbm_opt);
+		test_job(client, rows, cols, type,
+			stegim::lsb_matching_options().set_tile_size(16));
+		test_job(client, rows, cols, type,
+			stegim::lsb_matching_options().set_feistel(true)
+				.set_encryption(true));
+	}
+
+	/*
+	 * a job refused by the client keeps the connection
+	 */
+	stegim::shared_frame frame(10, 10, CV_8UC1);
+	std::vector<char> key = generate_data(8);
+	if(client.embed(frame, std::vector<char>(100), key))
+		fail("Data larger than the frame accepted!");
+
+	if(client.embed(frame, std::vector<char>(1), key,
+		stegim::lsb_matching_options().set_edge_adaptive(true)))
+		fail("Edge adaptive job accepted!");
+
+	if(!client.connected() || !client.embed(frame, std::vector<char>(1), key))
+		fail("Connection lost after a refused job!");
+
+	/*
+	 * the frame mapped by the service cannot be truncated
+	 */
+	if(ftruncate(frame.fd(), 0) == 0 || ftruncate(frame.fd(), 1 << 20) == 0)
+		fail("Shared frame not sealed!");
+}
+
+/*
+ * the jobs of the same key and geometry share the permutation
+ */
+void test_cache(stegim::service& service, const std::string& socket_path)
+{
+	stegim::service_client client;
+	if(!client.connect(socket_path))
+		fail("Cannot connect!");
+
+	std::vector<char> key = generate_data(16);
+	stegim::shared_frame frame(64, 48, CV_8UC3);
+	fill_frame(frame.mat());
+
+	size_t misses = service.cache_misses(), hits = service.cache_hits();
+
+	const int n_jobs = 8;
+	for(int i = 0; i < n_jobs; i++){
+		std::vector<char> data = generate_data(100), extracted;
+		if(!client.embed(frame, data, key) ||
+			!client.extract(frame, extracted, data.size(), key) ||
+			extracted != data)
+			fail("Cached job failed!");
+	}
+
+	if(service.cache_misses() != misses + 1 ||
+		service.cache_hits() != hits + 2*n_jobs - 1)
+		fail("Permutation not cached!");
+}
+
+/*
+ * frames of the same samples per row but other channels do not share
+ * the tiled permutation, checked against the embedding in process
+ */
+void test_cache_channels(const std::string& socket_path)
+{
+	stegim::service_client client;
+	if(!client.connect(socket_path))
+		fail("Cannot connect!");
+
+	std::vector<char> key = generate_data(16);
+	stegim::lsb_matching_options lsbm_opt;
+	lsbm_opt.set_tile_size(4);
+
+	stegim::shared_frame gray(12, 30, CV_8UC1);
+	stegim::shared_frame color(12, 10, CV_8UC3);
+	fill_frame(gray.mat());
+	fill_frame(color.mat());
+
+	std::vector<char> data = generate_data(20), extracted;
+	if(!client.embed(gray, data, key, lsbm_opt) ||
+		!client.embed(color, data, key, lsbm_opt))
+		fail("Cannot embed!");
+
+	stegim::lsb_matching_extract(color.mat(), extracted, data.size(), key,
+		lsbm_opt);
+	if(extracted != data)
+		fail("Permutation shared by frames of other channels!");
+
+	cv::Mat stego;
+	stegim::lsb_matching_embed(color.mat(), stego, data, key, lsbm_opt);
+	stego.copyTo(color.mat());
+	if(!client.extract(color, extracted, data.size(), key, lsbm_opt) ||
+		extracted != data)
+		fail("Service extraction differs from the embedding in process!");
+}
+
+/*
+ * clients in parallel, each on its own frames
+ */
+void test_clients(const std::string& socket_path)
+{
+	const int n_clients = 4;
+	std::vector<std::thread> threads;
+
+	for(int t = 0; t < n_clients; t++)
+		threads.emplace_back([&socket_path](){
+			stegim::service_client client;
+			if(!client.connect(socket_path))
+				fail("Cannot connect!");
+
+			for(int i = 0; i < 8; i++)
+				test_job(client, 100, 120, CV_8UC3,
+					stegim::lsb_matching_options());
+		});
+
+	for(std::thread& t : threads)
+		t.join();
+}
+
+int main()
+{
+	srand(time(NULL));
+
+	std::string socket_path = "/tmp/stegim_test_" +
+		std::to_string(getpid()) + ".sock";
+
+	stegim::service_client client;
+	if(client.connect(socket_path))
+		fail("Connected without a service!");
+
+	stegim::service service(socket_path,
+		stegim::service_options().set_cache_size(4));
+	if(!service.listening())
+		fail("Cannot listen on " + socket_path);
+
+	std::thread runner([&service](){ service.run(); });
+
+	test_jobs(socket_path);
+	test_cache(service, socket_path);
+	test_cache_channels(socket_path);
+	test_clients(socket_path);
+
+	if(!client.connect(socket_path))
+		fail("Cannot connect!");
+
+	service.stop();
+	runner.join();
+
+	if(service.listening())
+		fail("Still listening after stop!");
+
+	/*
+	 * the connections are shut down by stop, or reset if not yet
+	 * accepted
+	 */
+	stegim::shared_frame frame(10, 10, CV_8UC1);
+	if(client.embed(frame, std::vector<char>(1), std::vector<char>(1)))
+		fail("Job done after stop!");
+
+	return 0;
+}
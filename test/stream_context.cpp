@@ -0,0 +1,205 @@
+#include <iostream>
+#include <string>
+#include <set>
+#include <atomic>
+#include <new>
+
+#include <cstdlib>
+#include <ctime>
+#include <climits>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "stream_context.hpp"
+
+/*
+ * the heap allocations of every thread are counted
+ */
+std::atomic<size_t> n_allocations(0);
+
+void* operator new(size_t size)
+{
+	n_allocations++;
+
+	void* p = std::malloc(size ? size : 1);
+	if(!p)
+		throw std::bad_alloc();
+
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+std::vector<char> generate_data(int n)
+{
+	std::vector<char> v;
+	for(int i = 0; i<n ; i++)
+		v.push_back(rand()%(UCHAR_MAX+1));
+
+	return v;
+}
+
+cv::Mat generate_frame(int rows, int cols, int type)
+{
+	cv::Mat frame(rows, cols, type);
+	for(int i = 0; i < frame.rows; i++){
+		uchar* ptr = frame.ptr<uchar>(i);
+		for(int j = 0; j < frame.cols*frame.channels(); j++)
+			ptr[j] = rand()%(UCHAR_MAX+1);
+	}
+
+	return frame;
+}
+
+void fail(const std::string& msg)
+{
+	std::cerr << msg << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+void check_stego(
+	const cv::Mat& stego,
+	const std::vector<char>& data,
+	const std::vector<char>& key)
+{
+	std::vector<char> extracted_data;
+	stegim::lsb_matching_extract(stego, extracted_data, data.size(), key);
+
+	if(data != extracted_data)
+		fail("Extracted data is different from embedded data!");
+}
+
+void test(int rows, int cols, int type)
+{
+	std::cout << "Geometry: " << rows << "x" << cols
+		<< "x" << CV_MAT_CN(type) << std::endl;
+
+	const int n_frames = 16;
+	std::vector<char> key = generate_data(10);
+
+	std::vector<cv::Mat> frames;
+	std::vector<std::vector<char>> data;
+	size_t n_bytes = 0;
+
+	stegim::stats stats;
+	stegim::lsb_matching_options lsbm_opt;
+	lsbm_opt.set_stats(&stats);
+
+	stegim::stream_context context(
+		stegim::cover_geometry(rows, cols, CV_MAT_CN(type)), key, lsbm_opt);
+
+	for(int i = 0; i < n_frames; i++){
+		frames.push_back(generate_frame(rows, cols, type));
+		data.push_back(generate_data(rand()%(context.capacity() + 1)));
+		n_bytes += data.back().size();
+	}
+
+	/*
+	 * the stegos are written in the two buffers of the context
+	 */
+	std::set<const uchar*> buffers;
+
+	for(int i = 0; i < n_frames; i++){
+		const cv::Mat& stego = context.process(frames[i], data[i]);
+		check_stego(stego, data[i], key);
+		buffers.insert(stego.data);
+	}
+
+	/*
+	 * double buffered submission, two frames in flight
+	 */
+	context.submit(frames[0], data[0]);
+	context.submit(frames[1], data[1]);
+	for(int i = 0; i < n_frames; i++){
+		const cv::Mat& stego = context.retrieve();
+		check_stego(stego, data[i], key);
+		buffers.insert(stego.data);
+
+		if(i + 2 < n_frames)
+			context.submit(frames[i + 2], data[i + 2]);
+	}
+
+	/*
+	 * back to the synchronous processing
+	 */
+	const cv::Mat& stego = context.process(frames[0], data[0]);
+	check_stego(stego, data[0], key);
+	buffers.insert(stego.data);
+
+	if(buffers.size() != 2)
+		fail("Stegos were not written in the context buffers!");
+
+	if(	stats.bytes_processed != 2*n_bytes + data[0].size() ||
+		stats.permutation_ns != 0)
+		fail("Wrong stream stats!");
+}
+
+/*
+ * the tiles of a frame are embedded by the threads of the context,
+ * so the frames after the first one are embedded without allocations
+ */
+void test_tiles(int type)
+{
+	std::cout << "Tiles: " << CV_MAT_CN(type) << " channels" << std::endl;
+
+	int rows = 64 + rand()%64, cols = 64 + rand()%64;
+	std::vector<char> key = generate_data(10);
+
+	stegim::lsb_matching_options lsbm_opt;
+	lsbm_opt.set_tile_size(16).set_threads(4);
+
+	stegim::stream_context context(
+		stegim::cover_geometry(rows, cols, CV_MAT_CN(type)), key, lsbm_opt);
+
+	const int n_frames = 8;
+	std::vector<cv::Mat> frames;
+	std::vector<std::vector<char>> data;
+	for(int i = 0; i < n_frames; i++){
+		frames.push_back(generate_frame(rows, cols, type));
+		data.push_back(generate_data(context.capacity()));
+	}
+
+	context.process(frames[0], data[0]);
+
+	size_t n_before = n_allocations;
+	for(int i = 1; i < n_frames; i++)
+		context.process(frames[i], data[i]);
+
+	context.submit(frames[0], data[0]);
+	context.submit(frames[1], data[1]);
+	context.retrieve();
+	const cv::Mat& stego = context.retrieve();
+	size_t n_after = n_allocations;
+
+	std::vector<char> extracted;
+	stegim::lsb_matching_extract(stego, extracted, data[1].size(), key, lsbm_opt);
+	if(extracted != data[1])
+		fail("Extracted data is different from embedded data!");
+
+	if(n_after != n_before)
+		fail("Embedding the tiles of a frame allocated memory!");
+}
+
+int main()
+{
+	srand(time(NULL));
+
+	test(1 + rand()%300, 1 + rand()%300, CV_8UC1);
+	test(1 + rand()%300, 1 + rand()%300, CV_8UC3);
+	test(1 + rand()%300, 1 + rand()%300, CV_8UC4);
+	test(1, 1, CV_8UC1);
+	test_tiles(CV_8UC1);
+	test_tiles(CV_8UC3);
+
+	return 0;
+}
@@ -0,0 +1,144 @@
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include "lsb.hpp"
+#include "lsb_matching.hpp"
+#include "pipeline.hpp"
+
+void usage(const char* name)
+{
+	std::cerr
+		<< "usage: " << name << " embed [options] <payload> <output dir> <image>..." << std::endl
+		<< "       " << name << " extract [options] <size> <output dir> <image>..." << std::endl
+		<< std::endl
+		<< "embed writes each stego image in <output dir> with the name of its cover," << std::endl
+		<< "extract writes <size> bytes of each image in <output dir>/<name>.bin" << std::endl
+		<< std::endl
+		<< "options:" << std::endl
+		<< "  -d <n>    decode threads (default 2)" << std::endl
+		<< "  -e <n>    embed or extract threads (default 1)" << std::endl
+		<< "  -w <n>    encode threads (default 2)" << std::endl
+		<< "  -q <n>    images queued between two stages (default 8)" << std::endl
+		<< "  -k <key>  use lsb matching with <key> instead of lsb" << std::endl;
+
+	exit(EXIT_FAILURE);
+}
+
+std::string base_name(const std::string& path)
+{
+	size_t slash = path.find_last_of('/');
+	return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+void print_report(const stegim::pipeline_report& report)
+{
+	std::cout << "stage\tthreads\titems\tbusy ms\tstall ms\titems/s" << std::endl;
+
+	for(const stegim::stage_report& s : report.stages)
+		std::cout
+			<< s.name << "\t"
+			<< s.n_threads << "\t"
+			<< s.items << "\t"
+			<< s.busy_ns/1000000 << "\t"
+			<< s.stall_ns/1000000 << "\t\t"
+			<< s.items_per_second() << std::endl;
+
+	std::cout << "wall " << report.wall_ns/1000000 << " ms, "
+		<< report.failed.size() << " failed" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+		usage(argv[0]);
+
+	std::string command(argv[1]);
+	if(command != "embed" && command != "extract")
+		usage(argv[0]);
+
+	stegim::pipeline_options pipe_opt;
+	std::string key;
+	bool lsbm = false;
+
+	optind = 2;
+	for(int opt; (opt = getopt(argc, argv, "d:e:w:q:k:")) != -1;){
+		switch(opt){
+		case 'd': pipe_opt.set_decode_threads(atoi(optarg)); break;
+		case 'e': pipe_opt.set_embed_threads(atoi(optarg)); break;
+		case 'w': pipe_opt.set_encode_threads(atoi(optarg)); break;
+		case 'q': pipe_opt.set_queue_size(atoi(optarg)); break;
+		case 'k': key = optarg; lsbm = true; break;
+		default: usage(argv[0]);
+		}
+	}
+
+	if(argc - optind < 3)
+		usage(argv[0]);
+
+	std::string argument(argv[optind]);
+	std::string output_dir(argv[optind + 1]);
+	std::vector<std::string> images(argv + optind + 2, argv + argc);
+
+	if(command == "embed"){
+		std::ifstream in(argument, std::ios::binary);
+		if(!in){
+			std::cerr << "Cannot open " << argument << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		std::vector<char> payload(
+			(std::istreambuf_iterator<char>(in)),
+			std::istreambuf_iterator<char>());
+
+		std::vector<stegim::pipeline_job> jobs(images.size());
+		for(size_t i = 0; i < images.size(); i++){
+			jobs[i].input = images[i];
+			jobs[i].output = output_dir + "/" + base_name(images[i]);
+			jobs[i].data = payload;
+		}
+
+		stegim::pipeline_report report = stegim::pipeline_embed(jobs,
+			[&](const cv::Mat& cover, cv::Mat& stego, const std::vector<char>& data){
+				if(lsbm)
+					stegim::lsb_matching_embed(cover, stego, data, key);
+				else
+					stegim::lsb_embed(cover, stego, data);
+			}, pipe_opt);
+
+		print_report(report);
+		return report.failed.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	int size = atoi(argument.c_str());
+	std::vector<std::vector<char>> data;
+
+	stegim::pipeline_report report = stegim::pipeline_extract(images, data,
+		[&](const cv::Mat& stego, std::vector<char>& d){
+			if(lsbm)
+				stegim::lsb_matching_extract(stego, d, size, key);
+			else
+				stegim::lsb_extract(stego, d, size);
+		}, pipe_opt);
+
+	std::vector<char> failed(images.size(), false);
+	for(size_t i : report.failed)
+		failed[i] = true;
+
+	for(size_t i = 0; i < images.size(); i++){
+		if(failed[i])
+			continue;
+
+		std::ofstream out(output_dir + "/" + base_name(images[i]) + ".bin",
+			std::ios::binary);
+		out.write(data[i].data(), data[i].size());
+	}
+
+	print_report(report);
+	return report.failed.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
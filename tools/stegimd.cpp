@@ -0,0 +1,68 @@
+#include <iostream>
+#include <string>
+
+#include <csignal>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include "service.hpp"
+
+stegim::service* running_service = nullptr;
+
+void usage(const char* name)
+{
+	std::cerr
+		<< "usage: " << name << " [options] <socket path>" << std::endl
+		<< std::endl
+		<< "serves lsb matching jobs on the Unix domain socket <socket path>" << std::endl
+		<< "until it receives SIGINT or SIGTERM" << std::endl
+		<< std::endl
+		<< "options:" << std::endl
+		<< "  -c <n>    permutations kept warm (default 16)" << std::endl
+		<< "  -t <n>    threads of each job, 0 for one per core (default 1)" << std::endl;
+
+	exit(EXIT_FAILURE);
+}
+
+void on_signal(int)
+{
+	if(running_service)
+		running_service->stop();
+}
+
+int main(int argc, char** argv)
+{
+	stegim::service_options service_opt;
+
+	for(int opt; (opt = getopt(argc, argv, "c:t:")) != -1;){
+		switch(opt){
+		case 'c': service_opt.set_cache_size(atoi(optarg)); break;
+		case 't': service_opt.set_threads(atoi(optarg)); break;
+		default: usage(argv[0]);
+		}
+	}
+
+	if(argc - optind != 1)
+		usage(argv[0]);
+
+	std::string socket_path(argv[optind]);
+	stegim::service service(socket_path, service_opt);
+	if(!service.listening()){
+		std::cerr << "Cannot listen on " << socket_path << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	running_service = &service;
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	std::cout << "listening on " << socket_path << std::endl;
+	service.run();
+
+	std::cout << "cache: " << service.cache_hits() << " hits, "
+		<< service.cache_misses() << " misses" << std::endl;
+
+	running_service = nullptr;
+	return EXIT_SUCCESS;
+}